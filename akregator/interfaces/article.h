@@ -53,6 +53,7 @@ namespace Akregator {
 
 namespace Backend
 {
+    class ArticleInfo;
     class FeedStorage;
 }
 
@@ -75,6 +76,10 @@ public:
             The constructor accesses the archive to load it's data
             */
         Article(const QString& guid, Feed* feed);
+        /** creates an article object for an existing article from data
+            already read from the archive, see Backend::FeedStorage::articleInfos()
+            */
+        Article(const Backend::ArticleInfo& info, Feed* feed, Backend::FeedStorage* archive);
         /** creates an article object from a parsed librss Article
             the article is added to the archive if not yet stored, or updated if stored but modified
         */
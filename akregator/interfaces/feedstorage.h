@@ -61,6 +61,20 @@ class Category
     }
 };
 
+/** the fields of an article which are loaded eagerly when a feed's articles are set up,
+    see FeedStorage::articleInfos() */
+class ArticleInfo
+{
+    public:
+
+    ArticleInfo() : status(0), hash(0), pubDate(0) {}
+
+    QString guid;
+    int status;
+    uint hash;
+    uint pubDate;
+};
+
 class Storage;
 
 class FeedStorage : public QObject
@@ -79,6 +93,10 @@ class FeedStorage : public QObject
         /** returns the guid of the articles in a given category */
         virtual QStringList articles(const Category& cat) const = 0;
 
+        /** returns guid, status, hash and publication date of all articles in this storage,
+            read in one pass over the archive instead of looking up every article per field */
+        virtual QList<ArticleInfo> articleInfos() const = 0;
+
         /** Appends all articles from another storage. If there is already an article in this feed with the same guid, it is replaced by the article from the source
         @param source the archive which articles should be appended
         */
@@ -31,14 +31,24 @@
 #include <syndication/item.h>
 
 #include <mk4.h>
+#include <mk4io.h>
 
 #include <qdom.h>
 #include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include <kdebug.h>
+#include <kde_file.h>
 #include <kglobal.h>
 #include <kstandarddirs.h>
 
+#include <cstdio>
+#ifndef Q_OS_WIN
+#include <unistd.h>
+#endif
+
 namespace {
 static uint calcHash(const QString& str)
 {
@@ -50,6 +60,15 @@ static uint calcHash(const QString& str)
     while ( ( c = *s++ ) ) hash = ((hash << 5) + hash) + c; // hash*33 + c
     return hash;
 }
+
+// the deleted flag of the article status, see Article
+static const int DELETED_STATUS = 0x01;
+
+// archives smaller than this are not worth compacting
+static const qint64 MINIMUM_COMPACTION_SIZE = 256 * 1024;
+
+// what an article needs besides its strings, roughly
+static const qint64 ARTICLE_OVERHEAD = 64;
 }
 
 
@@ -60,6 +79,7 @@ class FeedStorageMK4Impl::FeedStorageMK4ImplPrivate
 {
     public:
         FeedStorageMK4ImplPrivate() :
+            lock(QMutex::Recursive),
             modified(false),
             pguid("guid"),
             ptitle("title"),
@@ -90,7 +110,13 @@ class FeedStorageMK4Impl::FeedStorageMK4ImplPrivate
             pcategories("categories")
         {}
 
+        void openStorage();
+
         QString url;
+        QString archiveFile;
+        // guards storage and archiveView, which are committed in the
+        // commit thread of the main storage
+        QMutex lock;
         c4_Storage* storage;
         StorageMK4Impl* mainStorage;
         c4_View archiveView;
@@ -129,6 +155,16 @@ void FeedStorageMK4Impl::convertOldArchive()
     }
 }
 
+void FeedStorageMK4Impl::FeedStorageMK4ImplPrivate::openStorage()
+{
+    storage = new c4_Storage(archiveFile.toLocal8Bit(), true);
+
+    archiveView = storage->GetAs("articles[guid:S,title:S,hash:I,guidIsHash:I,guidIsPermaLink:I,description:S,link:S,comments:I,commentsLink:S,status:I,pubDate:I,tags[tag:S],hasEnclosure:I,enclosureUrl:S,enclosureType:S,enclosureLength:I,categories[catTerm:S,catScheme:S,catName:S],authorName:S,content:S,authorUri:S,authorEMail:S]");
+
+    c4_View hash = storage->GetAs("archiveHash[_H:I,_R:I]");
+    archiveView = archiveView.Hash(hash, 1); // hash on guid
+}
+
 FeedStorageMK4Impl::FeedStorageMK4Impl(const QString& url, StorageMK4Impl* main)
 {
     d = new FeedStorageMK4ImplPrivate;
@@ -149,12 +185,8 @@ FeedStorageMK4Impl::FeedStorageMK4Impl(const QString& url, StorageMK4Impl* main)
     QString filePath = main->archivePath() + '/' + t.replace('/', '_').replace(':', '_');
     d->oldArchivePath = KGlobal::dirs()->saveLocation("data", "akregator/Archive/") + t2.replace('/', '_').replace(':', '_') + ".xml";
     d->convert = !QFile::exists(filePath + ".mk4") && QFile::exists(d->oldArchivePath);
-    d->storage = new c4_Storage((filePath + ".mk4").toLocal8Bit(), true);
-
-    d->archiveView = d->storage->GetAs("articles[guid:S,title:S,hash:I,guidIsHash:I,guidIsPermaLink:I,description:S,link:S,comments:I,commentsLink:S,status:I,pubDate:I,tags[tag:S],hasEnclosure:I,enclosureUrl:S,enclosureType:S,enclosureLength:I,categories[catTerm:S,catScheme:S,catName:S],authorName:S,content:S,authorUri:S,authorEMail:S]");
-
-    c4_View hash = d->storage->GetAs("archiveHash[_H:I,_R:I]");
-    d->archiveView = d->archiveView.Hash(hash, 1); // hash on guid
+    d->archiveFile = filePath + ".mk4";
+    d->openStorage();
 }
 
 
@@ -166,16 +198,18 @@ FeedStorageMK4Impl::~FeedStorageMK4Impl()
 
 void FeedStorageMK4Impl::markDirty()
 {
+    QMutexLocker locker(&d->lock);
     if (!d->modified)
     {
         d->modified = true;
-        // Tell this to mainStorage
-        d->mainStorage->markDirty();
+        // Tell this to mainStorage, which commits us
+        d->mainStorage->markDirty(this);
     }
 }
 
 void FeedStorageMK4Impl::commit()
 {
+    QMutexLocker locker(&d->lock);
     if (d->modified)
     {
         d->storage->Commit();
@@ -185,9 +219,100 @@ void FeedStorageMK4Impl::commit()
 
 void FeedStorageMK4Impl::rollback()
 {
+    QMutexLocker locker(&d->lock);
     d->storage->Rollback();
 }
 
+bool FeedStorageMK4Impl::needsCompaction() const
+{
+    QMutexLocker locker(&d->lock);
+    const qint64 fileSize = QFileInfo(d->archiveFile).size();
+    if (fileSize < MINIMUM_COMPACTION_SIZE)
+        return false;
+
+    // what the articles take, the rest is free space left behind by
+    // removed and changed articles
+    qint64 liveSize = 0;
+    const c4_StringProp* strings[] = { &d->pguid, &d->ptitle, &d->pdescription, &d->pcontent, &d->plink,
+                                       &d->pcommentsLink, &d->pEnclosureUrl, &d->pEnclosureType,
+                                       &d->pauthorName, &d->pauthorUri, &d->pauthorEMail };
+    const int size = d->archiveView.GetSize();
+    for (int i = 0; i < size; ++i)
+    {
+        const c4_RowRef row = d->archiveView.GetAt(i);
+        liveSize += ARTICLE_OVERHEAD;
+        for (uint j = 0; j < sizeof(strings) / sizeof(strings[0]); ++j)
+            liveSize += qstrlen((*strings[j])(row));
+    }
+
+    return fileSize > 2 * liveSize;
+}
+
+bool FeedStorageMK4Impl::compact()
+{
+    QMutexLocker locker(&d->lock);
+
+    // what isn't committed yet must not get lost if the new file can't be used
+    commit();
+
+    // deleted articles are kept to not fetch them again, which needs
+    // nothing but their guid and status
+    const int size = d->archiveView.GetSize();
+    for (int i = 0; i < size; ++i)
+    {
+        c4_Row row = d->archiveView.GetAt(i);
+        if (!(d->pstatus(row) & DELETED_STATUS))
+            continue;
+        if (!d->pHasEnclosure(row) && d->pcategories(row).GetSize() == 0 && d->ptags(row).GetSize() == 0 && qstrlen(d->pcontent(row)) == 0)
+            continue;
+        d->pHasEnclosure(row) = false;
+        d->pEnclosureUrl(row) = "";
+        d->pEnclosureType(row) = "";
+        d->pEnclosureLength(row) = -1;
+        d->pcategories(row) = c4_View();
+        d->ptags(row) = c4_View();
+        d->pcontent(row) = "";
+        d->archiveView.SetAt(i, row);
+    }
+
+    // write what is left without the free space into a file of its own
+    const QString compactFile = d->archiveFile + ".compact";
+    FILE* file = KDE::fopen(compactFile, "wb");
+    if (!file)
+    {
+        kWarning() << "Could not create" << compactFile;
+        return false;
+    }
+    c4_FileStream stream(file);
+    d->storage->SaveTo(stream);
+    bool written = !ferror(file) && fflush(file) == 0;
+#ifndef Q_OS_WIN
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    fclose(file);
+    if (!written)
+    {
+        kWarning() << "Could not write" << compactFile;
+        QFile::remove(compactFile);
+        return false;
+    }
+
+    // and replace the archive with it, an interruption leaves either file
+    // in place
+    d->archiveView = c4_View();
+    delete d->storage;
+    d->storage = 0;
+    const bool replaced = KDE::rename(compactFile, d->archiveFile) == 0;
+    if (!replaced)
+    {
+        kWarning() << "Could not replace" << d->archiveFile;
+        QFile::remove(compactFile);
+    }
+    d->openStorage();
+    d->modified = false;
+    return replaced;
+}
+
 void FeedStorageMK4Impl::close()
 {
     if (d->autoCommit)
@@ -224,6 +349,7 @@ void FeedStorageMK4Impl::setLastFetch(int lastFetch)
 
 QStringList FeedStorageMK4Impl::articles(const QString& tag) const
 {
+    QMutexLocker locker(&d->lock);
     QStringList list;
 #if 0 //category and tag support disabled
     if (tag.isNull()) // return all articles
@@ -274,8 +400,28 @@ QStringList FeedStorageMK4Impl::articles(const Category& cat) const
     return list;
 }
 
+QList<ArticleInfo> FeedStorageMK4Impl::articleInfos() const
+{
+    QMutexLocker locker(&d->lock);
+    QList<ArticleInfo> list;
+    const int size = d->archiveView.GetSize();
+    list.reserve(size);
+    for (int i = 0; i < size; i++)
+    {
+        const c4_RowRef row = d->archiveView.GetAt(i);
+        ArticleInfo info;
+        info.guid = QString(d->pguid(row));
+        info.status = d->pstatus(row);
+        info.hash = d->phash(row);
+        info.pubDate = d->ppubDate(row);
+        list += info;
+    }
+    return list;
+}
+
 void FeedStorageMK4Impl::addEntry(const QString& guid)
 {
+    QMutexLocker locker(&d->lock);
     c4_Row row;
     d->pguid(row) = guid.toAscii();
     if (!contains(guid))
@@ -288,11 +434,13 @@ void FeedStorageMK4Impl::addEntry(const QString& guid)
 
 bool FeedStorageMK4Impl::contains(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     return findArticle(guid) != -1;
 }
 
 int FeedStorageMK4Impl::findArticle(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     c4_Row findrow;
     d->pguid(findrow) = guid.toAscii();
     return d->archiveView.Find(findrow);
@@ -300,6 +448,7 @@ int FeedStorageMK4Impl::findArticle(const QString& guid) const
 
 void FeedStorageMK4Impl::deleteArticle(const QString& guid)
 {
+    QMutexLocker locker(&d->lock);
 
     int findidx = findArticle(guid);
     if (findidx != -1)
@@ -315,30 +464,35 @@ void FeedStorageMK4Impl::deleteArticle(const QString& guid)
 
 int FeedStorageMK4Impl::comments(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? d->pcomments(d->archiveView.GetAt(findidx)) : 0;
 }
 
 QString FeedStorageMK4Impl::commentsLink(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
    int findidx = findArticle(guid);
    return findidx != -1 ? QString(d->pcommentsLink(d->archiveView.GetAt(findidx))) : "";
 }
 
 bool FeedStorageMK4Impl::guidIsHash(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? d->pguidIsHash(d->archiveView.GetAt(findidx)) : false;
 }
 
 bool FeedStorageMK4Impl::guidIsPermaLink(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? d->pguidIsPermaLink(d->archiveView.GetAt(findidx)) : false;
 }
 
 uint FeedStorageMK4Impl::hash(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? d->phash(d->archiveView.GetAt(findidx)) : 0;
 }
@@ -346,6 +500,7 @@ uint FeedStorageMK4Impl::hash(const QString& guid) const
 
 void FeedStorageMK4Impl::setDeleted(const QString& guid)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -369,24 +524,28 @@ void FeedStorageMK4Impl::setDeleted(const QString& guid)
 
 QString FeedStorageMK4Impl::link(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? QString(d->plink(d->archiveView.GetAt(findidx))) : "";
 }
 
 uint FeedStorageMK4Impl::pubDate(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? d->ppubDate(d->archiveView.GetAt(findidx)) : 0;
 }
 
 int FeedStorageMK4Impl::status(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? d->pstatus(d->archiveView.GetAt(findidx)) : 0;
 }
 
 void FeedStorageMK4Impl::setStatus(const QString& guid, int status)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -399,18 +558,21 @@ void FeedStorageMK4Impl::setStatus(const QString& guid, int status)
 
 QString FeedStorageMK4Impl::title(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? QString::fromUtf8(d->ptitle(d->archiveView.GetAt(findidx))) : "";
 }
 
 QString FeedStorageMK4Impl::description(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? QString::fromUtf8(d->pdescription(d->archiveView.GetAt(findidx))) : "";
 }
 
 QString FeedStorageMK4Impl::content(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? QString::fromUtf8(d->pcontent(d->archiveView.GetAt(findidx))) : "";
 }
@@ -418,6 +580,7 @@ QString FeedStorageMK4Impl::content(const QString& guid) const
 
 void FeedStorageMK4Impl::setPubDate(const QString& guid, uint pubdate)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -430,6 +593,7 @@ void FeedStorageMK4Impl::setPubDate(const QString& guid, uint pubdate)
 
 void FeedStorageMK4Impl::setGuidIsHash(const QString& guid, bool isHash)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -442,6 +606,7 @@ void FeedStorageMK4Impl::setGuidIsHash(const QString& guid, bool isHash)
 
 void FeedStorageMK4Impl::setLink(const QString& guid, const QString& link)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -454,6 +619,7 @@ void FeedStorageMK4Impl::setLink(const QString& guid, const QString& link)
 
 void FeedStorageMK4Impl::setHash(const QString& guid, uint hash)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -466,6 +632,7 @@ void FeedStorageMK4Impl::setHash(const QString& guid, uint hash)
 
 void FeedStorageMK4Impl::setTitle(const QString& guid, const QString& title)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -478,6 +645,7 @@ void FeedStorageMK4Impl::setTitle(const QString& guid, const QString& title)
 
 void FeedStorageMK4Impl::setDescription(const QString& guid, const QString& description)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -490,6 +658,7 @@ void FeedStorageMK4Impl::setDescription(const QString& guid, const QString& desc
 
 void FeedStorageMK4Impl::setContent(const QString& guid, const QString& content)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -502,6 +671,7 @@ void FeedStorageMK4Impl::setContent(const QString& guid, const QString& content)
 
 void FeedStorageMK4Impl::setAuthorName(const QString& guid, const QString& author)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -515,6 +685,7 @@ void FeedStorageMK4Impl::setAuthorName(const QString& guid, const QString& autho
 
 void FeedStorageMK4Impl::setAuthorUri(const QString& guid, const QString& author)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -528,6 +699,7 @@ void FeedStorageMK4Impl::setAuthorUri(const QString& guid, const QString& author
 
 void FeedStorageMK4Impl::setAuthorEMail(const QString& guid, const QString& author)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -540,18 +712,21 @@ void FeedStorageMK4Impl::setAuthorEMail(const QString& guid, const QString& auth
 
 QString FeedStorageMK4Impl::authorName(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? QString::fromUtf8(d->pauthorName(d->archiveView.GetAt(findidx))) : "";
 }
 
 QString FeedStorageMK4Impl::authorUri(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? QString::fromUtf8(d->pauthorUri(d->archiveView.GetAt(findidx))) : "";
 }
 
 QString FeedStorageMK4Impl::authorEMail(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     return findidx != -1 ? QString::fromUtf8(d->pauthorEMail(d->archiveView.GetAt(findidx))) : "";
 }
@@ -559,6 +734,7 @@ QString FeedStorageMK4Impl::authorEMail(const QString& guid) const
 
 void FeedStorageMK4Impl::setCommentsLink(const QString& guid, const QString& commentsLink)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -571,6 +747,7 @@ void FeedStorageMK4Impl::setCommentsLink(const QString& guid, const QString& com
 
 void FeedStorageMK4Impl::setComments(const QString& guid, int comments)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -584,6 +761,7 @@ void FeedStorageMK4Impl::setComments(const QString& guid, int comments)
 
 void FeedStorageMK4Impl::setGuidIsPermaLink(const QString& guid, bool isPermaLink)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -596,6 +774,7 @@ void FeedStorageMK4Impl::setGuidIsPermaLink(const QString& guid, bool isPermaLin
 
 void FeedStorageMK4Impl::addCategory(const QString& guid, const Category& cat)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -649,6 +828,7 @@ void FeedStorageMK4Impl::addCategory(const QString& guid, const Category& cat)
 
 QList<Category> FeedStorageMK4Impl::categories(const QString& guid) const
 {
+    QMutexLocker locker(&d->lock);
 
     QList<Category> list;
 
@@ -848,6 +1028,7 @@ void FeedStorageMK4Impl::copyArticle(const QString& guid, FeedStorage* source)
 
 void FeedStorageMK4Impl::setEnclosure(const QString& guid, const QString& url, const QString& type, int length)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -864,6 +1045,7 @@ void FeedStorageMK4Impl::setEnclosure(const QString& guid, const QString& url, c
 
 void FeedStorageMK4Impl::removeEnclosure(const QString& guid)
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
         return;
@@ -880,6 +1062,7 @@ void FeedStorageMK4Impl::removeEnclosure(const QString& guid)
 
 void FeedStorageMK4Impl::enclosure(const QString& guid, bool& hasEnclosure, QString& url, QString& type, int& length) const
 {
+    QMutexLocker locker(&d->lock);
     int findidx = findArticle(guid);
     if (findidx == -1)
     {
@@ -898,6 +1081,7 @@ void FeedStorageMK4Impl::enclosure(const QString& guid, bool& hasEnclosure, QStr
 
 void FeedStorageMK4Impl::clear()
 {
+    QMutexLocker locker(&d->lock);
     d->storage->RemoveAll();
 
     setUnread(0);
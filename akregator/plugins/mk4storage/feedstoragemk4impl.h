@@ -50,6 +50,8 @@ class FeedStorageMK4Impl : public FeedStorage
 
         QStringList articles(const Category& cat) const;
 
+        QList<ArticleInfo> articleInfos() const;
+
         bool contains(const QString& guid) const;
         void addEntry(const QString& guid);
         void deleteArticle(const QString& guid);
@@ -100,6 +102,15 @@ class FeedStorageMK4Impl : public FeedStorage
         void commit();
         void rollback();
 
+        /** returns whether the archive file is much larger than the articles in it */
+        bool needsCompaction() const;
+        /**
+         * Rewrites the archive into a fresh file without the free space left
+         * behind by removed and changed articles, and replaces the old one with it.
+         * @return true if the archive was replaced
+         */
+        bool compact();
+
         void convertOldArchive();
    private:
         void markDirty();
@@ -28,18 +28,68 @@
 #include <mk4.h>
 
 #include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
 #include <QString>
 #include <QStringList>
+#include <QThread>
 #include <QTimer>
+#include <QWaitCondition>
 
 #include <kdebug.h>
 #include <kstandarddirs.h>
 
 
+// how long changes are collected before they are committed
+static const int COMMIT_INTERVAL = 3000;
+
+// how long after opening the archives are checked for compaction
+static const int COMPACTION_DELAY = 5 * 60 * 1000;
+
 class Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate
 {
     public:
-        StorageMK4ImplPrivate() : modified(false),
+        /**
+         * Commits the archives handed to it one after the other, so that
+         * slow disks don't block the UI. Archives handed over again while
+         * they are waiting are committed once. Compactions run one archive
+         * at a time when there is nothing to commit.
+         */
+        class CommitThread : public QThread
+        {
+            public:
+                explicit CommitThread(StorageMK4ImplPrivate* storage);
+
+                void enqueue(const QSet<FeedStorageMK4Impl*>& feeds, bool index);
+                /** compacts @p feeds, unless @p onlyIfNeeded and they don't need it */
+                void enqueueCompaction(const QList<FeedStorageMK4Impl*>& feeds, bool onlyIfNeeded);
+                /** blocks until everything handed over so far is committed and compacted */
+                void waitForCommits();
+                /** commits what is left and ends the thread, pending compactions are dropped */
+                void stop();
+
+            protected:
+                void run();
+
+            private:
+                bool hasWork() const { return !m_feeds.isEmpty() || m_index || !m_compactions.isEmpty(); }
+
+                StorageMK4ImplPrivate* const m_storage;
+                QMutex m_mutex;
+                QWaitCondition m_workAvailable;
+                QWaitCondition m_idle;
+                QSet<FeedStorageMK4Impl*> m_feeds;
+                bool m_index;
+                // archive -> whether to check if it needs compaction first
+                QMap<FeedStorageMK4Impl*, bool> m_compactions;
+                bool m_busy;
+                bool m_stop;
+        };
+
+        StorageMK4ImplPrivate() : storage(0),
+            modified(false),
+            commitThread(this),
             purl("url"),
             pFeedList("feedList"),
             pTagSet("tagSet"),
@@ -47,11 +97,15 @@ class Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate
             ptotalCount("totalCount"),
             plastFetch("lastFetch") {}
 
+        // guards storage and archiveView, which are committed in the commit thread
+        mutable QMutex lock;
         c4_Storage* storage;
 	Akregator::Backend::StorageMK4Impl* q;
         c4_View archiveView;
         bool autoCommit;
         bool modified;
+        QSet<Akregator::Backend::FeedStorageMK4Impl*> dirtyFeeds;
+        CommitThread commitThread;
         mutable QMap<QString, Akregator::Backend::FeedStorageMK4Impl*> feeds;
         QStringList feedURLs;
         c4_StringProp purl, pFeedList, pTagSet;
@@ -62,8 +116,98 @@ class Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate
         c4_View feedListView;
 
         Akregator::Backend::FeedStorageMK4Impl* createFeedStorage( const QString& url );
+        void commitIndex();
 };
 
+Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate::CommitThread::CommitThread(StorageMK4ImplPrivate* storage)
+    : m_storage(storage), m_index(false), m_busy(false), m_stop(false)
+{
+}
+
+void Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate::CommitThread::enqueue(const QSet<FeedStorageMK4Impl*>& feeds, bool index)
+{
+    QMutexLocker locker(&m_mutex);
+    m_feeds += feeds;
+    m_index = m_index || index;
+    m_workAvailable.wakeOne();
+}
+
+void Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate::CommitThread::enqueueCompaction(const QList<FeedStorageMK4Impl*>& feeds, bool onlyIfNeeded)
+{
+    QMutexLocker locker(&m_mutex);
+    Q_FOREACH(FeedStorageMK4Impl* fs, feeds)
+        m_compactions[fs] = m_compactions.value(fs, onlyIfNeeded) && onlyIfNeeded;
+    m_workAvailable.wakeOne();
+}
+
+void Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate::CommitThread::waitForCommits()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_busy || (hasWork() && isRunning()))
+        m_idle.wait(&m_mutex);
+}
+
+void Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate::CommitThread::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stop = true;
+        m_workAvailable.wakeOne();
+    }
+    wait();
+    m_stop = false;
+}
+
+void Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate::CommitThread::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (true)
+    {
+        while (!hasWork() && !m_stop)
+            m_workAvailable.wait(&m_mutex);
+        if (m_stop)
+            m_compactions.clear();
+        if (!hasWork())
+            break;
+
+        if (m_feeds.isEmpty() && !m_index)
+        {
+            const QMap<FeedStorageMK4Impl*, bool>::Iterator it = m_compactions.begin();
+            FeedStorageMK4Impl* const fs = it.key();
+            const bool onlyIfNeeded = it.value();
+            m_compactions.erase(it);
+            m_busy = true;
+            locker.unlock();
+
+            if (!onlyIfNeeded || fs->needsCompaction())
+                fs->compact();
+
+            locker.relock();
+            m_busy = false;
+            m_idle.wakeAll();
+            continue;
+        }
+
+        const QSet<FeedStorageMK4Impl*> feeds = m_feeds;
+        const bool index = m_index;
+        m_feeds.clear();
+        m_index = false;
+        m_busy = true;
+        locker.unlock();
+
+        // every archive is a file of its own, committing one doesn't keep
+        // the others from being used
+        Q_FOREACH(FeedStorageMK4Impl* fs, feeds)
+            fs->commit();
+        if (index)
+            m_storage->commitIndex();
+
+        locker.relock();
+        m_busy = false;
+        m_idle.wakeAll();
+    }
+}
+
 Akregator::Backend::StorageMK4Impl::StorageMK4Impl() : d(new StorageMK4ImplPrivate)
 {
     d->q = this;
@@ -78,6 +222,7 @@ Akregator::Backend::FeedStorageMK4Impl* Akregator::Backend::StorageMK4Impl::Stor
         feeds[url] = fs;
         c4_Row findrow;
         purl(findrow) = url.toAscii();
+        QMutexLocker locker(&lock);
         int findidx = archiveView.Find(findrow);
         if (findidx == -1)
         {
@@ -87,11 +232,19 @@ Akregator::Backend::FeedStorageMK4Impl* Akregator::Backend::StorageMK4Impl::Stor
             archiveView.Add(findrow);
             modified = true;
         }
+        locker.unlock();
         fs->convertOldArchive();
     }
     return feeds[url];
 }
 
+void Akregator::Backend::StorageMK4Impl::StorageMK4ImplPrivate::commitIndex()
+{
+    QMutexLocker locker(&lock);
+    if (storage)
+        storage->Commit();
+}
+
 Akregator::Backend::FeedStorage* Akregator::Backend::StorageMK4Impl::archiveFor(const QString& url)
 {
     return d->createFeedStorage( url );
@@ -140,6 +293,9 @@ bool Akregator::Backend::StorageMK4Impl::open(bool autoCommit)
     filePath = d->archivePath +"/feedlistbackup.mk4";
     d->feedListStorage = new c4_Storage(filePath.toLocal8Bit(), true);
     d->feedListView = d->feedListStorage->GetAs("archive[feedList:S,tagSet:S]");
+
+    d->commitThread.start(QThread::LowPriority);
+    QTimer::singleShot(COMPACTION_DELAY, this, SLOT(slotCompact()));
     return true;
 }
 
@@ -150,6 +306,9 @@ bool Akregator::Backend::StorageMK4Impl::autoCommit() const
 
 bool Akregator::Backend::StorageMK4Impl::close()
 {
+    // let the commits already handed over finish before the archives go away
+    d->commitThread.stop();
+
     QMap<QString, FeedStorageMK4Impl*>::Iterator it;
     QMap<QString, FeedStorageMK4Impl*>::Iterator end(d->feeds.end() ) ;
     for (it = d->feeds.begin(); it != end; ++it)
@@ -157,6 +316,10 @@ bool Akregator::Backend::StorageMK4Impl::close()
         it.value()->close();
         delete it.value();
     }
+    d->feeds.clear();
+    d->dirtyFeeds.clear();
+    d->modified = false;
+
     if(d->autoCommit)
         d->storage->Commit();
 
@@ -172,27 +335,29 @@ bool Akregator::Backend::StorageMK4Impl::close()
 
 bool Akregator::Backend::StorageMK4Impl::commit()
 {
-    QMap<QString, FeedStorageMK4Impl*>::Iterator it;
-    QMap<QString, FeedStorageMK4Impl*>::Iterator end(d->feeds.end() ) ;
-    for ( it = d->feeds.begin(); it != end; ++it )
-        it.value()->commit();
+    if (!d->storage)
+        return false;
 
-    if(d->storage)
-    {
-        d->storage->Commit();
-        return true;
-    }
-
-    return false;
+    // the archives not marked dirty skip their commit
+    d->commitThread.enqueue(QSet<FeedStorageMK4Impl*>::fromList(d->feeds.values()), true);
+    d->dirtyFeeds.clear();
+    d->modified = false;
+    d->commitThread.waitForCommits();
+    return true;
 }
 
 bool Akregator::Backend::StorageMK4Impl::rollback()
 {
+    d->commitThread.waitForCommits();
+    d->dirtyFeeds.clear();
+    d->modified = false;
+
     QMap<QString, FeedStorageMK4Impl*>::Iterator it;
     QMap<QString, FeedStorageMK4Impl*>::Iterator end(d->feeds.end() ) ;
     for ( it = d->feeds.begin(); it != end; ++it )
         it.value()->rollback();
 
+    QMutexLocker locker(&d->lock);
     if(d->storage)
     {
         d->storage->Rollback();
@@ -203,6 +368,7 @@ bool Akregator::Backend::StorageMK4Impl::rollback()
 
 int Akregator::Backend::StorageMK4Impl::unreadFor(const QString &url) const
 {
+    QMutexLocker locker(&d->lock);
     c4_Row findrow;
     d->purl(findrow) = url.toAscii();
     int findidx = d->archiveView.Find(findrow);
@@ -212,6 +378,7 @@ int Akregator::Backend::StorageMK4Impl::unreadFor(const QString &url) const
 
 void Akregator::Backend::StorageMK4Impl::setUnreadFor(const QString &url, int unread)
 {
+    QMutexLocker locker(&d->lock);
     c4_Row findrow;
     d->purl(findrow) = url.toAscii();
     int findidx = d->archiveView.Find(findrow);
@@ -225,6 +392,7 @@ void Akregator::Backend::StorageMK4Impl::setUnreadFor(const QString &url, int un
 
 int Akregator::Backend::StorageMK4Impl::totalCountFor(const QString &url) const
 {
+    QMutexLocker locker(&d->lock);
     c4_Row findrow;
     d->purl(findrow) = url.toAscii();
     int findidx = d->archiveView.Find(findrow);
@@ -234,6 +402,7 @@ int Akregator::Backend::StorageMK4Impl::totalCountFor(const QString &url) const
 
 void Akregator::Backend::StorageMK4Impl::setTotalCountFor(const QString &url, int total)
 {
+    QMutexLocker locker(&d->lock);
     c4_Row findrow;
     d->purl(findrow) = url.toAscii();
     int findidx = d->archiveView.Find(findrow);
@@ -247,6 +416,7 @@ void Akregator::Backend::StorageMK4Impl::setTotalCountFor(const QString &url, in
 
 int Akregator::Backend::StorageMK4Impl::lastFetchFor(const QString& url) const
 {
+    QMutexLocker locker(&d->lock);
     c4_Row findrow;
     d->purl(findrow) = url.toAscii();
     int findidx = d->archiveView.Find(findrow);
@@ -256,6 +426,7 @@ int Akregator::Backend::StorageMK4Impl::lastFetchFor(const QString& url) const
 
 void Akregator::Backend::StorageMK4Impl::setLastFetchFor(const QString& url, int lastFetch)
 {
+    QMutexLocker locker(&d->lock);
     c4_Row findrow;
     d->purl(findrow) = url.toAscii();
     int findidx = d->archiveView.Find(findrow);
@@ -272,21 +443,42 @@ void Akregator::Backend::StorageMK4Impl::markDirty()
     if (!d->modified)
     {
         d->modified = true;
-        // commit changes after 3 seconds
-        QTimer::singleShot(3000, this, SLOT(slotCommit()));
+        // commit changes after 3 seconds, everything changing until then
+        // goes into the same commit
+        QTimer::singleShot(COMMIT_INTERVAL, this, SLOT(slotCommit()));
     }
 }
 
+void Akregator::Backend::StorageMK4Impl::markDirty(FeedStorageMK4Impl* feedStorage)
+{
+    d->dirtyFeeds.insert(feedStorage);
+    markDirty();
+}
+
+void Akregator::Backend::StorageMK4Impl::compact()
+{
+    if (d->storage)
+        d->commitThread.enqueueCompaction(d->feeds.values(), false);
+}
+
+void Akregator::Backend::StorageMK4Impl::slotCompact()
+{
+    if (d->storage)
+        d->commitThread.enqueueCompaction(d->feeds.values(), true);
+}
+
 void Akregator::Backend::StorageMK4Impl::slotCommit()
 {
-    if (d->modified)
-        commit();
+    if (d->modified && d->storage)
+        d->commitThread.enqueue(d->dirtyFeeds, true);
+    d->dirtyFeeds.clear();
     d->modified = false;
 }
 
 QStringList Akregator::Backend::StorageMK4Impl::feeds() const
 {
     // TODO: cache list
+    QMutexLocker locker(&d->lock);
     QStringList list;
     int size = d->archiveView.GetSize();
     for (int i = 0; i < size; i++)
@@ -311,10 +503,7 @@ void Akregator::Backend::StorageMK4Impl::add(Storage* source)
 
 void Akregator::Backend::StorageMK4Impl::clear()
 {
-   QStringList feeds;
-    int size = d->archiveView.GetSize();
-    for (int i = 0; i < size; i++)
-        feeds += QString(d->purl(d->archiveView.GetAt(i)));
+    const QStringList feeds = this->feeds();
     QStringList::ConstIterator end(feeds.constEnd() ) ;
 
     for (QStringList::ConstIterator it = feeds.constBegin(); it != end; ++it)
@@ -324,6 +513,7 @@ void Akregator::Backend::StorageMK4Impl::clear()
         fa->commit();
         // FIXME: delete file (should be 0 in size now)
     }
+    QMutexLocker locker(&d->lock);
     d->storage->RemoveAll();
 
 }
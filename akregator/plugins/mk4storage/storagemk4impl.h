@@ -31,6 +31,8 @@
 namespace Akregator {
 namespace Backend {
 
+class FeedStorageMK4Impl;
+
 /**
  * Metakit implementation of Storage interface
  */
@@ -68,6 +70,7 @@ class StorageMK4Impl : public Storage
 
         /**
          * Commit changes made in feeds and articles, making them persistent.
+         * Waits for the commits running in the background.
          * @return true on success.
          */
         bool commit();
@@ -114,10 +117,22 @@ class StorageMK4Impl : public Storage
         /** deletes all feed storages in this archive */
         void clear();
         
+        /** schedules a commit of the archive index in the background */
         void markDirty();
+        /** schedules a commit of @p feedStorage and the archive index in the background */
+        void markDirty(FeedStorageMK4Impl* feedStorage);
+
+        /**
+         * Rewrites the feed archives without the space left behind by removed
+         * and changed articles, in the background. Done some minutes after
+         * opening for the archives that have grown much larger than their
+         * articles.
+         */
+        void compact();
 
     protected slots:
         void slotCommit();
+        void slotCompact();
         
     private:
         class StorageMK4ImplPrivate;
@@ -0,0 +1,500 @@
+/*
+    This file is part of Akregator.
+
+    Copyright (C) 2010 the KDE PIM authors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+    As a special exception, permission is given to link this program
+    with any edition of Qt, and distribute the resulting executable,
+    without including the source code for Qt in the source distribution.
+*/
+
+#include "storagemk4impl.h"
+#include "feedstoragemk4impl.h"
+
+#include <qtest_kde.h>
+
+#include <ktempdir.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+using namespace Akregator::Backend;
+
+// the size of a full refresh in the benchmarks
+static const int FEED_COUNT = 100;
+static const int ARTICLE_COUNT = 20;
+
+// the size of the archives that have been fetched for a while
+static const int CHURN_FEED_COUNT = 10;
+static const int CHURN_ROUNDS = 10;
+
+// see Article
+static const int READ_STATUS = 0x08;
+static const int KEEP_STATUS = 0x10;
+static const int DELETED_READ_STATUS = 0x01 | READ_STATUS;
+
+static QString feedUrl( int feed )
+{
+    return QString::fromLatin1( "http://www.example.org/feed%1.rss" ).arg( feed );
+}
+
+static QString articleGuid( int feed, int article )
+{
+    return QString::fromLatin1( "feed%1-article%2" ).arg( feed ).arg( article );
+}
+
+static QString articleTitle( int feed, int article, int round )
+{
+    return QString::fromLatin1( "Article %1 of feed %2, round %3" ).arg( article ).arg( feed ).arg( round );
+}
+
+static QString articleDescription()
+{
+    return QString::fromLatin1( "A paragraph of text to give the article a realistic size. " ).repeated( 30 );
+}
+
+// what fetching the feeds writes to the archive
+static void writeFeeds( StorageMK4Impl* storage, int feeds, int articles, int round )
+{
+    const QString description = articleDescription();
+    for ( int feed = 0; feed < feeds; ++feed ) {
+        FeedStorage* fs = storage->archiveFor( feedUrl( feed ) );
+        for ( int article = 0; article < articles; ++article ) {
+            const QString guid = articleGuid( feed, article );
+            fs->addEntry( guid );
+            fs->setTitle( guid, articleTitle( feed, article, round ) );
+            fs->setDescription( guid, description );
+            fs->setPubDate( guid, 1262304000 + article );
+            fs->setStatus( guid, round );
+        }
+        fs->setUnread( articles - round );
+    }
+}
+
+// copies the archive files as a crash would leave them behind
+static void copyArchive( const QString& from, const QString& to )
+{
+    QDir().mkpath( to );
+    const QDir dir( from );
+    Q_FOREACH ( const QString& file, dir.entryList( QStringList() << QLatin1String( "*.mk4" ), QDir::Files ) ) {
+        QFile::remove( to + '/' + file );
+        QVERIFY( QFile::copy( from + '/' + file, to + '/' + file ) );
+    }
+}
+
+static void verifyFeeds( const QString& path, int feeds, int articles, int round )
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( path );
+    QVERIFY( storage.open( false ) );
+
+    for ( int feed = 0; feed < feeds; ++feed ) {
+        FeedStorage* fs = storage.archiveFor( feedUrl( feed ) );
+        QCOMPARE( fs->articles().count(), articles );
+        for ( int article = 0; article < articles; ++article ) {
+            const QString guid = articleGuid( feed, article );
+            QCOMPARE( fs->title( guid ), articleTitle( feed, article, round ) );
+            QCOMPARE( fs->status( guid ), round );
+        }
+        QCOMPARE( storage.unreadFor( feedUrl( feed ) ), articles - round );
+    }
+}
+
+// what fetching a feed for a while leaves in its archive: every round
+// brings new articles, the ones of the round before are deleted by the
+// user, and the ones deleted before that have left the feed and are purged
+static void churnFeed( StorageMK4Impl* storage, int feed, int rounds, int articles )
+{
+    const QString description = articleDescription();
+    FeedStorage* fs = storage->archiveFor( feedUrl( feed ) );
+    for ( int round = 0; round < rounds; ++round ) {
+        for ( int article = 0; article < articles; ++article ) {
+            const QString guid = articleGuid( feed, round * articles + article );
+            fs->addEntry( guid );
+            fs->setTitle( guid, articleTitle( feed, round * articles + article, round ) );
+            fs->setDescription( guid, description );
+            fs->setContent( guid, description );
+            fs->setEnclosure( guid, QLatin1String( "http://www.example.org/" ) + guid + QLatin1String( ".mp3" ), QLatin1String( "audio/mpeg" ), 1000 );
+            fs->setPubDate( guid, 1262304000 + round * articles + article );
+            fs->setStatus( guid, 0 );
+        }
+        for ( int article = 0; round > 0 && article < articles; ++article ) {
+            const QString guid = articleGuid( feed, ( round - 1 ) * articles + article );
+            fs->setStatus( guid, DELETED_READ_STATUS );
+            fs->setDeleted( guid );
+        }
+        for ( int article = 0; round > 1 && article < articles; ++article )
+            fs->deleteArticle( articleGuid( feed, ( round - 2 ) * articles + article ) );
+        fs->setUnread( articles );
+        QVERIFY( storage->commit() );
+    }
+}
+
+static void verifyChurnedFeed( const FeedStorage* fs, int feed, int rounds, int articles )
+{
+    QCOMPARE( fs->articles().count(), 2 * articles );
+    for ( int article = 0; article < articles; ++article ) {
+        const int live = ( rounds - 1 ) * articles + article;
+        QCOMPARE( fs->title( articleGuid( feed, live ) ), articleTitle( feed, live, rounds - 1 ) );
+        QCOMPARE( fs->description( articleGuid( feed, live ) ), articleDescription() );
+        QCOMPARE( fs->status( articleGuid( feed, live ) ), 0 );
+        bool hasEnclosure = false;
+        QString url, type;
+        int length = 0;
+        fs->enclosure( articleGuid( feed, live ), hasEnclosure, url, type, length );
+        QVERIFY( hasEnclosure );
+        QCOMPARE( length, 1000 );
+
+        // the deleted articles are kept, so that they are not fetched again
+        const QString deleted = articleGuid( feed, ( rounds - 2 ) * articles + article );
+        QVERIFY( fs->contains( deleted ) );
+        QCOMPARE( fs->status( deleted ), DELETED_READ_STATUS );
+        QVERIFY( fs->title( deleted ).isEmpty() );
+        QVERIFY( !fs->contains( articleGuid( feed, ( rounds - 3 ) * articles + article ) ) );
+    }
+}
+
+static qint64 archiveSize( const QString& path )
+{
+    qint64 size = 0;
+    const QDir dir( path );
+    Q_FOREACH ( const QFileInfo& file, dir.entryInfoList( QStringList() << QLatin1String( "*.mk4" ), QDir::Files ) )
+        size += file.size();
+    return size;
+}
+
+// what the article list needs when akregator starts
+static void loadFeeds( const QString& path, int feeds )
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( path );
+    QVERIFY( storage.open( false ) );
+    for ( int feed = 0; feed < feeds; ++feed ) {
+        const FeedStorage* fs = storage.archiveFor( feedUrl( feed ) );
+        Q_FOREACH ( const ArticleInfo& info, fs->articleInfos() )
+            fs->title( info.guid );
+    }
+}
+
+static void commitInBackground( StorageMK4Impl* storage )
+{
+    // what the commit timer does
+    QVERIFY( QMetaObject::invokeMethod( storage, "slotCommit", Qt::DirectConnection ) );
+}
+
+class StorageMK4ImplBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testCommit();
+    void testCommitInterval();
+    void testWritesDuringCommit();
+    void testClose();
+    void testArticleInfos();
+    void testCompaction();
+    void testWritesAfterCompaction();
+    void testBackgroundCompaction();
+    void benchmarkSynchronousCommit();
+    void benchmarkBackgroundCommit();
+    void benchmarkLoadChurned();
+    void benchmarkLoadCompacted();
+
+private:
+    QString archivePath() const { return m_dir->name() + QLatin1String( "archive" ); }
+    QString crashPath() const { return m_dir->name() + QLatin1String( "crash" ); }
+
+    KTempDir* m_dir;
+};
+
+QTEST_KDEMAIN( StorageMK4ImplBenchmark, NoGUI )
+
+void StorageMK4ImplBenchmark::init()
+{
+    m_dir = new KTempDir;
+    QVERIFY( QDir().mkpath( archivePath() ) );
+}
+
+void StorageMK4ImplBenchmark::cleanup()
+{
+    delete m_dir;
+    m_dir = 0;
+}
+
+void StorageMK4ImplBenchmark::testCommit()
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+
+    writeFeeds( &storage, 10, 10, 0 );
+    QVERIFY( storage.commit() );
+
+    // everything is on disk once commit() returns, without closing
+    copyArchive( archivePath(), crashPath() );
+    verifyFeeds( crashPath(), 10, 10, 0 );
+}
+
+void StorageMK4ImplBenchmark::testCommitInterval()
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+
+    writeFeeds( &storage, 10, 10, 1 );
+    QTest::qWait( 4000 );
+
+    // rolling back waits for the commit started by the timer, and only
+    // reverts what it didn't commit
+    QVERIFY( storage.rollback() );
+    copyArchive( archivePath(), crashPath() );
+    verifyFeeds( crashPath(), 10, 10, 1 );
+}
+
+void StorageMK4ImplBenchmark::testWritesDuringCommit()
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+
+    writeFeeds( &storage, 20, 10, 0 );
+    commitInBackground( &storage );
+
+    // the archives are written to while the thread commits them
+    writeFeeds( &storage, 20, 10, 1 );
+    commitInBackground( &storage );
+    writeFeeds( &storage, 20, 10, 2 );
+    QVERIFY( storage.commit() );
+
+    copyArchive( archivePath(), crashPath() );
+    verifyFeeds( crashPath(), 20, 10, 2 );
+
+    // nothing is left to roll back
+    QVERIFY( storage.rollback() );
+    FeedStorage* fs = storage.archiveFor( feedUrl( 7 ) );
+    QCOMPARE( fs->title( articleGuid( 7, 3 ) ), articleTitle( 7, 3, 2 ) );
+}
+
+void StorageMK4ImplBenchmark::testClose()
+{
+    {
+        StorageMK4Impl storage;
+        storage.setArchivePath( archivePath() );
+        QVERIFY( storage.open( true ) );
+
+        writeFeeds( &storage, 10, 10, 0 );
+        commitInBackground( &storage );
+        writeFeeds( &storage, 10, 10, 1 );
+        // closing, when the storage goes away, waits for the running
+        // commit and commits the rest
+    }
+
+    verifyFeeds( archivePath(), 10, 10, 1 );
+}
+
+void StorageMK4ImplBenchmark::testArticleInfos()
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+
+    writeFeeds( &storage, 1, 50, 1 );
+    FeedStorage* fs = storage.archiveFor( feedUrl( 0 ) );
+    for ( int article = 0; article < 50; article += 3 )
+        fs->setHash( articleGuid( 0, article ), 1000 + article );
+    fs->setStatus( articleGuid( 0, 7 ), DELETED_READ_STATUS );
+
+    // the bulk read has what the getters return
+    const QList<ArticleInfo> infos = fs->articleInfos();
+    QCOMPARE( infos.count(), 50 );
+    QSet<QString> guids;
+    Q_FOREACH ( const ArticleInfo& info, infos ) {
+        QCOMPARE( info.status, fs->status( info.guid ) );
+        QCOMPARE( info.hash, fs->hash( info.guid ) );
+        QCOMPARE( info.pubDate, fs->pubDate( info.guid ) );
+        guids.insert( info.guid );
+    }
+    QCOMPARE( guids, fs->articles().toSet() );
+}
+
+void StorageMK4ImplBenchmark::testCompaction()
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+
+    // small archives are left alone
+    FeedStorageMK4Impl* fs = static_cast<FeedStorageMK4Impl*>( storage.archiveFor( feedUrl( 0 ) ) );
+    writeFeeds( &storage, 1, 10, 0 );
+    QVERIFY( storage.commit() );
+    QVERIFY( !fs->needsCompaction() );
+
+    churnFeed( &storage, 1, CHURN_ROUNDS, ARTICLE_COUNT );
+    fs = static_cast<FeedStorageMK4Impl*>( storage.archiveFor( feedUrl( 1 ) ) );
+    const qint64 sizeBefore = archiveSize( archivePath() );
+
+    QVERIFY( fs->compact() );
+    const qint64 sizeAfter = archiveSize( archivePath() );
+    QVERIFY( sizeAfter < sizeBefore );
+    QVERIFY( !fs->needsCompaction() );
+    QVERIFY( !QFile::exists( archivePath() + QLatin1String( "/http___www.example.org_feed1.rss.mk4.compact" ) ) );
+
+    // the storage goes on with the new file
+    verifyChurnedFeed( fs, 1, CHURN_ROUNDS, ARTICLE_COUNT );
+    QCOMPARE( storage.unreadFor( feedUrl( 1 ) ), ARTICLE_COUNT );
+
+    // and so does the next start
+    copyArchive( archivePath(), crashPath() );
+    StorageMK4Impl reopened;
+    reopened.setArchivePath( crashPath() );
+    QVERIFY( reopened.open( false ) );
+    verifyChurnedFeed( reopened.archiveFor( feedUrl( 1 ) ), 1, CHURN_ROUNDS, ARTICLE_COUNT );
+    QCOMPARE( reopened.archiveFor( feedUrl( 0 ) )->title( articleGuid( 0, 3 ) ), articleTitle( 0, 3, 0 ) );
+}
+
+void StorageMK4ImplBenchmark::testWritesAfterCompaction()
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+
+    churnFeed( &storage, 0, CHURN_ROUNDS, ARTICLE_COUNT );
+    FeedStorageMK4Impl* fs = static_cast<FeedStorageMK4Impl*>( storage.archiveFor( feedUrl( 0 ) ) );
+
+    // uncommitted changes are kept when compacting
+    const QString liveGuid = articleGuid( 0, ( CHURN_ROUNDS - 1 ) * ARTICLE_COUNT );
+    fs->setTitle( liveGuid, QLatin1String( "Not committed" ) );
+    fs->setStatus( liveGuid, READ_STATUS );
+    QVERIFY( fs->compact() );
+    QCOMPARE( fs->title( liveGuid ), QString::fromLatin1( "Not committed" ) );
+    QCOMPARE( fs->status( liveGuid ), READ_STATUS );
+
+    fs->addEntry( QLatin1String( "new" ) );
+    fs->setTitle( QLatin1String( "new" ), QLatin1String( "Written after compacting" ) );
+    fs->setStatus( liveGuid, READ_STATUS | KEEP_STATUS );
+    QVERIFY( storage.commit() );
+
+    copyArchive( archivePath(), crashPath() );
+    StorageMK4Impl reopened;
+    reopened.setArchivePath( crashPath() );
+    QVERIFY( reopened.open( false ) );
+    const FeedStorage* copy = reopened.archiveFor( feedUrl( 0 ) );
+    QCOMPARE( copy->title( QLatin1String( "new" ) ), QString::fromLatin1( "Written after compacting" ) );
+    QCOMPARE( copy->title( liveGuid ), QString::fromLatin1( "Not committed" ) );
+    QCOMPARE( copy->status( liveGuid ), READ_STATUS | KEEP_STATUS );
+    QCOMPARE( copy->articles().count(), 2 * ARTICLE_COUNT + 1 );
+}
+
+void StorageMK4ImplBenchmark::testBackgroundCompaction()
+{
+    {
+        StorageMK4Impl storage;
+        storage.setArchivePath( archivePath() );
+        QVERIFY( storage.open( true ) );
+
+        for ( int feed = 0; feed < 3; ++feed )
+            churnFeed( &storage, feed, CHURN_ROUNDS, ARTICLE_COUNT );
+        const qint64 sizeBefore = archiveSize( archivePath() );
+
+        // the archives are written to while the thread compacts them
+        storage.compact();
+        writeFeeds( &storage, 3, 5, 1 );
+        QVERIFY( storage.commit() );
+        QVERIFY( archiveSize( archivePath() ) < sizeBefore );
+    }
+
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+    for ( int feed = 0; feed < 3; ++feed ) {
+        const FeedStorage* fs = storage.archiveFor( feedUrl( feed ) );
+        QCOMPARE( fs->articles().count(), 2 * ARTICLE_COUNT + 5 );
+        QCOMPARE( fs->title( articleGuid( feed, 4 ) ), articleTitle( feed, 4, 1 ) );
+    }
+}
+
+void StorageMK4ImplBenchmark::benchmarkSynchronousCommit()
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+
+    // a full refresh that waits for its commits, as the UI thread did before
+    int round = 0;
+    QBENCHMARK {
+        writeFeeds( &storage, FEED_COUNT, ARTICLE_COUNT, round % 2 );
+        QVERIFY( storage.commit() );
+        ++round;
+    }
+}
+
+void StorageMK4ImplBenchmark::benchmarkBackgroundCommit()
+{
+    StorageMK4Impl storage;
+    storage.setArchivePath( archivePath() );
+    QVERIFY( storage.open( false ) );
+
+    // the time the UI thread spends on a full refresh now
+    int round = 0;
+    QBENCHMARK {
+        writeFeeds( &storage, FEED_COUNT, ARTICLE_COUNT, round % 2 );
+        commitInBackground( &storage );
+        ++round;
+    }
+
+    QVERIFY( storage.commit() );
+}
+
+void StorageMK4ImplBenchmark::benchmarkLoadChurned()
+{
+    {
+        StorageMK4Impl storage;
+        storage.setArchivePath( archivePath() );
+        QVERIFY( storage.open( false ) );
+        for ( int feed = 0; feed < CHURN_FEED_COUNT; ++feed )
+            churnFeed( &storage, feed, CHURN_ROUNDS, ARTICLE_COUNT );
+    }
+    qDebug() << "archive size:" << archiveSize( archivePath() );
+
+    QBENCHMARK {
+        loadFeeds( archivePath(), CHURN_FEED_COUNT );
+    }
+}
+
+void StorageMK4ImplBenchmark::benchmarkLoadCompacted()
+{
+    {
+        StorageMK4Impl storage;
+        storage.setArchivePath( archivePath() );
+        QVERIFY( storage.open( false ) );
+        for ( int feed = 0; feed < CHURN_FEED_COUNT; ++feed )
+            churnFeed( &storage, feed, CHURN_ROUNDS, ARTICLE_COUNT );
+        storage.compact();
+        QVERIFY( storage.commit() );
+    }
+    qDebug() << "archive size:" << archiveSize( archivePath() );
+
+    QBENCHMARK {
+        loadFeeds( archivePath(), CHURN_FEED_COUNT );
+    }
+}
+
+#include "storagemk4implbenchmark.moc"
@@ -84,6 +84,7 @@ struct Article::Private : public Shared
 {
     Private();
     Private( const QString& guid, Feed* feed, Backend::FeedStorage* archive );
+    Private( const Backend::ArticleInfo& info, Feed* feed, Backend::FeedStorage* archive );
     Private( const ItemPtr& article, Feed* feed, Backend::FeedStorage* archive );
 
     /** The status of the article is stored in an int, the bits having the
@@ -151,6 +152,16 @@ Article::Private::Private( const QString& guid_, Feed* feed_, Backend::FeedStora
 {
 }
 
+Article::Private::Private( const Backend::ArticleInfo& info, Feed* feed_, Backend::FeedStorage* archive_ )
+  : feed( feed_ ),
+    guid( info.guid ),
+    archive( archive_ ),
+    status( info.status ),
+    hash( info.hash ),
+    pubDate( QDateTime::fromTime_t( info.pubDate ) )
+{
+}
+
 Article::Private::Private( const ItemPtr& article, Feed* feed_, Backend::FeedStorage* archive_ )
   : feed( feed_ ),
     archive( archive_ ),
@@ -242,6 +253,10 @@ Article::Article( const QString& guid, Feed* feed ) : d( new Private( guid, feed
 {
 }
 
+Article::Article( const Backend::ArticleInfo& info, Feed* feed, Backend::FeedStorage* archive ) : d( new Private( info, feed, archive ) )
+{
+}
+
 Article::Article( const ItemPtr& article, Feed* feed ) : d( new Private( article, feed, feed->storage()->archiveFor( feed->xmlUrl() ) ) )
 {
 }
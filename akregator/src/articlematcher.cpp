@@ -45,6 +45,56 @@ AbstractMatcher::AbstractMatcher() {}
 
 AbstractMatcher::~AbstractMatcher() {}
 
+bool AbstractMatcher::matchesFields(const ArticleFields& fields) const
+{
+    return matches(fields.article());
+}
+
+ArticleFields::ArticleFields( const Article &article )
+    : m_article( article )
+{
+}
+
+ArticleFields::~ArticleFields()
+{
+}
+
+const Article &ArticleFields::article() const
+{
+    return m_article;
+}
+
+QString ArticleFields::title() const
+{
+    return m_article.title();
+}
+
+QString ArticleFields::description() const
+{
+    return m_article.description();
+}
+
+QString ArticleFields::link() const
+{
+    // ### Maybe use prettyUrl here?
+    return m_article.link().url();
+}
+
+QString ArticleFields::authorName() const
+{
+    return m_article.authorName();
+}
+
+int ArticleFields::status() const
+{
+    return m_article.status();
+}
+
+bool ArticleFields::keep() const
+{
+    return m_article.keep();
+}
+
 QString Criterion::subjectToString(Subject subj)
 {
     switch (subj)
@@ -118,6 +168,7 @@ Criterion::Predicate Criterion::stringToPredicate(const QString& predStr)
 }
 
 Criterion::Criterion()
+    : m_objectInt( 0 )
 {
 }
 
@@ -126,7 +177,15 @@ Criterion::Criterion( Subject subject, Predicate predicate, const QVariant &obje
     , m_predicate( predicate )
     , m_object( object )
 {
+    compile();
+}
 
+void Criterion::compile()
+{
+    m_objectString = m_object.toString();
+    m_objectInt = m_object.toInt();
+    m_objectMatcher = QStringMatcher( m_objectString, Qt::CaseInsensitive );
+    m_objectRegExp = QRegExp( m_objectString );
 }
 
 void Criterion::writeConfig(KConfigGroup* config) const
@@ -150,56 +209,62 @@ void Criterion::readConfig(KConfigGroup* config)
     {
         m_object = config->readEntry(QString::fromLatin1("objectValue"), QVariant(type) );
     }
+    compile();
 }
 
-bool Criterion::satisfiedBy( const Article &article ) const
+QString Criterion::subjectString( const ArticleFields &fields ) const
 {
-    QVariant concreteSubject;
-
     switch ( m_subject ) {
         case Title:
-            concreteSubject = QVariant(article.title());
-            break;
+            return fields.title();
         case Description:
-            concreteSubject = QVariant(article.description());
-            break;
+            return fields.description();
         case Link:
-            // ### Maybe use prettyUrl here?
-            concreteSubject = QVariant(article.link().url());
-            break;
+            return fields.link();
         case Status:
-            concreteSubject = QVariant(article.status());
-            break;
+            return QString::number( fields.status() );
         case KeepFlag:
-            concreteSubject = QVariant(article.keep());
-            break;
+            // the way QVariant converts a bool
+            return fields.keep() ? QString::fromLatin1( "true" ) : QString::fromLatin1( "false" );
         case Author:
-            concreteSubject = QVariant(article.authorName());
+            return fields.authorName();
         default:
-            break;
+            return QString();
     }
+}
 
+bool Criterion::satisfiedBy( const Article &article ) const
+{
+    const ArticleFields fields( article );
+    return satisfiedBy( fields );
+}
+
+bool Criterion::satisfiedBy( const ArticleFields &fields ) const
+{
     bool satisfied = false;
 
     const Predicate predicateType = static_cast<Predicate>( m_predicate & ~Negation );
-	QString subjectType=concreteSubject.typeName();
 
-    switch ( predicateType ) {
-        case Contains:
-            satisfied = concreteSubject.toString().indexOf( m_object.toString(), 0, Qt::CaseInsensitive ) != -1;
-            break;
-        case Equals:
-            if (subjectType=="int")
-                satisfied = concreteSubject.toInt() == m_object.toInt();
-            else
-                satisfied = concreteSubject.toString() == m_object.toString();
-            break;
-        case Matches:
-            satisfied = QRegExp( m_object.toString() ).indexIn( concreteSubject.toString() ) != -1;
-            break;
-        default:
-            kDebug() <<"Internal inconsistency; predicateType should never be Negation";
-            break;
+    if ( m_subject == Status && predicateType == Equals ) {
+        // the status is the only subject compared as a number
+        satisfied = fields.status() == m_objectInt;
+    } else {
+        const QString concreteSubject = subjectString( fields );
+
+        switch ( predicateType ) {
+            case Contains:
+                satisfied = m_objectMatcher.indexIn( concreteSubject ) != -1;
+                break;
+            case Equals:
+                satisfied = concreteSubject == m_objectString;
+                break;
+            case Matches:
+                satisfied = m_objectRegExp.indexIn( concreteSubject ) != -1;
+                break;
+            default:
+                kDebug() <<"Internal inconsistency; predicateType should never be Negation";
+                break;
+        }
     }
 
     if ( m_predicate & Negation ) {
@@ -240,6 +305,12 @@ ArticleMatcher::ArticleMatcher( const QList<Criterion> &criteria, Association as
 }
 
 bool ArticleMatcher::matches( const Article &a ) const
+{
+    const ArticleFields fields( a );
+    return matchesFields( fields );
+}
+
+bool ArticleMatcher::matchesFields( const ArticleFields &a ) const
 {
     switch ( m_association ) {
         case LogicalOr:
@@ -302,7 +373,7 @@ bool ArticleMatcher::operator!=(const AbstractMatcher& other) const
     return !(*this == other);
 }
 
-bool ArticleMatcher::anyCriterionMatches( const Article &a ) const
+bool ArticleMatcher::anyCriterionMatches( const ArticleFields &a ) const
 {
     if (m_criteria.count()==0)
         return true;
@@ -316,7 +387,7 @@ bool ArticleMatcher::anyCriterionMatches( const Article &a ) const
     return false;
 }
 
-bool ArticleMatcher::allCriteriaMatch( const Article &a ) const
+bool ArticleMatcher::allCriteriaMatch( const ArticleFields &a ) const
 {
     if (m_criteria.count()==0)
         return true;
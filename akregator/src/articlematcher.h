@@ -30,7 +30,9 @@
 
 #include "akregator_export.h"
 #include <QList>
+#include <QRegExp>
 #include <QString>
+#include <QStringMatcher>
 #include <QVariant>
 
 class KConfigGroup;
@@ -42,6 +44,7 @@ class Article;
 namespace Filters {
 
 class AbstractMatcher;
+class ArticleFields;
 class Criterion;
 
 /** Abstract base class for matchers, a matcher just takes an article and checks whether the article matches some criterion or not. 
@@ -54,6 +57,10 @@ class AKREGATORPART_EXPORT AbstractMatcher
 
         virtual bool matches(const Article& article) const = 0;
 
+        /** matches against fields someone already has at hand, such as the
+         *  article list model. The default implementation matches the article. */
+        virtual bool matchesFields(const ArticleFields& fields) const;
+
         virtual void writeConfig(KConfigGroup* config) const = 0;
         virtual void readConfig(KConfigGroup* config) = 0;
 
@@ -69,6 +76,31 @@ class AKREGATORPART_EXPORT AbstractMatcher
 };
 
 
+/** The fields of an article the criteria look at. Reads them from the article,
+ *  subclasses can hand in copies kept elsewhere to spare the archive lookups.
+ */
+class AKREGATORPART_EXPORT ArticleFields
+{
+    public:
+        explicit ArticleFields( const Article &article );
+        virtual ~ArticleFields();
+
+        const Article &article() const;
+
+        virtual QString title() const;
+        virtual QString description() const;
+        virtual QString link() const;
+        virtual QString authorName() const;
+        virtual int status() const;
+        virtual bool keep() const;
+
+    private:
+        Q_DISABLE_COPY( ArticleFields )
+
+        const Article &m_article;
+};
+
+
 /** a powerful matcher supporting multiple criterions, which can be combined      via logical OR or AND
  *  @author Frerich Raabe
  */
@@ -86,6 +118,7 @@ class AKREGATORPART_EXPORT ArticleMatcher : public AbstractMatcher
         ~ArticleMatcher();
 
         bool matches(const Article &article) const;
+        bool matchesFields(const ArticleFields &fields) const;
         bool operator==(const AbstractMatcher &other) const;
         bool operator!=(const AbstractMatcher &other) const;
         
@@ -97,8 +130,8 @@ class AKREGATORPART_EXPORT ArticleMatcher : public AbstractMatcher
         static Association stringToAssociation(const QString& assocStr);
         static QString associationToString(Association association);
 
-        bool anyCriterionMatches( const Article &a ) const;
-        bool allCriteriaMatch( const Article &a ) const;
+        bool anyCriterionMatches( const ArticleFields &a ) const;
+        bool allCriteriaMatch( const ArticleFields &a ) const;
 
         QList<Criterion> m_criteria;
         Association m_association;
@@ -132,6 +165,7 @@ class AKREGATORPART_EXPORT Criterion
         Criterion( Subject subject, Predicate predicate, const QVariant &object );
         virtual ~Criterion(){} 
         bool satisfiedBy( const Article &article ) const;
+        bool satisfiedBy( const ArticleFields &fields ) const;
 
         virtual void writeConfig(KConfigGroup* config) const;
         virtual void readConfig(KConfigGroup* config);
@@ -143,9 +177,19 @@ class AKREGATORPART_EXPORT Criterion
         { return m_subject == other.m_subject && m_predicate == other.m_predicate && m_object == other.m_object; }
         
     private:
+        /** prepares the object for matching, called whenever it changes */
+        void compile();
+        /** returns the subject of @p fields in the string form the predicates compare against */
+        QString subjectString( const ArticleFields &fields ) const;
+
         Subject m_subject;
         Predicate m_predicate;
         QVariant m_object;
+
+        QString m_objectString;
+        int m_objectInt;
+        QStringMatcher m_objectMatcher;
+        QRegExp m_objectRegExp;
 };
 
 } // namespace Filters
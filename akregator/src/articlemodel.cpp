@@ -30,6 +30,7 @@
 
 #include <syndication/tools.h>
 
+#include <QHash>
 #include <QMimeData>
 #include <QString>
 #include <QVector>
@@ -44,13 +45,128 @@
 
 using namespace Akregator;
 
+//like Syndication::htmlToPlainText, but without linebreaks
+
+static QString stripHtml( const QString& html ) {
+    QString str(html);
+    //TODO: preserve some formatting, such as line breaks
+    str.remove(QRegExp("<[^>]*>")); // remove tags
+    str = Syndication::resolveEntities(str);
+    return str.simplified();
+}
+
+namespace {
+
+// hands out one id per distinct string, so that the articles of a feed share
+// their author and repeated titles are stored once. Every intern() has to be
+// matched by a release(); a string is dropped and its id reused once it is no
+// longer referenced.
+class StringPool {
+public:
+    // @p added is set if @p str was not in the pool before
+    int intern( const QString& str, bool* added = 0 )
+    {
+        const QHash<QString, int>::const_iterator it = m_ids.constFind( str );
+        if ( it != m_ids.constEnd() ) {
+            ++m_refs[it.value()];
+            if ( added )
+                *added = false;
+            return it.value();
+        }
+        int id;
+        if ( m_free.isEmpty() ) {
+            id = m_strings.count();
+            m_strings.append( str );
+            m_refs.append( 1 );
+        } else {
+            id = m_free.back();
+            m_free.pop_back();
+            m_strings[id] = str;
+            m_refs[id] = 1;
+        }
+        m_ids.insert( str, id );
+        if ( added )
+            *added = true;
+        return id;
+    }
+
+    // returns whether the string was dropped
+    bool release( int id )
+    {
+        if ( --m_refs[id] > 0 )
+            return false;
+        m_ids.remove( m_strings[id] );
+        m_strings[id].clear();
+        m_free.append( id );
+        return true;
+    }
+
+    const QString& at( int id ) const { return m_strings[id]; }
+
+    // the number of ids handed out, including free ones
+    int size() const { return m_strings.count(); }
+
+    void clear()
+    {
+        m_ids.clear();
+        m_strings.clear();
+        m_refs.clear();
+        m_free.clear();
+    }
+
+private:
+    QHash<QString, int> m_ids;
+    QVector<QString> m_strings;
+    QVector<int> m_refs;
+    QVector<int> m_free;
+};
+
+}
+
 class ArticleModel::Private {
 private:
     ArticleModel* const q;
 public:
+    enum RowFlag {
+        StatusMask = 0x03,
+        Keep = 0x04,
+        Deleted = 0x08,
+        Null = 0x10
+    };
+
+    class RowFields;
+
     Private( const QList<Article>& articles, ArticleModel* qq );
     QList<Article> articles;
-    QVector<QString> titleCache;
+
+    // The fields the list sorts and filters on, one entry per row. They are
+    // read once when an article is added or updated, so that sorting and
+    // filtering don't have to go to the archive for every comparison.
+    QVector<quint8> flags;
+    QVector<uint> pubDates;
+    QVector<Feed*> feeds;
+    QVector<int> titleIds;
+    QVector<int> authorNameIds;
+    QVector<int> authorShortIds;
+    StringPool titles;
+    QVector<QString> plainTitles; // indexed by title id
+    StringPool authors;
+
+    QHash<QString, int> rowsByGuid;
+
+    // While rows are removed, the rows from gapStart on are stored gapSize
+    // entries further back, behind the rows already taken out.
+    int gapStart;
+    int gapSize;
+
+    int rowCount() const { return articles.count() - gapSize; }
+    int storedRow( int row ) const { return row < gapStart ? row : row + gapSize; }
+
+    void resize( int count );
+    void readRow( int row );
+    void releaseRow( int row );
+    void moveRow( int from, int to );
+    void rebuildRowsByGuid();
 
     void articlesAdded( const QList<Article>& );
     void articlesRemoved( const QList<Article>& );
@@ -58,22 +174,115 @@ public:
 
 };
 
-//like Syndication::htmlToPlainText, but without linebreaks
+class ArticleModel::Private::RowFields : public Filters::ArticleFields
+{
+public:
+    RowFields( const ArticleModel::Private* d, int row )
+        : Filters::ArticleFields( d->articles[row] ), m_d( d ), m_row( row ) {}
 
-static QString stripHtml( const QString& html ) {
-    QString str(html);
-    //TODO: preserve some formatting, such as line breaks
-    str.remove(QRegExp("<[^>]*>")); // remove tags
-    str = Syndication::resolveEntities(str);
-    return str.simplified();
-}
+    QString title() const { return m_d->titles.at( m_d->titleIds[m_row] ); }
+    // descriptions are large and only needed when searching, so they are
+    // not kept in the model
+    QString description() const { return m_d->articles[m_row].description(); }
+    QString authorName() const { return m_d->authors.at( m_d->authorNameIds[m_row] ); }
+    int status() const { return m_d->flags[m_row] & StatusMask; }
+    bool keep() const { return ( m_d->flags[m_row] & Keep ) != 0; }
+
+private:
+    const ArticleModel::Private* const m_d;
+    const int m_row;
+};
 
 ArticleModel::Private::Private( const QList<Article>& articles_, ArticleModel* qq )
- : q( qq ), articles( articles_ )
+ : q( qq ), articles( articles_ ), gapStart( 0 ), gapSize( 0 )
 {
-    titleCache.resize( articles.count() );
+    resize( articles.count() );
     for ( int i = 0; i < articles.count(); ++i )
-        titleCache[i] = stripHtml( articles[i].title() );
+        readRow( i );
+    rebuildRowsByGuid();
+}
+
+void ArticleModel::Private::resize( int count )
+{
+    const int oldCount = flags.count();
+    flags.resize( count );
+    pubDates.resize( count );
+    feeds.resize( count );
+    titleIds.resize( count );
+    authorNameIds.resize( count );
+    authorShortIds.resize( count );
+    // new rows don't reference any strings yet
+    for ( int i = oldCount; i < count; ++i )
+        titleIds[i] = authorNameIds[i] = authorShortIds[i] = -1;
+}
+
+void ArticleModel::Private::readRow( int row )
+{
+    const Article& article = articles[row];
+    releaseRow( row );
+
+    if ( article.isNull() ) {
+        flags[row] = Null;
+        pubDates[row] = 0;
+        feeds[row] = 0;
+        titleIds[row] = authorNameIds[row] = authorShortIds[row] = -1;
+        return;
+    }
+
+    quint8 f = article.status() & StatusMask;
+    if ( article.keep() )
+        f |= Keep;
+    if ( article.isDeleted() )
+        f |= Deleted;
+    flags[row] = f;
+    pubDates[row] = article.pubDate().toTime_t();
+    feeds[row] = article.feed();
+
+    bool added;
+    const int titleId = titles.intern( article.title(), &added );
+    if ( added ) {
+        plainTitles.resize( titles.size() );
+        plainTitles[titleId] = stripHtml( titles.at( titleId ) );
+    }
+    titleIds[row] = titleId;
+
+    const QString authorName = article.authorName();
+    authorNameIds[row] = authors.intern( authorName );
+    // authorShort() falls back to the email and uri only if there is no name
+    authorShortIds[row] = authorName.isEmpty() ? authors.intern( article.authorShort() ) : authorNameIds[row];
+}
+
+void ArticleModel::Private::releaseRow( int row )
+{
+    if ( titleIds[row] < 0 )
+        return;
+    if ( titles.release( titleIds[row] ) )
+        plainTitles[titleIds[row]].clear();
+    // the short author was interned separately if there is no name
+    if ( authors.at( authorNameIds[row] ).isEmpty() )
+        authors.release( authorShortIds[row] );
+    authors.release( authorNameIds[row] );
+    titleIds[row] = authorNameIds[row] = authorShortIds[row] = -1;
+}
+
+void ArticleModel::Private::moveRow( int from, int to )
+{
+    articles[to] = articles[from];
+    flags[to] = flags[from];
+    pubDates[to] = pubDates[from];
+    feeds[to] = feeds[from];
+    titleIds[to] = titleIds[from];
+    authorNameIds[to] = authorNameIds[from];
+    authorShortIds[to] = authorShortIds[from];
+}
+
+void ArticleModel::Private::rebuildRowsByGuid()
+{
+    rowsByGuid.clear();
+    rowsByGuid.reserve( articles.count() );
+    // like QList::indexOf(), the first of several articles with the same guid wins
+    for ( int i = articles.count() - 1; i >= 0; --i )
+        rowsByGuid.insert( articles[i].guid(), i );
 }
 
 Akregator::ArticleModel::ArticleModel(const QList<Article>& articles, QObject* parent) : QAbstractTableModel( parent ), d( new Private( articles, this ) )
@@ -92,7 +301,7 @@ int Akregator::ArticleModel::columnCount( const QModelIndex& parent ) const
 
 int Akregator::ArticleModel::rowCount( const QModelIndex& parent ) const
 {
-    return parent.isValid() ? 0 : d->articles.count();
+    return parent.isValid() ? 0 : d->rowCount();
 }
 
 QVariant Akregator::ArticleModel::headerData( int section, Qt::Orientation, int role ) const
@@ -121,62 +330,62 @@ QVariant Akregator::ArticleModel::headerData( int section, Qt::Orientation, int
 
 QVariant Akregator::ArticleModel::data( const QModelIndex& index, int role ) const
 {
-    if ( !index.isValid() || index.row() < 0 || index.row() >= d->articles.count() )
+    if ( !index.isValid() || index.row() < 0 || index.row() >= d->rowCount() )
         return QVariant();
-    const int row = index.row();
-    const Akregator::Article& article( d->articles[row] );
+    const int row = d->storedRow( index.row() );
+    const quint8 flags = d->flags[row];
 
-    if ( article.isNull() )
+    if ( flags & Private::Null )
         return QVariant();
 
     switch ( role )
     {
         case SortRole:
             if ( index.column() == DateColumn )
-                return article.pubDate();
+                return d->pubDates[row];
             // no break
         case Qt::DisplayRole:
         {
             switch ( index.column() )
             {
                 case FeedTitleColumn:
-                    return article.feed() ? article.feed()->title() : QVariant();
+                    return d->feeds[row] ? d->feeds[row]->title() : QVariant();
                 case DateColumn:
-                    return KGlobal::locale()->formatDateTime(article.pubDate(),
+                    return KGlobal::locale()->formatDateTime(d->articles[row].pubDate(),
                                                              KLocale::FancyShortDate );
                 case ItemTitleColumn:
-                    return d->titleCache[row];
+                    return d->plainTitles[d->titleIds[row]];
                 case AuthorColumn:
-                    return article.authorShort();
+                    return d->authors.at( d->authorShortIds[row] );
                 case DescriptionColumn:
                 case ContentColumn:
-                    return article.description();
+                    return d->articles[row].description();
             }
         }
         case LinkRole:
         {
-            return article.link();
+            return d->articles[row].link();
         }
         case ItemIdRole:
         case GuidRole:
         {
-            return article.guid();
+            return d->articles[row].guid();
         }
         case FeedIdRole:
         {
-            return article.feed() ? article.feed()->xmlUrl() : QVariant();
+            return d->feeds[row] ? d->feeds[row]->xmlUrl() : QVariant();
         }
         case StatusRole:
         {
-            return article.status();
+            return flags & Private::StatusMask;
         }
         case IsImportantRole:
         {
-            return article.keep();
+            return ( flags & Private::Keep ) != 0;
         }
         case IsDeletedRole:
         {
-            return article.isDeleted();
+            return ( flags & Private::Deleted ) != 0;
         }
     }
 
@@ -186,7 +395,11 @@ QVariant Akregator::ArticleModel::data( const QModelIndex& index, int role ) con
 void ArticleModel::clear()
 {
     d->articles.clear();
-    d->titleCache.clear();
+    d->resize( 0 );
+    d->titles.clear();
+    d->plainTitles.clear();
+    d->authors.clear();
+    d->rowsByGuid.clear();
     reset();
 }
 
@@ -210,21 +423,63 @@ void ArticleModel::Private::articlesAdded( const QList<Article>& list )
 
     const int oldSize = articles.size();
     articles << list;
-    titleCache.resize( articles.count() );
-    for ( int i = oldSize; i < articles.count(); ++i )
-        titleCache[i] = Syndication::htmlToPlainText( articles[i].title() );
+    resize( articles.count() );
+    for ( int i = oldSize; i < articles.count(); ++i ) {
+        readRow( i );
+        const QString guid = articles[i].guid();
+        if ( !rowsByGuid.contains( guid ) )
+            rowsByGuid.insert( guid, i );
+    }
     q->endInsertRows();
 }
 
 void ArticleModel::Private::articlesRemoved( const QList<Article>& list )
 {
-    //might want to avoid indexOf() in case of performance problems
+    QList<int> rows;
     Q_FOREACH ( const Article& i, list )
     {
-        const int row = articles.indexOf( i );
+        const int row = rowsByGuid.value( i.guid(), -1 );
         assert( row != -1 );
-        q->removeRow( row, QModelIndex() );
+        if ( row != -1 )
+            rows.append( row );
     }
+    if ( rows.isEmpty() )
+        return;
+
+    // One pass from the front: the rows that stay are moved forward over
+    // those removed, and every run of adjacent rows is announced as one
+    // range. Until the pass is done, the rows not yet moved are found
+    // through the gap, so the model is consistent at every signal.
+    qSort( rows );
+    const int count = articles.count();
+    int read = 0;
+    int write = 0;
+    int i = 0;
+    while ( i < rows.count() )
+    {
+        const int first = rows[i];
+        int last = first;
+        while ( i < rows.count() && rows[i] <= last + 1 )
+            last = std::max( last, rows[i++] );
+
+        for ( ; read < first; ++read, ++write )
+            moveRow( read, write );
+        gapStart = write;
+        gapSize = read - write;
+
+        q->beginRemoveRows( QModelIndex(), write, write + last - first );
+        for ( ; read <= last; ++read )
+            releaseRow( read );
+        gapSize = read - write;
+        q->endRemoveRows();
+    }
+    for ( ; read < count; ++read, ++write )
+        moveRow( read, write );
+    gapStart = gapSize = 0;
+
+    articles.erase( articles.begin() + write, articles.end() );
+    resize( write );
+    rebuildRowsByGuid();
 }
 
 
@@ -236,15 +491,14 @@ void ArticleModel::Private::articlesUpdated( const QList<Article>& list )
     if ( articles.count() > 0 )
     {
          rmin = articles.count() - 1;
-        //might want to avoid indexOf() in case of performance problems
         Q_FOREACH ( const Article& i, list )
         {
-            const int row = articles.indexOf( i );
+            const int row = rowsByGuid.value( i.guid(), -1 );
             //TODO: figure out how why the Article might not be found in
             //TODO: the articles list because we should need this conditional.
             if ( row >= 0 )
             {
-                titleCache[row] = Syndication::htmlToPlainText( articles[row].title() );
+                readRow( row );
                 rmin = std::min( row, rmin );
                 rmax = std::max( row, rmax );
             }
@@ -257,14 +511,17 @@ void ArticleModel::Private::articlesUpdated( const QList<Article>& list )
 bool ArticleModel::rowMatches( int row, const boost::shared_ptr<const Akregator::Filters::AbstractMatcher>& matcher ) const
 {
     assert( matcher );
-    return matcher->matches( article( row ) );
+    if ( row < 0 || row >= d->rowCount() || ( d->flags[d->storedRow( row )] & Private::Null ) )
+        return matcher->matches( article( row ) );
+    const Private::RowFields fields( d, d->storedRow( row ) );
+    return matcher->matchesFields( fields );
 }
 
 Article ArticleModel::article( int row ) const
 {
-    if ( row < 0 || row >= d->articles.count() )
+    if ( row < 0 || row >= d->rowCount() )
         return Article();
-    return d->articles[row];
+    return d->articles[d->storedRow( row )];
 }
 
 QStringList ArticleModel::mimeTypes() const
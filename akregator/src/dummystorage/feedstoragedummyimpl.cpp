@@ -150,6 +150,24 @@ QStringList FeedStorageDummyImpl::articles(const Category& cat) const
     return d->categorizedArticles.value(cat);
 }
 
+QList<ArticleInfo> FeedStorageDummyImpl::articleInfos() const
+{
+    QList<ArticleInfo> list;
+    list.reserve(d->entries.count());
+    QHash<QString, FeedStorageDummyImplPrivate::Entry>::ConstIterator it = d->entries.constBegin();
+    const QHash<QString, FeedStorageDummyImplPrivate::Entry>::ConstIterator end = d->entries.constEnd();
+    for ( ; it != end; ++it)
+    {
+        ArticleInfo info;
+        info.guid = it.key();
+        info.status = it.value().status;
+        info.hash = it.value().hash;
+        info.pubDate = it.value().pubDate;
+        list += info;
+    }
+    return list;
+}
+
 void FeedStorageDummyImpl::addEntry(const QString& guid)
 {
     if (!d->entries.contains(guid))
@@ -50,6 +50,8 @@ class FeedStorageDummyImpl : public FeedStorage
 
         virtual QStringList articles(const Category& cat) const;
 
+        virtual QList<ArticleInfo> articleInfos() const;
+
 
         virtual bool contains(const QString& guid) const;
         virtual void addEntry(const QString& guid);
@@ -54,10 +54,14 @@
 #include <QIcon>
 #include <QList>
 #include <QPixmap>
+#include <QSet>
 #include <QTimer>
+#include <QVector>
 
 #include <boost/bind.hpp>
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 
 using Syndication::ItemPtr;
@@ -95,8 +99,19 @@ class Feed::Private
         /** list of feed articles */
         QHash<QString, Article> articles;
 
-        /** list of deleted articles. This contains **/
-        QList<Article> deletedArticles;
+        /** deleted articles by guid. This contains **/
+        QHash<QString, Article> deletedArticles;
+
+        /** articles with status New by guid, reset to Unread when fetching */
+        QHash<QString, Article> newArticles;
+
+        /** guids of the articles which are not deleted and have the keep flag set */
+        QSet<QString> keptArticles;
+
+        /** the articles which are not deleted, with the oldest one on top. Entries
+            of articles deleted or replaced since are dropped when they come up. */
+        QVector<Article> evictionHeap;
+        void addEvictionCandidate( const Article& a );
 
         /** caches guids of deleted articles for notification */
 
@@ -109,6 +124,10 @@ class Feed::Private
         QIcon favicon;
         mutable int totalCount;
         void setTotalCountDirty() const { totalCount = -1; }
+        void adjustTotalCount( int delta ) const { if ( totalCount != -1 ) totalCount += delta; }
+
+        /** caches the unread count of the archive, -1 if not read yet */
+        mutable int unread;
 };
 
 QString Feed::archiveModeToString(ArchiveMode mode)
@@ -233,14 +252,25 @@ void Feed::loadArticles()
     if (!d->archive)
         d->archive = d->storage->archiveFor(xmlUrl());
 
-    QStringList list = d->archive->articles();
-    for ( QStringList::ConstIterator it = list.constBegin(); it != list.constEnd(); ++it)
+    const QList<Backend::ArticleInfo> list = d->archive->articleInfos();
+    d->articles.reserve(list.count());
+    d->evictionHeap.reserve(list.count());
+    for ( QList<Backend::ArticleInfo>::ConstIterator it = list.constBegin(); it != list.constEnd(); ++it)
     {
-        Article mya(*it, this);
+        Article mya(*it, this, d->archive);
         d->articles[mya.guid()] = mya;
         if (mya.isDeleted())
-            d->deletedArticles.append(mya);
+        {
+            d->deletedArticles.insert(mya.guid(), mya);
+            continue;
+        }
+        if (mya.status() == New)
+            d->newArticles.insert(mya.guid(), mya);
+        if (mya.keep())
+            d->keptArticles.insert(mya.guid());
+        d->evictionHeap.append(mya);
     }
+    std::make_heap(d->evictionHeap.begin(), d->evictionHeap.end());
 
     d->articlesLoaded = true;
     enforceLimitArticleNumber();
@@ -249,23 +279,23 @@ void Feed::loadArticles()
 
 void Feed::recalcUnreadCount()
 {
-    QList<Article> tarticles = articles();
-    QList<Article>::ConstIterator it;
-    QList<Article>::ConstIterator en = tarticles.constEnd();
-
-    int oldUnread = d->archive->unread();
-
+    // only needed once after loading, status changes adjust the counts from then on
     int unread = 0;
+    int total = 0;
 
-    for (it = tarticles.constBegin(); it != en; ++it)
-        if (!(*it).isDeleted() && (*it).status() != Read)
-            ++unread;
-
-    if (unread != oldUnread)
+    QHash<QString, Article>::ConstIterator it = d->articles.constBegin();
+    const QHash<QString, Article>::ConstIterator en = d->articles.constEnd();
+    for ( ; it != en; ++it)
     {
-        d->archive->setUnread(unread);
-        nodeModified();
+        if ((*it).isDeleted())
+            continue;
+        ++total;
+        if ((*it).status() != Read)
+            ++unread;
     }
+
+    d->totalCount = total;
+    setUnread(unread);
 }
 
 Feed::ArchiveMode Feed::stringToArchiveMode(const QString& str)
@@ -284,6 +314,28 @@ Feed::ArchiveMode Feed::stringToArchiveMode(const QString& str)
     return globalDefault;
 }
 
+void Feed::Private::addEvictionCandidate( const Article& a )
+{
+    // get rid of the entries left behind by deleted and replaced articles
+    // once they make up most of the heap
+    const int live = articles.count() - deletedArticles.count();
+    if ( evictionHeap.count() > 2 * live + 64 )
+    {
+        evictionHeap.clear();
+        QHash<QString, Article>::ConstIterator it = articles.constBegin();
+        const QHash<QString, Article>::ConstIterator en = articles.constEnd();
+        for ( ; it != en; ++it)
+        {
+            if ( !(*it).isDeleted() && (*it).guid() != a.guid() )
+                evictionHeap.append(*it);
+        }
+        std::make_heap(evictionHeap.begin(), evictionHeap.end());
+    }
+
+    evictionHeap.append(a);
+    std::push_heap(evictionHeap.begin(), evictionHeap.end());
+}
+
 Feed::Private::Private( Backend::Storage* storage_, Feed* qq )
   : q( qq ),
     storage( storage_ ),
@@ -302,7 +354,8 @@ Feed::Private::Private( Backend::Storage* storage_, Feed* qq )
     loader( 0 ),
     articlesLoaded( false ),
     archive( 0 ),
-    totalCount( -1 )
+    totalCount( -1 ),
+    unread( -1 )
 {
     assert( q );
     assert( storage );
@@ -461,7 +514,6 @@ void Feed::slotAddFeedIconListener()
 
 void Feed::appendArticles(const Syndication::FeedPtr feed)
 {
-    d->setTotalCountDirty();
     bool changed = false;
     const bool notify = useNotification() || Settings::useNotifications();
 
@@ -472,7 +524,7 @@ void Feed::appendArticles(const Syndication::FeedPtr feed)
 
     int nudge=0;
 
-    QList<Article> deletedArticles = d->deletedArticles;
+    QHash<QString, Article> deletedArticles = d->deletedArticles;
 
     for ( ; it != en; ++it)
     {
@@ -504,6 +556,7 @@ void Feed::appendArticles(const Syndication::FeedPtr feed)
                 old.setStatus(Read);
 
                 d->articles.remove(old.guid());
+                d->adjustTotalCount(-1);
                 appendArticle(mya);
 
                 mya.setStatus(oldstatus);
@@ -512,27 +565,26 @@ void Feed::appendArticles(const Syndication::FeedPtr feed)
                 changed = true;
             }
             else if (old.isDeleted())
-                deletedArticles.removeAll(mya);
+                deletedArticles.remove(mya.guid());
         }
     }
 
 
-    QList<Article>::ConstIterator dit = deletedArticles.constBegin();
-    QList<Article>::ConstIterator dtmp;
-    QList<Article>::ConstIterator den = deletedArticles.constEnd();
+    QHash<QString, Article>::ConstIterator dit = deletedArticles.constBegin();
+    const QHash<QString, Article>::ConstIterator den = deletedArticles.constEnd();
 
     // delete articles with delete flag set completely from archive, which aren't in the current feed source anymore
-    while (dit != den)
+    for ( ; dit != den; ++dit)
     {
-        dtmp = dit;
-        ++dit;
-        d->articles.remove((*dtmp).guid());
-        d->archive->deleteArticle((*dtmp).guid());
-        d->removedArticlesNotify.append( *dtmp );
+        d->articles.remove(dit.key());
+        d->archive->deleteArticle(dit.key());
+        d->removedArticlesNotify.append( *dit );
         changed = true;
-        d->deletedArticles.removeAll(*dtmp);
+        d->deletedArticles.remove(dit.key());
     }
 
+    enforceLimitArticleNumber();
+
     if (changed)
         articlesModified();
 }
@@ -563,8 +615,17 @@ void Feed::appendArticle(const Article& a)
         if (!d->articles.contains(a.guid()))
         {
             d->articles[a.guid()] = a;
-            if (!a.isDeleted() && a.status() != Read)
-                setUnread(unread()+1);
+            if (!a.isDeleted())
+            {
+                d->adjustTotalCount(+1);
+                if (a.keep())
+                    d->keptArticles.insert(a.guid());
+                d->addEvictionCandidate(a);
+                if (a.status() == New)
+                    d->newArticles.insert(a.guid(), a);
+                if (a.status() != Read)
+                    setUnread(unread()+1);
+            }
         }
     }
 }
@@ -576,7 +637,7 @@ void Feed::fetch(bool followDiscovery)
     d->fetchTries = 0;
 
     // mark all new as unread
-    QList<Article> articles = d->articles.values();
+    QList<Article> articles = d->newArticles.values();
     QList<Article>::Iterator it;
     QList<Article>::Iterator en = articles.end();
     for (it = articles.begin(); it != en; ++it)
@@ -746,13 +807,18 @@ void Feed::setArchiveMode(ArchiveMode archiveMode)
 
 int Feed::unread() const
 {
-    return d->archive ? d->archive->unread() : 0;
+    if (!d->archive)
+        return 0;
+    if (d->unread == -1)
+        d->unread = d->archive->unread();
+    return d->unread;
 }
 
 void Feed::setUnread(int unread)
 {
-    if (d->archive && unread != d->archive->unread())
+    if (d->archive && unread != Feed::unread())
     {
+        d->unread = unread;
         d->archive->setUnread(unread);
         nodeModified();
     }
@@ -761,9 +827,12 @@ void Feed::setUnread(int unread)
 
 void Feed::setArticleDeleted(Article& a)
 {
-    d->setTotalCountDirty();
-    if (!d->deletedArticles.contains(a))
-        d->deletedArticles.append(a);
+    if (!d->deletedArticles.contains(a.guid()))
+    {
+        d->deletedArticles.insert(a.guid(), a);
+        d->keptArticles.remove(a.guid());
+        d->adjustTotalCount(-1);
+    }
 
     d->updatedArticlesNotify.append(a);
     articlesModified();
@@ -774,11 +843,19 @@ void Feed::setArticleChanged(Article& a, int oldStatus)
     if (oldStatus != -1)
     {
         int newStatus = a.status();
+        if (newStatus == New)
+            d->newArticles.insert(a.guid(), a);
+        else if (oldStatus == New)
+            d->newArticles.remove(a.guid());
         if (oldStatus == Read && newStatus != Read)
             setUnread(unread()+1);
         else if (oldStatus != Read && newStatus == Read)
             setUnread(unread()-1);
     }
+    if (a.keep() && !a.isDeleted())
+        d->keptArticles.insert(a.guid());
+    else
+        d->keptArticles.remove(a.guid());
     d->updatedArticlesNotify.append(a);
     articlesModified();
 }
@@ -860,26 +937,48 @@ void Feed::enforceLimitArticleNumber()
     else if (d->archiveMode == limitArticleNumber)
         limit = maxArticleNumber();
 
-    if (limit == -1 || limit >= d->articles.count() - d->deletedArticles.count())
+    if (limit == -1)
         return;
 
-    QList<Article> articles = d->articles.values();
-    qSort(articles);
-
-    int c = 0;
+    // articles kept as important neither count nor expire
     const bool useKeep = Settings::doNotExpireImportantArticles();
+    int excess = d->articles.count() - d->deletedArticles.count() - limit;
+    if (useKeep)
+        excess -= d->keptArticles.count();
+    if (excess <= 0)
+        return;
 
-    Q_FOREACH ( Article i, articles )
+    // delete the oldest articles until the limit is met
+    QList<Article> kept;
+    QSet<QString> seen;
+    while (excess > 0 && !d->evictionHeap.isEmpty())
     {
-        if (c < limit)
+        std::pop_heap(d->evictionHeap.begin(), d->evictionHeap.end());
+        const Article entry = d->evictionHeap.last();
+        d->evictionHeap.pop_back();
+
+        const QHash<QString, Article>::ConstIterator it = d->articles.constFind(entry.guid());
+        if (it == d->articles.constEnd() || (*it).isDeleted() || (*it).pubDate() != entry.pubDate())
+            continue;
+        if (seen.contains(entry.guid()))
+            continue;
+        seen.insert(entry.guid());
+
+        Article article = *it;
+        if (useKeep && article.keep())
         {
-            if ( !i.isDeleted() && ( !useKeep || !i.keep() ) )
-                ++c;
-        }
-        else if ( !useKeep || !i.keep() )
-        {
-            i.setDeleted();
+            kept.append(article);
+            continue;
         }
+        article.setDeleted();
+        --excess;
+    }
+
+    // the important ones may lose their keep flag later
+    Q_FOREACH (const Article& article, kept)
+    {
+        d->evictionHeap.append(article);
+        std::push_heap(d->evictionHeap.begin(), d->evictionHeap.end());
     }
 }
 
@@ -50,6 +50,8 @@ class Folder::FolderPrivate
         QList<TreeNode*> children;
         /** caching unread count of children */
         mutable int unread;
+        /** caching total count of children */
+        mutable int totalCount;
         /** whether or not the folder is expanded */
         bool open;
 
@@ -59,7 +61,7 @@ class Folder::FolderPrivate
         QList<Article> removedArticlesNotify;
 };
 
-Folder::FolderPrivate::FolderPrivate( Folder* qq ) : q( qq ), unread( 0 ), open( false )
+Folder::FolderPrivate::FolderPrivate( Folder* qq ) : q( qq ), unread( 0 ), totalCount( 0 ), open( false )
 {
 }
 
@@ -201,6 +203,7 @@ void Folder::insertChild(int index, TreeNode* node)
         node->setParent(this);
         connectToNode(node);
         updateUnreadCount();
+        updateTotalCount();
         emit signalChildAdded(node);
         d->addedArticlesNotify += node->articles();
         articlesModified();
@@ -218,6 +221,7 @@ void Folder::appendChild(TreeNode* node)
         node->setParent(this);
         connectToNode(node);
         updateUnreadCount();
+        updateTotalCount();
         emit signalChildAdded(node);
         d->addedArticlesNotify += node->articles();
         articlesModified();
@@ -235,6 +239,7 @@ void Folder::prependChild(TreeNode* node)
         node->setParent(this);
         connectToNode(node);
         updateUnreadCount();
+        updateTotalCount();
         emit signalChildAdded(node);
         d->addedArticlesNotify += node->articles();
         articlesModified();
@@ -253,6 +258,7 @@ void Folder::removeChild(TreeNode* node)
     d->children.removeAll(node);
     disconnectFromNode(node);
     updateUnreadCount();
+    updateTotalCount();
     emit signalChildRemoved(this, node);
     d->removedArticlesNotify += node->articles();
     articlesModified(); // articles were removed, TODO: add guids to a list
@@ -297,20 +303,27 @@ int Folder::unread() const
 
 int Folder::totalCount() const
 {
-    int total = 0;
-    Q_FOREACH( const Feed* const i, feeds() )
-        total += i->totalCount();
-    return total;
+    return d->totalCount;
 }
 
 void Folder::updateUnreadCount() const
 {
+    // child folders keep their own count up to date, no need to visit the whole subtree
     int unread = 0;
-    Q_FOREACH ( const Feed* const i, feeds() )
+    Q_FOREACH ( const TreeNode* const i, d->children )
         unread += i->unread();
     d->unread = unread;
 }
 
+void Folder::updateTotalCount() const
+{
+    // as for the unread count, child folders keep their own total up to date
+    int total = 0;
+    Q_FOREACH ( const TreeNode* const i, d->children )
+        total += i->totalCount();
+    d->totalCount = total;
+}
+
 KJob* Folder::createMarkAsReadJob()
 {
     std::auto_ptr<CompositeJob> job( new CompositeJob );
@@ -322,6 +335,7 @@ KJob* Folder::createMarkAsReadJob()
 void Folder::slotChildChanged(TreeNode* /*node*/)
 {
     updateUnreadCount();
+    updateTotalCount();
     nodeModified();
 }
 
@@ -329,9 +343,15 @@ void Folder::slotChildDestroyed(TreeNode* node)
 {
     d->children.removeAll(node);
     updateUnreadCount();
+    updateTotalCount();
     nodeModified();
 }
 
+void Folder::slotChildArticlesChanged()
+{
+    updateTotalCount();
+}
+
 bool Folder::subtreeContains( const TreeNode* node ) const
 {
     if ( node == this )
@@ -361,6 +381,10 @@ void Folder::connectToNode(TreeNode* child)
 {
     connect(child, SIGNAL(signalChanged(Akregator::TreeNode*)), this, SLOT(slotChildChanged(Akregator::TreeNode*)));
     connect(child, SIGNAL(signalDestroyed(Akregator::TreeNode*)), this, SLOT(slotChildDestroyed(Akregator::TreeNode*)));
+    // connected before the signals are passed on, so that the parent sees the new total
+    connect(child, SIGNAL(signalArticlesAdded(Akregator::TreeNode*, QList<Akregator::Article>)), this, SLOT(slotChildArticlesChanged()));
+    connect(child, SIGNAL(signalArticlesRemoved(Akregator::TreeNode*, QList<Akregator::Article>)), this, SLOT(slotChildArticlesChanged()));
+    connect(child, SIGNAL(signalArticlesUpdated(Akregator::TreeNode*, QList<Akregator::Article>)), this, SLOT(slotChildArticlesChanged()));
     connect(child, SIGNAL(signalArticlesAdded(Akregator::TreeNode*, QList<Akregator::Article>)), this, SIGNAL(signalArticlesAdded(Akregator::TreeNode*, QList<Akregator::Article>)));
     connect(child, SIGNAL(signalArticlesRemoved(Akregator::TreeNode*, QList<Akregator::Article>)), this, SIGNAL(signalArticlesRemoved(Akregator::TreeNode*, QList<Akregator::Article>)));
     connect(child, SIGNAL(signalArticlesUpdated(Akregator::TreeNode*, QList<Akregator::Article>)), this, SIGNAL(signalArticlesUpdated(Akregator::TreeNode*, QList<Akregator::Article>)));
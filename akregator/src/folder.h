@@ -184,6 +184,11 @@ class AKREGATOR_EXPORT Folder : public TreeNode
         @param queue a fetch queue */
         void slotAddToFetchQueue(Akregator::FetchQueue* queue, bool intervalFetchesOnly=false);
 
+    private slots:
+
+        /** Called when articles of a child were added, removed or updated. */
+        void slotChildArticlesChanged();
+
     protected:
 
         /** inserts @c node as child on position @c index
@@ -200,6 +205,7 @@ class AKREGATOR_EXPORT Folder : public TreeNode
         void disconnectFromNode(TreeNode* child);
 
         void updateUnreadCount() const;
+        void updateTotalCount() const;
 
         class FolderPrivate;
         FolderPrivate* d;
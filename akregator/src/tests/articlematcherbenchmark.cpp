@@ -0,0 +1,325 @@
+/*
+    This file is part of Akregator.
+
+    Copyright (C) 2010 the KDE PIM authors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+    As a special exception, permission is given to link this program
+    with any edition of Qt, and distribute the resulting executable,
+    without including the source code for Qt in the source distribution.
+*/
+
+#include "article.h"
+#include "articlematcher.h"
+#include "types.h"
+
+#include <qtest_kde.h>
+
+#include <kconfig.h>
+#include <kconfiggroup.h>
+
+#include <QRegExp>
+
+using namespace Akregator;
+using namespace Akregator::Filters;
+
+// the number of articles in the benchmarked list
+static const int ARTICLE_COUNT = 20000;
+
+static const Article& nullArticle()
+{
+    static const Article article;
+    return article;
+}
+
+// fields handed in directly, without an archive behind them
+class FixedFields : public ArticleFields
+{
+public:
+    FixedFields( const QString& title, const QString& description, const QString& link,
+                 const QString& authorName, int status, bool keep )
+        : ArticleFields( nullArticle() ), m_title( title ), m_description( description ), m_link( link ),
+          m_authorName( authorName ), m_status( status ), m_keep( keep ) {}
+
+    QString title() const { return m_title; }
+    QString description() const { return m_description; }
+    QString link() const { return m_link; }
+    QString authorName() const { return m_authorName; }
+    int status() const { return m_status; }
+    bool keep() const { return m_keep; }
+
+private:
+    QString m_title;
+    QString m_description;
+    QString m_link;
+    QString m_authorName;
+    int m_status;
+    bool m_keep;
+};
+
+// what Criterion::satisfiedBy() did before the criteria were precompiled
+static bool referenceSatisfiedBy( Criterion::Subject subject, int predicate, const QVariant& object,
+                                  const ArticleFields& fields )
+{
+    QVariant concreteSubject;
+
+    switch ( subject ) {
+        case Criterion::Title:
+            concreteSubject = QVariant( fields.title() );
+            break;
+        case Criterion::Description:
+            concreteSubject = QVariant( fields.description() );
+            break;
+        case Criterion::Link:
+            concreteSubject = QVariant( fields.link() );
+            break;
+        case Criterion::Status:
+            concreteSubject = QVariant( fields.status() );
+            break;
+        case Criterion::KeepFlag:
+            concreteSubject = QVariant( fields.keep() );
+            break;
+        case Criterion::Author:
+            concreteSubject = QVariant( fields.authorName() );
+            break;
+        default:
+            break;
+    }
+
+    bool satisfied = false;
+
+    const int predicateType = predicate & ~Criterion::Negation;
+    const QString subjectType = concreteSubject.typeName();
+
+    switch ( predicateType ) {
+        case Criterion::Contains:
+            satisfied = concreteSubject.toString().indexOf( object.toString(), 0, Qt::CaseInsensitive ) != -1;
+            break;
+        case Criterion::Equals:
+            if ( subjectType == "int" )
+                satisfied = concreteSubject.toInt() == object.toInt();
+            else
+                satisfied = concreteSubject.toString() == object.toString();
+            break;
+        case Criterion::Matches:
+            satisfied = QRegExp( object.toString() ).indexIn( concreteSubject.toString() ) != -1;
+            break;
+        default:
+            break;
+    }
+
+    if ( predicate & Criterion::Negation )
+        satisfied = !satisfied;
+
+    return satisfied;
+}
+
+static QList<Criterion::Subject> subjects()
+{
+    return QList<Criterion::Subject>() << Criterion::Title << Criterion::Description << Criterion::Link
+                                       << Criterion::Status << Criterion::KeepFlag << Criterion::Author;
+}
+
+static QList<int> predicates()
+{
+    QList<int> predicates;
+    Q_FOREACH ( const int predicate, QList<int>() << Criterion::Contains << Criterion::Equals << Criterion::Matches ) {
+        predicates << predicate;
+        predicates << ( predicate | Criterion::Negation );
+    }
+    return predicates;
+}
+
+// objects as the filter dialog and old configs hand them in
+static QList<QVariant> objects()
+{
+    return QList<QVariant>()
+        << QVariant( QString() ) << QVariant( QString::fromLatin1( "kde" ) ) << QVariant( QString::fromLatin1( "KDE" ) )
+        << QVariant( QString::fromLatin1( "KDE 4.5 released" ) ) << QVariant( QString::fromLatin1( "^Akregator" ) )
+        << QVariant( QString::fromLatin1( "[0-9]+\\.[0-9]" ) ) << QVariant( QString::fromLatin1( "(" ) )
+        << QVariant( QString::fromLatin1( "http://www.example.org/" ) ) << QVariant( QString::fromLatin1( "Frank" ) )
+        << QVariant( QString::fromLatin1( "true" ) ) << QVariant( QString::fromLatin1( "false" ) )
+        << QVariant( QString::fromLatin1( "1" ) ) << QVariant( QString::fromLatin1( " 2" ) )
+        << QVariant( QString::fromLatin1( "New" ) )
+        << QVariant( static_cast<int>( Unread ) ) << QVariant( static_cast<int>( Read ) ) << QVariant( static_cast<int>( New ) )
+        << QVariant( true ) << QVariant( false );
+}
+
+static QList<FixedFields*> createFields()
+{
+    QList<FixedFields*> fields;
+    fields << new FixedFields( QString::fromLatin1( "KDE 4.5 released" ), QString::fromLatin1( "<p>The KDE community is proud to announce 4.5.</p>" ),
+                               QString::fromLatin1( "http://www.example.org/kde-4.5" ), QString::fromLatin1( "Frank Osterfeld" ), New, false )
+           << new FixedFields( QString::fromLatin1( "akregator: a feed reader" ), QString(),
+                               QString::fromLatin1( "https://example.com/akregator?x=(1)" ), QString::fromLatin1( "frank" ), Read, true )
+           << new FixedFields( QString(), QString(), QString(), QString(), Unread, false )
+           << new FixedFields( QString::fromUtf8( "Kl\xc3\xa4ralvdalens Datakonsult" ), QString::fromLatin1( "true" ),
+                               QString::fromLatin1( "1" ), QString::fromLatin1( "New" ), Read, false )
+           << new FixedFields( QString::fromLatin1( "(" ), QString::fromLatin1( "Version 2.0.1 is out" ),
+                               QString::fromLatin1( "http://www.example.org/" ), QString::fromLatin1( " 2" ), New, true );
+    return fields;
+}
+
+class ArticleMatcherBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testEquivalence();
+    void testReadConfig();
+    void testMatcher();
+    void benchmarkReference();
+    void benchmarkPrecompiled();
+
+private:
+    QList<Criterion> benchmarkCriteria() const;
+
+    QList<FixedFields*> m_fields;
+    QList<FixedFields*> m_articles;
+};
+
+QTEST_KDEMAIN( ArticleMatcherBenchmark, NoGUI )
+
+void ArticleMatcherBenchmark::initTestCase()
+{
+    m_fields = createFields();
+
+    for ( int i = 0; i < ARTICLE_COUNT; ++i ) {
+        m_articles << new FixedFields( QString::fromLatin1( "Article %1 about %2" ).arg( i ).arg( QLatin1String( i % 7 == 0 ? "KDE" : "something else" ) ),
+                                       QString::fromLatin1( "<p>A paragraph of text to give the article a realistic size.</p>" ).repeated( 10 ),
+                                       QString::fromLatin1( "http://www.example.org/article%1" ).arg( i ),
+                                       QString::fromLatin1( "Author %1" ).arg( i % 13 ),
+                                       i % 3, i % 50 == 0 );
+    }
+}
+
+void ArticleMatcherBenchmark::cleanupTestCase()
+{
+    qDeleteAll( m_fields );
+    qDeleteAll( m_articles );
+}
+
+void ArticleMatcherBenchmark::testEquivalence()
+{
+    // every subject and predicate, with and without negation, against the
+    // matcher as it was before
+    int checked = 0;
+    Q_FOREACH ( const Criterion::Subject subject, subjects() ) {
+        Q_FOREACH ( const int predicate, predicates() ) {
+            Q_FOREACH ( const QVariant& object, objects() ) {
+                const Criterion criterion( subject, static_cast<Criterion::Predicate>( predicate ), object );
+                Q_FOREACH ( const FixedFields* fields, m_fields ) {
+                    const bool expected = referenceSatisfiedBy( subject, predicate, object, *fields );
+                    QVERIFY2( criterion.satisfiedBy( *fields ) == expected,
+                              qPrintable( QString::fromLatin1( "%1 %2 %3 on \"%4\"" )
+                                          .arg( Criterion::subjectToString( subject ) )
+                                          .arg( predicate, 0, 16 ).arg( object.toString() )
+                                          .arg( fields->title() ) ) );
+                    ++checked;
+                }
+            }
+        }
+    }
+    QCOMPARE( checked, subjects().count() * predicates().count() * objects().count() * m_fields.count() );
+}
+
+void ArticleMatcherBenchmark::testReadConfig()
+{
+    // criteria read from the config are prepared as well
+    KConfig config( QString(), KConfig::SimpleConfig );
+    Q_FOREACH ( const Criterion::Subject subject, subjects() ) {
+        Q_FOREACH ( const int predicate, predicates() ) {
+            Q_FOREACH ( const QVariant& object, objects() ) {
+                const Criterion written( subject, static_cast<Criterion::Predicate>( predicate ), object );
+                KConfigGroup group( &config, "Criterion" );
+                written.writeConfig( &group );
+
+                Criterion read;
+                read.readConfig( &group );
+                Q_FOREACH ( const FixedFields* fields, m_fields )
+                    QCOMPARE( read.satisfiedBy( *fields ), written.satisfiedBy( *fields ) );
+            }
+        }
+    }
+}
+
+void ArticleMatcherBenchmark::testMatcher()
+{
+    const QList<Criterion> criteria = benchmarkCriteria();
+    const ArticleMatcher any( criteria, ArticleMatcher::LogicalOr );
+    const ArticleMatcher all( criteria, ArticleMatcher::LogicalAnd );
+
+    Q_FOREACH ( const FixedFields* fields, m_fields ) {
+        bool anySatisfied = false;
+        bool allSatisfied = true;
+        Q_FOREACH ( const Criterion& criterion, criteria ) {
+            const bool satisfied = referenceSatisfiedBy( criterion.subject(), criterion.predicate(), criterion.object(), *fields );
+            anySatisfied = anySatisfied || satisfied;
+            allSatisfied = allSatisfied && satisfied;
+        }
+        QCOMPARE( any.matchesFields( *fields ), anySatisfied );
+        QCOMPARE( all.matchesFields( *fields ), allSatisfied );
+    }
+}
+
+QList<Criterion> ArticleMatcherBenchmark::benchmarkCriteria() const
+{
+    // a quick search for "kde" plus a saved filter
+    return QList<Criterion>()
+        << Criterion( Criterion::Title, Criterion::Contains, QString::fromLatin1( "kde" ) )
+        << Criterion( Criterion::Description, Criterion::Contains, QString::fromLatin1( "kde" ) )
+        << Criterion( Criterion::Author, Criterion::Matches, QString::fromLatin1( "^Author 1[0-2]$" ) )
+        << Criterion( Criterion::Status, Criterion::Equals, static_cast<int>( New ) )
+        << Criterion( Criterion::KeepFlag, static_cast<Criterion::Predicate>( Criterion::Equals | Criterion::Negation ), true );
+}
+
+void ArticleMatcherBenchmark::benchmarkReference()
+{
+    const QList<Criterion> criteria = benchmarkCriteria();
+
+    int count = 0;
+    QBENCHMARK {
+        count = 0;
+        Q_FOREACH ( const FixedFields* fields, m_articles ) {
+            Q_FOREACH ( const Criterion& criterion, criteria ) {
+                if ( referenceSatisfiedBy( criterion.subject(), criterion.predicate(), criterion.object(), *fields ) ) {
+                    ++count;
+                    break;
+                }
+            }
+        }
+    }
+    QVERIFY( count > 0 );
+}
+
+void ArticleMatcherBenchmark::benchmarkPrecompiled()
+{
+    const ArticleMatcher matcher( benchmarkCriteria(), ArticleMatcher::LogicalOr );
+
+    int count = 0;
+    QBENCHMARK {
+        count = 0;
+        Q_FOREACH ( const FixedFields* fields, m_articles ) {
+            if ( matcher.matchesFields( *fields ) )
+                ++count;
+        }
+    }
+    QVERIFY( count > 0 );
+}
+
+#include "articlematcherbenchmark.moc"
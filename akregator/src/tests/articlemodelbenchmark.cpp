@@ -0,0 +1,385 @@
+/*
+    This file is part of Akregator.
+
+    Copyright (C) 2010 the KDE PIM authors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+    As a special exception, permission is given to link this program
+    with any edition of Qt, and distribute the resulting executable,
+    without including the source code for Qt in the source distribution.
+*/
+
+#include "article.h"
+#include "articlematcher.h"
+#include "articlemodel.h"
+#include "types.h"
+#include "dummystorage/feedstoragedummyimpl.h"
+#include "dummystorage/storagedummyimpl.h"
+
+#include <qtest_kde.h>
+
+#include <QSignalSpy>
+#include <QSortFilterProxyModel>
+
+#include <boost/shared_ptr.hpp>
+
+using namespace Akregator;
+using namespace Akregator::Backend;
+using namespace Akregator::Filters;
+
+// the number of articles in the benchmarked list
+static const int ARTICLE_COUNT = 20000;
+
+// counts the lookups of the fields the article list shows
+class CountingFeedStorage : public FeedStorageDummyImpl
+{
+public:
+    CountingFeedStorage( StorageDummyImpl* main )
+        : FeedStorageDummyImpl( "http://www.example.org/feed.rss", main ), lookups( 0 ) {}
+
+    QString title( const QString& guid ) const
+    { ++lookups; return FeedStorageDummyImpl::title( guid ); }
+    QString description( const QString& guid ) const
+    { ++lookups; return FeedStorageDummyImpl::description( guid ); }
+    QString authorName( const QString& guid ) const
+    { ++lookups; return FeedStorageDummyImpl::authorName( guid ); }
+
+    mutable int lookups;
+};
+
+class ArticleModelBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testFields();
+    void testMatches();
+    void testNoLookups();
+    void testUpdateAndRemove();
+    void testRemoveRanges();
+    void benchmarkSortFromArticles();
+    void benchmarkSort();
+    void benchmarkFilterFromArticles();
+    void benchmarkFilter();
+    void benchmarkRemove();
+
+private:
+    boost::shared_ptr<const AbstractMatcher> searchMatcher() const;
+
+    StorageDummyImpl* m_storage;
+    CountingFeedStorage* m_feedStorage;
+    QList<Article> m_articles;
+};
+
+QTEST_KDEMAIN( ArticleModelBenchmark, NoGUI )
+
+void ArticleModelBenchmark::initTestCase()
+{
+    m_storage = new StorageDummyImpl;
+    m_feedStorage = new CountingFeedStorage( m_storage );
+
+    for ( int i = 0; i < ARTICLE_COUNT; ++i ) {
+        ArticleInfo info;
+        info.guid = QString::fromLatin1( "article-%1" ).arg( i );
+        info.pubDate = 1262304000 + ( i * 7919 ) % ARTICLE_COUNT * 60;
+        m_feedStorage->addEntry( info.guid );
+        m_feedStorage->setTitle( info.guid, QString::fromLatin1( "<b>Article</b> number %1 &amp; more" ).arg( ( i * 31 ) % 5000 ) );
+        m_feedStorage->setDescription( info.guid, QString::fromLatin1( "<p>Some text about topic %1.</p>" ).arg( i % 97 ) );
+        // a few dozen authors, some only known by their address
+        if ( i % 5 )
+            m_feedStorage->setAuthorName( info.guid, QString::fromLatin1( "Author %1" ).arg( i % 40 ) );
+        else
+            m_feedStorage->setAuthorEMail( info.guid, QString::fromLatin1( "author%1@example.org" ).arg( i % 40 ) );
+
+        Article article( info, 0, m_feedStorage );
+        article.setStatus( i % 3 );
+        if ( i % 11 == 0 )
+            article.setKeep( true );
+        m_articles.append( article );
+    }
+}
+
+void ArticleModelBenchmark::cleanupTestCase()
+{
+    m_articles.clear();
+    delete m_feedStorage;
+    delete m_storage;
+}
+
+boost::shared_ptr<const AbstractMatcher> ArticleModelBenchmark::searchMatcher() const
+{
+    // what the search bar builds for a search text
+    QList<Criterion> criteria;
+    criteria << Criterion( Criterion::Title, Criterion::Contains, QString::fromLatin1( "number 12" ) );
+    criteria << Criterion( Criterion::Description, Criterion::Contains, QString::fromLatin1( "number 12" ) );
+    criteria << Criterion( Criterion::Author, Criterion::Contains, QString::fromLatin1( "number 12" ) );
+    return boost::shared_ptr<const AbstractMatcher>( new ArticleMatcher( criteria, ArticleMatcher::LogicalOr ) );
+}
+
+void ArticleModelBenchmark::testFields()
+{
+    ArticleModel model( m_articles );
+    QCOMPARE( model.rowCount(), m_articles.count() );
+
+    for ( int row = 0; row < model.rowCount(); row += 97 ) {
+        const Article& article = m_articles[row];
+        QCOMPARE( model.index( row, ArticleModel::ItemTitleColumn ).data().toString(),
+                  QString::fromLatin1( "Article number %1 & more" ).arg( ( row * 31 ) % 5000 ) );
+        QCOMPARE( model.index( row, ArticleModel::AuthorColumn ).data().toString(), article.authorShort() );
+        QCOMPARE( model.index( row, ArticleModel::DescriptionColumn ).data().toString(), article.description() );
+        QCOMPARE( model.index( row, ArticleModel::DateColumn ).data( ArticleModel::SortRole ).toUInt(),
+                  article.pubDate().toTime_t() );
+        QCOMPARE( model.index( row, 0 ).data( ArticleModel::StatusRole ).toInt(), article.status() );
+        QCOMPARE( model.index( row, 0 ).data( ArticleModel::IsImportantRole ).toBool(), article.keep() );
+        QCOMPARE( model.index( row, 0 ).data( ArticleModel::GuidRole ).toString(), article.guid() );
+    }
+}
+
+void ArticleModelBenchmark::testMatches()
+{
+    ArticleModel model( m_articles );
+
+    QList<boost::shared_ptr<const AbstractMatcher> > matchers;
+    matchers << searchMatcher();
+
+    QList<Criterion> criteria;
+    criteria << Criterion( Criterion::Status, Criterion::Equals, New );
+    criteria << Criterion( Criterion::Status, Criterion::Equals, Unread );
+    matchers << boost::shared_ptr<const AbstractMatcher>( new ArticleMatcher( criteria, ArticleMatcher::LogicalOr ) );
+
+    criteria.clear();
+    criteria << Criterion( Criterion::KeepFlag, Criterion::Equals, true );
+    criteria << Criterion( Criterion::Author, Criterion::Matches, QString::fromLatin1( "^Author 1" ) );
+    matchers << boost::shared_ptr<const AbstractMatcher>( new ArticleMatcher( criteria, ArticleMatcher::LogicalAnd ) );
+
+    criteria.clear();
+    criteria << Criterion( Criterion::Title, static_cast<Criterion::Predicate>( Criterion::Contains | Criterion::Negation ),
+                           QString::fromLatin1( "<b>" ) );
+    criteria << Criterion( Criterion::Description, Criterion::Contains, QString::fromLatin1( "topic 5." ) );
+    matchers << boost::shared_ptr<const AbstractMatcher>( new ArticleMatcher( criteria, ArticleMatcher::LogicalOr ) );
+
+    Q_FOREACH ( const boost::shared_ptr<const AbstractMatcher>& matcher, matchers ) {
+        int matching = 0;
+        for ( int row = 0; row < model.rowCount(); ++row ) {
+            const bool matches = matcher->matches( m_articles[row] );
+            QCOMPARE( model.rowMatches( row, matcher ), matches );
+            if ( matches )
+                ++matching;
+        }
+        QVERIFY( matching > 0 );
+    }
+}
+
+void ArticleModelBenchmark::testNoLookups()
+{
+    ArticleModel model( m_articles );
+
+    QSortFilterProxyModel proxy;
+    proxy.setSortRole( ArticleModel::SortRole );
+    proxy.setSourceModel( &model );
+
+    QList<Criterion> criteria;
+    criteria << Criterion( Criterion::Title, Criterion::Contains, QString::fromLatin1( "number 12" ) );
+    criteria << Criterion( Criterion::Author, Criterion::Contains, QString::fromLatin1( "Author 3" ) );
+    const boost::shared_ptr<const AbstractMatcher> matcher( new ArticleMatcher( criteria, ArticleMatcher::LogicalOr ) );
+
+    const int lookups = m_feedStorage->lookups;
+    proxy.sort( ArticleModel::ItemTitleColumn );
+    proxy.sort( ArticleModel::AuthorColumn );
+    proxy.sort( ArticleModel::DateColumn, Qt::DescendingOrder );
+    for ( int row = 0; row < model.rowCount(); ++row )
+        model.rowMatches( row, matcher );
+    QCOMPARE( m_feedStorage->lookups, lookups );
+
+    // descriptions are not kept, every search reads those it needs, and
+    // only those
+    const boost::shared_ptr<const AbstractMatcher> search = searchMatcher();
+    for ( int row = 0; row < model.rowCount(); ++row )
+        model.rowMatches( row, search );
+    const int firstSearch = m_feedStorage->lookups - lookups;
+    QVERIFY( firstSearch > 0 );
+    QVERIFY( firstSearch <= model.rowCount() );
+    for ( int row = 0; row < model.rowCount(); ++row )
+        model.rowMatches( row, search );
+    QCOMPARE( m_feedStorage->lookups - lookups, 2 * firstSearch );
+}
+
+void ArticleModelBenchmark::testUpdateAndRemove()
+{
+    QList<Article> articles = m_articles.mid( 0, 100 );
+    ArticleModel model( articles );
+
+    Article article = articles[42];
+    const QString oldTitle = article.title();
+    m_feedStorage->setTitle( article.guid(), QString::fromLatin1( "Updated &lt;title&gt;" ) );
+    article.setKeep( !article.keep() );
+    model.articlesUpdated( 0, QList<Article>() << article );
+    QCOMPARE( model.index( 42, ArticleModel::ItemTitleColumn ).data().toString(), QString::fromLatin1( "Updated <title>" ) );
+    QCOMPARE( model.index( 42, 0 ).data( ArticleModel::IsImportantRole ).toBool(), article.keep() );
+    m_feedStorage->setTitle( article.guid(), oldTitle );
+    article.setKeep( !article.keep() );
+    model.articlesUpdated( 0, QList<Article>() << article );
+    QCOMPARE( model.index( 42, ArticleModel::ItemTitleColumn ).data().toString(),
+              QString::fromLatin1( "Article number %1 & more" ).arg( ( 42 * 31 ) % 5000 ) );
+
+    // the strings of the replaced title and author are dropped, and their
+    // ids handed out again
+    Article other = articles[7];
+    const QString otherTitle = other.title();
+    const QString otherAuthor = other.authorName();
+    m_feedStorage->setTitle( other.guid(), QString::fromLatin1( "Other <i>title</i>" ) );
+    m_feedStorage->setAuthorName( other.guid(), QString::fromLatin1( "Somebody else" ) );
+    model.articlesUpdated( 0, QList<Article>() << other );
+    m_feedStorage->setTitle( other.guid(), QString::fromLatin1( "Third title" ) );
+    model.articlesUpdated( 0, QList<Article>() << other );
+    QCOMPARE( model.index( 7, ArticleModel::ItemTitleColumn ).data().toString(), QString::fromLatin1( "Third title" ) );
+    QCOMPARE( model.index( 7, ArticleModel::AuthorColumn ).data().toString(), QString::fromLatin1( "Somebody else" ) );
+    m_feedStorage->setTitle( other.guid(), otherTitle );
+    m_feedStorage->setAuthorName( other.guid(), otherAuthor );
+    model.articlesUpdated( 0, QList<Article>() << other );
+    QCOMPARE( model.index( 7, ArticleModel::ItemTitleColumn ).data().toString(),
+              QString::fromLatin1( "Article number %1 & more" ).arg( ( 7 * 31 ) % 5000 ) );
+    QCOMPARE( model.index( 7, ArticleModel::AuthorColumn ).data().toString(), other.authorShort() );
+    for ( int row = 0; row < model.rowCount(); ++row )
+        QCOMPARE( model.index( row, ArticleModel::AuthorColumn ).data().toString(), articles[row].authorShort() );
+
+    model.articlesRemoved( 0, QList<Article>() << articles[10] << articles[42] );
+    QCOMPARE( model.rowCount(), 98 );
+    QCOMPARE( model.index( 10, 0 ).data( ArticleModel::GuidRole ).toString(), articles[11].guid() );
+    QCOMPARE( model.index( 41, 0 ).data( ArticleModel::GuidRole ).toString(), articles[43].guid() );
+    QCOMPARE( model.index( 41, ArticleModel::AuthorColumn ).data().toString(), articles[43].authorShort() );
+
+    // rows after the removed ones are still found for updates
+    model.articlesUpdated( 0, QList<Article>() << articles[99] );
+    QCOMPARE( model.index( 97, ArticleModel::ItemTitleColumn ).data().toString(),
+              QString::fromLatin1( "Article number %1 & more" ).arg( ( 99 * 31 ) % 5000 ) );
+}
+
+void ArticleModelBenchmark::testRemoveRanges()
+{
+    const QList<Article> articles = m_articles.mid( 0, 100 );
+    ArticleModel model( articles );
+
+    QSortFilterProxyModel proxy;
+    proxy.setSortRole( ArticleModel::SortRole );
+    proxy.setSourceModel( &model );
+    proxy.sort( ArticleModel::DateColumn );
+
+    QSignalSpy spy( &model, SIGNAL(rowsRemoved(QModelIndex,int,int)) );
+    QList<Article> removed;
+    removed << articles[51] << articles[3] << articles[99] << articles[5] << articles[10]
+            << articles[4] << articles[50] << articles[0] << articles[4];
+    model.articlesRemoved( 0, removed );
+
+    // one signal per run of adjacent rows, numbered as they are at the time
+    QCOMPARE( spy.count(), 5 );
+    const int ranges[5][2] = { { 0, 0 }, { 2, 4 }, { 6, 6 }, { 45, 46 }, { 92, 92 } };
+    for ( int i = 0; i < 5; ++i ) {
+        QCOMPARE( spy[i][1].toInt(), ranges[i][0] );
+        QCOMPARE( spy[i][2].toInt(), ranges[i][1] );
+    }
+
+    QList<Article> remaining = articles;
+    Q_FOREACH ( const Article& article, removed )
+        remaining.removeAll( article );
+    QCOMPARE( model.rowCount(), remaining.count() );
+    QCOMPARE( proxy.rowCount(), remaining.count() );
+    for ( int row = 0; row < model.rowCount(); ++row ) {
+        QCOMPARE( model.index( row, 0 ).data( ArticleModel::GuidRole ).toString(), remaining[row].guid() );
+        QCOMPARE( model.index( row, ArticleModel::AuthorColumn ).data().toString(), remaining[row].authorShort() );
+        QCOMPARE( model.index( row, ArticleModel::DateColumn ).data( ArticleModel::SortRole ).toUInt(),
+                  remaining[row].pubDate().toTime_t() );
+    }
+
+    // the rows are found by guid at their new numbers
+    model.articlesRemoved( 0, QList<Article>() << remaining[90] );
+    QCOMPARE( model.rowCount(), remaining.count() - 1 );
+    QCOMPARE( model.index( 90, 0 ).data( ArticleModel::GuidRole ).toString(), remaining[91].guid() );
+}
+
+static bool authorLessThan( const Article& a1, const Article& a2 )
+{
+    return a1.authorShort() < a2.authorShort();
+}
+
+void ArticleModelBenchmark::benchmarkSortFromArticles()
+{
+    // what sorting by author amounted to when every comparison asked the articles
+    QBENCHMARK {
+        QList<Article> articles = m_articles;
+        qStableSort( articles.begin(), articles.end(), authorLessThan );
+    }
+}
+
+void ArticleModelBenchmark::benchmarkSort()
+{
+    ArticleModel model( m_articles );
+
+    QSortFilterProxyModel proxy;
+    proxy.setSortRole( ArticleModel::SortRole );
+    proxy.setSourceModel( &model );
+
+    QBENCHMARK {
+        proxy.sort( ArticleModel::AuthorColumn );
+        proxy.sort( ArticleModel::DateColumn, Qt::DescendingOrder );
+    }
+}
+
+void ArticleModelBenchmark::benchmarkFilterFromArticles()
+{
+    const boost::shared_ptr<const AbstractMatcher> matcher = searchMatcher();
+
+    QBENCHMARK {
+        int matching = 0;
+        Q_FOREACH ( const Article& article, m_articles ) {
+            if ( matcher->matches( article ) )
+                ++matching;
+        }
+        QVERIFY( matching > 0 );
+    }
+}
+
+void ArticleModelBenchmark::benchmarkFilter()
+{
+    ArticleModel model( m_articles );
+    const boost::shared_ptr<const AbstractMatcher> matcher = searchMatcher();
+
+    QBENCHMARK {
+        int matching = 0;
+        for ( int row = 0; row < model.rowCount(); ++row ) {
+            if ( model.rowMatches( row, matcher ) )
+                ++matching;
+        }
+        QVERIFY( matching > 0 );
+    }
+}
+
+void ArticleModelBenchmark::benchmarkRemove()
+{
+    ArticleModel model( m_articles );
+    QList<Article> expired;
+    for ( int i = 0; i < m_articles.count(); i += 10 )
+        expired.append( m_articles[i] );
+
+    QBENCHMARK_ONCE {
+        model.articlesRemoved( 0, expired );
+    }
+    QCOMPARE( model.rowCount(), m_articles.count() - expired.count() );
+}
+
+#include "articlemodelbenchmark.moc"
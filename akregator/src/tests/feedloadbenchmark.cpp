@@ -0,0 +1,238 @@
+/*
+    This file is part of Akregator.
+
+    Copyright (C) 2010 the KDE PIM authors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+    As a special exception, permission is given to link this program
+    with any edition of Qt, and distribute the resulting executable,
+    without including the source code for Qt in the source distribution.
+*/
+
+#include "article.h"
+#include "feed.h"
+#include "types.h"
+#include "dummystorage/feedstoragedummyimpl.h"
+#include "dummystorage/storagedummyimpl.h"
+
+#include <qtest_kde.h>
+
+#include <QDomDocument>
+#include <QHash>
+#include <QSet>
+
+using namespace Akregator;
+using namespace Akregator::Backend;
+
+// the size of the generated archive
+static const int FEED_COUNT = 50;
+static const int ARTICLE_COUNT = 400;
+
+// the status bits of the archive, see Article
+static const int DELETED = 0x01;
+static const int READ = 0x08;
+static const int NEW = 0x04;
+static const int KEEP = 0x10;
+
+static QString feedUrl( int feed )
+{
+    return QString::fromLatin1( "http://www.example.org/feed%1.rss" ).arg( feed );
+}
+
+static QString articleGuid( int feed, int article )
+{
+    return QString::fromLatin1( "feed%1-article%2" ).arg( feed ).arg( article );
+}
+
+// reads the eagerly loaded fields the way Feed::loadArticles() did before,
+// one lookup per article and field
+class PerFieldFeedStorage : public FeedStorageDummyImpl
+{
+public:
+    PerFieldFeedStorage( const QString& url, StorageDummyImpl* main )
+        : FeedStorageDummyImpl( url, main ) {}
+
+    QList<ArticleInfo> articleInfos() const
+    {
+        QList<ArticleInfo> list;
+        Q_FOREACH ( const QString& guid, articles() ) {
+            ArticleInfo info;
+            info.guid = guid;
+            info.status = status( guid );
+            info.hash = hash( guid );
+            info.pubDate = pubDate( guid );
+            list += info;
+        }
+        return list;
+    }
+};
+
+// hands out the archives generated by the benchmark
+class GeneratedStorage : public StorageDummyImpl
+{
+public:
+    explicit GeneratedStorage( bool perField )
+    {
+        for ( int feed = 0; feed < FEED_COUNT; ++feed ) {
+            FeedStorageDummyImpl* fs = perField ? new PerFieldFeedStorage( feedUrl( feed ), this )
+                                                : new FeedStorageDummyImpl( feedUrl( feed ), this );
+            for ( int article = 0; article < ARTICLE_COUNT; ++article ) {
+                const QString guid = articleGuid( feed, article );
+                fs->addEntry( guid );
+                fs->setTitle( guid, QString::fromLatin1( "Article %1" ).arg( article ) );
+                fs->setHash( guid, qHash( guid ) );
+                fs->setPubDate( guid, 1262304000 + article * 3600 );
+                int status = article % 3 == 0 ? READ : 0;
+                if ( article % 17 == 0 )
+                    status |= NEW;
+                if ( article % 23 == 0 )
+                    status = DELETED | READ;
+                if ( article % 29 == 0 )
+                    status |= KEEP;
+                fs->setStatus( guid, status );
+            }
+            m_feeds.insert( feedUrl( feed ), fs );
+        }
+    }
+
+    ~GeneratedStorage()
+    {
+        qDeleteAll( m_feeds );
+    }
+
+    FeedStorage* archiveFor( const QString& url )
+    {
+        return m_feeds.value( url );
+    }
+
+    const FeedStorage* archiveFor( const QString& url ) const
+    {
+        return m_feeds.value( url );
+    }
+
+private:
+    QHash<QString, FeedStorageDummyImpl*> m_feeds;
+};
+
+// what reading the feed list does at startup
+static QList<Feed*> loadFeeds( Storage* storage )
+{
+    QDomDocument document;
+    QList<Feed*> feeds;
+    for ( int feed = 0; feed < FEED_COUNT; ++feed ) {
+        QDomElement outline = document.createElement( QLatin1String( "outline" ) );
+        outline.setAttribute( QLatin1String( "text" ), QString::fromLatin1( "Feed %1" ).arg( feed ) );
+        outline.setAttribute( QLatin1String( "xmlUrl" ), feedUrl( feed ) );
+        feeds += Feed::fromOPML( outline, storage );
+    }
+    return feeds;
+}
+
+class FeedLoadBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testArticleInfos();
+    void testLoadArticles();
+    void benchmarkPerField();
+    void benchmarkArticleInfos();
+
+private:
+    GeneratedStorage* m_storage;
+    GeneratedStorage* m_perFieldStorage;
+};
+
+QTEST_KDEMAIN( FeedLoadBenchmark, NoGUI )
+
+void FeedLoadBenchmark::initTestCase()
+{
+    m_storage = new GeneratedStorage( false );
+    m_perFieldStorage = new GeneratedStorage( true );
+}
+
+void FeedLoadBenchmark::cleanupTestCase()
+{
+    delete m_storage;
+    delete m_perFieldStorage;
+}
+
+void FeedLoadBenchmark::testArticleInfos()
+{
+    for ( int feed = 0; feed < FEED_COUNT; feed += 7 ) {
+        const FeedStorage* fs = m_storage->archiveFor( feedUrl( feed ) );
+        const QList<ArticleInfo> infos = fs->articleInfos();
+        QCOMPARE( infos.count(), fs->articles().count() );
+
+        QSet<QString> guids;
+        Q_FOREACH ( const ArticleInfo& info, infos ) {
+            QVERIFY( fs->contains( info.guid ) );
+            QCOMPARE( info.status, fs->status( info.guid ) );
+            QCOMPARE( info.hash, fs->hash( info.guid ) );
+            QCOMPARE( info.pubDate, fs->pubDate( info.guid ) );
+            guids.insert( info.guid );
+        }
+        QCOMPARE( guids, fs->articles().toSet() );
+    }
+}
+
+void FeedLoadBenchmark::testLoadArticles()
+{
+    const QList<Feed*> feeds = loadFeeds( m_storage );
+    const QList<Feed*> perFieldFeeds = loadFeeds( m_perFieldStorage );
+
+    for ( int feed = 0; feed < FEED_COUNT; ++feed ) {
+        const Feed* loaded = feeds.at( feed );
+        const Feed* expected = perFieldFeeds.at( feed );
+        QVERIFY( loaded->isArticlesLoaded() );
+        QCOMPARE( loaded->totalCount(), expected->totalCount() );
+        QCOMPARE( loaded->unread(), expected->unread() );
+
+        for ( int article = 0; article < ARTICLE_COUNT; article += 5 ) {
+            const Article a = loaded->findArticle( articleGuid( feed, article ) );
+            const Article b = expected->findArticle( articleGuid( feed, article ) );
+            QCOMPARE( a.status(), b.status() );
+            QCOMPARE( a.isDeleted(), b.isDeleted() );
+            QCOMPARE( a.keep(), b.keep() );
+            QCOMPARE( a.hash(), b.hash() );
+            QCOMPARE( a.pubDate(), b.pubDate() );
+            QCOMPARE( a.title(), b.title() );
+        }
+    }
+
+    qDeleteAll( feeds );
+    qDeleteAll( perFieldFeeds );
+}
+
+void FeedLoadBenchmark::benchmarkPerField()
+{
+    QBENCHMARK {
+        const QList<Feed*> feeds = loadFeeds( m_perFieldStorage );
+        qDeleteAll( feeds );
+    }
+}
+
+void FeedLoadBenchmark::benchmarkArticleInfos()
+{
+    QBENCHMARK {
+        const QList<Feed*> feeds = loadFeeds( m_storage );
+        qDeleteAll( feeds );
+    }
+}
+
+#include "feedloadbenchmark.moc"
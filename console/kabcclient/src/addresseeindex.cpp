@@ -0,0 +1,221 @@
+//
+//  Copyright (C) 2010 the KDE PIM authors
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+// local includes
+#include "addresseeindex.h"
+
+// Qt includes
+#include <QtCore/QStringList>
+#include <QtCore/QtAlgorithms>
+
+using namespace KABC;
+
+///////////////////////////////////////////////////////////////////////////////
+
+AddresseeIndex::AddresseeIndex(Qt::CaseSensitivity sensitivity)
+    : m_sensitivity(sensitivity)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AddresseeIndex::insert(const Addressee& addressee)
+{
+    int position = m_uids.value(addressee.uid(), -1);
+    if (position == -1)
+    {
+        position = m_addressees.count();
+        m_addressees.append(addressee);
+        m_removed.append(false);
+        m_uids.insert(addressee.uid(), position);
+    }
+    else
+    {
+        // the trigrams of the old data stay, search() checks the current one
+        m_addressees[position] = addressee;
+    }
+
+    addTrigrams(m_nameTrigrams, addressee.realName(), position);
+
+    const QStringList emails = addressee.emails();
+    QStringList::const_iterator it    = emails.begin();
+    QStringList::const_iterator endIt = emails.end();
+    for (; it != endIt; ++it)
+    {
+        addTrigrams(m_emailTrigrams, *it, position);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AddresseeIndex::remove(const Addressee& addressee)
+{
+    QHash<QString, int>::iterator it = m_uids.find(addressee.uid());
+    if (it == m_uids.end()) return;
+
+    m_removed[it.value()] = true;
+    m_addressees[it.value()] = Addressee();
+    m_uids.erase(it);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+AddresseeList AddresseeIndex::search(const Addressee& search, int maxCount) const
+{
+    QVector<int> candidates;
+    bool checkAll = false;
+
+    if (!search.uid().isEmpty())
+    {
+        const int position = m_uids.value(search.uid(), -1);
+        if (position != -1) candidates.append(position);
+    }
+
+    // family and given name are matched against the real name as well
+    const QString realName = search.realName();
+    if (!realName.isEmpty() && !addCandidates(m_nameTrigrams, realName, candidates))
+        checkAll = true;
+
+    if (!search.familyName().isEmpty() && !addCandidates(m_nameTrigrams, search.familyName(), candidates))
+        checkAll = true;
+
+    if (!search.givenName().isEmpty() && !addCandidates(m_nameTrigrams, search.givenName(), candidates))
+        checkAll = true;
+
+    const QString email = search.preferredEmail();
+    if (!email.isEmpty() && !addCandidates(m_emailTrigrams, email, candidates))
+        checkAll = true;
+
+    if (checkAll)
+    {
+        candidates.resize(m_addressees.count());
+        for (int i = 0; i < candidates.count(); ++i)
+        {
+            candidates[i] = i;
+        }
+    }
+    else
+    {
+        qSort(candidates);
+    }
+
+    AddresseeList result;
+
+    int previous = -1;
+    QVector<int>::const_iterator it    = candidates.constBegin();
+    QVector<int>::const_iterator endIt = candidates.constEnd();
+    for (; it != endIt; ++it)
+    {
+        if (*it == previous || m_removed[*it]) continue;
+        previous = *it;
+
+        if (matches(m_addressees[*it], search, m_sensitivity))
+        {
+            result.append(m_addressees[*it]);
+            if (maxCount != -1 && result.count() >= maxCount) break;
+        }
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool AddresseeIndex::matches(const Addressee& addressee, const Addressee& search,
+                             Qt::CaseSensitivity sensitivity)
+{
+    if (!search.uid().isEmpty() && addressee.uid() == search.uid())
+    {
+        return true;
+    }
+    else if (!search.realName().isEmpty() &&
+             addressee.realName().indexOf(search.realName(), 0, sensitivity) != -1)
+    {
+        return true;
+    }
+    else if (!search.familyName().isEmpty() &&
+             addressee.realName().indexOf(search.familyName(), 0, sensitivity) != -1)
+    {
+        if (!search.givenName().isEmpty())
+            return addressee.realName().indexOf(search.givenName(), 0, sensitivity) != -1;
+        else
+            return true;
+    }
+    else if (!search.givenName().isEmpty() &&
+             addressee.realName().indexOf(search.givenName(), 0, sensitivity) != -1)
+    {
+        return true;
+    }
+    else if (!search.preferredEmail().isEmpty())
+    {
+        QStringList found = addressee.emails().filter(search.preferredEmail(), sensitivity);
+        return found.count() > 0;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+quint64 AddresseeIndex::trigram(const QChar* text)
+{
+    return (quint64(text[0].unicode()) << 32) | (quint64(text[1].unicode()) << 16) | text[2].unicode();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AddresseeIndex::addTrigrams(TrigramMap& map, const QString& text, int position)
+{
+    // case folding is what case insensitive QString::indexOf() compares, and
+    // for case sensitive search it just finds a few more candidates
+    const QString folded = text.toCaseFolded();
+
+    for (int i = 0; i + 3 <= folded.length(); ++i)
+    {
+        QVector<int>& positions = map[trigram(folded.constData() + i)];
+        if (positions.isEmpty() || positions.last() != position)
+            positions.append(position);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool AddresseeIndex::addCandidates(const TrigramMap& map, const QString& text,
+                                   QVector<int>& candidates) const
+{
+    const QString folded = text.toCaseFolded();
+    if (folded.length() < 3) return false; // too short for the index
+
+    // every contact containing the text contains each of its trigrams,
+    // so the one found in the fewest contacts is enough
+    const QVector<int>* rarest = 0;
+    for (int i = 0; i + 3 <= folded.length(); ++i)
+    {
+        TrigramMap::const_iterator it = map.constFind(trigram(folded.constData() + i));
+        if (it == map.constEnd()) return true; // no contact contains the text
+
+        if (rarest == 0 || it.value().count() < rarest->count())
+            rarest = &it.value();
+    }
+
+    candidates += *rarest;
+
+    return true;
+}
+
+// End of file
@@ -0,0 +1,123 @@
+//
+//  Copyright (C) 2010 the KDE PIM authors
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+#ifndef ADDRESSEEINDEX_H
+#define ADDRESSEEINDEX_H
+
+// Qt includes
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+// KABC includes
+#include <kabc/addressee.h>
+#include <kabc/addresseelist.h>
+
+/**
+* @brief Index for looking up contacts matching search input
+*
+* Holds a copy of the contacts of an address book, in the address book's
+* order, together with a hash of their UIDs and maps from every three
+* character sequence of their real names and e-mail addresses to the contacts
+* containing it.
+*
+* search() uses those maps to find the few contacts which can match the
+* search input at all and checks only those with matches(), instead of
+* checking every contact of the address book for every search input.
+* The result is the same, including its order.
+*
+* @author the KDE PIM authors
+*/
+class AddresseeIndex
+{
+public:
+    /**
+    * @brief Creates an empty index
+    *
+    * @param sensitivity whether search() compares strings case sensitive
+    */
+    explicit AddresseeIndex(Qt::CaseSensitivity sensitivity);
+
+    /**
+    * @brief Adds a contact or updates a contact already in the index
+    *
+    * Contacts are identified by their UID. New contacts are added after
+    * all contacts already in the index.
+    *
+    * @param addressee the contact to add or update
+    */
+    void insert(const KABC::Addressee& addressee);
+
+    /**
+    * @brief Removes a contact from the index
+    *
+    * @param addressee the contact to remove, identified by its UID
+    */
+    void remove(const KABC::Addressee& addressee);
+
+    /**
+    * @brief Returns the contacts matching the search input
+    *
+    * @param search the search input, see matches()
+    * @param maxCount the number of matches after which to stop searching,
+    *                 @c -1 for finding all
+    *
+    * @return the matching contacts, in the order they were added in
+    */
+    KABC::AddresseeList search(const KABC::Addressee& search, int maxCount = -1) const;
+
+    /**
+    * @brief Checks whether a contact matches search input
+    *
+    * A contact matches if it has the UID of the search input, or if its
+    * real name contains the search input's real name, family name (and
+    * given name, if there is one) or given name, or if one of its e-mail
+    * addresses contains the search input's preferred e-mail address,
+    * checked in this order.
+    *
+    * @param addressee the contact to check
+    * @param search the search input
+    * @param sensitivity whether to compare strings case sensitive
+    *
+    * @return @c true if @p addressee matches @p search
+    */
+    static bool matches(const KABC::Addressee& addressee, const KABC::Addressee& search,
+                        Qt::CaseSensitivity sensitivity);
+
+private:
+    // three UTF-16 code units of case folded text, see trigram()
+    typedef QHash<quint64, QVector<int> > TrigramMap;
+
+    Qt::CaseSensitivity m_sensitivity;
+
+    QVector<KABC::Addressee> m_addressees;
+    QVector<bool> m_removed;
+
+    QHash<QString, int> m_uids;
+    TrigramMap m_nameTrigrams;
+    TrigramMap m_emailTrigrams;
+
+private:
+    static quint64 trigram(const QChar* text);
+    static void addTrigrams(TrigramMap& map, const QString& text, int position);
+    bool addCandidates(const TrigramMap& map, const QString& text, QVector<int>& candidates) const;
+};
+
+#endif
+
+// End of file
@@ -19,6 +19,7 @@
 
 // local includes
 #include "kabcclient.h"
+#include "addresseeindex.h"
 #include "formatfactory.h"
 #include "inputformat.h"
 #include "outputformat.h"
@@ -254,6 +255,9 @@ int KABCClient::performAdd()
 
 int KABCClient::performRemove()
 {
+    AddresseeIndex index(m_matchCaseSensitivity);
+    fillIndex(index);
+
     bool wantSave = false;
 
     uint count = 0;
@@ -264,56 +268,14 @@ int KABCClient::performRemove()
 
         count++;
 
-        AddresseeList result;
-
-        AddressBook::ConstIterator it    = m_addressBook->constBegin();
-        AddressBook::ConstIterator endIt = m_addressBook->constEnd();
-        for (; it != endIt; ++it)
-        {
-            if (!search.uid().isEmpty() && (*it).uid() == search.uid())
-            {
-                result.append(*it);
-            }
-            else if (!search.realName().isEmpty() &&
-                     (*it).realName().indexOf(search.realName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                result.append(*it);
-            }
-            else if (!search.familyName().isEmpty() &&
-                     (*it).realName().indexOf(search.familyName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                if (!search.givenName().isEmpty())
-                {
-                    if ((*it).realName().indexOf(search.givenName(), 0, m_matchCaseSensitivity) != -1)
-                    {
-                        result.append(*it);
-                    }
-                }
-                else
-                    result.append(*it);
-            }
-            else if (!search.givenName().isEmpty() &&
-                     (*it).realName().indexOf(search.givenName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                result.append(*it);
-            }
-            else if (!search.preferredEmail().isEmpty())
-            {
-                QStringList matches =
-                    (*it).emails().filter(search.preferredEmail(), m_matchCaseSensitivity);
-                if (matches.count() > 0)
-                {
-                    result.append(*it);
-                }
-            }
-
-            if (result.count() > 1) break;
-        }
+        // only two matches are needed to know it is ambiguous
+        AddresseeList result = index.search(search, 2);
 
         // only work with unambiguous matches
         if (result.count() == 1)
         {
             m_addressBook->removeAddressee(result[0]);
+            index.remove(result[0]);
             wantSave = true;
 
             m_outputFormat->writeAddressee(result[0], std::cout);
@@ -352,6 +314,9 @@ int KABCClient::performRemove()
 
 int KABCClient::performMerge()
 {
+    AddresseeIndex index(m_matchCaseSensitivity);
+    fillIndex(index);
+
     bool wantSave = false;
 
     uint count = 0;
@@ -362,52 +327,8 @@ int KABCClient::performMerge()
 
         count++;
 
-        AddresseeList result;
-
-        AddressBook::ConstIterator it    = m_addressBook->constBegin();
-        AddressBook::ConstIterator endIt = m_addressBook->constEnd();
-        for (; it != endIt; ++it)
-        {
-            if (!addressee.uid().isEmpty() && (*it).uid() == addressee.uid())
-            {
-                result.append(*it);
-            }
-            else if (!addressee.realName().isEmpty() &&
-                     (*it).realName().indexOf(addressee.realName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                result.append(*it);
-            }
-            else if (!addressee.familyName().isEmpty() &&
-                     (*it).realName().indexOf(addressee.familyName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                if (!addressee.givenName().isEmpty())
-                {
-                    if ((*it).realName().indexOf(addressee.givenName(),
-                                              0, m_matchCaseSensitivity) != -1)
-                    {
-                        result.append(*it);
-                    }
-                }
-                else
-                    result.append(*it);
-            }
-            else if (!addressee.givenName().isEmpty() &&
-                     (*it).realName().indexOf(addressee.givenName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                result.append(*it);
-            }
-            else if (!addressee.preferredEmail().isEmpty())
-            {
-                QStringList matches =
-                    (*it).emails().filter(addressee.preferredEmail(), m_matchCaseSensitivity);
-                if (matches.count() > 0)
-                {
-                    result.append(*it);
-                }
-            }
-
-            if (result.count() > 1) break;
-        }
+        // only two matches are needed to know it is ambiguous
+        AddresseeList result = index.search(addressee, 2);
 
         // only work with unambiguous matches
         if (result.count() == 1)
@@ -416,6 +337,7 @@ int KABCClient::performMerge()
             mergeAddressees(master, addressee);
 
             m_addressBook->insertAddressee(master);
+            index.insert(master);
             wantSave = true;
 
             m_outputFormat->writeAddressee(master, std::cout);
@@ -465,55 +387,15 @@ int KABCClient::performSearch()
 {
     int resultValue = 2; // i.e. search didn't find any match
 
-    AddressBook::ConstIterator endIt = m_addressBook->constEnd();
+    AddresseeIndex index(m_matchCaseSensitivity);
+    fillIndex(index);
 
     while (!m_inputStream->bad() && !m_inputStream->eof())
     {
         Addressee search = m_inputFormat->readAddressee(*m_inputStream);
         if (search.isEmpty()) continue;
 
-        AddresseeList result;
-
-        AddressBook::ConstIterator it = m_addressBook->constBegin();
-        for (; it != endIt; ++it)
-        {
-            if (!search.uid().isEmpty() && (*it).uid() == search.uid())
-            {
-                result.append(*it);
-            }
-            else if (!search.realName().isEmpty() &&
-                     (*it).realName().indexOf(search.realName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                result.append(*it);
-            }
-            else if (!search.familyName().isEmpty() &&
-                     (*it).realName().indexOf(search.familyName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                if (!search.givenName().isEmpty())
-                {
-                    if ((*it).realName().indexOf(search.givenName(), 0, m_matchCaseSensitivity) != -1)
-                    {
-                        result.append(*it);
-                    }
-                }
-                else
-                    result.append(*it);
-            }
-            else if (!search.givenName().isEmpty() &&
-                     (*it).realName().indexOf(search.givenName(), 0, m_matchCaseSensitivity) != -1)
-            {
-                result.append(*it);
-            }
-            else if (!search.preferredEmail().isEmpty())
-            {
-                QStringList matches =
-                    (*it).emails().filter(search.preferredEmail(), m_matchCaseSensitivity);
-                if (matches.count() > 0)
-                {
-                    result.append(*it);
-                }
-            }
-        }
+        AddresseeList result = index.search(search);
 
         if (result.count() > 0)
         {
@@ -529,6 +411,18 @@ int KABCClient::performSearch()
     return resultValue;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+void KABCClient::fillIndex(AddresseeIndex& index) const
+{
+    AddressBook::ConstIterator it    = m_addressBook->constBegin();
+    AddressBook::ConstIterator endIt = m_addressBook->constEnd();
+    for (; it != endIt; ++it)
+    {
+        index.insert(*it);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // taken from KAddressBook/KABCTools (c) Tobias Koenig
 
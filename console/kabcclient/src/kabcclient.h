@@ -26,6 +26,7 @@
 #include <QtCore/QObject>
 
 // forward declarations
+class AddresseeIndex;
 class FormatFactory;
 class InputFormat;
 class OutputFormat;
@@ -301,6 +302,8 @@ private:
     int performList();
     int performSearch();
 
+    void fillIndex(AddresseeIndex& index) const;
+
     void mergeAddressees(KABC::Addressee& master, const KABC::Addressee& slave);
     void mergePictures(KABC::Picture& master, const KABC::Picture slave);
 
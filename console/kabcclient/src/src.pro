@@ -5,6 +5,7 @@ TARGET = ../bin/kabcclient
 CONFIG += qt thread debug warn_on
 
 SOURCES = main.cpp \
+          addresseeindex.cpp \
           csvtemplate.cpp \
           csvtemplatefactory.cpp \
           formatfactory.cpp \
@@ -12,7 +13,8 @@ SOURCES = main.cpp \
           kabcclient.cpp \
           outputformatimpls.cpp
 
-HEADERS = csvtemplate.h \
+HEADERS = addresseeindex.h \
+          csvtemplate.h \
           csvtemplatefactory.h \
           formatfactory.h \
           inputformat.h \
@@ -0,0 +1,387 @@
+//
+//  Copyright (C) 2010 the KDE PIM authors
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+//
+
+// local includes
+#include "addresseeindex.h"
+
+// Qt includes
+#include <QtCore/QStringList>
+
+// KDE includes
+#include <qtest_kde.h>
+
+// KABC includes
+#include <kabc/vcardconverter.h>
+
+using namespace KABC;
+
+// contacts in the address book of the benchmarks
+static const int BOOK_SIZE = 20000;
+
+// search inputs per benchmark run
+static const int QUERY_COUNT = 200;
+
+static const char* const givenNames[] =
+{
+    "Anna", "Bernd", "Chloé", "Dieter", "Élise", "Frank", "Grete", "Hans",
+    "Ingrid", "Jürgen", "Karl", "Lena", "Max", "Nina", "Otto", "Paula"
+};
+
+static const char* const familyNames[] =
+{
+    "Müller", "Schmidt", "Schneider", "Fischer", "Weber", "Meyer", "Wagner",
+    "Becker", "Schulz", "Hoffmann", "Schäfer", "Koch", "Bauer", "Richter",
+    "Klein", "Wolf", "Schröder", "Neumann", "Schwarz", "Zimmermann"
+};
+
+static const int givenNameCount  = sizeof(givenNames) / sizeof(givenNames[0]);
+static const int familyNameCount = sizeof(familyNames) / sizeof(familyNames[0]);
+
+class AddresseeIndexBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testSearch_data();
+    void testSearch();
+    void testRemoveAndUpdate();
+    void benchmarkScan();
+    void benchmarkIndex();
+
+private:
+    static AddresseeList generateAddressees(int count);
+    static Addressee searchInput(const QString& uid, const QString& formattedName,
+                                 const QString& givenName, const QString& familyName,
+                                 const QString& email);
+    static AddresseeList scan(const AddresseeList& addressees, const Addressee& search,
+                              Qt::CaseSensitivity sensitivity, int maxCount = -1);
+    static QStringList uids(const AddresseeList& addressees);
+    QList<Addressee> queries() const;
+
+    AddresseeList m_addressees;
+    AddresseeList m_book;
+};
+
+QTEST_KDEMAIN(AddresseeIndexBenchmark, NoGUI)
+
+///////////////////////////////////////////////////////////////////////////////
+
+AddresseeList AddresseeIndexBenchmark::generateAddressees(int count)
+{
+    QByteArray vCards;
+    for (int i = 0; i < count; ++i)
+    {
+        const QString given  = QString::fromUtf8(givenNames[i % givenNameCount]);
+        const QString family = QString::fromUtf8(familyNames[(i / givenNameCount) % familyNameCount]);
+        const QString number = QString::number(i);
+
+        QString vCard = QLatin1String("BEGIN:VCARD\r\nVERSION:3.0\r\n");
+        vCard += QString::fromLatin1("UID:contact-%1\r\n").arg(number);
+        vCard += QString::fromLatin1("N:%1%2;%3;;;\r\n").arg(family, number, given);
+        vCard += QString::fromLatin1("FN:%1 %2%3\r\n").arg(given, family, number);
+        vCard += QString::fromLatin1("EMAIL:%1.%2%3@example.org\r\n").arg(given.toLower(), family.toLower(), number);
+        if (i % 3 == 0)
+            vCard += QString::fromLatin1("EMAIL:%1@Work.Example.COM\r\n").arg(number);
+        vCard += QLatin1String("END:VCARD\r\n");
+
+        vCards += vCard.toUtf8();
+    }
+
+    VCardConverter converter;
+    return converter.parseVCards(vCards);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Addressee AddresseeIndexBenchmark::searchInput(const QString& uid, const QString& formattedName,
+                                               const QString& givenName, const QString& familyName,
+                                               const QString& email)
+{
+    Addressee search;
+    search.setUid(uid);
+    search.setFormattedName(formattedName);
+    search.setGivenName(givenName);
+    search.setFamilyName(familyName);
+    if (!email.isEmpty()) search.insertEmail(email, true);
+
+    return search;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// what KABCClient did for every search input before using the index
+AddresseeList AddresseeIndexBenchmark::scan(const AddresseeList& addressees, const Addressee& search,
+                                            Qt::CaseSensitivity sensitivity, int maxCount)
+{
+    AddresseeList result;
+
+    AddresseeList::ConstIterator it    = addressees.begin();
+    AddresseeList::ConstIterator endIt = addressees.end();
+    for (; it != endIt; ++it)
+    {
+        if (!search.uid().isEmpty() && (*it).uid() == search.uid())
+        {
+            result.append(*it);
+        }
+        else if (!search.realName().isEmpty() &&
+                 (*it).realName().indexOf(search.realName(), 0, sensitivity) != -1)
+        {
+            result.append(*it);
+        }
+        else if (!search.familyName().isEmpty() &&
+                 (*it).realName().indexOf(search.familyName(), 0, sensitivity) != -1)
+        {
+            if (!search.givenName().isEmpty())
+            {
+                if ((*it).realName().indexOf(search.givenName(), 0, sensitivity) != -1)
+                {
+                    result.append(*it);
+                }
+            }
+            else
+                result.append(*it);
+        }
+        else if (!search.givenName().isEmpty() &&
+                 (*it).realName().indexOf(search.givenName(), 0, sensitivity) != -1)
+        {
+            result.append(*it);
+        }
+        else if (!search.preferredEmail().isEmpty())
+        {
+            QStringList matches = (*it).emails().filter(search.preferredEmail(), sensitivity);
+            if (matches.count() > 0)
+            {
+                result.append(*it);
+            }
+        }
+
+        if (maxCount != -1 && result.count() >= maxCount) break;
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QStringList AddresseeIndexBenchmark::uids(const AddresseeList& addressees)
+{
+    QStringList result;
+
+    AddresseeList::ConstIterator it    = addressees.begin();
+    AddresseeList::ConstIterator endIt = addressees.end();
+    for (; it != endIt; ++it)
+    {
+        result.append((*it).uid());
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+QList<Addressee> AddresseeIndexBenchmark::queries() const
+{
+    // a mix of unique and ambiguous search inputs, like a script would send
+    QList<Addressee> result;
+    for (int i = 0; i < QUERY_COUNT; ++i)
+    {
+        const int number = (i * 7919) % BOOK_SIZE;
+        const QString given  = QString::fromUtf8(givenNames[number % givenNameCount]);
+        const QString family = QString::fromUtf8(familyNames[(number / givenNameCount) % familyNameCount]);
+
+        switch (i % 4)
+        {
+            case 0:
+                result.append(searchInput(QString::fromLatin1("contact-%1").arg(number),
+                                          QString(), QString(), QString(), QString()));
+                break;
+
+            case 1:
+                result.append(searchInput(QString(), QString::fromLatin1("%1 %2%3").arg(given, family).arg(number),
+                                          QString(), QString(), QString()));
+                break;
+
+            case 2:
+                result.append(searchInput(QString(), QString(), QString(), QString(),
+                                          QString::fromLatin1("%1%2@").arg(family.toLower()).arg(number)));
+                break;
+
+            default:
+                result.append(searchInput(QString(), QString(), given, family + QString::number(number),
+                                          QString()));
+                break;
+        }
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AddresseeIndexBenchmark::initTestCase()
+{
+    m_addressees = generateAddressees(400);
+    QCOMPARE(m_addressees.count(), 400);
+
+    m_book = generateAddressees(BOOK_SIZE);
+    QCOMPARE(m_book.count(), BOOK_SIZE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AddresseeIndexBenchmark::testSearch_data()
+{
+    QTest::addColumn<Addressee>("search");
+
+    QTest::newRow("uid") << searchInput(QLatin1String("contact-17"), QString(), QString(), QString(), QString());
+    QTest::newRow("unknown uid") << searchInput(QLatin1String("nobody"), QString(), QString(), QString(), QString());
+    QTest::newRow("full name") << searchInput(QString(), QLatin1String("Bernd Müller1"), QString(), QString(), QString());
+    QTest::newRow("name part") << searchInput(QString(), QLatin1String("ller3"), QString(), QString(), QString());
+    QTest::newRow("other case") << searchInput(QString(), QString::fromUtf8("SCHRÖDER"), QString(), QString(), QString());
+    QTest::newRow("accented") << searchInput(QString(), QString::fromUtf8("élise"), QString(), QString(), QString());
+    QTest::newRow("short name") << searchInput(QString(), QLatin1String("na"), QString(), QString(), QString());
+    QTest::newRow("one letter") << searchInput(QString(), QLatin1String("x"), QString(), QString(), QString());
+    QTest::newRow("unknown name") << searchInput(QString(), QLatin1String("Nobody"), QString(), QString(), QString());
+    QTest::newRow("family") << searchInput(QString(), QString(), QString(), QLatin1String("Weber"), QString());
+    QTest::newRow("family and given") << searchInput(QString(), QString(), QLatin1String("Hans"), QLatin1String("weber"), QString());
+    QTest::newRow("given") << searchInput(QString(), QString(), QLatin1String("Otto"), QString(), QString());
+    QTest::newRow("email") << searchInput(QString(), QString(), QString(), QString(), QLatin1String("nina.fischer"));
+    QTest::newRow("email other case") << searchInput(QString(), QString(), QString(), QString(), QLatin1String("@WORK.example"));
+    QTest::newRow("email part") << searchInput(QString(), QString(), QString(), QString(), QLatin1String("12@"));
+    QTest::newRow("short email") << searchInput(QString(), QString(), QString(), QString(), QLatin1String("@w"));
+    QTest::newRow("name or email") << searchInput(QString(), QLatin1String("Koch"), QString(), QString(), QLatin1String("anna."));
+    QTest::newRow("uid or name") << searchInput(QLatin1String("contact-5"), QLatin1String("Paula Wolf"), QString(), QString(), QString());
+}
+
+void AddresseeIndexBenchmark::testSearch()
+{
+    QFETCH(Addressee, search);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        const Qt::CaseSensitivity sensitivity = (i == 0 ? Qt::CaseInsensitive : Qt::CaseSensitive);
+
+        AddresseeIndex index(sensitivity);
+        AddresseeList::ConstIterator it    = m_addressees.begin();
+        AddresseeList::ConstIterator endIt = m_addressees.end();
+        for (; it != endIt; ++it)
+        {
+            index.insert(*it);
+        }
+
+        QCOMPARE(uids(index.search(search)), uids(scan(m_addressees, search, sensitivity)));
+        QCOMPARE(uids(index.search(search, 2)), uids(scan(m_addressees, search, sensitivity, 2)));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AddresseeIndexBenchmark::testRemoveAndUpdate()
+{
+    AddresseeList addressees = m_addressees;
+
+    AddresseeIndex index(Qt::CaseInsensitive);
+    AddresseeList::ConstIterator it    = addressees.begin();
+    AddresseeList::ConstIterator endIt = addressees.end();
+    for (; it != endIt; ++it)
+    {
+        index.insert(*it);
+    }
+
+    // what the remove and merge operations do to the address book
+    AddresseeList remaining;
+    for (int i = 0; i < addressees.count(); ++i)
+    {
+        if (i % 5 == 0)
+            index.remove(addressees[i]);
+        else
+            remaining.append(addressees[i]);
+    }
+    addressees = remaining;
+
+    for (int i = 1; i < addressees.count(); i += 10)
+    {
+        Addressee addressee = addressees[i];
+        addressee.setFormattedName(QLatin1String("Renamed ") + addressee.formattedName());
+        addressee.insertEmail(QLatin1String("renamed@example.net"));
+        addressees[i] = addressee;
+        index.insert(addressee);
+    }
+
+    QList<Addressee> searches;
+    searches << searchInput(QString(), QLatin1String("renamed"), QString(), QString(), QString())
+             << searchInput(QString(), QString(), QString(), QString(), QLatin1String("renamed@"))
+             << searchInput(QString(), QLatin1String("Anna"), QString(), QString(), QString())
+             << searchInput(QLatin1String("contact-0"), QString(), QString(), QString(), QString())
+             << searchInput(QLatin1String("contact-1"), QString(), QString(), QString(), QString());
+
+    foreach (const Addressee& search, searches)
+    {
+        QCOMPARE(uids(index.search(search)), uids(scan(addressees, search, Qt::CaseInsensitive)));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AddresseeIndexBenchmark::benchmarkScan()
+{
+    const QList<Addressee> searches = queries();
+
+    int found = 0;
+    QBENCHMARK_ONCE
+    {
+        foreach (const Addressee& search, searches)
+        {
+            found += scan(m_book, search, Qt::CaseInsensitive).count();
+        }
+    }
+
+    QVERIFY(found >= QUERY_COUNT);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void AddresseeIndexBenchmark::benchmarkIndex()
+{
+    const QList<Addressee> searches = queries();
+
+    int found = 0;
+    QBENCHMARK_ONCE
+    {
+        // building the index is part of every run of the client
+        AddresseeIndex index(Qt::CaseInsensitive);
+        AddresseeList::ConstIterator it    = m_book.begin();
+        AddresseeList::ConstIterator endIt = m_book.end();
+        for (; it != endIt; ++it)
+        {
+            index.insert(*it);
+        }
+
+        foreach (const Addressee& search, searches)
+        {
+            found += index.search(search).count();
+        }
+    }
+
+    QVERIFY(found >= QUERY_COUNT);
+}
+
+#include "addresseeindexbenchmark.moc"
+
+// End of file
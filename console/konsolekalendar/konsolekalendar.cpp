@@ -43,6 +43,7 @@
 #include <QtCore/QDateTime>
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
+#include <QtCore/QVector>
 
 #include <kdebug.h>
 #include <klocale.h>
@@ -55,6 +56,7 @@
 #include <kcal/event.h>
 #include <kcal/htmlexport.h>
 #include <kcal/htmlexportsettings.h>
+#include <kcal/recurrence.h>
 
 using namespace KCal;
 using namespace std;
@@ -154,19 +156,10 @@ bool KonsoleKalendar::showInstance()
           Event::List sortedList =
             m_variables->getCalendar()->events( EventSortStartDate );
           if ( sortedList.count() > 0 ) {
-            KDateTime::Spec timeSpec = m_variables->getCalendar()->timeSpec();
-            QDate dt, firstdate, lastdate;
+            QDate firstdate, lastdate;
             firstdate = sortedList.first()->dtStart().date();
             lastdate = sortedList.last()->dtStart().date();
-            for ( dt = firstdate;
-                  dt <= lastdate && status != false;
-                  dt = dt.addDays( 1 ) ) {
-              Event::List events =
-                m_variables->getCalendar()->events( dt, timeSpec,
-                                                    EventSortStartDate,
-                                                    SortDirectionAscending );
-              status = printEventList( &ts, &events, dt );
-            }
+            status = printEventDays( &ts, firstdate, lastdate );
           }
 
         } else if ( m_variables->isUID() ) {
@@ -186,10 +179,11 @@ bool KonsoleKalendar::showInstance()
           datetime = datetime.addDays( 720 );
 
           KDateTime::Spec timeSpec = m_variables->getCalendar()->timeSpec();
-          QDate dt;
-          for ( dt = m_variables->getStartDateTime().date();
-                dt <= datetime.date();
-                dt = dt.addDays( 1 ) ) {
+          const QList<QDate> days =
+            eventDays( m_variables->getStartDateTime().date(), datetime.date() );
+          QList<QDate>::ConstIterator it;
+          for ( it = days.constBegin(); it != days.constEnd(); ++it ) {
+            const QDate dt = *it;
             Event::List events =
               m_variables->getCalendar()->events( dt, timeSpec,
                                                   EventSortStartDate,
@@ -206,17 +200,8 @@ bool KonsoleKalendar::showInstance()
           kDebug() << "konsolekalendar.cpp::showInstance() |"
                    << "view raw events within date range list";
 
-          KDateTime::Spec timeSpec = m_variables->getCalendar()->timeSpec();
-          QDate dt;
-          for ( dt = m_variables->getStartDateTime().date();
-                dt <= m_variables->getEndDateTime().date() && status != false;
-                dt = dt.addDays( 1 ) ) {
-            Event::List events =
-              m_variables->getCalendar()->events( dt, timeSpec,
-                                                  EventSortStartDate,
-                                                  SortDirectionAscending );
-            status = printEventList( &ts, &events, dt );
-          }
+          status = printEventDays( &ts, m_variables->getStartDateTime().date(),
+                                   m_variables->getEndDateTime().date() );
         }
       } else {
         QDate firstdate, lastdate;
@@ -298,6 +283,104 @@ bool KonsoleKalendar::showInstance()
   return status;
 }
 
+QList<QDate> KonsoleKalendar::eventDays( const QDate &first, const QDate &last ) const
+{
+  // The days are found in one pass over the events, without asking the
+  // calendar about every single day of the range. They are a superset of
+  // the days with events, with an extra day on both sides of each event for
+  // time zone differences, so that asking the calendar about these days
+  // only still finds everything.
+  QList<QDate> days;
+  const int dayCount = first.daysTo( last ) + 1;
+  if ( dayCount <= 0 ) {
+    return days;
+  }
+
+  QVector<bool> hasEvents( dayCount, false );
+  KDateTime::Spec timeSpec = m_variables->getCalendar()->timeSpec();
+
+  Event::List events = m_variables->getCalendar()->rawEvents();
+  Event::List::ConstIterator it;
+  for ( it = events.constBegin(); it != events.constEnd(); ++it ) {
+    Event *event = *it;
+    const QDate startDate = event->dtStart().toTimeSpec( timeSpec ).date();
+    const QDate endDate = event->dtEnd().toTimeSpec( timeSpec ).date();
+    const int length = qMax( 0, startDate.daysTo( endDate ) );
+
+    if ( !event->recurs() ) {
+      markDays( hasEvents, first, startDate.addDays( -1 ), endDate.addDays( 1 ) );
+      continue;
+    }
+
+    // no occurrence starts before the event itself or after the end of the
+    // recurrence, which is invalid if the recurrence goes on forever
+    const KDateTime recurrenceEnd = event->recurrence()->endDateTime();
+    const QDate spanFirst = qMax( first.addDays( -length - 1 ), startDate.addDays( -1 ) );
+    QDate spanLast = last.addDays( 1 );
+    if ( recurrenceEnd.isValid() ) {
+      spanLast = qMin( spanLast, recurrenceEnd.toTimeSpec( timeSpec ).date().addDays( 1 ) );
+    }
+    if ( spanFirst > spanLast ) {
+      continue;
+    }
+
+    const ushort type = event->recurrence()->recurrenceType();
+    if ( type == Recurrence::rMinutely || type == Recurrence::rHourly ||
+         type == Recurrence::rOther ) {
+      // too many occurrences to look at, it may be on any day of its span
+      markDays( hasEvents, first, spanFirst, spanLast.addDays( length ) );
+      continue;
+    }
+
+    const DateTimeList times =
+      event->recurrence()->timesInInterval(
+        KDateTime( spanFirst, QTime( 0, 0, 0 ), timeSpec ),
+        KDateTime( spanLast, QTime( 23, 59, 59 ), timeSpec ) );
+    DateTimeList::ConstIterator timeIt;
+    for ( timeIt = times.constBegin(); timeIt != times.constEnd(); ++timeIt ) {
+      const QDate date = (*timeIt).toTimeSpec( timeSpec ).date();
+      markDays( hasEvents, first, date.addDays( -1 ), date.addDays( length + 1 ) );
+    }
+  }
+
+  for ( int i = 0; i < dayCount; ++i ) {
+    if ( hasEvents[i] ) {
+      days.append( first.addDays( i ) );
+    }
+  }
+
+  return days;
+}
+
+void KonsoleKalendar::markDays( QVector<bool> &days, const QDate &first,
+                                const QDate &from, const QDate &to )
+{
+  const int begin = qMax( 0, first.daysTo( from ) );
+  const int end = qMin( days.count() - 1, first.daysTo( to ) );
+  for ( int i = begin; i <= end; ++i ) {
+    days[i] = true;
+  }
+}
+
+bool KonsoleKalendar::printEventDays( QTextStream *ts,
+                                      const QDate &first, const QDate &last )
+{
+  bool status = true;
+  KDateTime::Spec timeSpec = m_variables->getCalendar()->timeSpec();
+
+  const QList<QDate> days = eventDays( first, last );
+  QList<QDate>::ConstIterator it;
+  for ( it = days.constBegin(); it != days.constEnd() && status != false; ++it ) {
+    Event::List events =
+      m_variables->getCalendar()->events( *it, timeSpec,
+                                          EventSortStartDate,
+                                          SortDirectionAscending );
+    status = printEventList( ts, &events, *it );
+  }
+
+  return status;
+}
+
 bool KonsoleKalendar::printEventList( QTextStream *ts,
                                       Event::List *eventList, QDate date )
 {
@@ -397,22 +480,32 @@ bool KonsoleKalendar::isEvent( QDateTime startdate,
   Event *event;
   Event::List::ConstIterator it;
 
-  bool found = false;
-
   KDateTime::Spec timeSpec = m_variables->getCalendar()->timeSpec();
-  Event::List eventList( m_variables->getCalendar()->
-                         rawEventsForDate( startdate.date(), timeSpec,
-                                           EventSortStartDate,
-                                           SortDirectionAscending ) );
+
+  // Look for the summary and end first, which is a plain comparison for every
+  // event; only if one matches, whether it takes place on the start date
+  // has to be checked, which expands the recurrences of all events.
+  Event::List candidates;
+  Event::List eventList( m_variables->getCalendar()->rawEvents() );
   for ( it = eventList.constBegin(); it != eventList.constEnd(); ++it ) {
     event = *it;
-    if ( event->dtEnd().toTimeSpec( timeSpec ).dateTime() == enddate &&
-         event->summary() == summary ) {
-      found = true;
-      break;
+    if ( event->summary() == summary &&
+         event->dtEnd().toTimeSpec( timeSpec ).dateTime() == enddate ) {
+      candidates.append( event );
+    }
+  }
+
+  if ( candidates.isEmpty() ) {
+    return false;
+  }
+
+  eventList = m_variables->getCalendar()->rawEventsForDate( startdate.date(), timeSpec );
+  for ( it = candidates.constBegin(); it != candidates.constEnd(); ++it ) {
+    if ( eventList.contains( *it ) ) {
+      return true;
     }
   }
-  return found;
+  return false;
 }
 
 void KonsoleKalendar::printSpecs()
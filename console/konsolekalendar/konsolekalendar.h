@@ -29,6 +29,7 @@
 #define KONSOLEKALENDAR_H
 
 #include <QDateTime>
+#include <QVector>
 
 #include <kapplication.h>
 
@@ -111,6 +112,31 @@ class KonsoleKalendar
      */
     void printSpecs();
 
+    /**
+     * Returns the days from @p first to @p last on which events may take
+     * place. This includes all days with events, and maybe a few more.
+     *
+     * @param first is the first day of the range
+     * @param last is the last day of the range
+     */
+    QList<QDate> eventDays( const QDate &first, const QDate &last ) const;
+
+    /**
+     * Marks the days from @p from to @p to in @p days, which holds one
+     * entry per day starting at @p first. Days outside are ignored.
+     */
+    static void markDays( QVector<bool> &days, const QDate &first,
+                          const QDate &from, const QDate &to );
+
+    /**
+     * Prints the events of the days from @p first to @p last
+     *
+     * @param ts is the #QTextStream to be printed
+     * @param first is the first day to print
+     * @param last is the last day to print
+     */
+    bool printEventDays( QTextStream *ts, const QDate &first, const QDate &last );
+
     /**
      * Prints event list in many formats
      *
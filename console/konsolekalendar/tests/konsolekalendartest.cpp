@@ -0,0 +1,246 @@
+/*
+    This file is part of KonsoleKalendar.
+
+    Copyright (c) 2010 the KDE PIM authors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+    As a special exception, permission is given to link this program
+    with any edition of Qt, and distribute the resulting executable,
+    without including the source code for Qt in the source distribution.
+*/
+
+#include "konsolekalendar.h"
+#include "konsolekalendarexports.h"
+#include "konsolekalendarvariables.h"
+
+#include <kcal/calendarlocal.h>
+#include <kcal/calendarresources.h>
+#include <kcal/event.h>
+#include <kcal/recurrence.h>
+#include <kcal/resourcelocal.h>
+
+#include <ksystemtimezone.h>
+#include <ktempdir.h>
+#include <qtest_kde.h>
+
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+using namespace KCal;
+
+Q_DECLARE_METATYPE( ExportType )
+
+class KonsoleKalendarTest : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testShowInstance_data();
+    void testShowInstance();
+
+  private:
+    QString referenceOutput( const QDate &first, const QDate &last, ExportType type );
+
+    KTempDir *m_tempDir;
+    CalendarResources *m_calendar;
+};
+
+QTEST_KDEMAIN( KonsoleKalendarTest, NoGUI )
+
+static Event *newEvent( const QString &summary, const KDateTime &start, const KDateTime &end )
+{
+  Event *event = new Event;
+  event->setSummary( summary );
+  event->setDtStart( start );
+  event->setDtEnd( end );
+  return event;
+}
+
+static Event *newAllDayEvent( const QString &summary, const QDate &start, const QDate &end )
+{
+  Event *event = newEvent( summary, KDateTime( start ), KDateTime( end ) );
+  event->setAllDay( true );
+  return event;
+}
+
+void KonsoleKalendarTest::initTestCase()
+{
+  const KDateTime::Spec spec = KSystemTimeZones::local();
+  CalendarLocal calendar( spec );
+  Event *event;
+
+  event = newEvent( QLatin1String( "Weekly meeting" ),
+                    KDateTime( QDate( 2009, 1, 5 ), QTime( 10, 0 ), spec ),
+                    KDateTime( QDate( 2009, 1, 5 ), QTime( 11, 0 ), spec ) );
+  event->recurrence()->setWeekly( 1 );
+  event->recurrence()->setDuration( 10 );
+  calendar.addEvent( event );
+
+  event = newEvent( QLatin1String( "Overnight shift" ),
+                    KDateTime( QDate( 2009, 3, 1 ), QTime( 22, 0 ), spec ),
+                    KDateTime( QDate( 2009, 3, 2 ), QTime( 6, 0 ), spec ) );
+  event->recurrence()->setDaily( 1 );
+  event->recurrence()->setEndDate( QDate( 2009, 3, 20 ) );
+  event->recurrence()->addExDate( QDate( 2009, 3, 8 ) );
+  calendar.addEvent( event );
+
+  event = newEvent( QLatin1String( "Medication" ),
+                    KDateTime( QDate( 2009, 2, 10 ), QTime( 8, 0 ), spec ),
+                    KDateTime( QDate( 2009, 2, 10 ), QTime( 8, 15 ), spec ) );
+  event->recurrence()->setHourly( 6 );
+  event->recurrence()->setDuration( 12 );
+  calendar.addEvent( event );
+
+  event = newEvent( QLatin1String( "Conference" ),
+                    KDateTime( QDate( 2009, 4, 28 ), QTime( 9, 0 ), spec ),
+                    KDateTime( QDate( 2009, 5, 3 ), QTime( 17, 0 ), spec ) );
+  calendar.addEvent( event );
+
+  calendar.addEvent( newAllDayEvent( QLatin1String( "Holiday" ),
+                                     QDate( 2009, 6, 15 ), QDate( 2009, 6, 15 ) ) );
+  calendar.addEvent( newAllDayEvent( QLatin1String( "Trip" ),
+                                     QDate( 2009, 7, 1 ), QDate( 2009, 7, 3 ) ) );
+
+  event = newAllDayEvent( QLatin1String( "Birthday" ), QDate( 2005, 8, 20 ), QDate( 2005, 8, 20 ) );
+  event->recurrence()->setYearly( 1 );
+  calendar.addEvent( event );
+
+  event = newEvent( QLatin1String( "Rent" ),
+                    KDateTime( QDate( 2008, 11, 30 ), QTime( 12, 0 ), spec ),
+                    KDateTime( QDate( 2008, 11, 30 ), QTime( 12, 30 ), spec ) );
+  event->recurrence()->setMonthly( 1 );
+  event->recurrence()->setEndDate( QDate( 2009, 12, 31 ) );
+  event->recurrence()->addRDate( QDate( 2010, 2, 15 ) );
+  calendar.addEvent( event );
+
+  m_tempDir = new KTempDir;
+  const QString fileName = m_tempDir->name() + QLatin1String( "calendar.ics" );
+  QVERIFY( calendar.save( fileName ) );
+
+  // a family of its own, so that no configured resource gets in the way
+  m_calendar = new CalendarResources( spec, QLatin1String( "konsolekalendartest" ) );
+  ResourceLocal *resource = new ResourceLocal( fileName );
+  resource->setTimeSpec( spec );
+  m_calendar->resourceManager()->add( resource );
+  m_calendar->resourceManager()->setStandardResource( resource );
+  m_calendar->load();
+  QCOMPARE( m_calendar->rawEvents().count(), 8 );
+}
+
+void KonsoleKalendarTest::cleanupTestCase()
+{
+  delete m_calendar;
+  delete m_tempDir;
+}
+
+// what showInstance() printed before, asking the calendar about every day
+QString KonsoleKalendarTest::referenceOutput( const QDate &first, const QDate &last,
+                                              ExportType type )
+{
+  QString output;
+  QTextStream ts( &output );
+  KonsoleKalendarExports exports;
+  KDateTime::Spec timeSpec = m_calendar->timeSpec();
+
+  for ( QDate dt = first; dt <= last; dt = dt.addDays( 1 ) ) {
+    Event::List events = m_calendar->events( dt, timeSpec,
+                                             EventSortStartDate,
+                                             SortDirectionAscending );
+    Event::List::ConstIterator it;
+    for ( it = events.constBegin(); it != events.constEnd(); ++it ) {
+      if ( type == ExportTypeCSV ) {
+        exports.exportAsCSV( &ts, *it, dt );
+      } else {
+        exports.exportAsTxt( &ts, *it, dt );
+      }
+    }
+  }
+
+  ts.flush();
+  return output;
+}
+
+void KonsoleKalendarTest::testShowInstance_data()
+{
+  QTest::addColumn<ExportType>( "type" );
+  QTest::addColumn<bool>( "all" );
+  QTest::addColumn<QDate>( "first" );
+  QTest::addColumn<QDate>( "last" );
+
+  const ExportType types[] = { ExportTypeText, ExportTypeCSV };
+  for ( int i = 0; i < 2; ++i ) {
+    const ExportType type = types[i];
+    const char *name = type == ExportTypeCSV ? "csv" : "text";
+
+    QTest::newRow( ( QByteArray( name ) + " all" ).constData() )
+      << type << true << QDate() << QDate();
+    QTest::newRow( ( QByteArray( name ) + " year" ).constData() )
+      << type << false << QDate( 2009, 1, 1 ) << QDate( 2009, 12, 31 );
+    QTest::newRow( ( QByteArray( name ) + " twenty years" ).constData() )
+      << type << false << QDate( 2000, 1, 1 ) << QDate( 2019, 12, 31 );
+    QTest::newRow( ( QByteArray( name ) + " hourly" ).constData() )
+      << type << false << QDate( 2009, 2, 9 ) << QDate( 2009, 2, 13 );
+    QTest::newRow( ( QByteArray( name ) + " overnight" ).constData() )
+      << type << false << QDate( 2009, 3, 7 ) << QDate( 2009, 3, 9 );
+    QTest::newRow( ( QByteArray( name ) + " inside multi-day" ).constData() )
+      << type << false << QDate( 2009, 4, 30 ) << QDate( 2009, 5, 1 );
+    QTest::newRow( ( QByteArray( name ) + " all-day" ).constData() )
+      << type << false << QDate( 2009, 7, 2 ) << QDate( 2009, 7, 2 );
+    QTest::newRow( ( QByteArray( name ) + " extra date" ).constData() )
+      << type << false << QDate( 2010, 1, 1 ) << QDate( 2010, 3, 1 );
+  }
+}
+
+void KonsoleKalendarTest::testShowInstance()
+{
+  QFETCH( ExportType, type );
+  QFETCH( bool, all );
+  QFETCH( QDate, first );
+  QFETCH( QDate, last );
+
+  if ( all ) {
+    const Event::List sortedList = m_calendar->events( EventSortStartDate );
+    first = sortedList.first()->dtStart().date();
+    last = sortedList.last()->dtStart().date();
+  }
+
+  const QString fileName = m_tempDir->name() + QLatin1String( "output" );
+
+  KonsoleKalendarVariables variables;
+  variables.setCalendar( m_calendar );
+  variables.setExportType( type );
+  variables.setExportFile( fileName );
+  variables.setAll( all );
+  if ( !all ) {
+    variables.setStartDateTime( QDateTime( first, QTime( 0, 0 ) ) );
+    variables.setEndDateTime( QDateTime( last, QTime( 23, 59 ) ) );
+  }
+
+  KonsoleKalendar konsolekalendar( &variables );
+  QVERIFY( konsolekalendar.showInstance() );
+
+  QFile file( fileName );
+  QVERIFY( file.open( QIODevice::ReadOnly ) );
+  QTextStream ts( &file );
+  const QString output = ts.readAll();
+
+  QCOMPARE( output, referenceOutput( first, last, type ) );
+  QVERIFY( !output.isEmpty() );
+}
+
+#include "konsolekalendartest.moc"
@@ -0,0 +1,307 @@
+/*
+    This file is part of KAddressBook.
+
+    Copyright (c) 2010 the KDE PIM authors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include "../xxport/contactimportjob.h"
+#include "xxport.h"
+
+#include <akonadi/agentinstance.h>
+#include <akonadi/agentmanager.h>
+#include <akonadi/collection.h>
+#include <akonadi/collectionfetchjob.h>
+#include <akonadi/item.h>
+#include <akonadi/itemcreatejob.h>
+#include <akonadi/itemfetchjob.h>
+#include <akonadi/qtest_akonadi.h>
+#include <kabc/vcardconverter.h>
+#include <ktempdir.h>
+
+#include <QtCore/QEventLoop>
+#include <QtCore/QObject>
+#include <QtTest/QSignalSpy>
+#include <QtDBus/QDBusInterface>
+
+// large enough to show the difference, small enough for a test run
+static const int CONTACT_COUNT = 5000;
+
+/**
+ * An import module reading generated vCards, so that the benchmark
+ * measures parsing and storing without any file dialogs.
+ */
+class GeneratedXXPort : public XXPort
+{
+  public:
+    /**
+     * @param readCount If not null, is set to the number of contacts read so far.
+     */
+    explicit GeneratedXXPort( int count, int *readCount = 0 )
+      : mCount( count ), mNext( 0 ), mReadCount( readCount )
+    {
+    }
+
+    KABC::Addressee::List importContacts() const
+    {
+      return parse( 0, mCount );
+    }
+
+    bool exportContacts( const KABC::Addressee::List& ) const
+    {
+      return false;
+    }
+
+    bool beginImport()
+    {
+      mNext = 0;
+      return mCount > 0;
+    }
+
+    KABC::Addressee::List importNextContacts( int maxCount )
+    {
+      const int count = qMin( maxCount, mCount - mNext );
+      const KABC::Addressee::List contacts = parse( mNext, count );
+      mNext += count;
+      if ( mReadCount )
+        *mReadCount = mNext;
+
+      return contacts;
+    }
+
+    int importProgress() const
+    {
+      return mCount > 0 ? ( mNext * 100 ) / mCount : 100;
+    }
+
+  private:
+    static KABC::Addressee::List parse( int first, int count )
+    {
+      QByteArray data;
+      for ( int i = first; i < first + count; ++i ) {
+        const QByteArray number = QByteArray::number( i );
+        data += "BEGIN:VCARD\r\nVERSION:3.0\r\n"
+                "N:Contact " + number + ";Imported;;;\r\n"
+                "FN:Imported Contact " + number + "\r\n"
+                "EMAIL;TYPE=INTERNET:contact" + number + "@example.org\r\n"
+                "TEL;TYPE=WORK:+49 30 " + number + "\r\n"
+                "ADR;TYPE=HOME:;;Street " + number + ";Berlin;;10115;Germany\r\n"
+                "NOTE:Generated for the import benchmark\r\n"
+                "END:VCARD\r\n";
+      }
+
+      return KABC::VCardConverter().parseVCards( data );
+    }
+
+    int mCount;
+    int mNext;
+    int *mReadCount;
+};
+
+class ContactImportBenchmark : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void initTestCase();
+    void benchmarkOneJobPerContact();
+    void benchmarkBatchedImport();
+    void testImportedItems();
+    void testKill();
+    void testFailedBatches();
+
+  public Q_SLOTS:
+    void createJobDone( KJob *job );
+    void killJob( KJob *job );
+
+  private:
+    int itemCount();
+
+    KTempDir mContactsDir;
+    Akonadi::Collection mAddressBook;
+    QEventLoop *mLoop;
+    int mRunningJobs;
+    int mFailedJobs;
+};
+
+QTEST_AKONADIMAIN( ContactImportBenchmark, NoGUI )
+
+void ContactImportBenchmark::initTestCase()
+{
+  Akonadi::AgentInstance resource;
+  foreach ( const Akonadi::AgentInstance &instance, Akonadi::AgentManager::self()->instances() ) {
+    if ( instance.type().identifier() == QLatin1String( "akonadi_vcarddir_resource" ) )
+      resource = instance;
+  }
+  QVERIFY( resource.isValid() );
+
+  // let the resource store its files in a directory of its own
+  QDBusInterface settings( QLatin1String( "org.freedesktop.Akonadi.Resource." ) + resource.identifier(),
+                           QLatin1String( "/Settings" ) );
+  QVERIFY( settings.isValid() );
+  settings.call( QLatin1String( "setPath" ), mContactsDir.name() );
+  settings.call( QLatin1String( "writeConfig" ) );
+  resource.reconfigure();
+
+  for ( int i = 0; i < 100 && !mAddressBook.isValid(); ++i ) {
+    Akonadi::CollectionFetchJob *job = new Akonadi::CollectionFetchJob( Akonadi::Collection::root(),
+                                                                        Akonadi::CollectionFetchJob::Recursive );
+    AKVERIFYEXEC( job );
+
+    foreach ( const Akonadi::Collection &collection, job->collections() ) {
+      if ( collection.resource() == resource.identifier() &&
+           collection.contentMimeTypes().contains( KABC::Addressee::mimeType() ) )
+        mAddressBook = collection;
+    }
+
+    if ( !mAddressBook.isValid() )
+      QTest::qWait( 100 );
+  }
+  QVERIFY( mAddressBook.isValid() );
+}
+
+void ContactImportBenchmark::createJobDone( KJob *job )
+{
+  if ( job->error() )
+    ++mFailedJobs;
+
+  if ( --mRunningJobs == 0 )
+    mLoop->quit();
+}
+
+void ContactImportBenchmark::benchmarkOneJobPerContact()
+{
+  // what the import did before: read everything, then one job per contact
+  QBENCHMARK_ONCE {
+    const KABC::Addressee::List contacts = GeneratedXXPort( CONTACT_COUNT ).importContacts();
+
+    QEventLoop loop;
+    mLoop = &loop;
+    mRunningJobs = contacts.count();
+    mFailedJobs = 0;
+
+    foreach ( const KABC::Addressee &contact, contacts ) {
+      Akonadi::Item item;
+      item.setPayload<KABC::Addressee>( contact );
+      item.setMimeType( KABC::Addressee::mimeType() );
+
+      Akonadi::ItemCreateJob *job = new Akonadi::ItemCreateJob( item, mAddressBook );
+      connect( job, SIGNAL( result( KJob* ) ), SLOT( createJobDone( KJob* ) ) );
+    }
+
+    loop.exec();
+  }
+
+  QCOMPARE( mFailedJobs, 0 );
+}
+
+void ContactImportBenchmark::benchmarkBatchedImport()
+{
+  QBENCHMARK_ONCE {
+    GeneratedXXPort *xxport = new GeneratedXXPort( CONTACT_COUNT );
+    QVERIFY( xxport->beginImport() );
+
+    ContactImportJob *job = new ContactImportJob( xxport, mAddressBook );
+    job->setAutoDelete( false );
+    AKVERIFYEXEC( job );
+
+    QCOMPARE( job->importedCount(), CONTACT_COUNT );
+    QCOMPARE( job->failedCount(), 0 );
+    delete job;
+  }
+}
+
+void ContactImportBenchmark::testImportedItems()
+{
+  Akonadi::ItemFetchJob *job = new Akonadi::ItemFetchJob( mAddressBook );
+  AKVERIFYEXEC( job );
+
+  QCOMPARE( job->items().count(), 2 * CONTACT_COUNT );
+}
+
+int ContactImportBenchmark::itemCount()
+{
+  Akonadi::ItemFetchJob *job = new Akonadi::ItemFetchJob( mAddressBook );
+  if ( !job->exec() )
+    return -1;
+
+  return job->items().count();
+}
+
+void ContactImportBenchmark::killJob( KJob *job )
+{
+  // what cancelling the progress dialog does
+  job->kill( KJob::EmitResult );
+}
+
+void ContactImportBenchmark::testKill()
+{
+  const int before = itemCount();
+  QVERIFY( before >= 0 );
+
+  int readCount = 0;
+  GeneratedXXPort *xxport = new GeneratedXXPort( 1000, &readCount );
+  QVERIFY( xxport->beginImport() );
+
+  ContactImportJob *job = new ContactImportJob( xxport, mAddressBook );
+  job->setAutoDelete( false );
+  job->setBatchSize( 10 );
+  job->setMaximumRunningBatches( 1 );
+  // the progress is first reported once the first batch has been handed
+  // to the server
+  connect( job, SIGNAL( percent( KJob*, unsigned long ) ), SLOT( killJob( KJob* ) ) );
+
+  QSignalSpy resultSpy( job, SIGNAL( result( KJob* ) ) );
+  job->start();
+  QVERIFY( QTest::kWaitForSignal( job, SIGNAL( result( KJob* ) ), 10000 ) );
+  QCOMPARE( resultSpy.count(), 1 );
+  QCOMPARE( job->error(), int( KJob::KilledJobError ) );
+  QCOMPARE( readCount, 10 );
+
+  // the batch being stored is completed, but nothing after it
+  for ( int i = 0; i < 100 && itemCount() < before + 10; ++i )
+    QTest::qWait( 100 );
+  QTest::qWait( 500 );
+  QCOMPARE( itemCount(), before + 10 );
+  QCOMPARE( readCount, 10 );
+  QCOMPARE( resultSpy.count(), 1 );
+
+  delete job;
+}
+
+void ContactImportBenchmark::testFailedBatches()
+{
+  const int before = itemCount();
+
+  GeneratedXXPort *xxport = new GeneratedXXPort( 25 );
+  QVERIFY( xxport->beginImport() );
+
+  // the server refuses every contact for an address book that does not
+  // exist, so every batch fails and its contacts are stored one by one
+  ContactImportJob *job = new ContactImportJob( xxport, Akonadi::Collection( mAddressBook.id() + 1000 ) );
+  job->setAutoDelete( false );
+  job->setBatchSize( 10 );
+  QVERIFY( !job->exec() );
+
+  QCOMPARE( job->error(), int( KJob::UserDefinedError ) );
+  QCOMPARE( job->failedCount(), 25 );
+  QCOMPARE( job->importedCount(), 0 );
+  QCOMPARE( itemCount(), before );
+
+  delete job;
+}
+
+#include "contactimportbenchmark.moc"
@@ -0,0 +1,213 @@
+#include "../xxport/csv/qcsvreader.h"
+
+#include <qtest_kde.h>
+
+#include <QtCore/QBuffer>
+#include <QtCore/QObject>
+#include <QtCore/QTextCodec>
+
+class QCsvReaderTest : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void testParse_data();
+    void testParse();
+    void testStartRow();
+    void testByteOrderMark();
+    void testShortRows();
+    void benchmarkRead();
+    void benchmarkIndex();
+};
+
+QTEST_KDEMAIN( QCsvReaderTest, NoGUI )
+
+// Joins the fields of a row with '|', which none of the test data contain.
+static QStringList readWithBuilder( const QByteArray &data, const QChar &quote = QChar( '"' ), uint startRow = 0 )
+{
+  QBuffer buffer;
+  buffer.setData( data );
+  buffer.open( QIODevice::ReadOnly );
+
+  QCsvStandardBuilder builder;
+  QCsvReader reader( &builder );
+  reader.setDelimiter( ',' );
+  reader.setTextQuote( quote );
+  reader.setStartRow( startRow );
+  reader.setTextCodec( QTextCodec::codecForName( "UTF-8" ) );
+  reader.read( &buffer );
+
+  QStringList rows;
+  for ( uint row = 0; row < builder.rowCount(); ++row ) {
+    QStringList fields;
+    for ( uint column = 0; column < builder.columnCount(); ++column )
+      fields.append( builder.data( row, column ) );
+    rows.append( fields.join( "|" ) );
+  }
+  return rows;
+}
+
+static QStringList readWithIndex( const QByteArray &data, const QChar &quote = QChar( '"' ), uint startRow = 0 )
+{
+  QBuffer buffer;
+  buffer.setData( data );
+  buffer.open( QIODevice::ReadOnly );
+
+  QCsvIndex index;
+  QCsvReader reader;
+  reader.setDelimiter( ',' );
+  reader.setTextQuote( quote );
+  reader.setStartRow( startRow );
+  reader.setTextCodec( QTextCodec::codecForName( "UTF-8" ) );
+  reader.read( &buffer, &index );
+
+  QStringList rows;
+  for ( uint row = 0; row < index.rowCount(); ++row ) {
+    QStringList fields = index.row( row );
+    while ( (uint)fields.count() < index.columnCount() )
+      fields.append( QString() );
+    rows.append( fields.join( "|" ) );
+  }
+  return rows;
+}
+
+void QCsvReaderTest::testParse_data()
+{
+  QTest::addColumn<QByteArray>( "data" );
+  QTest::addColumn<QStringList>( "rows" );
+
+  QTest::newRow( "plain" ) << QByteArray( "a,b,c\n1,2,3\n" ) << ( QStringList() << "a|b|c" << "1|2|3" );
+  QTest::newRow( "no final line break" ) << QByteArray( "a,b\n1,2" ) << ( QStringList() << "a|b" << "1|2" );
+  QTest::newRow( "crlf and empty lines" ) << QByteArray( "\r\na,b\r\n\r\n\r\n1,2\r\n" ) << ( QStringList() << "a|b" << "1|2" );
+  QTest::newRow( "empty fields" ) << QByteArray( ",a,,b,\n" ) << ( QStringList() << "|a||b|" );
+  QTest::newRow( "delimiter in quotes" ) << QByteArray( "\"a,b\",c\n" ) << ( QStringList() << "a,b|c" );
+  QTest::newRow( "line break in quotes" ) << QByteArray( "\"a\r\nb\",c\nd,e\n" ) << ( QStringList() << "a\r\nb|c" << "d|e" );
+  QTest::newRow( "doubled quotes" ) << QByteArray( "\"say \"\"hi\"\"\",x\n" ) << ( QStringList() << "say \"hi\"|x" );
+  QTest::newRow( "only doubled quotes" ) << QByteArray( "\"\"\"\",x\n" ) << ( QStringList() << "\"|x" );
+  QTest::newRow( "empty quoted fields" ) << QByteArray( "\"\",\"\"\n" ) << ( QStringList() << "|" );
+  QTest::newRow( "text after closing quote" ) << QByteArray( "\"abc\"def,g\n" ) << ( QStringList() << "abcdef|g" );
+  QTest::newRow( "quote inside unquoted field" ) << QByteArray( "ab\"c,d\n" ) << ( QStringList() << "ab\"c|d" );
+  QTest::newRow( "unterminated quote" ) << QByteArray( "a,\"bc\nd" ) << ( QStringList() << "a|bc\nd" );
+  QTest::newRow( "non-ascii" ) << QByteArray( "\xc3\xa4,\"\xc3\xb6\"\n" ) << ( QStringList() << QString::fromUtf8( "\xc3\xa4|\xc3\xb6" ) );
+}
+
+void QCsvReaderTest::testParse()
+{
+  QFETCH( QByteArray, data );
+  QFETCH( QStringList, rows );
+
+  QCOMPARE( readWithBuilder( data ), rows );
+  QCOMPARE( readWithIndex( data ), rows );
+}
+
+void QCsvReaderTest::testStartRow()
+{
+  const QByteArray data( "\"Name\",\"E-Mail\"\n\"Joe\",joe@example.org\n\"Jane\",jane@example.org\n" );
+  const QStringList rows = QStringList() << "Joe|joe@example.org" << "Jane|jane@example.org";
+
+  QCOMPARE( readWithBuilder( data, '"', 1 ), rows );
+  QCOMPARE( readWithIndex( data, '"', 1 ), rows );
+}
+
+void QCsvReaderTest::testByteOrderMark()
+{
+  QByteArray data( "\xef\xbb\xbf" "a,\xc3\xa4\n" );
+  QCOMPARE( readWithIndex( data ), QStringList() << QString::fromUtf8( "a|\xc3\xa4" ) );
+
+  // quoting disabled
+  data = "\"a\",b\n";
+  QCOMPARE( readWithIndex( data, QChar() ), QStringList() << "\"a\"|b" );
+  QCOMPARE( readWithBuilder( data, QChar() ), QStringList() << "\"a\"|b" );
+}
+
+void QCsvReaderTest::testShortRows()
+{
+  QBuffer buffer;
+  buffer.setData( "a\nb,c,d\ne,f\n" );
+  buffer.open( QIODevice::ReadOnly );
+
+  QCsvStandardBuilder builder;
+  QCsvReader reader( &builder );
+  reader.setDelimiter( ',' );
+  QVERIFY( reader.read( &buffer ) );
+
+  QCOMPARE( builder.rowCount(), 3u );
+  QCOMPARE( builder.columnCount(), 3u );
+  QCOMPARE( builder.data( 0, 0 ), QString( "a" ) );
+  QVERIFY( builder.data( 0, 1 ).isNull() );
+  QCOMPARE( builder.data( 1, 2 ), QString( "d" ) );
+  QCOMPARE( builder.data( 2, 1 ), QString( "f" ) );
+  QVERIFY( builder.data( 2, 2 ).isNull() );
+  QVERIFY( builder.data( 3, 0 ).isNull() );
+
+  QCsvIndex index;
+  buffer.reset();
+  QVERIFY( reader.read( &buffer, &index ) );
+  QCOMPARE( index.rowCount(), 3u );
+  QCOMPARE( index.columnCount(), 3u );
+  QCOMPARE( index.row( 2 ), QStringList() << "e" << "f" );
+  QVERIFY( index.row( 3 ).isEmpty() );
+}
+
+// A CRM style export: a header and rows of 60 columns, some of them quoted.
+static QByteArray makeExport( int rows )
+{
+  QByteArray data;
+  for ( int column = 0; column < 60; ++column )
+    data += "\"Column " + QByteArray::number( column ) + ( column < 59 ? "\"," : "\"\r\n" );
+
+  for ( int row = 0; row < rows; ++row ) {
+    for ( int column = 0; column < 60; ++column ) {
+      if ( column % 3 == 0 )
+        data += "\"Street " + QByteArray::number( row ) + ", \"\"Apt\"\" " + QByteArray::number( column ) + '"';
+      else
+        data += "value" + QByteArray::number( row * 60 + column );
+      data += ( column < 59 ? "," : "\r\n" );
+    }
+  }
+  return data;
+}
+
+void QCsvReaderTest::benchmarkRead()
+{
+  QBuffer buffer;
+  buffer.setData( makeExport( 10000 ) );
+  buffer.open( QIODevice::ReadOnly );
+
+  QCsvStandardBuilder builder;
+  QCsvReader reader( &builder );
+  reader.setDelimiter( ',' );
+  reader.setStartRow( 1 );
+
+  QBENCHMARK {
+    buffer.reset();
+    reader.read( &buffer );
+  }
+
+  QCOMPARE( builder.rowCount(), 10000u );
+  QCOMPARE( builder.columnCount(), 60u );
+  QCOMPARE( builder.data( 9999, 57 ), QString( "Street 9999, \"Apt\" 57" ) );
+}
+
+void QCsvReaderTest::benchmarkIndex()
+{
+  QBuffer buffer;
+  buffer.setData( makeExport( 10000 ) );
+  buffer.open( QIODevice::ReadOnly );
+
+  QCsvIndex index;
+  QCsvReader reader;
+  reader.setDelimiter( ',' );
+  reader.setStartRow( 1 );
+
+  QBENCHMARK {
+    buffer.reset();
+    reader.read( &buffer, &index );
+  }
+
+  QCOMPARE( index.rowCount(), 10000u );
+  QCOMPARE( index.columnCount(), 60u );
+  QCOMPARE( index.row( 9999 ).at( 58 ), QString( "value" ) + QString::number( 9999 * 60 + 58 ) );
+}
+
+#include "qcsvreadertest.moc"
@@ -0,0 +1,214 @@
+/*
+    This file is part of KAddressBook.
+
+    Copyright (c) 2010 the KDE PIM authors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#include "contactimportjob.h"
+
+#include "xxport.h"
+
+#include <akonadi/collection.h>
+#include <akonadi/item.h>
+#include <akonadi/itemcreatejob.h>
+#include <akonadi/transactionsequence.h>
+#include <kdebug.h>
+#include <klocale.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QTimer>
+
+class ContactImportJob::Private
+{
+  public:
+    Private( ContactImportJob *qq, XXPort *xxport, const Akonadi::Collection &collection )
+      : q( qq ), mXXPort( xxport ), mCollection( collection ),
+        mBatchSize( 100 ), mMaximumRunningBatches( 4 ), mRunningContacts( 0 ),
+        mImportedCount( 0 ), mFailedCount( 0 ),
+        mAtEnd( false ), mFilling( false ), mFinished( false )
+    {
+    }
+
+    ~Private()
+    {
+      delete mXXPort;
+    }
+
+    void fillWindow()
+    {
+      // reading may show a message box, whose event loop delivers the
+      // results of running batches
+      if ( mFilling || mFinished )
+        return;
+
+      mFilling = true;
+
+      while ( !mAtEnd && mBatches.count() < mMaximumRunningBatches ) {
+        KABC::Addressee::List contacts;
+        if ( !mPendingContacts.isEmpty() ) {
+          contacts = mPendingContacts;
+          mPendingContacts.clear();
+        } else {
+          contacts = mXXPort->importNextContacts( mBatchSize );
+        }
+
+        if ( contacts.isEmpty() )
+          mAtEnd = true;
+        else
+          storeBatch( contacts );
+      }
+
+      mFilling = false;
+
+      q->setPercent( mXXPort->importProgress() );
+
+      if ( mAtEnd && !mFinished && mBatches.isEmpty() && mRunningContacts == 0 ) {
+        mFinished = true;
+
+        if ( mFailedCount > 0 ) {
+          q->setError( UserDefinedError );
+          q->setErrorText( i18np( "One contact could not be imported.",
+                                  "%1 contacts could not be imported.", mFailedCount ) );
+        }
+
+        q->emitResult();
+      }
+    }
+
+    void storeBatch( const KABC::Addressee::List &contacts )
+    {
+      // one transaction per batch saves the server a commit per contact
+      Akonadi::TransactionSequence *transaction = new Akonadi::TransactionSequence();
+
+      foreach ( const KABC::Addressee &contact, contacts )
+        new Akonadi::ItemCreateJob( item( contact ), mCollection, transaction );
+
+      transaction->commit();
+
+      q->connect( transaction, SIGNAL( result( KJob* ) ), SLOT( batchDone( KJob* ) ) );
+      mBatches.insert( transaction, contacts );
+    }
+
+    void batchDone( KJob *job )
+    {
+      const KABC::Addressee::List contacts = mBatches.take( job );
+
+      if ( job->error() ) {
+        kWarning() << "Storing a batch of contacts failed:" << job->errorString();
+
+        // the whole transaction has been rolled back, so store the contacts
+        // one by one to find the ones that cannot be stored
+        foreach ( const KABC::Addressee &contact, contacts ) {
+          Akonadi::ItemCreateJob *createJob = new Akonadi::ItemCreateJob( item( contact ), mCollection );
+          q->connect( createJob, SIGNAL( result( KJob* ) ), SLOT( contactDone( KJob* ) ) );
+          ++mRunningContacts;
+        }
+      } else {
+        mImportedCount += contacts.count();
+      }
+
+      fillWindow();
+    }
+
+    void contactDone( KJob *job )
+    {
+      --mRunningContacts;
+
+      if ( job->error() ) {
+        kWarning() << "Storing a contact failed:" << job->errorString();
+        ++mFailedCount;
+      } else {
+        ++mImportedCount;
+      }
+
+      fillWindow();
+    }
+
+    static Akonadi::Item item( const KABC::Addressee &contact )
+    {
+      Akonadi::Item item;
+      item.setPayload<KABC::Addressee>( contact );
+      item.setMimeType( KABC::Addressee::mimeType() );
+
+      return item;
+    }
+
+    ContactImportJob *q;
+    XXPort *mXXPort;
+    Akonadi::Collection mCollection;
+    KABC::Addressee::List mPendingContacts;
+    QHash<KJob*, KABC::Addressee::List> mBatches;
+    int mBatchSize;
+    int mMaximumRunningBatches;
+    int mRunningContacts;
+    int mImportedCount;
+    int mFailedCount;
+    bool mAtEnd;
+    bool mFilling;
+    bool mFinished;
+};
+
+ContactImportJob::ContactImportJob( XXPort *xxport, const Akonadi::Collection &collection, QObject *parent )
+  : KJob( parent ), d( new Private( this, xxport, collection ) )
+{
+}
+
+ContactImportJob::~ContactImportJob()
+{
+  delete d;
+}
+
+void ContactImportJob::setBatchSize( int size )
+{
+  d->mBatchSize = qMax( 1, size );
+}
+
+void ContactImportJob::setMaximumRunningBatches( int count )
+{
+  d->mMaximumRunningBatches = qMax( 1, count );
+}
+
+void ContactImportJob::setPendingContacts( const KABC::Addressee::List &contacts )
+{
+  d->mPendingContacts = contacts;
+}
+
+int ContactImportJob::importedCount() const
+{
+  return d->mImportedCount;
+}
+
+int ContactImportJob::failedCount() const
+{
+  return d->mFailedCount;
+}
+
+void ContactImportJob::start()
+{
+  QTimer::singleShot( 0, this, SLOT( fillWindow() ) );
+}
+
+bool ContactImportJob::doKill()
+{
+  // batches already handed to the server are completed anyway
+  d->mAtEnd = true;
+  d->mFinished = true;
+
+  return true;
+}
+
+#include "contactimportjob.moc"
@@ -0,0 +1,110 @@
+/*
+    This file is part of KAddressBook.
+
+    Copyright (c) 2010 the KDE PIM authors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CONTACTIMPORTJOB_H
+#define CONTACTIMPORTJOB_H
+
+#include <kabc/addressee.h>
+#include <kjob.h>
+
+namespace Akonadi {
+class Collection;
+}
+
+class XXPort;
+
+/**
+ * @short A job that stores the contacts read by an import module in Akonadi.
+ *
+ * The contacts are read from the module in batches, each of which is stored
+ * within one transaction. Only a limited number of batches is in flight at
+ * any time, so the memory needed does not grow with the size of the import.
+ *
+ * The job reports the progress of the module via the percent() signal and
+ * fails with UserDefinedError if some of the contacts could not be stored.
+ */
+class ContactImportJob : public KJob
+{
+  Q_OBJECT
+
+  public:
+    /**
+     * Creates a new contact import job.
+     *
+     * @param xxport The import module to read from, beginImport() must have
+     *               been called on it already. The job takes ownership of it.
+     * @param collection The address book the contacts shall be stored in.
+     * @param parent The parent object.
+     */
+    ContactImportJob( XXPort *xxport, const Akonadi::Collection &collection, QObject *parent = 0 );
+
+    /**
+     * Destroys the contact import job.
+     */
+    ~ContactImportJob();
+
+    /**
+     * Sets the number of contacts that are stored in one transaction.
+     * The default is 100.
+     */
+    void setBatchSize( int size );
+
+    /**
+     * Sets the number of transactions that may run at the same time.
+     * The default is 4.
+     */
+    void setMaximumRunningBatches( int count );
+
+    /**
+     * Sets @p contacts that have already been read from the import module
+     * and shall be stored before reading any further ones.
+     */
+    void setPendingContacts( const KABC::Addressee::List &contacts );
+
+    /**
+     * Returns the number of contacts stored so far.
+     */
+    int importedCount() const;
+
+    /**
+     * Returns the number of contacts that could not be stored.
+     */
+    int failedCount() const;
+
+    /**
+     * Starts the job.
+     */
+    virtual void start();
+
+  protected:
+    virtual bool doKill();
+
+  private:
+    //@cond PRIVATE
+    class Private;
+    Private* const d;
+
+    Q_PRIVATE_SLOT( d, void fillWindow() )
+    Q_PRIVATE_SLOT( d, void batchDone( KJob* ) )
+    Q_PRIVATE_SLOT( d, void contactDone( KJob* ) )
+    //@endcond
+};
+
+#endif
@@ -34,10 +34,15 @@
 #include <QtCore/QTextStream>
 
 CsvXXPort::CsvXXPort( QWidget *parent )
-  : XXPort( parent )
+  : XXPort( parent ), mImportRow( 0 ), mImportRowCount( 0 )
 {
 }
 
+CsvXXPort::~CsvXXPort()
+{
+  delete mImportDialog;
+}
+
 bool CsvXXPort::exportContacts( const KABC::Addressee::List &contacts ) const
 {
   KUrl url = KFileDialog::getSaveUrl( KUrl( "addressbook.csv" ) );
@@ -144,3 +149,42 @@ KABC::Addressee::List CsvXXPort::importContacts() const
 
   return contacts;
 }
+
+bool CsvXXPort::beginImport()
+{
+  mImportDialog = new CSVImportDialog( parentWidget() );
+  if ( !mImportDialog->exec() || !mImportDialog ) {
+    delete mImportDialog;
+    return false;
+  }
+
+  // the dialog keeps the indexed file, rows are converted when asked for
+  mImportRow = 1;
+  mImportRowCount = mImportDialog->rowCount();
+
+  return mImportRow < mImportRowCount;
+}
+
+KABC::Addressee::List CsvXXPort::importNextContacts( int maxCount )
+{
+  KABC::Addressee::List contacts;
+
+  while ( mImportDialog && contacts.count() < maxCount && mImportRow < mImportRowCount ) {
+    const int count = maxCount - contacts.count();
+    contacts += mImportDialog->contacts( mImportRow, count );
+    mImportRow += count;
+  }
+
+  if ( mImportRow >= mImportRowCount )
+    delete mImportDialog;
+
+  return contacts;
+}
+
+int CsvXXPort::importProgress() const
+{
+  if ( mImportRowCount <= 1 )
+    return 100;
+
+  return qMin( 100, ( ( mImportRow - 1 ) * 100 ) / ( mImportRowCount - 1 ) );
+}
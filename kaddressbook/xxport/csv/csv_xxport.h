@@ -22,18 +22,30 @@
 
 #include "xxport.h"
 
+#include <QtCore/QPointer>
+
+class CSVImportDialog;
 class QFile;
 
 class CsvXXPort : public XXPort
 {
   public:
     CsvXXPort( QWidget *parent = 0 );
+    ~CsvXXPort();
 
     bool exportContacts( const KABC::Addressee::List &contacts ) const;
     KABC::Addressee::List importContacts() const;
 
+    bool beginImport();
+    KABC::Addressee::List importNextContacts( int maxCount );
+    int importProgress() const;
+
   private:
     void exportToFile( QFile*, const KABC::Addressee::List& ) const;
+
+    QPointer<CSVImportDialog> mImportDialog;
+    int mImportRow;
+    int mImportRowCount;
 };
 
 #endif
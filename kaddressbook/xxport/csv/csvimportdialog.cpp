@@ -223,26 +223,7 @@ KABC::AddresseeList CSVImportDialog::contacts() const
   kapp->processEvents();
 
   for ( int row = 1; row < mModel->rowCount(); ++row ) {
-    KABC::Addressee contact;
-    bool emptyRow = true;
-
-    for ( int column = 0; column < mModel->columnCount(); ++column ) {
-      QString value = mModel->data( mModel->index( row, column ), Qt::DisplayRole ).toString();
-
-      if ( !value.isEmpty() ) {
-        emptyRow = false;
-
-        const ContactFields::Field field = (ContactFields::Field)mModel->data( mModel->index( 0, column ) ).toUInt();
-
-        // convert the custom date format to ISO format
-        if ( field == ContactFields::Birthday || field == ContactFields::Anniversary )
-          value = dateParser.parse( value ).toString( Qt::ISODate );
-
-        value.replace( "\\n", "\n" );
-
-        ContactFields::setValue( field, value, contact );
-      }
-    }
+    const KABC::Addressee contact = this->contact( row, dateParser );
 
     kapp->processEvents();
 
@@ -251,13 +232,57 @@ KABC::AddresseeList CSVImportDialog::contacts() const
 
     progressDialog.progressBar()->setValue( progressDialog.progressBar()->value() + 1 );
 
-    if ( !emptyRow && !contact.isEmpty() )
+    if ( !contact.isEmpty() )
       contacts.append( contact );
   }
 
   return contacts;
 }
 
+KABC::AddresseeList CSVImportDialog::contacts( int firstRow, int count ) const
+{
+  KABC::AddresseeList contacts;
+  const DateParser dateParser( mDatePatternEdit->text() );
+
+  // the first row holds the field selection
+  const int lastRow = qMin( firstRow + count, mModel->rowCount() );
+  for ( int row = qMax( firstRow, 1 ); row < lastRow; ++row ) {
+    const KABC::Addressee contact = this->contact( row, dateParser );
+    if ( !contact.isEmpty() )
+      contacts.append( contact );
+  }
+
+  return contacts;
+}
+
+int CSVImportDialog::rowCount() const
+{
+  return mModel->rowCount();
+}
+
+KABC::Addressee CSVImportDialog::contact( int row, const DateParser &dateParser ) const
+{
+  KABC::Addressee contact;
+
+  for ( int column = 0; column < mModel->columnCount(); ++column ) {
+    QString value = mModel->data( mModel->index( row, column ), Qt::DisplayRole ).toString();
+
+    if ( !value.isEmpty() ) {
+      const ContactFields::Field field = (ContactFields::Field)mModel->data( mModel->index( 0, column ) ).toUInt();
+
+      // convert the custom date format to ISO format
+      if ( field == ContactFields::Birthday || field == ContactFields::Anniversary )
+        value = dateParser.parse( value ).toString( Qt::ISODate );
+
+      value.replace( "\\n", "\n" );
+
+      ContactFields::setValue( field, value, contact );
+    }
+  }
+
+  return contact;
+}
+
 void CSVImportDialog::initGUI()
 {
   QWidget *page = new QWidget( this );
@@ -36,6 +36,8 @@ class QCheckBox;
 class QCsvModel;
 class QTableView;
 
+class DateParser;
+
 class CSVImportDialog : public KDialog
 {
   Q_OBJECT
@@ -45,6 +47,8 @@ class CSVImportDialog : public KDialog
     ~CSVImportDialog();
 
     KABC::AddresseeList contacts() const;
+    KABC::AddresseeList contacts( int firstRow, int count ) const;
+    int rowCount() const;
 
   protected Q_SLOTS:
     virtual void slotButtonClicked( int );
@@ -65,6 +69,8 @@ class CSVImportDialog : public KDialog
     void finalizeApplyTemplate();
 
   private:
+    KABC::Addressee contact( int row, const DateParser &dateParser ) const;
+
     void applyTemplate();
     void saveTemplate();
 
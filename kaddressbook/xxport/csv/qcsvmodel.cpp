@@ -21,69 +21,49 @@
 #include "qcsvmodel_p.h"
 #include "qcsvreader.h"
 
-#include <QtCore/QMap>
-#include <QtCore/QPair>
+#include <QtCore/QCache>
+#include <QtCore/QIODevice>
 #include <QtCore/QStringList>
 #include <QtCore/QVector>
 
 CsvParser::CsvParser( QObject *parent )
-  : QThread( parent ), mDevice( 0 )
+  : QThread( parent ), mDevice( 0 ), mIndex( 0 )
 {
-  mReader = new QCsvReader( this );
+  mReader = new QCsvReader();
 }
 
 CsvParser::~CsvParser()
 {
+  if ( isRunning() ) {
+    mReader->terminate();
+    wait();
+  }
+
   delete mReader;
+  delete mIndex;
 }
 
 void CsvParser::load( QIODevice *device )
 {
-  mDevice = device;
-
-  start();
-}
-
-void CsvParser::begin()
-{
-  mCacheCounter = 0;
-  mRowCount = 0;
-  mColumnCount = 0;
-}
-
-void CsvParser::beginLine()
-{
-  mRowCount++;
-}
-
-void CsvParser::field( const QString &data, uint row, uint column )
-{
-  const int tmp = qMax( mColumnCount, (int)column + 1 );
-  if ( tmp != mColumnCount ) {
-    mColumnCount = tmp;
-    emit columnCountChanged( tmp );
+  if ( isRunning() ) {
+    mReader->terminate();
+    wait();
   }
 
-  emit dataChanged( data, row, column );
-}
+  mDevice = device;
 
-void CsvParser::endLine()
-{
-  mCacheCounter++;
-  if ( mCacheCounter == 50 ) {
-    emit rowCountChanged( mRowCount );
-    mCacheCounter = 0;
-  }
+  start();
 }
 
-void CsvParser::end()
+QCsvIndex* CsvParser::takeIndex()
 {
-  emit rowCountChanged( mRowCount );
-  emit ended();
-}
+  if ( isRunning() )
+    return 0;
 
-void CsvParser::error( const QString& )
-{
+  QMutexLocker locker( &mMutex );
+  QCsvIndex *index = mIndex;
+  mIndex = 0;
+  return index;
 }
 
 void CsvParser::run()
@@ -92,54 +72,70 @@ void CsvParser::run()
     mDevice->open( QIODevice::ReadOnly );
 
   mDevice->reset();
-  mReader->read( mDevice );
+
+  QCsvIndex *index = new QCsvIndex;
+  mReader->read( mDevice, index );
+
+  {
+    QMutexLocker locker( &mMutex );
+    delete mIndex;
+    mIndex = index;
+  }
+
+  emit ended();
 }
 
 class QCsvModel::Private
 {
   public:
     Private( QCsvModel *model )
-      : mParent( model ),
-        mDevice( 0 ), mRowCount( 0 ), mColumnCount( 0 )
+      : mParent( model ), mIndex( 0 ), mDevice( 0 )
     {
+      // views and the import ask for the fields row by row
+      mRowCache.setMaxCost( 256 );
     }
 
-    void columnCountChanged( int columns );
-    void rowCountChanged( int rows );
-    void fieldChanged( const QString &data, int row, int column );
+    ~Private()
+    {
+      delete mIndex;
+    }
+
+    const QStringList *row( int row ) const;
+
     void finishedLoading();
 
     QCsvModel *mParent;
     CsvParser *mParser;
+    QCsvIndex *mIndex;
+    mutable QCache<int, QStringList> mRowCache;
     QVector<QString> mFieldIdentifiers;
-    QMap< QPair<int, int>, QString> mFields;
     QIODevice *mDevice;
-
-    int mRowCount;
-    int mColumnCount;
 };
 
-void QCsvModel::Private::columnCountChanged( int columns )
-{
-  mColumnCount = columns;
-  mFieldIdentifiers.resize( columns );
-  mFieldIdentifiers[ columns - 1 ] = QString( "0" );
-  emit mParent->layoutChanged();
-}
-
-void QCsvModel::Private::rowCountChanged( int rows )
+const QStringList *QCsvModel::Private::row( int row ) const
 {
-  mRowCount = rows;
-  emit mParent->layoutChanged();
-}
+  QStringList *fields = mRowCache.object( row );
+  if ( !fields ) {
+    fields = new QStringList( mIndex->row( row ) );
+    mRowCache.insert( row, fields );
+  }
 
-void QCsvModel::Private::fieldChanged( const QString &data, int row, int column )
-{
-  mFields.insert( QPair<int, int>( row, column ), data );
+  return fields;
 }
 
 void QCsvModel::Private::finishedLoading()
 {
+  QCsvIndex *index = mParser->takeIndex();
+  if ( !index )
+    return; // superseded by a newer load
+
+  mParent->beginResetModel();
+  delete mIndex;
+  mIndex = index;
+  mRowCache.clear();
+  mFieldIdentifiers.fill( QString( "0" ), mIndex->columnCount() );
+  mParent->endResetModel();
+
   emit mParent->finishedLoading();
 }
 
@@ -148,13 +144,7 @@ QCsvModel::QCsvModel( QObject *parent )
 {
   d->mParser = new CsvParser( this );
 
-  connect( d->mParser, SIGNAL( columnCountChanged( int ) ),
-           this, SLOT( columnCountChanged( int ) ), Qt::QueuedConnection );
-  connect( d->mParser, SIGNAL( rowCountChanged( int ) ),
-           this, SLOT( rowCountChanged( int ) ), Qt::QueuedConnection );
-  connect( d->mParser, SIGNAL( dataChanged( const QString&, int, int ) ),
-           this, SLOT( fieldChanged( const QString&, int, int ) ), Qt::QueuedConnection );
-  connect( d->mParser, SIGNAL( ended() ), this, SLOT( finishedLoading() ) );
+  connect( d->mParser, SIGNAL( ended() ), this, SLOT( finishedLoading() ), Qt::QueuedConnection );
 }
 
 QCsvModel::~QCsvModel()
@@ -165,10 +155,12 @@ QCsvModel::~QCsvModel()
 bool QCsvModel::load( QIODevice *device )
 {
   d->mDevice = device;
-  d->mRowCount = 0;
-  d->mColumnCount = 0;
 
-  emit layoutChanged();
+  beginResetModel();
+  delete d->mIndex;
+  d->mIndex = 0;
+  d->mRowCache.clear();
+  endResetModel();
 
   d->mParser->load( device );
 
@@ -257,8 +249,8 @@ QTextCodec *QCsvModel::textCodec() const
 
 int QCsvModel::columnCount( const QModelIndex &parent ) const
 {
-  if ( !parent.isValid() )
-    return d->mColumnCount;
+  if ( !parent.isValid() && d->mIndex )
+    return d->mIndex->columnCount();
   else
     return 0;
 }
@@ -266,7 +258,7 @@ int QCsvModel::columnCount( const QModelIndex &parent ) const
 int QCsvModel::rowCount( const QModelIndex &parent ) const
 {
   if ( !parent.isValid() )
-    return d->mRowCount + 1; // +1 for the header row
+    return (d->mIndex ? d->mIndex->rowCount() : 0) + 1; // +1 for the header row
   else
     return 0;
 }
@@ -286,21 +278,19 @@ QVariant QCsvModel::data( const QModelIndex &index, int role ) const
     return QVariant();
   }
 
-  const QPair<int, int> pair( index.row() - 1, index.column() );
-  if ( !d->mFields.contains( pair ) )
+  if ( role != Qt::DisplayRole || !d->mIndex )
     return QVariant();
 
-  const QString data = d->mFields.value( pair );
-
-  if ( role == Qt::DisplayRole )
-    return data;
-  else
+  const QStringList *fields = d->row( index.row() - 1 );
+  if ( index.column() >= fields->count() )
     return QVariant();
+
+  return fields->at( index.column() );
 }
 
 bool QCsvModel::setData( const QModelIndex &index, const QVariant &data, int role )
 {
-  if ( role == Qt::EditRole && index.row() == 0 && index.column() <= d->mFieldIdentifiers.count() ) {
+  if ( role == Qt::EditRole && index.row() == 0 && index.column() < d->mFieldIdentifiers.count() ) {
     d->mFieldIdentifiers[ index.column() ] = data.toString();
 
     emit dataChanged( index, index );
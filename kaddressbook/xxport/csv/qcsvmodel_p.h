@@ -20,11 +20,12 @@
 #ifndef QCSVMODEL_P_H
 #define QCSVMODEL_P_H
 
+#include <QtCore/QMutex>
 #include <QtCore/QThread>
 
 #include "qcsvreader.h"
 
-class CsvParser : public QThread, public QCsvBuilderInterface
+class CsvParser : public QThread
 {
   Q_OBJECT
 
@@ -34,19 +35,15 @@ class CsvParser : public QThread, public QCsvBuilderInterface
 
     void load( QIODevice *device );
 
-    void begin();
-    void beginLine();
-    void field( const QString &data, uint row, uint column );
-    void endLine();
-    void end();
-    void error( const QString &errorMsg );
+    /**
+     * Returns the index read by the last completed load and passes
+     * its ownership to the caller, or 0 if a load is still running.
+     */
+    QCsvIndex* takeIndex();
 
     QCsvReader* reader() { return mReader; }
 
   Q_SIGNALS:
-    void columnCountChanged( int columns );
-    void rowCountChanged( int rows );
-    void dataChanged( const QString &data, int row, int column );
     void ended();
 
   protected:
@@ -55,9 +52,8 @@ class CsvParser : public QThread, public QCsvBuilderInterface
   private:
     QCsvReader *mReader;
     QIODevice *mDevice;
-    int mRowCount;
-    int mColumnCount;
-    int mCacheCounter;
+    QCsvIndex *mIndex;
+    QMutex mMutex;
 };
 
 
@@ -19,14 +19,179 @@
 
 #include "qcsvreader.h"
 
-#include <QtCore/QStringList>
+#include <QtCore/QIODevice>
 #include <QtCore/QTextCodec>
-#include <QtCore/QTextStream>
+#include <QtCore/QVector>
 
 QCsvBuilderInterface::~QCsvBuilderInterface()
 {
 }
 
+namespace {
+
+// Counts the fields of a row without extracting them.
+struct FieldCounter
+{
+  FieldCounter() : count( 0 ) {}
+
+  void field( const QChar*, const QChar* )
+  {
+    ++count;
+  }
+
+  uint count;
+};
+
+// Collects the values of the fields of a row.
+struct FieldCollector
+{
+  FieldCollector( QStringList *fields, const QChar &quote ) : fields( fields ), quote( quote ) {}
+
+  void field( const QChar *begin, const QChar *end );
+
+  QStringList *fields;
+  QChar quote;
+};
+
+}
+
+static const QChar *skipLineBreaks( const QChar *pos, const QChar *end )
+{
+  while ( pos != end && ( *pos == QLatin1Char( '\r' ) || *pos == QLatin1Char( '\n' ) ) )
+    ++pos;
+  return pos;
+}
+
+/**
+ * Scans the row starting at @p pos and passes the raw extent of each of
+ * its fields to @p sink. Returns the position of the line break ending
+ * the row, or @p end.
+ *
+ * A field that starts with the quote character extends to the next quote
+ * that is not doubled, so it may contain delimiters and line breaks.
+ * Anything following the closing quote up to the next delimiter still
+ * belongs to the field. Otherwise quote characters have no special meaning.
+ */
+template <typename Sink>
+static const QChar *scanRow( const QChar *pos, const QChar *end, const QChar &quote, const QChar &delimiter, Sink &sink )
+{
+  const bool quoting = !quote.isNull();
+
+  forever {
+    const QChar *fieldBegin = pos;
+    if ( quoting && pos != end && *pos == quote ) {
+      ++pos;
+      while ( pos != end ) {
+        if ( *pos++ == quote ) {
+          if ( pos == end || *pos != quote )
+            break;
+          ++pos;
+        }
+      }
+    }
+
+    while ( pos != end && *pos != delimiter && *pos != QLatin1Char( '\r' ) && *pos != QLatin1Char( '\n' ) )
+      ++pos;
+
+    sink.field( fieldBegin, pos );
+
+    if ( pos == end || *pos != delimiter )
+      return pos;
+    ++pos;
+  }
+}
+
+void FieldCollector::field( const QChar *begin, const QChar *end )
+{
+  if ( quote.isNull() || begin == end || *begin != quote ) {
+    fields->append( QString( begin, end - begin ) );
+    return;
+  }
+
+  // the common case, a quoted field without quotes inside
+  const QChar *closingQuote = begin + 1;
+  while ( closingQuote != end && *closingQuote != quote )
+    ++closingQuote;
+  if ( closingQuote == end || closingQuote + 1 == end ) {
+    fields->append( QString( begin + 1, closingQuote - begin - 1 ) );
+    return;
+  }
+
+  QString value;
+  value.reserve( end - begin );
+  bool quoted = true;
+  for ( const QChar *pos = begin + 1; pos != end; ++pos ) {
+    if ( quoted && *pos == quote ) {
+      if ( pos + 1 != end && pos[ 1 ] == quote ) {
+        value += quote;
+        ++pos;
+      } else {
+        quoted = false;
+      }
+    } else {
+      value += *pos;
+    }
+  }
+  fields->append( value );
+}
+
+class QCsvIndex::Private
+{
+  public:
+    Private()
+      : mColumnCount( 0 )
+    {
+    }
+
+    void clear()
+    {
+      mText.clear();
+      mRowOffsets.clear();
+      mColumnCount = 0;
+    }
+
+    QString mText;
+    QVector<int> mRowOffsets;
+    uint mColumnCount;
+    QChar mTextQuote;
+    QChar mDelimiter;
+};
+
+QCsvIndex::QCsvIndex()
+  : d( new Private )
+{
+}
+
+QCsvIndex::~QCsvIndex()
+{
+  delete d;
+}
+
+uint QCsvIndex::rowCount() const
+{
+  return d->mRowOffsets.count();
+}
+
+uint QCsvIndex::columnCount() const
+{
+  return d->mColumnCount;
+}
+
+QStringList QCsvIndex::row( uint row ) const
+{
+  QStringList fields;
+  if ( row >= (uint)d->mRowOffsets.count() )
+    return fields;
+
+  const QChar *begin = d->mText.constData();
+  const QChar *end = begin + d->mText.length();
+
+  FieldCollector collector( &fields, d->mTextQuote );
+  scanRow( begin + d->mRowOffsets.at( row ), end, d->mTextQuote, d->mDelimiter, collector );
+
+  return fields;
+}
+
 class QCsvReader::Private
 {
   public:
@@ -39,9 +204,7 @@ class QCsvReader::Private
       mCodec = QTextCodec::codecForLocale();
     }
 
-    void emitBeginLine( uint row );
-    void emitEndLine( uint row );
-    void emitField( const QString &data, int row, int column );
+    QString decode( QIODevice *device ) const;
 
     QCsvBuilderInterface *mBuilder;
     QTextCodec *mCodec;
@@ -49,31 +212,24 @@ class QCsvReader::Private
     QChar mDelimiter;
 
     uint mStartRow;
-    bool mNotTerminated;
+    volatile bool mNotTerminated;
 };
 
-void QCsvReader::Private::emitBeginLine( uint row )
+QString QCsvReader::Private::decode( QIODevice *device ) const
 {
-  if ( (row - mStartRow) > 0 )
-    mBuilder->beginLine();
-}
+  const QByteArray data = device->readAll();
 
-void QCsvReader::Private::emitEndLine( uint row )
-{
-  if ( (row - mStartRow) > 0 )
-    mBuilder->endLine();
-}
+  // honor a byte order mark, like QTextStream does
+  QTextCodec *codec = QTextCodec::codecForUtfText( data, mCodec );
+  if ( !codec )
+    codec = QTextCodec::codecForLocale();
 
-void QCsvReader::Private::emitField( const QString &data, int row, int column )
-{
-  if ( (row - mStartRow) > 0 )
-    mBuilder->field( data, row - mStartRow - 1, column - 1 );
+  return codec->toUnicode( data );
 }
 
 QCsvReader::QCsvReader( QCsvBuilderInterface *builder )
   : d( new Private( builder ) )
 {
-  Q_ASSERT( builder );
 }
 
 QCsvReader::~QCsvReader()
@@ -83,176 +239,43 @@ QCsvReader::~QCsvReader()
 
 bool QCsvReader::read( QIODevice *device )
 {
-  enum State
-  {
-    StartLine,
-    QuotedField,
-    QuotedFieldEnd,
-    NormalField,
-    EmptyField
-  };
-
-  int row, column;
-
-  QString field;
-  QChar input;
-  State currentState = StartLine;
-
-  row = column = 1;
+  Q_ASSERT( d->mBuilder );
 
+  d->mNotTerminated = true;
   d->mBuilder->begin();
 
   if ( !device->isOpen() ) {
-    d->emitBeginLine( row );
     d->mBuilder->error( "Device is not open" );
-    d->emitEndLine( row );
     d->mBuilder->end();
     return false;
   }
 
-  QTextStream inputStream( device );
-  inputStream.setCodec( d->mCodec );
-
-  /**
-   * We use the following state machine to parse CSV:
-   *
-   * digraph {
-   *   StartLine -> StartLine [label="\\r\\n"]
-   *   StartLine -> QuotedField [label="Quote"]
-   *   StartLine -> EmptyField [label="Delimiter"]
-   *   StartLine -> NormalField [label="Other Char"]
-   *
-   *   QuotedField -> QuotedField [label="\\r\\n"]
-   *   QuotedField -> QuotedFieldEnd [label="Quote"]
-   *   QuotedField -> QuotedField [label="Delimiter"]
-   *   QuotedField -> QuotedField [label="Other Char"]
-   *
-   *   QuotedFieldEnd -> StartLine [label="\\r\\n"]
-   *   QuotedFieldEnd -> QuotedField [label="Quote"]
-   *   QuotedFieldEnd -> EmptyField [label="Delimiter"]
-   *   QuotedFieldEnd -> EmptyField [label="Other Char"]
-   *
-   *   EmptyField -> StartLine [label="\\r\\n"]
-   *   EmptyField -> QuotedField [label="Quote"]
-   *   EmptyField -> EmptyField [label="Delimiter"]
-   *   EmptyField -> NormalField [label="Other Char"]
-   *
-   *   NormalField -> StartLine [label="\\r\\n"]
-   *   NormalField -> NormalField [label="Quote"]
-   *   NormalField -> EmptyField [label="Delimiter"]
-   *   NormalField -> NormalField [label="Other Char"]
-   * }
-   */
-
-  while ( !inputStream.atEnd() && d->mNotTerminated ) {
-    inputStream >> input;
-
-    switch ( currentState ) {
-      case StartLine:
-        if ( input == QLatin1Char( '\r' ) || input == QLatin1Char( '\n' ) ) {
-          currentState = StartLine;
-        } else if ( input == d->mTextQuote ) {
-          d->emitBeginLine( row );
-          currentState = QuotedField;
-        } else if ( input == d->mDelimiter ) {
-          d->emitBeginLine( row );
-          d->emitField( field, row, column );
-          column++;
-          currentState = EmptyField;
-        } else {
-          d->emitBeginLine( row );
-          field.append( input );
-          currentState = NormalField;
-        }
-        break;
-      case QuotedField:
-        if ( input == QLatin1Char( '\r' ) || input == QLatin1Char( '\n' ) ) {
-          field.append( input );
-          currentState = QuotedField;
-        } else if ( input == d->mTextQuote ) {
-          currentState = QuotedFieldEnd;
-        } else if ( input == d->mDelimiter ) {
-          field.append( input );
-          currentState = QuotedField;
-        } else {
-          field.append( input );
-          currentState = QuotedField;
-        }
-        break;
-      case QuotedFieldEnd:
-        if ( input == QLatin1Char( '\r' ) || input == QLatin1Char( '\n' ) ) {
-          d->emitField( field, row, column );
-          field.clear();
-          d->emitEndLine( row );
-          column = 1;
-          row++;
-          currentState = StartLine;
-        } else if ( input == d->mTextQuote ) {
-          field.append( input );
-          currentState = QuotedField;
-        } else if ( input == d->mDelimiter ) {
-          d->emitField( field, row, column );
-          field.clear();
-          column++;
-          currentState = EmptyField;
-        } else {
-          d->emitField( field, row, column );
-          field.clear();
-          column++;
-          field.append( input );
-          currentState = EmptyField;
-        }
-        break;
-      case NormalField:
-        if ( input == QLatin1Char( '\r' ) || input == QLatin1Char( '\n' ) ) {
-          d->emitField( field, row, column );
-          field.clear();
-          d->emitEndLine( row );
-          row++;
-          column = 1;
-          currentState = StartLine;
-        } else if ( input == d->mTextQuote ) {
-          field.append( input );
-          currentState = NormalField;
-        } else if ( input == d->mDelimiter ) {
-          d->emitField( field, row, column );
-          field.clear();
-          column++;
-          currentState = EmptyField;
-        } else {
-          field.append( input );
-          currentState = NormalField;
-        }
-        break;
-      case EmptyField:
-        if ( input == QLatin1Char( '\r' ) || input == QLatin1Char( '\n' ) ) {
-          d->emitField( QString(), row, column );
-          field.clear();
-          d->emitEndLine( row );
-          column = 1;
-          row++;
-          currentState = StartLine;
-        } else if ( input == d->mTextQuote ) {
-          currentState = QuotedField;
-        } else if ( input == d->mDelimiter ) {
-          d->emitField( QString(), row, column );
-          column++;
-          currentState = EmptyField;
-        } else {
-          field.append( input );
-          currentState = NormalField;
-        }
-        break;
-    }
-  }
+  const QString text = d->decode( device );
+  const QChar *pos = text.constData();
+  const QChar *end = pos + text.length();
+
+  uint row = 0;
+  QStringList fields;
+  FieldCollector collector( &fields, d->mTextQuote );
 
-  if ( currentState != StartLine ) {
-    if ( field.length() > 0 ) {
-      d->emitField( field, row, column );
+  pos = skipLineBreaks( pos, end );
+  while ( pos != end && d->mNotTerminated ) {
+    if ( row < d->mStartRow ) {
+      FieldCounter counter;
+      pos = skipLineBreaks( scanRow( pos, end, d->mTextQuote, d->mDelimiter, counter ), end );
       ++row;
-      field.clear();
+      continue;
     }
-    d->emitEndLine( row );
+
+    fields.clear();
+    pos = skipLineBreaks( scanRow( pos, end, d->mTextQuote, d->mDelimiter, collector ), end );
+
+    const uint builderRow = row - d->mStartRow;
+    d->mBuilder->beginLine();
+    for ( int column = 0; column < fields.count(); ++column )
+      d->mBuilder->field( fields.at( column ), builderRow, column );
+    d->mBuilder->endLine();
+    ++row;
   }
 
   d->mBuilder->end();
@@ -260,6 +283,38 @@ bool QCsvReader::read( QIODevice *device )
   return true;
 }
 
+bool QCsvReader::read( QIODevice *device, QCsvIndex *index )
+{
+  d->mNotTerminated = true;
+
+  index->d->clear();
+  index->d->mTextQuote = d->mTextQuote;
+  index->d->mDelimiter = d->mDelimiter;
+
+  if ( !device->isOpen() )
+    return false;
+
+  index->d->mText = d->decode( device );
+  const QChar *begin = index->d->mText.constData();
+  const QChar *end = begin + index->d->mText.length();
+
+  uint row = 0;
+  const QChar *pos = skipLineBreaks( begin, end );
+  while ( pos != end && d->mNotTerminated ) {
+    const QChar *rowBegin = pos;
+    FieldCounter counter;
+    pos = skipLineBreaks( scanRow( pos, end, d->mTextQuote, d->mDelimiter, counter ), end );
+
+    if ( row++ < d->mStartRow )
+      continue;
+
+    index->d->mRowOffsets.append( rowBegin - begin );
+    index->d->mColumnCount = qMax( index->d->mColumnCount, counter.count );
+  }
+
+  return true;
+}
+
 void QCsvReader::setTextQuote( const QChar &textQuote )
 {
   d->mTextQuote = textQuote;
@@ -316,15 +371,17 @@ class QCsvStandardBuilder::Private
     void init();
 
     QString mLastErrorString;
-    uint mRowCount;
     uint mColumnCount;
-    QList<QStringList> mRows;
+    // the fields of all rows, one after another
+    QVector<QString> mFields;
+    // the index into mFields each row starts at
+    QVector<int> mRowStarts;
 };
 
 void QCsvStandardBuilder::Private::init()
 {
-  mRows.clear();
-  mRowCount = 0;
+  mFields.clear();
+  mRowStarts.clear();
   mColumnCount = 0;
   mLastErrorString.clear();
 }
@@ -346,7 +403,7 @@ QString QCsvStandardBuilder::lastErrorString() const
 
 uint QCsvStandardBuilder::rowCount() const
 {
-  return d->mRowCount;
+  return d->mRowStarts.count();
 }
 
 uint QCsvStandardBuilder::columnCount() const
@@ -356,10 +413,15 @@ uint QCsvStandardBuilder::columnCount() const
 
 QString QCsvStandardBuilder::data( uint row, uint column ) const
 {
-  if ( row > d->mRowCount || column > d->mColumnCount || column >= (uint)d->mRows[ row ].count() )
+  if ( row >= (uint)d->mRowStarts.count() )
+    return QString();
+
+  const uint start = d->mRowStarts.at( row );
+  const uint end = (row + 1 < (uint)d->mRowStarts.count()) ? d->mRowStarts.at( row + 1 ) : d->mFields.count();
+  if ( column >= end - start )
     return QString();
 
-  return d->mRows[ row ][ column ];
+  return d->mFields.at( start + column );
 }
 
 void QCsvStandardBuilder::begin()
@@ -369,19 +431,19 @@ void QCsvStandardBuilder::begin()
 
 void QCsvStandardBuilder::beginLine()
 {
-  d->mRows.append( QStringList() );
-  d->mRowCount++;
+  d->mRowStarts.append( d->mFields.count() );
 }
 
 void QCsvStandardBuilder::field( const QString &data, uint row, uint column )
 {
-  const uint size = d->mRows[ row ].size();
-  if ( column >= size ) {
-    for ( uint i = column; i < size + 1; ++i )
-      d->mRows[ row ].append( QString() );
-  }
+  Q_ASSERT( row + 1 == (uint)d->mRowStarts.count() );
+  Q_UNUSED( row );
+
+  const uint index = d->mRowStarts.last() + column;
+  if ( index >= (uint)d->mFields.count() )
+    d->mFields.resize( index + 1 );
 
-  d->mRows[ row ][ column ] = data;
+  d->mFields[ index ] = data;
 
   d->mColumnCount = qMax( d->mColumnCount, column + 1 );
 }
@@ -392,6 +454,7 @@ void QCsvStandardBuilder::endLine()
 
 void QCsvStandardBuilder::end()
 {
+  d->mFields.squeeze();
 }
 
 void QCsvStandardBuilder::error( const QString &errorMsg )
@@ -21,7 +21,9 @@
 #define QCSVREADER_H
 
 #include <QtCore/QObject>
+#include <QtCore/QStringList>
 
+class QCsvIndex;
 class QIODevice;
 
 /**
@@ -100,9 +102,10 @@ class QCsvReader : public QObject
     /**
      * Creates a new csv reader.
      *
-     * @param builder The builder to use.
+     * @param builder The builder to use, may be null if the data are
+     *                only read into a QCsvIndex.
      */
-    QCsvReader( QCsvBuilderInterface *builder );
+    QCsvReader( QCsvBuilderInterface *builder = 0 );
 
     /**
      * Destroys the csv reader.
@@ -116,6 +119,15 @@ class QCsvReader : public QObject
      */
     bool read( QIODevice *device );
 
+    /**
+     * Reads the csv data from @p device into @p index, which only
+     * records where the rows start. The fields of a row are parsed
+     * when it is requested from the index.
+     *
+     * @return true on success, false otherwise.
+     */
+    bool read( QIODevice *device, QCsvIndex *index );
+
     /**
      * Sets the character that is used for quoting. The default is '"'.
      */
@@ -175,6 +187,50 @@ class QCsvReader : public QObject
     Private* const d;
 };
 
+/**
+ * @short The rows of csv data, parsed on demand.
+ *
+ * QCsvIndex keeps the decoded csv data together with a table of
+ * the offsets the rows start at. It is filled by QCsvReader::read()
+ * and splits a row into its fields only when asked for it, so even
+ * huge files can be loaded quickly and with little memory overhead.
+ */
+class QCsvIndex
+{
+  public:
+    /**
+     * Creates a new, empty csv index.
+     */
+    QCsvIndex();
+
+    /**
+     * Destroys the csv index.
+     */
+    ~QCsvIndex();
+
+    /**
+     * Returns the number of rows.
+     */
+    uint rowCount() const;
+
+    /**
+     * Returns the number of fields of the longest row.
+     */
+    uint columnCount() const;
+
+    /**
+     * Returns the fields of the given @p row.
+     */
+    QStringList row( uint row ) const;
+
+  private:
+    friend class QCsvReader;
+    class Private;
+    Private* const d;
+
+    Q_DISABLE_COPY( QCsvIndex )
+};
+
 /**
  * @short A convenience class that implements QCsvBuilderInterface.
  *
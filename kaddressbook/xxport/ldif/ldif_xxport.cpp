@@ -58,10 +58,15 @@ void doExport( QFile *file, const KABC::Addressee::List &list )
 }
 
 LDIFXXPort::LDIFXXPort( QWidget *parentWidget )
-  : XXPort( parentWidget )
+  : XXPort( parentWidget ), mImportFile( 0 ), mImportStream( 0 )
 {
 }
 
+LDIFXXPort::~LDIFXXPort()
+{
+  closeImportFile();
+}
+
 KABC::Addressee::List LDIFXXPort::importContacts() const
 {
   KABC::Addressee::List contacts;
@@ -89,6 +94,80 @@ KABC::Addressee::List LDIFXXPort::importContacts() const
   return contacts;
 }
 
+bool LDIFXXPort::beginImport()
+{
+  const QString fileName = KFileDialog::getOpenFileName( QDir::homePath(), "text/x-ldif", 0 );
+  if ( fileName.isEmpty() )
+    return false;
+
+  mImportFile = new QFile( fileName );
+  if ( !mImportFile->open( QIODevice::ReadOnly | QIODevice::Text ) ) {
+    const QString msg = i18n( "<qt>Unable to open <b>%1</b> for reading.</qt>", fileName );
+    KMessageBox::error( parentWidget(), msg );
+    closeImportFile();
+    return false;
+  }
+
+  mImportStream = new QTextStream( mImportFile );
+  mImportStream->setCodec( "ISO 8859-1" );
+  mImportDate = QFileInfo( *mImportFile ).lastModified();
+
+  return true;
+}
+
+KABC::Addressee::List LDIFXXPort::importNextContacts( int maxCount )
+{
+  KABC::Addressee::List contacts;
+
+  // entries are separated by empty lines, so hand the converter as many
+  // entries as contacts are requested instead of the whole file
+  while ( mImportStream && contacts.count() < maxCount ) {
+    QString data;
+    int entries = 0;
+    bool entryStarted = false;
+
+    while ( entries < maxCount - contacts.count() && !mImportStream->atEnd() ) {
+      const QString line = mImportStream->readLine();
+      data += line;
+      data += QLatin1Char( '\n' );
+
+      if ( line.trimmed().isEmpty() ) {
+        if ( entryStarted )
+          ++entries;
+        entryStarted = false;
+      } else {
+        entryStarted = true;
+      }
+    }
+
+    if ( mImportStream->atEnd() )
+      closeImportFile();
+
+    KABC::Addressee::List entryContacts;
+    KABC::LDIFConverter::LDIFToAddressee( data, entryContacts, mImportDate );
+    contacts += entryContacts;
+  }
+
+  return contacts;
+}
+
+int LDIFXXPort::importProgress() const
+{
+  if ( !mImportFile || mImportFile->size() == 0 )
+    return 100;
+
+  return qMin<qint64>( 100, ( mImportFile->pos() * 100 ) / mImportFile->size() );
+}
+
+void LDIFXXPort::closeImportFile()
+{
+  delete mImportStream;
+  mImportStream = 0;
+
+  delete mImportFile;
+  mImportFile = 0;
+}
+
 bool LDIFXXPort::exportContacts( const KABC::Addressee::List &list ) const
 {
   const KUrl url = KFileDialog::getSaveUrl( KUrl( QDir::homePath() + "/addressbook.ldif" ), "text/x-ldif" );
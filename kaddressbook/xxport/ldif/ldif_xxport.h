@@ -27,13 +27,30 @@
 
 #include "xxport.h"
 
+#include <QtCore/QDateTime>
+
+class QFile;
+class QTextStream;
+
 class LDIFXXPort : public XXPort
 {
   public:
     LDIFXXPort( QWidget *parent = 0 );
+    ~LDIFXXPort();
 
     bool exportContacts( const KABC::Addressee::List &contacts ) const;
     KABC::Addressee::List importContacts() const;
+
+    bool beginImport();
+    KABC::Addressee::List importNextContacts( int maxCount );
+    int importProgress() const;
+
+  private:
+    void closeImportFile();
+
+    QFile *mImportFile;
+    QTextStream *mImportStream;
+    QDateTime mImportDate;
 };
 
 #endif
@@ -20,7 +20,7 @@
 #include "xxport.h"
 
 XXPort::XXPort( QWidget *parent )
-  : mParentWidget( parent )
+  : mParentWidget( parent ), mPendingPosition( 0 )
 {
 }
 
@@ -38,6 +38,35 @@ bool XXPort::exportContacts( const KABC::Addressee::List& ) const
   return false;
 }
 
+bool XXPort::beginImport()
+{
+  mPendingContacts = importContacts();
+  mPendingPosition = 0;
+
+  return !mPendingContacts.isEmpty();
+}
+
+KABC::Addressee::List XXPort::importNextContacts( int maxCount )
+{
+  const KABC::Addressee::List contacts = mPendingContacts.mid( mPendingPosition, maxCount );
+  mPendingPosition += contacts.count();
+
+  if ( mPendingPosition >= mPendingContacts.count() ) {
+    mPendingContacts.clear();
+    mPendingPosition = 0;
+  }
+
+  return contacts;
+}
+
+int XXPort::importProgress() const
+{
+  if ( mPendingContacts.isEmpty() )
+    return 100;
+
+  return ( mPendingPosition * 100 ) / mPendingContacts.count();
+}
+
 void XXPort::setOption( const QString &key, const QString &value )
 {
   mOptions.insert( key, value );
@@ -50,6 +50,27 @@ class XXPort
      */
     virtual KABC::Addressee::List importContacts() const = 0;
 
+    /**
+     * Prepares an incremental import, e.g. by asking the user for the
+     * files to import. Returns @c false if there is nothing to import.
+     *
+     * The default implementation reads all contacts with importContacts()
+     * and hands them out in chunks; modules that can read their input
+     * piecewise reimplement it together with importNextContacts().
+     */
+    virtual bool beginImport();
+
+    /**
+     * Returns the next at most @p maxCount contacts of the import started
+     * with beginImport(), or an empty list if all contacts have been returned.
+     */
+    virtual KABC::Addressee::List importNextContacts( int maxCount );
+
+    /**
+     * Returns how much of the import has been read so far, in percent.
+     */
+    virtual int importProgress() const;
+
     /**
      * Exports the list of @p contacts.
      */
@@ -83,6 +104,8 @@ class XXPort
   private:
     QWidget *mParentWidget;
     QMap<QString, QString> mOptions;
+    KABC::Addressee::List mPendingContacts;
+    int mPendingPosition;
 };
 
 #endif
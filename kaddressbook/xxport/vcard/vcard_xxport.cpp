@@ -92,10 +92,19 @@ class VCardExportSelectionDialog : public KDialog
 };
 
 VCardXXPort::VCardXXPort( QWidget *parent )
-  : XXPort( parent )
+  : XXPort( parent ), mIncrementalImport( false ), mImportFile( 0 ),
+    mImportSize( 0 ), mImportedSize( 0 )
 {
 }
 
+VCardXXPort::~VCardXXPort()
+{
+  closeImportFile();
+
+  foreach ( const QString &fileName, mImportFileNames )
+    KIO::NetAccess::removeTempFile( fileName );
+}
+
 bool VCardXXPort::exportContacts( const KABC::Addressee::List &contacts ) const
 {
   KABC::VCardConverter converter;
@@ -230,6 +239,129 @@ KABC::Addressee::List VCardXXPort::importContacts() const
   return addrList;
 }
 
+bool VCardXXPort::beginImport()
+{
+  // contacts passed on the command line are presented in the viewer
+  // dialog, which needs all of them at once
+  if ( !option( "importData" ).isEmpty() || !option( "importUrl" ).isEmpty() ) {
+    mIncrementalImport = false;
+    return XXPort::beginImport();
+  }
+
+  mIncrementalImport = true;
+
+  const KUrl::List urls = KFileDialog::getOpenUrls( KUrl(), "*.vcf|vCards", parentWidget(),
+                                                    i18n( "Select vCard to Import" ) );
+
+  const QString caption( i18n( "vCard Import Failed" ) );
+
+  for ( int i = 0; i < urls.count(); ++i ) {
+    QString fileName;
+
+    if ( KIO::NetAccess::download( urls.at( i ), fileName, parentWidget() ) ) {
+      mImportFileNames.append( fileName );
+      mImportSize += QFileInfo( fileName ).size();
+    } else {
+      const QString msg = i18nc( "@info", "<para>Unable to access vCard:</para><para>%1</para>", KIO::NetAccess::lastErrorString() );
+      KMessageBox::error( parentWidget(), msg, caption );
+    }
+  }
+
+  return !mImportFileNames.isEmpty();
+}
+
+KABC::Addressee::List VCardXXPort::importNextContacts( int maxCount )
+{
+  if ( !mIncrementalImport )
+    return XXPort::importNextContacts( maxCount );
+
+  KABC::Addressee::List contacts;
+  QByteArray data;
+  int cards = 0;
+
+  // collect the raw data of whole cards until there are enough of them,
+  // so that only a small part of a large file is in memory at any time
+  while ( contacts.count() < maxCount ) {
+    if ( !mImportFile && !openNextImportFile() )
+      break;
+
+    if ( mImportFile->atEnd() ) {
+      closeImportFile();
+      contacts += parseVCard( data );
+      data.clear();
+      cards = 0;
+      continue;
+    }
+
+    const QByteArray line = mImportFile->readLine();
+    data += line;
+
+    const QByteArray trimmedLine = line.trimmed();
+    if ( trimmedLine.size() == 9 && qstrnicmp( trimmedLine.constData(), "END:VCARD", 9 ) == 0 ) {
+      if ( ++cards == maxCount - contacts.count() ) {
+        contacts += parseVCard( data );
+        data.clear();
+        cards = 0;
+      }
+    }
+  }
+
+  return contacts;
+}
+
+int VCardXXPort::importProgress() const
+{
+  if ( !mIncrementalImport )
+    return XXPort::importProgress();
+
+  if ( mImportSize <= 0 )
+    return 100;
+
+  const qint64 position = mImportedSize + ( mImportFile ? mImportFile->pos() : 0 );
+
+  return qMin<qint64>( 100, ( position * 100 ) / mImportSize );
+}
+
+bool VCardXXPort::openNextImportFile()
+{
+  while ( !mImportFileNames.isEmpty() ) {
+    const QString fileName = mImportFileNames.takeFirst();
+
+    QFile *file = new QFile( fileName );
+    if ( file->open( QIODevice::ReadOnly ) ) {
+      mImportFile = file;
+      return true;
+    }
+
+    const QString msg = i18nc( "@info",
+                               "<para>When trying to read the vCard, there was an error opening the file <filename>%1</filename>:</para>"
+                               "<para>%2</para>",
+                               fileName,
+                               i18nc( "QFile", file->errorString().toLatin1() ) );
+    KMessageBox::error( parentWidget(), msg, i18n( "vCard Import Failed" ) );
+
+    mImportSize -= file->size();
+    delete file;
+    KIO::NetAccess::removeTempFile( fileName );
+  }
+
+  return false;
+}
+
+void VCardXXPort::closeImportFile()
+{
+  if ( !mImportFile )
+    return;
+
+  const QString fileName = mImportFile->fileName();
+  mImportedSize += mImportFile->size();
+
+  delete mImportFile;
+  mImportFile = 0;
+
+  KIO::NetAccess::removeTempFile( fileName );
+}
+
 KABC::Addressee::List VCardXXPort::parseVCard( const QByteArray &data ) const
 {
   KABC::VCardConverter converter;
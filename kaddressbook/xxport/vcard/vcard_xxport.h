@@ -22,21 +22,39 @@
 
 #include "xxport.h"
 
+#include <QtCore/QStringList>
+
+class QFile;
+
 class VCardXXPort : public XXPort
 {
   public:
     VCardXXPort( QWidget *parent = 0 );
+    ~VCardXXPort();
 
     bool exportContacts( const KABC::Addressee::List &contacts ) const;
     KABC::Addressee::List importContacts() const;
 
+    bool beginImport();
+    KABC::Addressee::List importNextContacts( int maxCount );
+    int importProgress() const;
+
   private:
+    bool openNextImportFile();
+    void closeImportFile();
+
     KABC::Addressee::List parseVCard( const QByteArray &data ) const;
     bool doExport( const KUrl &url, const QByteArray &data ) const;
 
     void addKey( KABC::Addressee &addr, KABC::Key::Type type ) const;
 
     KABC::Addressee::List filterContacts( const KABC::Addressee::List& ) const;
+
+    bool mIncrementalImport;
+    QStringList mImportFileNames;
+    QFile *mImportFile;
+    qint64 mImportSize;
+    qint64 mImportedSize;
 };
 
 #endif
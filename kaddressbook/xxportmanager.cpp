@@ -20,13 +20,12 @@
 
 #include "xxportmanager.h"
 
+#include "xxport/contactimportjob.h"
 #include "contactselectiondialog.h"
 
 #include <akonadi/collection.h>
 #include <akonadi/collectiondialog.h>
 #include <akonadi/entitytreemodel.h>
-#include <akonadi/item.h>
-#include <akonadi/itemcreatejob.h>
 #include <klocale.h>
 #include <kmessagebox.h>
 #include <kprogressdialog.h>
@@ -37,10 +36,12 @@
 #include <QtGui/QItemSelectionModel>
 #include <QtGui/QWidget>
 
+// the number of contacts stored within one transaction
+static const int s_importBatchSize = 100;
 
 XXPortManager::XXPortManager( QWidget *parent )
   : QObject( parent ), mSelectionModel( 0 ),
-    mParentWidget( parent ), mImportProgressDialog( 0 )
+    mParentWidget( parent ), mImportProgressDialog( 0 ), mImportJob( 0 )
 {
   mImportMapper = new QSignalMapper( this );
   mExportMapper = new QSignalMapper( this );
@@ -79,16 +80,23 @@ void XXPortManager::setDefaultAddressBook( const Akonadi::Collection &addressBoo
 
 void XXPortManager::slotImport( const QString &identifier )
 {
-  const XXPort* xxport = mFactory.createXXPort( identifier, mParentWidget );
-  if( !xxport )
+  if ( mImportJob ) // an import is still running
     return;
 
-  const KABC::Addressee::List contacts = xxport->importContacts();
+  XXPort* xxport = mFactory.createXXPort( identifier, mParentWidget );
+  if( !xxport )
+    return;
 
-  delete xxport;
+  // read the first batch before asking for the address book, so that
+  // nothing is asked for when there is nothing to import
+  KABC::Addressee::List contacts;
+  if ( xxport->beginImport() )
+    contacts = xxport->importNextContacts( s_importBatchSize );
 
-  if ( contacts.isEmpty() ) // nothing to import
+  if ( contacts.isEmpty() ) { // nothing to import
+    delete xxport;
     return;
+  }
 
   const QStringList mimeTypes( KABC::Addressee::mimeType() );
 
@@ -101,47 +109,60 @@ void XXPortManager::slotImport( const QString &identifier )
 
   if ( !dlg->exec() || !dlg ) {
     delete dlg;
+    delete xxport;
     return;
   }
 
   const Akonadi::Collection collection = dlg->selectedCollection();
   delete dlg;
 
-  if ( !mImportProgressDialog ) {
-    mImportProgressDialog = new KProgressDialog( mParentWidget, i18n( "Import Contacts" ) );
-    mImportProgressDialog->setLabelText( i18np( "Importing one contact to %2", "Importing %1 contacts to %2",
-                                                contacts.count(), collection.name() ) );
-    mImportProgressDialog->setAllowCancel( false );
-    mImportProgressDialog->setAutoClose( true );
-    mImportProgressDialog->progressBar()->setRange( 1, contacts.count() );
-  }
-
+  mImportProgressDialog = new KProgressDialog( mParentWidget, i18n( "Import Contacts" ) );
+  mImportProgressDialog->setLabelText( i18n( "Importing contacts to %1", collection.name() ) );
+  mImportProgressDialog->setAllowCancel( true );
+  mImportProgressDialog->setAutoClose( false );
+  mImportProgressDialog->progressBar()->setRange( 0, 100 );
+  connect( mImportProgressDialog, SIGNAL( cancelClicked() ), SLOT( slotImportCancelled() ) );
+  connect( mImportProgressDialog, SIGNAL( rejected() ), SLOT( slotImportCancelled() ) );
   mImportProgressDialog->show();
 
-  for ( int i = 0; i < contacts.count(); ++i ) {
-    Akonadi::Item item;
-    item.setPayload<KABC::Addressee>( contacts.at( i ) );
-    item.setMimeType( KABC::Addressee::mimeType() );
-
-    Akonadi::ItemCreateJob *job = new Akonadi::ItemCreateJob( item, collection );
-    connect( job, SIGNAL( result( KJob* ) ), SLOT( slotImportJobDone( KJob* ) ) );
-  }
+  // the contacts are read and stored batch by batch, so that large files
+  // are never held in memory completely
+  mImportJob = new ContactImportJob( xxport, collection, this );
+  mImportJob->setBatchSize( s_importBatchSize );
+  mImportJob->setPendingContacts( contacts );
+  connect( mImportJob, SIGNAL( percent( KJob*, unsigned long ) ),
+           SLOT( slotImportProgress( KJob*, unsigned long ) ) );
+  connect( mImportJob, SIGNAL( result( KJob* ) ), SLOT( slotImportJobDone( KJob* ) ) );
+  mImportJob->start();
 }
 
-void XXPortManager::slotImportJobDone( KJob* )
+void XXPortManager::slotImportProgress( KJob*, unsigned long percent )
 {
   if ( !mImportProgressDialog )
     return;
 
-  QProgressBar *progressBar = mImportProgressDialog->progressBar();
+  mImportProgressDialog->progressBar()->setValue( percent );
+}
+
+void XXPortManager::slotImportCancelled()
+{
+  // stops reading further contacts, the batches already being stored are
+  // completed by the server
+  if ( mImportJob )
+    mImportJob->kill( KJob::EmitResult );
+}
 
-  progressBar->setValue( progressBar->value() + 1 );
+void XXPortManager::slotImportJobDone( KJob *job )
+{
+  mImportJob = 0;
 
-  // cleanup on last step
-  if ( progressBar->value() == progressBar->maximum() ) {
+  if ( mImportProgressDialog ) {
     mImportProgressDialog->deleteLater();
     mImportProgressDialog = 0;
   }
+
+  if ( job->error() && job->error() != KJob::KilledJobError )
+    KMessageBox::error( mParentWidget, job->errorText() );
 }
 
 void XXPortManager::slotExport( const QString &identifier )
@@ -32,6 +32,7 @@ class QAction;
 class QItemSelectionModel;
 class QSignalMapper;
 
+class ContactImportJob;
 class KJob;
 class KProgressDialog;
 
@@ -89,6 +90,8 @@ class XXPortManager : public QObject
     void slotImport( const QString& );
     void slotExport( const QString& );
 
+    void slotImportProgress( KJob*, unsigned long );
+    void slotImportCancelled();
     void slotImportJobDone( KJob* );
 
   private:
@@ -99,6 +102,7 @@ class XXPortManager : public QObject
     QSignalMapper *mExportMapper;
     Akonadi::Collection mDefaultAddressBook;
     KProgressDialog *mImportProgressDialog;
+    ContactImportJob *mImportJob;
 };
 
 #endif
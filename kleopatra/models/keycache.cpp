@@ -694,10 +694,101 @@ std::vector<Key> KeyCache::secretKeys() const
     return keys;
 }
 
+namespace {
+
+    bool userIDsDiffer( const UserID & lhs, const UserID & rhs ) {
+        return qstrcmp( lhs.id(), rhs.id() ) != 0
+            || lhs.validity() != rhs.validity()
+            || lhs.isRevoked() != rhs.isRevoked()
+            || lhs.isInvalid() != rhs.isInvalid() ;
+    }
+
+    bool subkeysDiffer( const Subkey & lhs, const Subkey & rhs ) {
+        return qstrcmp( lhs.keyID(), rhs.keyID() ) != 0
+            || lhs.expirationTime() != rhs.expirationTime()
+            || lhs.isRevoked() != rhs.isRevoked()
+            || lhs.isExpired() != rhs.isExpired()
+            || lhs.isDisabled() != rhs.isDisabled()
+            || lhs.isInvalid() != rhs.isInvalid()
+            || lhs.isSecret() != rhs.isSecret()
+            || lhs.canEncrypt() != rhs.canEncrypt()
+            || lhs.canSign() != rhs.canSign()
+            || lhs.canCertify() != rhs.canCertify()
+            || lhs.canAuthenticate() != rhs.canAuthenticate() ;
+    }
+
+    // whether two listings of the same key differ in anything the
+    // indexes or the views care about:
+    bool keysDiffer( const Key & lhs, const Key & rhs ) {
+        if ( qstrcmp( lhs.primaryFingerprint(), rhs.primaryFingerprint() ) != 0
+             || qstrcmp( lhs.chainID(), rhs.chainID() ) != 0
+             || lhs.keyListMode() != rhs.keyListMode()
+             || lhs.ownerTrust() != rhs.ownerTrust()
+             || lhs.hasSecret() != rhs.hasSecret()
+             || lhs.isRevoked() != rhs.isRevoked()
+             || lhs.isExpired() != rhs.isExpired()
+             || lhs.isDisabled() != rhs.isDisabled()
+             || lhs.isInvalid() != rhs.isInvalid()
+             || lhs.isQualified() != rhs.isQualified()
+             || lhs.canEncrypt() != rhs.canEncrypt()
+             || lhs.canSign() != rhs.canSign()
+             || lhs.canCertify() != rhs.canCertify()
+             || lhs.canAuthenticate() != rhs.canAuthenticate() )
+            return true;
+
+        const std::vector<UserID> luids = lhs.userIDs(), ruids = rhs.userIDs();
+        if ( luids.size() != ruids.size() )
+            return true;
+        for ( unsigned int i = 0, end = luids.size() ; i != end ; ++i )
+            if ( userIDsDiffer( luids[i], ruids[i] ) )
+                return true;
+
+        const std::vector<Subkey> lsubkeys = lhs.subkeys(), rsubkeys = rhs.subkeys();
+        if ( lsubkeys.size() != rsubkeys.size() )
+            return true;
+        for ( unsigned int i = 0, end = lsubkeys.size() ; i != end ; ++i )
+            if ( subkeysDiffer( lsubkeys[i], rsubkeys[i] ) )
+                return true;
+
+        return false;
+    }
+
+}
+
 void KeyCache::refresh( const std::vector<Key> & keys ) {
-    // make this better...
-    clear();
-    insert( keys );
+
+    std::vector<Key> sorted;
+    sorted.reserve( keys.size() );
+    std::remove_copy_if( keys.begin(), keys.end(),
+                         std::back_inserter( sorted ),
+                         bind( is_string_empty(), bind( &Key::primaryFingerprint, _1 ) ) );
+    std::sort( sorted.begin(), sorted.end(), _detail::ByFingerprint<std::less>() );
+
+    // Walk the new listing alongside by.fpr (both sorted by fingerprint)
+    // and only touch the keys that went away, appeared or changed, so
+    // that an unchanged keyring doesn't rebuild the indexes or make the
+    // views re-add every key:
+    std::vector<Key> removed, changed;
+    std::vector<Key>::const_iterator oit = d->by.fpr.begin(), oend = d->by.fpr.end();
+    std::vector<Key>::const_iterator nit = sorted.begin(), nend = sorted.end();
+    while ( oit != oend || nit != nend )
+        if ( nit == nend || ( oit != oend && _detail::ByFingerprint<std::less>()( *oit, *nit ) ) ) {
+            removed.push_back( *oit++ );
+        } else if ( oit == oend || _detail::ByFingerprint<std::less>()( *nit, *oit ) ) {
+            changed.push_back( *nit++ );
+        } else {
+            if ( keysDiffer( *oit, *nit ) )
+                changed.push_back( *nit );
+            ++oit;
+            ++nit;
+        }
+
+    remove( removed );
+
+    if ( !changed.empty() )
+        insert( changed );
+    else if ( !removed.empty() )
+        emit keysMayHaveChanged();
 }
 
 void KeyCache::insert( const Key & key ) {
@@ -930,14 +1021,6 @@ void KeyCache::RefreshKeysJob::Private::doStart()
 
 void KeyCache::RefreshKeysJob::Private::updateKeyCache()
 {
-    std::vector<Key> cachedKeys = m_cache->keys();
-    std::sort( cachedKeys.begin(), cachedKeys.end(), _detail::ByFingerprint<std::less>() );
-    std::vector<Key> keysToRemove;
-    std::set_difference( cachedKeys.begin(), cachedKeys.end(),
-                         m_keys.begin(), m_keys.end(),
-                         std::back_inserter( keysToRemove ),
-                         _detail::ByFingerprint<std::less>() );
-    m_cache->remove( keysToRemove );
     m_cache->refresh( m_keys );
 }
 
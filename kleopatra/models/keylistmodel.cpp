@@ -411,8 +411,8 @@ namespace {
         void addKeyWithoutParent( const char * issuer_fpr, const Key & key );
 
     private:
-        typedef std::map< std::string, std::vector<Key> > Map;
-        std::vector<Key> mKeysByFingerprint; // all keys
+        typedef QHash< QByteArray, std::vector<Key> > Map;
+        QHash<QByteArray, Key> mKeysByFingerprint; // all keys
         Map mKeysByExistingParent, mKeysByNonExistingParent; // parent->child map
         std::vector<Key> mTopLevels; // all roots + parent-less
     };
@@ -425,6 +425,12 @@ namespace {
         return "";
     }
 
+    // wraps a fingerprint for hash lookups without copying it.
+    // Never use the result as a key for insertion - it doesn't own the data.
+    static QByteArray lookupKey( const char * fpr ) {
+        return QByteArray::fromRawData( fpr, qstrlen( fpr ) );
+    }
+
 }
 
 
@@ -531,10 +537,10 @@ int HierarchicalKeyListModel::rowCount( const QModelIndex & pidx ) const {
     const char * const fpr = issuer.primaryFingerprint();
     if ( !fpr || !*fpr )
         return 0;
-    const Map::const_iterator it = mKeysByExistingParent.find( fpr );
-    if ( it == mKeysByExistingParent.end() )
+    const Map::const_iterator it = mKeysByExistingParent.constFind( lookupKey( fpr ) );
+    if ( it == mKeysByExistingParent.constEnd() )
         return 0;
-    return it->second.size();
+    return it->size();
 }
 
 QModelIndex HierarchicalKeyListModel::index( int row, int col, const QModelIndex & pidx ) const {
@@ -555,20 +561,18 @@ QModelIndex HierarchicalKeyListModel::index( int row, int col, const QModelIndex
     const char * const fpr = issuer.primaryFingerprint();
     if ( !fpr || !*fpr )
 	return QModelIndex();
-    const Map::const_iterator it = mKeysByExistingParent.find( fpr );
-    if ( it == mKeysByExistingParent.end() || static_cast<unsigned>( row ) >= it->second.size() )
+    const Map::const_iterator it = mKeysByExistingParent.constFind( lookupKey( fpr ) );
+    if ( it == mKeysByExistingParent.constEnd() || static_cast<unsigned>( row ) >= it->size() )
         return QModelIndex();
-    return index( it->second[row], col );
+    return index( (*it)[row], col );
 }
 
 QModelIndex HierarchicalKeyListModel::parent( const QModelIndex & idx ) const {
     const Key key = this->key( idx );
     if ( key.isNull() || key.isRoot() )
         return QModelIndex();
-    const std::vector<Key>::const_iterator it
-        = qBinaryFind( mKeysByFingerprint.begin(), mKeysByFingerprint.end(),
-                       cleanChainID( key ), _detail::ByFingerprint<std::less>() );
-    return it != mKeysByFingerprint.end() ? index( *it ) : QModelIndex();
+    const QHash<QByteArray, Key>::const_iterator it = mKeysByFingerprint.constFind( lookupKey( cleanChainID( key ) ) );
+    return it != mKeysByFingerprint.constEnd() ? index( *it ) : QModelIndex();
 }
 
 Key HierarchicalKeyListModel::doMapToKey( const QModelIndex & idx ) const {
@@ -587,10 +591,10 @@ Key HierarchicalKeyListModel::doMapToKey( const QModelIndex & idx ) const {
 
     // non-toplevel:
     const Map::const_iterator it
-	= mKeysByExistingParent.find( issuer_fpr );
-    if ( it == mKeysByExistingParent.end() || static_cast<unsigned>( idx.row() ) >= it->second.size() )
+	= mKeysByExistingParent.constFind( lookupKey( issuer_fpr ) );
+    if ( it == mKeysByExistingParent.constEnd() || static_cast<unsigned>( idx.row() ) >= it->size() )
 	return Key::null;
-    return it->second[idx.row()];
+    return (*it)[idx.row()];
 }
 
 QModelIndex HierarchicalKeyListModel::doMapFromKey( const Key & key, int col ) const {
@@ -603,11 +607,11 @@ QModelIndex HierarchicalKeyListModel::doMapFromKey( const Key & key, int col ) c
     // we need to look in the toplevels list,...
     const std::vector<Key> * v = &mTopLevels;
     if ( issuer_fpr && *issuer_fpr ) {
-	const std::map< std::string, std::vector<Key> >::const_iterator it
-	    = mKeysByExistingParent.find( issuer_fpr );
+	const Map::const_iterator it
+	    = mKeysByExistingParent.constFind( lookupKey( issuer_fpr ) );
 	// ...unless we find an existing parent:
-	if ( it != mKeysByExistingParent.end() )
-	    v = &it->second;
+	if ( it != mKeysByExistingParent.constEnd() )
+	    v = &*it;
 	else
 	    issuer_fpr = 0; // force internalPointer to zero for toplevels
     }
@@ -625,7 +629,7 @@ void HierarchicalKeyListModel::addKeyWithParent( const char * issuer_fpr, const
 
     assert( issuer_fpr ); assert( *issuer_fpr ); assert( !key.isNull() );
 
-    std::vector<Key> & subjects = mKeysByExistingParent[issuer_fpr];
+    std::vector<Key> & subjects = mKeysByExistingParent[QByteArray( issuer_fpr )];
 
     // find insertion point:
     const std::vector<Key>::iterator it = std::lower_bound( subjects.begin(), subjects.end(), key, _detail::ByFingerprint<std::less>() );
@@ -637,8 +641,8 @@ void HierarchicalKeyListModel::addKeyWithParent( const char * issuer_fpr, const
 	emit dataChanged( createIndex( row, 0, const_cast<char*>( issuer_fpr ) ), createIndex( row, NumColumns-1, const_cast<char*>( issuer_fpr ) ) );
     } else {
 	// doesn't exist -> insert
-	const std::vector<Key>::const_iterator pos = qBinaryFind( mKeysByFingerprint.begin(), mKeysByFingerprint.end(), issuer_fpr, _detail::ByFingerprint<std::less>() );
-	assert( pos != mKeysByFingerprint.end() );
+	const QHash<QByteArray, Key>::const_iterator pos = mKeysByFingerprint.constFind( lookupKey( issuer_fpr ) );
+	assert( pos != mKeysByFingerprint.constEnd() );
 	beginInsertRows( index( *pos ), row, row );
 	subjects.insert( it, key );
 	endInsertRows();
@@ -649,7 +653,7 @@ void HierarchicalKeyListModel::addKeyWithoutParent( const char * issuer_fpr, con
 
     assert( issuer_fpr ); assert( *issuer_fpr ); assert( !key.isNull() );
 
-    std::vector<Key> & subjects = mKeysByNonExistingParent[issuer_fpr];
+    std::vector<Key> & subjects = mKeysByNonExistingParent[QByteArray( issuer_fpr )];
 
     // find insertion point:
     const std::vector<Key>::iterator it = std::lower_bound( subjects.begin(), subjects.end(), key, _detail::ByFingerprint<std::less>() );
@@ -720,51 +724,51 @@ QList<QModelIndex> HierarchicalKeyListModel::doAddKeys( const std::vector<Key> &
     if ( keys.empty() )
         return QList<QModelIndex>();
 
-
-    const std::vector<Key> oldKeys = mKeysByFingerprint;
-
-    std::vector<Key> merged;
-    merged.reserve( keys.size() + mKeysByFingerprint.size() );
-    std::set_union( keys.begin(), keys.end(),
-                    mKeysByFingerprint.begin(), mKeysByFingerprint.end(),
-                    std::back_inserter( merged ), _detail::ByFingerprint<std::less>() );
-
-    mKeysByFingerprint = merged;
-
     std::set<Key, _detail::ByFingerprint<std::less> > changedParents;
 
+    // Parents are added before their children, so looking up issuers
+    // in mKeysByFingerprint as we go finds those of this batch, too:
     Q_FOREACH( const Key & key, topological_sort( keys ) ) {
 
-        // check to see whether this key is a parent for a previously parent-less group:
         const char * const fpr = key.primaryFingerprint();
         if ( !fpr || !*fpr )
             continue;
 
-        const bool keyAlreadyExisted = qBinaryFind( oldKeys.begin(), oldKeys.end(), key, _detail::ByFingerprint<std::less>() ) != oldKeys.end();
+        bool keyAlreadyExisted = false;
+        {
+            const QHash<QByteArray, Key>::iterator it = mKeysByFingerprint.find( lookupKey( fpr ) );
+            if ( it != mKeysByFingerprint.end() ) {
+                *it = key;
+                keyAlreadyExisted = true;
+            } else {
+                mKeysByFingerprint.insert( QByteArray( fpr ), key );
+            }
+        }
 
-        const Map::iterator it = mKeysByNonExistingParent.find( fpr );
-        const std::vector<Key> children = it != mKeysByNonExistingParent.end() ? it->second : std::vector<Key>();
-        if ( it != mKeysByNonExistingParent.end() )
-            mKeysByNonExistingParent.erase( it );
+        // check to see whether this key is a parent for a previously parent-less group:
+        std::vector<Key> children;
+        {
+            const Map::iterator it = mKeysByNonExistingParent.find( lookupKey( fpr ) );
+            if ( it != mKeysByNonExistingParent.end() ) {
+                children.swap( *it );
+                mKeysByNonExistingParent.erase( it );
+            }
+        }
 
         // Step 1: For new keys, remove children from toplevel:
 
         if ( !keyAlreadyExisted ) {
             std::vector<Key>::iterator last = mTopLevels.begin();
-            std::vector<Key>::iterator lastFP = mKeysByFingerprint.begin();
 
             Q_FOREACH( const Key & k, children ) {
                 last = qBinaryFind( last, mTopLevels.end(), k, _detail::ByFingerprint<std::less>() );
                 assert( last != mTopLevels.end() );
                 const int row = std::distance( mTopLevels.begin(), last );
 
-                lastFP = qBinaryFind( lastFP, mKeysByFingerprint.end(), k, _detail::ByFingerprint<std::less>() );
-                assert( lastFP != mKeysByFingerprint.end() );
-
                 emit rowAboutToBeMoved( QModelIndex(), row );
                 beginRemoveRows( QModelIndex(), row, row );
                 last = mTopLevels.erase( last );
-                lastFP = mKeysByFingerprint.erase( lastFP );
+                mKeysByFingerprint.remove( lookupKey( k.primaryFingerprint() ) );
                 endRemoveRows();
             }
         }
@@ -774,7 +778,7 @@ QList<QModelIndex> HierarchicalKeyListModel::doAddKeys( const std::vector<Key> &
         if ( !issuer_fpr || !*issuer_fpr )
             // root or something...
             addTopLevelKey( key );
-        else if ( std::binary_search( mKeysByFingerprint.begin(), mKeysByFingerprint.end(), issuer_fpr, _detail::ByFingerprint<std::less>() ) )
+        else if ( mKeysByFingerprint.contains( lookupKey( issuer_fpr ) ) )
             // parent exists...
             addKeyWithParent( issuer_fpr, key );
         else
@@ -815,14 +819,15 @@ void HierarchicalKeyListModel::doRemoveKey( const Key & key ) {
         return;
 
     const char * const fpr = key.primaryFingerprint();
-    if ( mKeysByExistingParent.find( fpr ) != mKeysByExistingParent.end() ) {
+    if ( mKeysByExistingParent.contains( lookupKey( fpr ) ) ) {
         //handle non-leave nodes:
-        std::vector<Key> keys = mKeysByFingerprint;
-        const std::vector<Key>::iterator it = qBinaryFind( keys.begin(), keys.end(),
-                                                           key, _detail::ByFingerprint<std::less>() );
-        if ( it == keys.end() )
+        if ( !mKeysByFingerprint.contains( lookupKey( fpr ) ) )
             return;
-        keys.erase( it );
+        std::vector<Key> keys;
+        keys.reserve( mKeysByFingerprint.size() );
+        for ( QHash<QByteArray, Key>::const_iterator it = mKeysByFingerprint.constBegin(), end = mKeysByFingerprint.constEnd() ; it != end ; ++it )
+            if ( it.key() != fpr )
+                keys.push_back( *it );
         // FIXME for simplicity, we just clear the model and re-add all keys minus the removed one. This is suboptimal,
         // but acceptable given that deletion of non-leave nodes is rather rare.
         clear();
@@ -832,15 +837,12 @@ void HierarchicalKeyListModel::doRemoveKey( const Key & key ) {
 
     //handle leave nodes:
 
-    const std::vector<Key>::iterator it = qBinaryFind( mKeysByFingerprint.begin(), mKeysByFingerprint.end(),
-                                                       key, _detail::ByFingerprint<std::less>() );
-
-    assert( it != mKeysByFingerprint.end() );
-    assert( mKeysByNonExistingParent.find( fpr ) == mKeysByNonExistingParent.end() );
-    assert( mKeysByExistingParent.find( fpr ) == mKeysByExistingParent.end() );
+    assert( mKeysByFingerprint.contains( lookupKey( fpr ) ) );
+    assert( !mKeysByNonExistingParent.contains( lookupKey( fpr ) ) );
+    assert( !mKeysByExistingParent.contains( lookupKey( fpr ) ) );
 
     beginRemoveRows( parent( idx ), idx.row(), idx.row() );
-    mKeysByFingerprint.erase( it );
+    mKeysByFingerprint.remove( lookupKey( fpr ) );
 
     const char * const issuer_fpr = cleanChainID( key );
 
@@ -849,21 +851,21 @@ void HierarchicalKeyListModel::doRemoveKey( const Key & key ) {
         mTopLevels.erase( tlIt );
 
     if ( issuer_fpr && *issuer_fpr ) {
-        const Map::iterator nexIt = mKeysByNonExistingParent.find( issuer_fpr );
+        const Map::iterator nexIt = mKeysByNonExistingParent.find( lookupKey( issuer_fpr ) );
         if ( nexIt != mKeysByNonExistingParent.end() ) {
-            const std::vector<Key>::iterator eit = qBinaryFind( nexIt->second.begin(), nexIt->second.end(), key, _detail::ByFingerprint<std::less>() );
-            if ( eit != nexIt->second.end() )
-                nexIt->second.erase( eit );
-            if ( nexIt->second.empty() )
+            const std::vector<Key>::iterator eit = qBinaryFind( nexIt->begin(), nexIt->end(), key, _detail::ByFingerprint<std::less>() );
+            if ( eit != nexIt->end() )
+                nexIt->erase( eit );
+            if ( nexIt->empty() )
                 mKeysByNonExistingParent.erase( nexIt );
         }
 
-        const Map::iterator exIt = mKeysByExistingParent.find( issuer_fpr );
+        const Map::iterator exIt = mKeysByExistingParent.find( lookupKey( issuer_fpr ) );
         if ( exIt != mKeysByExistingParent.end() ) {
-            const std::vector<Key>::iterator eit = qBinaryFind( exIt->second.begin(), exIt->second.end(), key, _detail::ByFingerprint<std::less>() );
-            if ( eit != exIt->second.end() )
-                exIt->second.erase( eit );
-            if ( exIt->second.empty() )
+            const std::vector<Key>::iterator eit = qBinaryFind( exIt->begin(), exIt->end(), key, _detail::ByFingerprint<std::less>() );
+            if ( eit != exIt->end() )
+                exIt->erase( eit );
+            if ( exIt->empty() )
                 mKeysByExistingParent.erase( exIt );
         }
     }
@@ -42,6 +42,11 @@
 
 #include <kleo/stl_util.h>
 
+#include <QByteArray>
+#include <QHash>
+#include <QRegExp>
+#include <QStringMatcher>
+
 #include <boost/bind.hpp>
 
 #include <cassert>
@@ -116,13 +121,150 @@ class KeyListSortFilterProxyModel::Private {
     friend class ::Kleo::KeyListSortFilterProxyModel;
 public:
     explicit Private()
-        : keyFilter() {}
+        : keyFilter(),
+          filterRole( -1 ),
+          literal( false ),
+          caseInsensitive( false ) {}
     ~Private() {}
 
+    void clearCache() {
+        searchKeys.clear();
+        accepted.clear();
+    }
+
+private:
+    struct SearchKey {
+        QString name, email;
+        QString lowerName, lowerEmail;
+    };
+
+    void updateFilter( const QRegExp & rx, int role ) const;
+    SearchKey searchKey( const QAbstractItemModel * model, const QModelIndex & index ) const;
+    bool matches( const SearchKey & sk ) const;
+    bool accepts( const QAbstractItemModel * model, const KeyListModelInterface * klm, const QModelIndex & index ) const;
+
 private:
     shared_ptr<const KeyFilter> keyFilter;
+
+    // the strings of each key the filter is matched against, by fingerprint
+    mutable QHash<QByteArray, SearchKey> searchKeys;
+    // the result of accepts() for the current filter, by fingerprint
+    mutable QHash<QByteArray, bool> accepted;
+
+    // the filter the cached results were computed for
+    mutable QRegExp filterRegExp;
+    mutable int filterRole;
+    mutable bool literal;
+    mutable bool caseInsensitive;
+    mutable QStringMatcher matcher;
 };
 
+void KeyListSortFilterProxyModel::Private::updateFilter( const QRegExp & rx, int role ) const {
+    if ( rx == filterRegExp && role == filterRole )
+        return;
+
+    if ( role != filterRole )
+        searchKeys.clear();
+    accepted.clear();
+    filterRegExp = rx;
+    filterRole = role;
+
+    // plain strings (the usual case, from setFilterFixedString()) are matched
+    // against the pre-lowered search keys without going through QRegExp
+    const QString pattern = rx.pattern();
+    literal = rx.patternSyntax() == QRegExp::FixedString
+        || ( ( rx.patternSyntax() == QRegExp::RegExp || rx.patternSyntax() == QRegExp::RegExp2 )
+             && QRegExp::escape( pattern ) == pattern );
+    caseInsensitive = rx.caseSensitivity() == Qt::CaseInsensitive;
+    matcher = QStringMatcher( caseInsensitive ? pattern.toLower() : pattern, Qt::CaseSensitive );
+}
+
+KeyListSortFilterProxyModel::Private::SearchKey KeyListSortFilterProxyModel::Private::searchKey( const QAbstractItemModel * model, const QModelIndex & index ) const {
+    SearchKey sk;
+    sk.name = model->index( index.row(), PrettyName, index.parent() ).data( filterRole ).toString();
+    sk.lowerName = sk.name.toLower();
+#ifndef KDEPIM_MOBILE_UI
+    sk.email = model->index( index.row(), PrettyEMail, index.parent() ).data( filterRole ).toString();
+    sk.lowerEmail = sk.email.toLower();
+#endif
+    return sk;
+}
+
+bool KeyListSortFilterProxyModel::Private::matches( const SearchKey & sk ) const {
+    if ( literal ) {
+        if ( caseInsensitive )
+            return matcher.indexIn( sk.lowerName ) != -1
+#ifndef KDEPIM_MOBILE_UI
+                || matcher.indexIn( sk.lowerEmail ) != -1
+#endif
+                ;
+        else
+            return matcher.indexIn( sk.name ) != -1
+#ifndef KDEPIM_MOBILE_UI
+                || matcher.indexIn( sk.email ) != -1
+#endif
+                ;
+    }
+
+    return sk.name.contains( filterRegExp )
+#ifndef KDEPIM_MOBILE_UI
+        || sk.email.contains( filterRegExp )
+#endif
+        ;
+}
+
+bool KeyListSortFilterProxyModel::Private::accepts( const QAbstractItemModel * model, const KeyListModelInterface * klm, const QModelIndex & index ) const {
+
+    const Key key = klm ? klm->key( index ) : Key();
+    const QByteArray fpr( key.primaryFingerprint() );
+
+    if ( !fpr.isEmpty() ) {
+        const QHash<QByteArray, bool>::const_iterator it = accepted.constFind( fpr );
+        if ( it != accepted.constEnd() )
+            return *it;
+    }
+
+    bool result = false;
+
+    //
+    // 0. Keep parents of matching children. Since the results are cached,
+    //    every descendant is only evaluated once per filter, no matter how
+    //    deep the hierarchy is.
+    //
+    for ( int i = 0, end = model->rowCount( index ) ; i != end ; ++i )
+        if ( accepts( model, klm, model->index( i, 0, index ) ) ) {
+            result = true;
+            break;
+        }
+
+    //
+    // 1. Check that name or email matches filterRegExp
+    //
+    if ( !result ) {
+        if ( fpr.isEmpty() ) {
+            result = matches( searchKey( model, index ) );
+        } else {
+            QHash<QByteArray, SearchKey>::const_iterator it = searchKeys.constFind( fpr );
+            if ( it == searchKeys.constEnd() )
+                it = searchKeys.insert( fpr, searchKey( model, index ) );
+            result = matches( *it );
+        }
+
+        //
+        // 2. Check that key filters match (if any are defined)
+        //
+        if ( result && keyFilter ) { // avoid artifacts when no filters are defined
+            assert( klm );
+            result = keyFilter->matches( key, KeyFilter::Filtering );
+        }
+    }
+
+    if ( !fpr.isEmpty() )
+        accepted.insert( fpr, result );
+
+    return result;
+}
+
 
 KeyListSortFilterProxyModel::KeyListSortFilterProxyModel( QObject * p )
     : AbstractKeyListSortFilterProxyModel( p ), d( new Private )
@@ -150,53 +292,41 @@ void KeyListSortFilterProxyModel::setKeyFilter( const shared_ptr<const KeyFilter
     if ( kf == d->keyFilter )
         return;
     d->keyFilter = kf;
+    d->accepted.clear();
     invalidateFilter();
 }
 
-bool KeyListSortFilterProxyModel::filterAcceptsRow( int source_row, const QModelIndex & source_parent ) const {
-
-    //
-    // 0. Keep parents of matching children:
-    //
-    const QModelIndex index = sourceModel()->index( source_row, 0, source_parent );
-    for ( int i = 0, end = sourceModel()->rowCount( index ) ; i != end ; ++i )
-	if ( filterAcceptsRow( i, index ) )
-	    return true;
-
-    //
-    // 1. Check that name or email matches filterRegExp
-    //
-    const int role = filterRole();
-
-    const QModelIndex nameIndex = sourceModel()->index( source_row, PrettyName, source_parent );
-    const QString name = nameIndex.data( role ).toString();
+void KeyListSortFilterProxyModel::setSourceModel( QAbstractItemModel * sm ) {
+    if ( sm == sourceModel() )
+        return;
 
-#ifndef KDEPIM_MOBILE_UI
-    const QModelIndex emailIndex = sourceModel()->index( source_row, PrettyEMail, source_parent );
-    const QString email = emailIndex.data( role ).toString();
-#endif
+    if ( QAbstractItemModel * const old = sourceModel() )
+        disconnect( old, 0, this, SLOT(clearCache()) );
+    d->clearCache();
+
+    // connect before QSortFilterProxyModel does, so that the cached results
+    // are dropped before it re-evaluates the filter for the changed rows
+    if ( sm ) {
+        connect( sm, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(clearCache()) );
+        connect( sm, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(clearCache()) );
+        connect( sm, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)), this, SLOT(clearCache()) );
+        connect( sm, SIGNAL(layoutAboutToBeChanged()), this, SLOT(clearCache()) );
+        connect( sm, SIGNAL(modelAboutToBeReset()), this, SLOT(clearCache()) );
+    }
 
-    const QRegExp rx = filterRegExp();
-    if ( !name.contains( rx ) )
-#ifndef KDEPIM_MOBILE_UI
-        if ( !email.contains( rx ) )
-#endif
-            return false;
+    AbstractKeyListSortFilterProxyModel::setSourceModel( sm );
+}
 
-    //
-    // 2. Check that key filters match (if any are defined)
-    //
-    if ( d->keyFilter ) { // avoid artifacts when no filters are defined
+bool KeyListSortFilterProxyModel::filterAcceptsRow( int source_row, const QModelIndex & source_parent ) const {
 
-        const KeyListModelInterface * const klm = dynamic_cast<KeyListModelInterface*>( sourceModel() );
-        assert( klm );
-        const Key key = klm->key( nameIndex );
+    // QSortFilterProxyModel gives us no notification when the filter string
+    // changes, so check whether the cached results still apply:
+    d->updateFilter( filterRegExp(), filterRole() );
 
-        return d->keyFilter->matches( key, KeyFilter::Filtering );
-    }
+    const QAbstractItemModel * const model = sourceModel();
+    const KeyListModelInterface * const klm = dynamic_cast<const KeyListModelInterface*>( model );
 
-    // 3. match by default:
-    return true;
+    return d->accepts( model, klm, model->index( source_row, 0, source_parent ) );
 }
 
 #include "moc_keylistsortfilterproxymodel.cpp"
@@ -81,6 +81,8 @@ namespace Kleo {
 	void setKeyFilter( const boost::shared_ptr<const KeyFilter> & kf );
 
         /* reimp */ KeyListSortFilterProxyModel * clone() const;
+
+        /* reimp */ void setSourceModel( QAbstractItemModel * sourceModel );
 	
     protected:
 	/* reimp */ bool filterAcceptsRow( int source_row, const QModelIndex & source_parent ) const;
@@ -88,6 +90,7 @@ namespace Kleo {
     private:
 	class Private;
 	kdtools::pimpl_ptr<Private> d;
+        Q_PRIVATE_SLOT( d, void clearCache() )
     };
 
 }
@@ -0,0 +1,140 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    tests/benchmark_classify.cpp
+
+    This file is part of Kleopatra's test suite.
+    Copyright (c) 2007 Klarälvdalens Datakonsult AB
+
+    Kleopatra is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kleopatra is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of this program with any edition of
+    the Qt library by Trolltech AS, Norway (or with modified versions
+    of Qt that use the same license as Qt), and distribute linked
+    combinations including the two.  You must obey the GNU General
+    Public License in all respects for all of the code used other than
+    Qt.  If you modify this file, you may extend this exception to
+    your version of the file, but you are not obligated to do so.  If
+    you do not wish to do so, delete this exception statement from
+    your version.
+*/
+
+
+#include <config-kleopatra.h>
+
+#include <utils/classify.h>
+
+#include <KTempDir>
+
+#include <qtest_kde.h>
+
+#include <QtCore/QObject>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+
+using namespace Kleo;
+using namespace Kleo::Class;
+
+static const char pgpSignature[] =
+    "-----BEGIN PGP SIGNATURE-----\n"
+    "Version: GnuPG v2.0.14 (GNU/Linux)\n"
+    "\n"
+    "iEYEABECAAYFAkvr0/0ACgkQb9iRZFpdSjuE3gCfXr2nHqvWOpEOLXA+jFNXv0Rx\n"
+    "-----END PGP SIGNATURE-----\n";
+
+static const char pgpMessage[] =
+    "-----BEGIN PGP MESSAGE-----\n"
+    "Version: GnuPG v2.0.14 (GNU/Linux)\n"
+    "\n"
+    "hQEOA9yx6yHNf1+sEAQAnyJ7QlxdvZCCo2Vj6Gtk8pM8hI4aG9H2Q7sH9ThPrPdD\n"
+    "-----END PGP MESSAGE-----\n";
+
+static void writeFile( const QString & fileName, const QByteArray & data ) {
+    QFile file( fileName );
+    QVERIFY( file.open( QIODevice::WriteOnly ) );
+    QCOMPARE( file.write( data ), qint64( data.size() ) );
+}
+
+class ClassifyBenchmark : public QObject {
+    Q_OBJECT
+private:
+    KTempDir mDir;
+    QStringList mSignatures; // .asc, need their content examined
+    QStringList mMixed;      // .asc, .sig and .p7s
+
+private Q_SLOTS:
+    void initTestCase();
+    void testClassify();
+    void testContentChange();
+    void benchmarkClassifyList();
+    void benchmarkClassifyOneByOne();
+};
+
+void ClassifyBenchmark::initTestCase() {
+    QVERIFY( mDir.exists() );
+    for ( int i = 0 ; i < 3000 ; ++i ) {
+        const QString base = mDir.name() + QString::fromLatin1( "file%1" ).arg( i );
+        writeFile( base + ".asc", pgpSignature );
+        mSignatures.push_back( base + ".asc" );
+        mMixed.push_back( base + ".asc" );
+        if ( i % 3 == 1 ) {
+            writeFile( base + ".sig", "\x88\x46" );
+            mMixed.push_back( base + ".sig" );
+        } else if ( i % 3 == 2 ) {
+            writeFile( base + ".p7s", "\x30\x80" );
+            mMixed.push_back( base + ".p7s" );
+        }
+    }
+}
+
+void ClassifyBenchmark::testClassify() {
+    const unsigned int expected = OpenPGP|DetachedSignature;
+    QCOMPARE( classify( mSignatures.front() ), expected );
+    QCOMPARE( classify( mSignatures ), expected );
+
+    unsigned int oneByOne = ~0U;
+    Q_FOREACH( const QString & fileName, mMixed )
+        oneByOne &= classify( fileName );
+    QCOMPARE( classify( mMixed ), oneByOne );
+
+    QCOMPARE( classify( QStringList() ), 0U );
+}
+
+void ClassifyBenchmark::testContentChange() {
+    const QString fileName = mDir.name() + "changing.asc";
+    writeFile( fileName, pgpSignature );
+    QCOMPARE( classify( fileName ), unsigned( OpenPGP|DetachedSignature ) );
+
+    // different size, so the cached classification must not be used:
+    writeFile( fileName, pgpMessage );
+    QCOMPARE( classify( fileName ), unsigned( OpenPGP|OpaqueSignature|CipherText ) );
+}
+
+void ClassifyBenchmark::benchmarkClassifyList() {
+    QBENCHMARK {
+        classify( mMixed );
+    }
+}
+
+void ClassifyBenchmark::benchmarkClassifyOneByOne() {
+    QBENCHMARK {
+        unsigned int result = ~0U;
+        Q_FOREACH( const QString & fileName, mMixed )
+            result &= classify( fileName );
+    }
+}
+
+QTEST_KDEMAIN( ClassifyBenchmark, NoGUI )
+
+#include "benchmark_classify.moc"
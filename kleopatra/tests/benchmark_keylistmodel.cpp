@@ -0,0 +1,151 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    tests/benchmark_keylistmodel.cpp
+
+    This file is part of Kleopatra's test suite.
+    Copyright (c) 2007 Klarälvdalens Datakonsult AB
+
+    Kleopatra is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kleopatra is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of this program with any edition of
+    the Qt library by Trolltech AS, Norway (or with modified versions
+    of Qt that use the same license as Qt), and distribute linked
+    combinations including the two.  You must obey the GNU General
+    Public License in all respects for all of the code used other than
+    Qt.  If you modify this file, you may extend this exception to
+    your version of the file, but you are not obligated to do so.  If
+    you do not wish to do so, delete this exception statement from
+    your version.
+*/
+
+#include <config-kleopatra.h>
+
+#include <models/keylistmodel.h>
+
+#include <gpgme++/key.h>
+
+#include <gpgme.h>
+
+#include <qtest_kde.h>
+
+#include <QtCore/QObject>
+
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+
+using namespace Kleo;
+using namespace GpgME;
+
+static QByteArray fingerprint( int i ) {
+    return QByteArray::number( i, 16 ).toUpper().rightJustified( 40, '0' );
+}
+
+// Creates a fake X.509 certificate with just enough filled in for the
+// key list models. The memory is deliberately never released: the
+// returned Key holds a second reference, so gpgme never tries to free
+// what it didn't allocate.
+static Key makeKey( const QByteArray & fpr, const QByteArray & issuer ) {
+    const gpgme_key_t key = static_cast<gpgme_key_t>( std::calloc( 1, sizeof( struct _gpgme_key ) ) );
+    const gpgme_subkey_t subkey = static_cast<gpgme_subkey_t>( std::calloc( 1, sizeof( struct _gpgme_subkey ) ) );
+    subkey->fpr = qstrdup( fpr.constData() );
+    key->subkeys = subkey;
+    key->protocol = GPGME_PROTOCOL_CMS;
+    key->chain_id = qstrdup( issuer.constData() );
+    key->_refs = 1;
+    return Key( key, true );
+}
+
+// Creates roots * intermediates * leaves certificates (plus their CAs),
+// shuffled, so that children are frequently added before their issuers.
+static std::vector<Key> makeKeys( int roots, int intermediates, int leaves ) {
+    std::vector<Key> result;
+    int n = 0;
+    for ( int r = 0 ; r < roots ; ++r ) {
+        const QByteArray root = fingerprint( n++ );
+        result.push_back( makeKey( root, root ) );
+        for ( int i = 0 ; i < intermediates ; ++i ) {
+            const QByteArray intermediate = fingerprint( n++ );
+            result.push_back( makeKey( intermediate, root ) );
+            for ( int l = 0 ; l < leaves ; ++l )
+                result.push_back( makeKey( fingerprint( n++ ), intermediate ) );
+        }
+    }
+    std::srand( 42 );
+    std::random_shuffle( result.begin(), result.end() );
+    return result;
+}
+
+static void addKeysInChunks( AbstractKeyListModel * model, const std::vector<Key> & keys, unsigned int chunkSize ) {
+    for ( unsigned int i = 0 ; i < keys.size() ; i += chunkSize ) {
+        const std::vector<Key>::const_iterator begin = keys.begin() + i;
+        const std::vector<Key>::const_iterator end = keys.begin() + qMin<unsigned int>( i + chunkSize, keys.size() );
+        model->addKeys( std::vector<Key>( begin, end ) );
+    }
+}
+
+class KeyListModelBenchmark : public QObject {
+    Q_OBJECT
+private Q_SLOTS:
+    void testHierarchy();
+    void benchmarkAddKeys();
+};
+
+void KeyListModelBenchmark::testHierarchy() {
+    const std::vector<Key> keys = makeKeys( 3, 5, 7 );
+    AbstractKeyListModel * const model = AbstractKeyListModel::createHierarchicalKeyListModel( this );
+    addKeysInChunks( model, keys, 4 );
+
+    QCOMPARE( model->rowCount( QModelIndex() ), 3 );
+    for ( int r = 0 ; r < 3 ; ++r ) {
+        const QModelIndex root = model->index( r, 0, QModelIndex() );
+        QVERIFY( !model->parent( root ).isValid() );
+        QCOMPARE( model->rowCount( root ), 5 );
+        for ( int i = 0 ; i < 5 ; ++i ) {
+            const QModelIndex intermediate = model->index( i, 0, root );
+            QCOMPARE( model->parent( intermediate ), root );
+            QCOMPARE( model->rowCount( intermediate ), 7 );
+            for ( int l = 0 ; l < 7 ; ++l ) {
+                const QModelIndex leaf = model->index( l, 0, intermediate );
+                QCOMPARE( model->parent( leaf ), intermediate );
+                QCOMPARE( model->rowCount( leaf ), 0 );
+                QCOMPARE( model->index( model->key( leaf ) ), leaf );
+            }
+        }
+    }
+
+    // re-adding known keys must update, not duplicate them:
+    addKeysInChunks( model, keys, 10 );
+    QCOMPARE( model->rowCount( QModelIndex() ), 3 );
+    QCOMPARE( model->rowCount( model->index( 0, 0, QModelIndex() ) ), 5 );
+
+    delete model;
+}
+
+void KeyListModelBenchmark::benchmarkAddKeys() {
+    // 10 roots, 1000 intermediate CAs, 99000 end-entity certificates:
+    const std::vector<Key> keys = makeKeys( 10, 100, 99 );
+
+    QBENCHMARK {
+        AbstractKeyListModel * const model = AbstractKeyListModel::createHierarchicalKeyListModel();
+        addKeysInChunks( model, keys, 250 );
+        QCOMPARE( model->rowCount( QModelIndex() ), 10 );
+        delete model;
+    }
+}
+
+QTEST_KDEMAIN( KeyListModelBenchmark, NoGUI )
+
+#include "benchmark_keylistmodel.moc"
@@ -0,0 +1,127 @@
+/*
+    This file is part of Kleopatra's test suite.
+    Copyright (c) 2010 the KDE PIM authors
+
+    Kleopatra is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kleopatra is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of this program with any edition of
+    the Qt library by Trolltech AS, Norway (or with modified versions
+    of Qt that use the same license as Qt), and distribute linked
+    combinations including the two.  You must obey the GNU General
+    Public License in all respects for all of the code used other than
+    Qt.  If you modify this file, you may extend this exception to
+    your version of the file, but you are not obligated to do so.  If
+    you do not wish to do so, delete this exception statement from
+    your version.
+*/
+
+#include <config-kleopatra.h>
+
+#include "kleo_test.h"
+
+#include <models/keycache.h>
+
+#include <gpgme++/key.h>
+#include <gpgme++/keylistresult.h>
+
+#include <QtCore/QObject>
+#include <QtCore/QEventLoop>
+#include <QtCore/QTimer>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+using namespace Kleo;
+
+class KeyCacheTest : public QObject
+{
+  Q_OBJECT
+  private:
+    boost::shared_ptr<KeyCache> mCache;
+    QEventLoop mEventLoop;
+    int mAdded;
+    int mRemoved;
+
+    void reloadAndWait()
+    {
+      QTimer::singleShot( 60000, &mEventLoop, SLOT( quit() ) );
+      mCache->reload();
+      mEventLoop.exec();
+    }
+
+  public slots:
+    void slotAdded() { ++mAdded; }
+    void slotAboutToRemove() { ++mRemoved; }
+    void slotKeyListingDone() { mEventLoop.quit(); }
+
+  private slots:
+    void initTestCase()
+    {
+      mCache = KeyCache::mutableInstance();
+      connect( mCache.get(), SIGNAL( added( GpgME::Key ) ),
+               this, SLOT( slotAdded() ) );
+      connect( mCache.get(), SIGNAL( aboutToRemove( GpgME::Key ) ),
+               this, SLOT( slotAboutToRemove() ) );
+      connect( mCache.get(), SIGNAL( keyListingDone( GpgME::KeyListResult ) ),
+               this, SLOT( slotKeyListingDone() ) );
+
+      reloadAndWait();
+      QVERIFY( !mCache->keys().empty() );
+    }
+
+    void init()
+    {
+      mAdded = 0;
+      mRemoved = 0;
+    }
+
+    // Listing an unchanged keyring again must not touch the cache
+    void testReloadUnchanged()
+    {
+      const std::vector<GpgME::Key> before = mCache->keys();
+
+      reloadAndWait();
+
+      QCOMPARE( mAdded, 0 );
+      QCOMPARE( mRemoved, 0 );
+      QCOMPARE( mCache->keys().size(), before.size() );
+    }
+
+    // Only the keys that went away or came back are removed or added
+    void testRefreshDifferential()
+    {
+      const std::vector<GpgME::Key> keys = mCache->keys();
+      const std::vector<GpgME::Key> subset( keys.begin() + 1, keys.end() );
+
+      mCache->refresh( subset );
+      QCOMPARE( mAdded, 0 );
+      QCOMPARE( mRemoved, 1 );
+      QCOMPARE( mCache->keys().size(), subset.size() );
+      QVERIFY( mCache->findByFingerprint( keys.front().primaryFingerprint() ).isNull() );
+
+      init();
+      mCache->refresh( keys );
+      QCOMPARE( mAdded, 1 );
+      QCOMPARE( mRemoved, 0 );
+      QCOMPARE( mCache->keys().size(), keys.size() );
+      QVERIFY( !mCache->findByFingerprint( keys.front().primaryFingerprint() ).isNull() );
+    }
+};
+
+QTEST_KLEOMAIN( KeyCacheTest, NoGUI )
+
+#include "test_keycache.moc"
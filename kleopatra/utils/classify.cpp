@@ -38,8 +38,12 @@
 #include <QStringList>
 #include <QFile>
 #include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
 #include <QtAlgorithms>
 #include <QByteArrayMatcher>
+#include <QtConcurrentMap>
 
 #include <boost/range.hpp>
 
@@ -138,44 +142,124 @@ namespace {
         }
     };
 
+    // not function-local, so classifyContent() is safe to call from the
+    // threads classify( QStringList ) uses:
+    static const char beginString[] = "-----BEGIN ";
+    static const QByteArrayMatcher beginMatcher( beginString );
+
+    static const _classification * findClassification( const QString & filename ) {
+#ifdef __GNUC__
+        assert( __gnu_cxx::is_sorted( begin( classifications ), end( classifications ), ByExtension<std::less>() ) );
+#endif
+        return qBinaryFind( begin( classifications ), end( classifications ),
+                            QFileInfo( filename ).suffix().toLatin1().constData(),
+                            ByExtension<std::less>() );
+    }
+
+    //
+    // Content classifications are cached by absolute path for as long
+    // as the file's modification time and size stay the same:
+    //
+
+    struct _cached_content_classification {
+        QDateTime lastModified;
+        qint64 size;
+        unsigned int classification;
+    };
+
+    static const int maxContentCacheSize = 4096;
+
+    static QMutex contentCacheMutex;
+    static QHash<QString,_cached_content_classification> contentCache;
+
+    static unsigned int classifyFileContent( const QString & filename ) {
+        const QFileInfo fi( filename );
+        const QString path = fi.absoluteFilePath();
+        const _cached_content_classification entry = { fi.lastModified(), fi.size(), defaultClassification };
+
+        {
+            const QMutexLocker locker( &contentCacheMutex );
+            const QHash<QString,_cached_content_classification>::const_iterator it = contentCache.constFind( path );
+            if ( it != contentCache.constEnd() && it->lastModified == entry.lastModified && it->size == entry.size )
+                return it->classification;
+        }
+
+        QFile file( filename );
+        if ( !file.open( QIODevice::ReadOnly|QIODevice::Text ) )
+            return defaultClassification;
+
+        const unsigned int classification = Kleo::classifyContent( file.read( 4096 ) );
+
+        const QMutexLocker locker( &contentCacheMutex );
+        if ( contentCache.size() >= maxContentCacheSize )
+            contentCache.clear();
+        _cached_content_classification & cached = contentCache[path];
+        cached = entry;
+        cached.classification = classification;
+        return classification;
+    }
+
+    static unsigned int classifyFile( const QString & filename ) {
+        const _classification * const it = findClassification( filename );
+        if ( it != end( classifications ) )
+            if ( !( it->classification & ExamineContentHint ) )
+                return it->classification;
+
+        const unsigned int bestGuess =
+            it == end( classifications ) ? defaultClassification
+            /* else */                   : it->classification ;
+
+        const unsigned int contentClassification = classifyFileContent( filename );
+        if ( contentClassification != defaultClassification )
+            return contentClassification;
+        else
+            return bestGuess;
+    }
+
+    // below this, starting threads costs more than it saves:
+    static const int minParallelContentClassifications = 8;
+
 }
 
 unsigned int Kleo::classify( const QStringList & fileNames ) {
     if ( fileNames.empty() )
         return 0;
-    unsigned int result = classify( fileNames.front() );
-    Q_FOREACH( const QString & fileName, fileNames )
-        result &= classify( fileName );
+
+    unsigned int result = ~0U;
+
+    // 1. resolve what can be resolved by extension alone, and collect
+    //    the files whose content needs to be examined:
+    QStringList examineContent;
+    Q_FOREACH( const QString & fileName, fileNames ) {
+        const _classification * const it = findClassification( fileName );
+        if ( it != end( classifications ) && !( it->classification & ExamineContentHint ) ) {
+            result &= it->classification;
+            if ( result == NoClass )
+                return result;
+        } else {
+            examineContent.push_back( fileName );
+        }
+    }
+
+    // 2. read the others, in parallel if there are enough of them:
+    if ( examineContent.size() < minParallelContentClassifications ) {
+        Q_FOREACH( const QString & fileName, examineContent ) {
+            result &= classifyFile( fileName );
+            if ( result == NoClass )
+                return result;
+        }
+    } else {
+        const QList<unsigned int> contentClassifications
+            = QtConcurrent::blockingMapped< QList<unsigned int> >( examineContent, &classifyFile );
+        Q_FOREACH( const unsigned int classification, contentClassifications )
+            result &= classification;
+    }
+
     return result;
 }
 
 unsigned int Kleo::classify( const QString & filename ) {
-#ifdef __GNUC__
-    assert( __gnu_cxx::is_sorted( begin( classifications ), end( classifications ), ByExtension<std::less>() ) );
-#endif
-
-    const QFileInfo fi( filename );
-
-    const _classification * const it = qBinaryFind( begin( classifications ), end( classifications ),
-                                                    fi.suffix().toLatin1().constData(),
-                                                    ByExtension<std::less>() );
-    if ( it != end( classifications ) )
-        if ( !( it->classification & ExamineContentHint ) )
-            return it->classification;
-
-    const unsigned int bestGuess =
-        it == end( classifications ) ? defaultClassification
-        /* else */                   : it->classification ;
-
-    QFile file( filename );
-    if ( !file.open( QIODevice::ReadOnly|QIODevice::Text ) )
-        return bestGuess;
-
-    const unsigned int contentClassification = classifyContent( file.read( 4096 ) );
-    if ( contentClassification != defaultClassification )
-        return contentClassification;
-    else
-        return bestGuess;
+    return classifyFile( filename );
 }
 
 unsigned int Kleo::classifyContent( const QByteArray & data ) {
@@ -183,8 +267,6 @@ unsigned int Kleo::classifyContent( const QByteArray & data ) {
     assert( __gnu_cxx::is_sorted( begin( content_classifications ), end( content_classifications ), ByContent<std::less>(100) ) );
 #endif
 
-    static const char beginString[] = "-----BEGIN ";
-    static const QByteArrayMatcher beginMatcher( beginString );
     int pos = beginMatcher.indexIn( data );
     if ( pos < 0 )
         return defaultClassification;
@@ -33,7 +33,7 @@
 KNGroupBrowser::KNGroupBrowser(QWidget *parent, const QString &caption, KNNntpAccount::Ptr a,
                                ButtonCodes buttons, bool newCBact, const QString &user1, const QString &user2) :
   KDialog( parent ),
-  incrementalFilter(false), a_ccount(a)
+  incrementalFilter(false), a_ccount(a), fedItems(0)
 {
 #if 0
   setCaption( caption );
@@ -42,9 +42,9 @@ KNGroupBrowser::KNGroupBrowser(QWidget *parent, const QString &caption, KNNntpAc
   setButtonGuiItem( User2, KGuiItem(user2) );
   refilterTimer = new QTimer();
   refilterTimer->setSingleShot( true );
+  feedTimer = new QTimer();
 
   allList=new QList<KNGroupInfo>;
-  matchList=new QList<KNGroupInfo>;
 
   //create Widgets
   page=new QWidget(this);
@@ -134,6 +134,7 @@ KNGroupBrowser::KNGroupBrowser(QWidget *parent, const QString &caption, KNNntpAc
           SLOT(slotItemExpand(Q3ListViewItem*)));
 
   connect(refilterTimer, SIGNAL(timeout()), SLOT(slotRefilter()));
+  connect(feedTimer, SIGNAL(timeout()), SLOT(slotFeedItems()));
   connect(noTreeCB, SIGNAL(clicked()), SLOT(slotTreeCBToggled()));
   connect(subCB, SIGNAL(clicked()), SLOT(slotSubCBToggled()));
   connect(newCB, SIGNAL(clicked()), SLOT(slotNewCBToggled()));
@@ -157,9 +158,9 @@ KNGroupBrowser::~KNGroupBrowser()
   knGlobals.scheduler()->cancelJobs( KNJobData::JTLoadGroups );
   knGlobals.scheduler()->cancelJobs( KNJobData::JTFetchGroups );
 
-  delete matchList;
   delete allList;
   delete refilterTimer;
+  delete feedTimer;
 #else
   kDebug() << "AKONADI PORT: Disabled code in" << Q_FUNC_INFO;
 #endif
@@ -175,6 +176,13 @@ void KNGroupBrowser::slotReceiveList( KNGroupListData::Ptr d )
   if (d) {  // d==0 if something has gone wrong...
     delete allList;
     allList = d->extractList();
+
+    QStringList names;
+    Q_FOREACH(const KNGroupInfo& g, *allList)
+      names.append(g.name);
+    catalog.setGroups(names);
+    matchList.clear();
+
     incrementalFilter=false;
     slotRefilter();
   }
@@ -233,15 +241,9 @@ void KNGroupBrowser::createListItems(Q3ListViewItem *parent)
     }
   }
 
-  qSort(*matchList);
-  Q_FOREACH(const KNGroupInfo& gn, *matchList) {
-
-    if(!prefix.isEmpty() && !gn.name.startsWith(prefix)) {
-      if(!compare.isNull())
-        break;
-      else
-        continue;
-    }
+  // matchList is kept in name order: the children of parent are a contiguous range of it
+  Q_FOREACH(int index, catalog.withPrefix(matchList, prefix)) {
+    const KNGroupInfo& gn = allList->at(index);
 
     compare=gn.name.mid(prefix.length());
 
@@ -362,47 +364,38 @@ void KNGroupBrowser::slotFilter(const QString &txt)
 #if 0
   QString filtertxt = txt.toLower();
   QRegExp reg(filtertxt, Qt::CaseInsensitive, QRegExp::RegExp);
-  CheckItem *cit=0;
 
   bool notCheckSub = !subCB->isChecked();
   bool notCheckNew = !newCB->isChecked();
-  bool notCheckStr = (filtertxt.isEmpty());
 
   bool isRegexp = filtertxt.contains(QRegExp("[^a-z0-9\\-\\+.]"));
 
-  bool doIncrementalUpdate = (!isRegexp && incrementalFilter && (filtertxt.left(lastFilter.length())==lastFilter));
+  bool doIncrementalUpdate = (!isRegexp && incrementalFilter && filtertxt.startsWith(lastFilter));
 
     kDebug() << "Populating view, incremental is " << doIncrementalUpdate;
-  if (doIncrementalUpdate) {
-    QList<KNGroupInfo> *tempList = new QList<KNGroupInfo>();
-
-    Q_FOREACH(const KNGroupInfo& g, *matchList) {
-      if ((notCheckSub||g.subscribed)&&
-          (notCheckNew||g.newGroup)&&
-          ( notCheckStr || ( g.name.indexOf(filtertxt) != -1 ) ) )
-      tempList->append(g);
+  if (doIncrementalUpdate)
+    matchList = catalog.refine(matchList, filtertxt);
+  else if (isRegexp)
+    matchList = catalog.match(reg);
+  else
+    matchList = catalog.find(filtertxt);
+
+  if (!notCheckSub || !notCheckNew) {
+    QVector<int> tempList;
+    Q_FOREACH(int index, matchList) {
+      const KNGroupInfo& g = allList->at(index);
+      if ((notCheckSub||g.subscribed)&&(notCheckNew||g.newGroup))
+        tempList.append(index);
     }
-
-    delete matchList;
     matchList=tempList;
-  } else {
-    matchList->clear();
-
-    Q_FOREACH(const KNGroupInfo& g, *allList) {
-      if ((notCheckSub||g.subscribed)&&
-          (notCheckNew||g.newGroup)&&
-          (notCheckStr||(isRegexp? (reg.indexIn(g.name,0) != -1) : ( g.name.indexOf( filtertxt ) != -1 ) )))
-        matchList->append(g);
-    }
   }
 
+  feedTimer->stop();
   groupView->clear();
 
-  if((matchList->count() < MIN_FOR_TREE) || noTreeCB->isChecked()) {
-    Q_FOREACH(const KNGroupInfo& g, *matchList) {
-      cit=new CheckItem(groupView, g, this);
-      updateItemState(cit);
-    }
+  if((matchList.count() < MIN_FOR_TREE) || noTreeCB->isChecked()) {
+    fedItems = 0;
+    slotFeedItems();
   } else {
     createListItems();
   }
@@ -410,7 +403,7 @@ void KNGroupBrowser::slotFilter(const QString &txt)
   lastFilter = filtertxt;
   incrementalFilter = !isRegexp;
 
-  leftLabel->setText(i18n("Groups on %1: (%2 displayed)", a_ccount->name(), matchList->count()));
+  leftLabel->setText(i18n("Groups on %1: (%2 displayed)", a_ccount->name(), matchList.count()));
 
   arrowBtn1->setEnabled(false);
   arrowBtn2->setEnabled(false);
@@ -420,6 +413,28 @@ void KNGroupBrowser::slotFilter(const QString &txt)
 }
 
 
+#define FEED_CHUNK_SIZE 500
+void KNGroupBrowser::slotFeedItems()
+{
+#if 0
+  // Large flat lists are inserted a chunk at a time from the event loop,
+  // so that the dialog stays responsive while the user keeps typing.
+  const int end = qMin(fedItems + FEED_CHUNK_SIZE, matchList.count());
+  for (; fedItems < end; ++fedItems) {
+    CheckItem *cit=new CheckItem(groupView, allList->at(matchList.at(fedItems)), this);
+    updateItemState(cit);
+  }
+
+  if (fedItems < matchList.count())
+    feedTimer->start(0);
+  else
+    feedTimer->stop();
+#else
+  kDebug() << "AKONADI PORT: Disabled code in" << Q_FUNC_INFO;
+#endif
+}
+
+
 void KNGroupBrowser::slotTreeCBToggled()
 {
 #if 0
@@ -16,6 +16,7 @@
 #define KNGROUPBROWSER_H
 
 #include "legacy_include.h"
+#include "utils/group_catalog.h"
 
 #include <kdialog.h>
 #include <q3listview.h>
@@ -91,12 +92,18 @@ class KNGroupBrowser : public KDialog {
     QIcon pmRight, pmLeft;
     QGridLayout *listL;
     QLabel *leftLabel, *rightLabel;
-    QTimer *refilterTimer;
+    QTimer *refilterTimer, *feedTimer;
     QString lastFilter;
     bool incrementalFilter;
 
     KNNntpAccount::Ptr a_ccount;
-    QList<KNGroupInfo> *allList, *matchList;
+    QList<KNGroupInfo> *allList;
+    /** Index over the names of allList. */
+    KNode::Utilities::GroupCatalog catalog;
+    /** Positions in allList of the groups that match the current filter, in name order. */
+    QVector<int> matchList;
+    /** Number of matching groups already inserted in the flat (non-tree) view. */
+    int fedItems;
 
   protected slots:
     void slotLoadList();
@@ -110,6 +117,8 @@ class KNGroupBrowser : public KDialog {
     void slotNewCBToggled();
     void slotFilterTextChanged(const QString &txt);
     void slotRefilter();
+    /** inserts the next chunk of matching groups into the flat view */
+    void slotFeedItems();
 
 };
 
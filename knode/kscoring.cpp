@@ -35,6 +35,7 @@
 #include <QDomNode>
 #include <QDomNodeList>
 #include <QFile>
+#include <QHash>
 #include <QLayout>
 #include <QLabel>
 #include <QTextStream>
@@ -431,8 +432,16 @@ void NotifyCollection::displayCollection( QWidget *p ) const
 //----------------------------------------------------------------------------
 KScoringExpression::KScoringExpression( const QString &h, const QString &t,
                                         const QString &n, const QString &ng )
-  : header( h ), expr_str( n )
+  : header( h ), expr_str( n ), expr_int( 0 )
 {
+  if ( header == "From" ) {
+    field = FROM;
+  } else if ( header == "Subject" ) {
+    field = SUBJECT;
+  } else {
+    field = OTHER;
+  }
+
   if ( t == "MATCH" ) {
     cond = MATCH;
     expr.setPattern( expr_str );
@@ -443,6 +452,7 @@ KScoringExpression::KScoringExpression( const QString &h, const QString &t,
     expr.setCaseSensitivity( Qt::CaseSensitive );
   } else if ( t == "CONTAINS" ) {
     cond = CONTAINS;
+    matcher = QStringMatcher( expr_str, Qt::CaseInsensitive );
   } else if ( t == "EQUALS" ) {
     cond = EQUALS;
   } else if ( t == "GREATER" ) {
@@ -544,21 +554,24 @@ bool KScoringExpression::match( ScorableArticle &a ) const
   bool res = true;
   QString head;
 
-  if ( header == "From" ) {
+  switch ( field ) {
+  case FROM:
     head = a.from();
-  } else if ( header == "Subject" ) {
+    break;
+  case SUBJECT:
     head = a.subject();
-  } else {
+    break;
+  default:
     head = a.getHeaderByType( header );
   }
 
   if ( !head.isEmpty() ) {
     switch( cond ) {
     case EQUALS:
-      res = ( head.toLower() == expr_str.toLower() );
+      res = ( QString::compare( head, expr_str, Qt::CaseInsensitive ) == 0 );
       break;
     case CONTAINS:
-      res = ( head.toLower().indexOf( expr_str.toLower() ) >= 0 );
+      res = ( matcher.indexIn( head ) >= 0 );
       break;
     case MATCH:
     case MATCHCS:
@@ -721,11 +734,17 @@ void KScoringRule::setExpire( const QString &e )
   kDebug(5100) <<"Rule" << getName() <<" expires at" << getExpireDateString();
 }
 
+// checks whether the group pattern of a rule matches the whole group name
+static bool matchGroupPattern( const QString &pattern, const QString &group )
+{
+  QRegExp e( pattern );
+  return e.indexIn( group, 0 ) != -1 && e.matchedLength() == group.length();
+}
+
 bool KScoringRule::matchGroup( const QString &group ) const
 {
   for ( GroupList::ConstIterator i = groups.begin(); i != groups.end(); ++i ) {
-    QRegExp e( *i );
-    if ( e.indexIn( group, 0 ) != -1 && e.matchedLength() == group.length() ) {
+    if ( matchGroupPattern( *i, group ) ) {
       return true;
     }
   }
@@ -864,6 +883,7 @@ void KScoringManager::load()
   f.close();
   kDebug(5100) <<"loaded the scorefile, creating internal representation";
   allRules.clear();
+  setCacheValid( false );
   createInternalFromXML( sdoc );
   expireRules();
   kDebug(5100) <<"ready, got" << allRules.count() <<" rules";
@@ -1058,6 +1078,7 @@ void KScoringManager::deleteRule( KScoringRule *r )
   int i = allRules.findRef( r );
   if ( i != -1 ) {
     allRules.remove();
+    setCacheValid( false );
     emit changedRules();
   }
 }
@@ -1082,6 +1103,7 @@ void KScoringManager::moveRuleAbove( KScoringRule *above, KScoringRule *below )
   }
   allRules.take( aindex );
   allRules.insert( bindex, above );
+  setCacheValid( false );
 }
 
 void KScoringManager::moveRuleBelow( KScoringRule *below, KScoringRule *above )
@@ -1096,6 +1118,7 @@ void KScoringManager::moveRuleBelow( KScoringRule *below, KScoringRule *above )
   }
   allRules.take( bindex );
   allRules.insert( aindex + 1, below );
+  setCacheValid( false );
 }
 
 void KScoringManager::editorReady()
@@ -1124,11 +1147,68 @@ void KScoringManager::applyRules( ScorableArticle &article, const QString &group
   applyRules( article );
 }
 
+namespace {
+
+// Remembers the headers of an article while the rules are applied to it,
+// so that each one is only looked up and decoded once.
+class CachedScorableArticle : public ScorableArticle
+{
+  public:
+    explicit CachedScorableArticle( ScorableArticle &a )
+      : article( a ), haveFrom( false ), haveSubject( false ) {}
+
+    virtual void addScore( short s ) { article.addScore( s ); }
+    virtual void displayMessage( const QString &s ) { article.displayMessage( s ); }
+    virtual void changeColor( const QColor &c ) { article.changeColor( c ); }
+    virtual void markAsRead() { article.markAsRead(); }
+
+    virtual QString from() const
+    {
+      if ( !haveFrom ) {
+        fromHeader = article.from();
+        haveFrom = true;
+      }
+      return fromHeader;
+    }
+
+    virtual QString subject() const
+    {
+      if ( !haveSubject ) {
+        subjectHeader = article.subject();
+        haveSubject = true;
+      }
+      return subjectHeader;
+    }
+
+    virtual QString getHeaderByType( const QString &type ) const
+    {
+      QHash<QString, QString>::const_iterator it = headers.constFind( type );
+      if ( it == headers.constEnd() ) {
+        it = headers.insert( type, article.getHeaderByType( type ) );
+      }
+      return *it;
+    }
+
+  private:
+    ScorableArticle &article;
+    mutable QString fromHeader;
+    mutable QString subjectHeader;
+    mutable bool haveFrom;
+    mutable bool haveSubject;
+    mutable QHash<QString, QString> headers;
+};
+
+}
+
 void KScoringManager::applyRules( ScorableArticle &a )
 {
-  Q3PtrListIterator<KScoringRule> it( isCacheValid() ? ruleList : allRules );
+  if ( !isCacheValid() ) {
+    initCache( group );
+  }
+  CachedScorableArticle cached( a );
+  Q3PtrListIterator<KScoringRule> it( ruleList );
   for ( ; it.current(); ++it ) {
-    it.current()->applyRule( a );
+    it.current()->applyRule( cached );
   }
 }
 
@@ -1136,10 +1216,20 @@ void KScoringManager::initCache( const QString &g )
 {
   group = g;
   ruleList.clear();
+  // rules share few distinct group patterns, so only match each one once
+  QHash<QString, bool> patterns;
   Q3PtrListIterator<KScoringRule> it(allRules);
   for ( ; it.current(); ++it ) {
-    if ( it.current()->matchGroup( group ) ) {
-      ruleList.append( it.current() );
+    const KScoringRule::GroupList &groups = it.current()->groups;
+    for ( KScoringRule::GroupList::ConstIterator i = groups.begin(); i != groups.end(); ++i ) {
+      QHash<QString, bool>::const_iterator pit = patterns.constFind( *i );
+      if ( pit == patterns.constEnd() ) {
+        pit = patterns.insert( *i, matchGroupPattern( *i, group ) );
+      }
+      if ( *pit ) {
+        ruleList.append( it.current() );
+        break;
+      }
     }
   }
   kDebug(5100) <<"created cache for group" << group
@@ -1149,7 +1239,7 @@ void KScoringManager::initCache( const QString &g )
 
 void KScoringManager::setGroup( const QString &g )
 {
-  if ( group != g ) {
+  if ( group != g || !isCacheValid() ) {
     initCache( g );
   }
 }
@@ -1248,6 +1338,7 @@ void KScoringManager::pushRuleList()
 void KScoringManager::popRuleList()
 {
   stack.pop( allRules );
+  setCacheValid( false );
 }
 
 void KScoringManager::removeTOS()
@@ -28,6 +28,7 @@
 #include <QRegExp>
 #include <QString>
 #include <QStringList>
+#include <QStringMatcher>
 #include <QTextStream>
 #include <Q3Dict>
 #include <Q3PtrList>
@@ -215,10 +216,19 @@ class KNODE_EXPORT KScoringExpression
     static QString getNameForCondition( int );
 
   private:
+    // the header accessor to use, resolved once
+    enum HeaderField {
+      FROM,
+      SUBJECT,
+      OTHER
+    };
+
     bool neg;
     QString header;
+    HeaderField field;
     Condition cond;
     QRegExp expr;
+    QStringMatcher matcher;
     QString expr_str;
     int expr_int;
 };
@@ -0,0 +1,208 @@
+/*
+  groupcatalogbenchmark.cpp
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software Foundation,
+  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, US
+*/
+
+#include "groupcatalogbenchmark.h"
+
+#include "utils/group_catalog.h"
+
+#include <qtest_kde.h>
+
+#include <QHash>
+#include <QRegExp>
+#include <QTest>
+
+using namespace KNode::Utilities;
+
+
+namespace {
+
+/**
+  What KNGroupBrowser used to do on every keystroke: sort, then scan every group.
+*/
+QVector<int> naiveFind( const QStringList &names, const QString &text )
+{
+  QHash<QString, int> positions;
+  for ( int i = 0 ; i < names.count() ; ++i ) {
+    positions.insert( names.at( i ), i );
+  }
+  QStringList sorted = names;
+  qSort( sorted );
+  QVector<int> result;
+  foreach ( const QString &name, sorted ) {
+    if ( name.contains( text, Qt::CaseInsensitive ) ) {
+      result.append( positions.value( name ) );
+    }
+  }
+  return result;
+}
+
+QStringList namesOf( const GroupCatalog &catalog, const QVector<int> &indexes )
+{
+  QStringList result;
+  foreach ( int i, indexes ) {
+    result.append( catalog.name( i ) );
+  }
+  return result;
+}
+
+}
+
+
+void GroupCatalogBenchmark::initTestCase()
+{
+  static const char * const hierarchies[] = {
+    "alt", "comp", "de", "fr", "misc", "news", "rec", "sci", "soc", "talk", "uk", "gmane"
+  };
+  static const char * const topics[] = {
+    "lang", "os", "linux", "kde", "binaries", "music", "games", "politics",
+    "test", "answers", "announce", "sources", "misc", "discuss", "help"
+  };
+  static const int hierarchyCount = sizeof( hierarchies ) / sizeof( *hierarchies );
+  static const int topicCount = sizeof( topics ) / sizeof( *topics );
+
+  // Unsorted, like a LIST ACTIVE answer.
+  for ( int i = 0 ; i < 100000 ; ++i ) {
+    mActiveList.append( QString::fromLatin1( "%1.%2.%3.g%4" )
+                          .arg( hierarchies[ ( i * 7 ) % hierarchyCount ] )
+                          .arg( topics[ ( i * 13 ) % topicCount ] )
+                          .arg( topics[ ( i / topicCount ) % topicCount ] )
+                          .arg( ( i * 7919 ) % 100003, 0, 36 ) );
+  }
+  mActiveList.append( QString::fromLatin1( "Alt.Mixed.Case" ) );
+}
+
+
+void GroupCatalogBenchmark::testFind()
+{
+  GroupCatalog catalog;
+  catalog.setGroups( mActiveList );
+  QCOMPARE( catalog.count(), mActiveList.count() );
+
+  QCOMPARE( catalog.all().count(), mActiveList.count() );
+  QCOMPARE( catalog.find( QString() ), catalog.all() );
+
+  const QStringList needles = QStringList() << "k" << "kd" << "kde" << "linux.kde" << "mixed"
+                                            << "ALT.MIX" << "s.an" << "nothing-like-this";
+  foreach ( const QString &needle, needles ) {
+    QCOMPARE( catalog.find( needle ), naiveFind( mActiveList, needle ) );
+  }
+  QCOMPARE( catalog.find( "mixed" ).count(), 1 );
+  QVERIFY( catalog.find( "nothing-like-this" ).isEmpty() );
+
+  catalog.clear();
+  QCOMPARE( catalog.count(), 0 );
+  QVERIFY( catalog.find( "kde" ).isEmpty() );
+}
+
+void GroupCatalogBenchmark::testRefine()
+{
+  GroupCatalog catalog;
+  catalog.setGroups( mActiveList );
+
+  const QString filter = "comp.linux.kde";
+  QVector<int> result = catalog.all();
+  for ( int i = 1 ; i <= filter.length() ; ++i ) {
+    result = catalog.refine( result, filter.left( i ) );
+    QCOMPARE( result, catalog.find( filter.left( i ) ) );
+  }
+  QVERIFY( !result.isEmpty() );
+
+  QCOMPARE( catalog.refine( result, QString() ), result );
+  QVERIFY( catalog.refine( result, "comp.linux.kdex" ).isEmpty() );
+}
+
+void GroupCatalogBenchmark::testWithPrefix()
+{
+  GroupCatalog catalog;
+  catalog.setGroups( mActiveList );
+
+  QStringList expected;
+  foreach ( const QString &name, mActiveList ) {
+    if ( name.startsWith( "comp.os." ) ) {
+      expected.append( name );
+    }
+  }
+  qSort( expected );
+  QVERIFY( !expected.isEmpty() );
+  QCOMPARE( namesOf( catalog, catalog.withPrefix( "comp.os." ) ), expected );
+
+  // Prefixes are case sensitive, like the group tree of the browser.
+  QCOMPARE( catalog.withPrefix( "Alt." ).count(), 1 );
+  QVERIFY( catalog.withPrefix( "COMP." ).isEmpty() );
+  QCOMPARE( catalog.withPrefix( QString() ), catalog.all() );
+
+  // Restricted to a previous result.
+  const QVector<int> kde = catalog.find( "kde" );
+  QStringList expectedKde;
+  foreach ( const QString &name, namesOf( catalog, kde ) ) {
+    if ( name.startsWith( "comp.os." ) ) {
+      expectedKde.append( name );
+    }
+  }
+  QVERIFY( !expectedKde.isEmpty() );
+  QCOMPARE( namesOf( catalog, catalog.withPrefix( kde, "comp.os." ) ), expectedKde );
+}
+
+void GroupCatalogBenchmark::testMatch()
+{
+  GroupCatalog catalog;
+  catalog.setGroups( mActiveList );
+
+  const QRegExp reg( "^comp\\.(os|lang)\\.kde\\.", Qt::CaseInsensitive );
+  QStringList expected;
+  foreach ( const QString &name, mActiveList ) {
+    if ( reg.indexIn( name ) != -1 ) {
+      expected.append( name );
+    }
+  }
+  qSort( expected );
+  QVERIFY( !expected.isEmpty() );
+  QCOMPARE( namesOf( catalog, catalog.match( reg ) ), expected );
+}
+
+
+void GroupCatalogBenchmark::benchmarkTypingWithCatalog()
+{
+  const QString filter = "comp.linux.kde";
+  GroupCatalog catalog;
+  catalog.setGroups( mActiveList );
+
+  QBENCHMARK {
+    QVector<int> result = catalog.find( filter.left( 1 ) );
+    for ( int i = 2 ; i <= filter.length() ; ++i ) {
+      result = catalog.refine( result, filter.left( i ) );
+    }
+  }
+}
+
+void GroupCatalogBenchmark::benchmarkTypingWithScan()
+{
+  const QString filter = "comp.linux.kde";
+  QStringList sorted = mActiveList;
+  qSort( sorted );
+
+  QBENCHMARK {
+    for ( int i = 1 ; i <= filter.length() ; ++i ) {
+      QStringList result;
+      foreach ( const QString &name, sorted ) {
+        if ( name.contains( filter.left( i ), Qt::CaseInsensitive ) ) {
+          result.append( name );
+        }
+      }
+    }
+  }
+}
+
+
+QTEST_KDEMAIN( GroupCatalogBenchmark, NoGUI )
+
+#include "groupcatalogbenchmark.moc"
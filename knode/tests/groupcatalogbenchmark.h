@@ -0,0 +1,39 @@
+/*
+  groupcatalogbenchmark.h
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software Foundation,
+  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, US
+*/
+
+#ifndef GROUPCATALOGBENCHMARK_H
+#define GROUPCATALOGBENCHMARK_H
+
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+
+class GroupCatalogBenchmark : public QObject
+{
+  Q_OBJECT
+
+  private slots:
+    void initTestCase();
+
+    void testFind();
+    void testRefine();
+    void testWithPrefix();
+    void testMatch();
+
+    void benchmarkTypingWithCatalog();
+    void benchmarkTypingWithScan();
+
+  private:
+    /** Synthetic active list of a large server. */
+    QStringList mActiveList;
+};
+
+#endif // GROUPCATALOGBENCHMARK_H
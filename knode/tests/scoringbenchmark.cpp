@@ -0,0 +1,167 @@
+/*
+  scoringbenchmark.cpp
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software Foundation,
+  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, US
+*/
+
+#include "scoringbenchmark.h"
+
+#include "kscoring.h"
+
+#include <qtest_kde.h>
+
+#include <QHash>
+#include <QTest>
+
+
+namespace {
+
+class TestArticle : public ScorableArticle
+{
+  public:
+    TestArticle() : score( 0 ) {}
+
+    virtual void addScore( short s ) { score += s; }
+    virtual QString from() const { return headers.value( "From" ); }
+    virtual QString subject() const { return headers.value( "Subject" ); }
+    virtual QString getHeaderByType( const QString &type ) const { return headers.value( type ); }
+
+    QHash<QString, QString> headers;
+    int score;
+};
+
+class TestScoringManager : public KScoringManager
+{
+  public:
+    TestScoringManager() : KScoringManager( "knode-scoringbenchmark" ) {}
+
+    virtual QStringList getGroups() const { return QStringList(); }
+
+    KScoringRule *addRule( const QString &group, const QString &header, const QString &type,
+                           const QString &expr, int score, KScoringRule::LinkMode link = KScoringRule::AND )
+    {
+      KScoringRule *rule = new KScoringRule( findUniqueName() );
+      rule->addGroup( group );
+      rule->setLinkMode( link );
+      rule->addExpression( new KScoringExpression( header, type, expr, "0" ) );
+      rule->addAction( ActionBase::SETSCORE, QString::number( score ) );
+      KScoringManager::addRule( rule );
+      return rule;
+    }
+};
+
+}
+
+
+void ScoringBenchmark::testApplyRules()
+{
+  TestScoringManager manager;
+  manager.addRule( ".*", "Subject", "CONTAINS", "KDE", 10 );
+  manager.addRule( "de.test", "From", "EQUALS", "joe@example.org", 5 );
+  manager.addRule( "alt.other", "Subject", "CONTAINS", "kde", 100 );
+  KScoringRule *rule = manager.addRule( "de\\..*", "Lines", "GREATER", "100", 1 );
+  rule->addExpression( new KScoringExpression( "Subject", "MATCH", "^re:", "0" ) );
+
+  TestArticle a;
+  a.headers.insert( "Subject", "Re: kde rocks" );
+  a.headers.insert( "From", "JOE@example.org" );
+  a.headers.insert( "Lines", "200" );
+  manager.applyRules( a, "de.test" );
+  QCOMPARE( a.score, 16 );
+
+  TestArticle b;
+  b.headers.insert( "Subject", "nothing to see" );
+  manager.applyRules( b, "alt.other" );
+  QCOMPARE( b.score, 0 );
+
+  TestArticle c;
+  c.headers.insert( "Subject", "About KDE" );
+  manager.applyRules( c, "alt.other" );
+  QCOMPARE( c.score, 110 );
+
+  // the same article in a group none of the group specific rules apply to
+  TestArticle d;
+  d.headers = a.headers;
+  manager.applyRules( d, "comp.misc" );
+  QCOMPARE( d.score, 10 );
+}
+
+void ScoringBenchmark::testRuleChanges()
+{
+  TestScoringManager manager;
+  KScoringRule *rule = manager.addRule( "de.test", "Subject", "CONTAINS", "kde", 10 );
+
+  TestArticle a;
+  a.headers.insert( "Subject", "KDE" );
+  manager.applyRules( a, "de.test" );
+  QCOMPARE( a.score, 10 );
+
+  // rules added or removed for the current group must be taken into account
+  manager.addRule( "de.test", "Subject", "CONTAINS", "kde", 1 );
+  manager.deleteRule( rule );
+  TestArticle b;
+  b.headers = a.headers;
+  manager.applyRules( b, "de.test" );
+  QCOMPARE( b.score, 1 );
+}
+
+void ScoringBenchmark::benchmarkApplyRules()
+{
+  static const int numRules = 300;
+  static const int numArticles = 100000;
+
+  TestScoringManager manager;
+  for ( int i = 0; i < numRules; ++i ) {
+    QString group;
+    switch ( i % 3 ) {
+    case 0:
+      group = "de.test";
+      break;
+    case 1:
+      group = ".*";
+      break;
+    default:
+      group = QString( "alt.group%1" ).arg( i );
+    }
+    switch ( i % 4 ) {
+    case 0:
+      manager.addRule( group, "Subject", "CONTAINS", QString( "word%1" ).arg( i ), 1 );
+      break;
+    case 1:
+      manager.addRule( group, "From", "EQUALS", QString( "user%1@example.org" ).arg( i ), 1 );
+      break;
+    case 2:
+      manager.addRule( group, "Subject", "MATCH", QString( "^re: .*topic%1" ).arg( i ), 1 );
+      break;
+    default:
+      manager.addRule( group, "Lines", "GREATER", QString::number( i ), 1 );
+    }
+  }
+
+  QList<TestArticle> articles;
+  for ( int i = 0; i < numArticles; ++i ) {
+    TestArticle a;
+    a.headers.insert( "Subject", QString( "Re: a discussion about word%1 and topic%2" ).arg( i % 500 ).arg( i % 700 ) );
+    a.headers.insert( "From", QString( "user%1@example.org" ).arg( i % 1000 ) );
+    a.headers.insert( "Lines", QString::number( i % 400 ) );
+    a.headers.insert( "Message-ID", QString( "<%1@example.org>" ).arg( i ) );
+    articles.append( a );
+  }
+
+  QBENCHMARK {
+    for ( QList<TestArticle>::Iterator it = articles.begin(); it != articles.end(); ++it ) {
+      manager.applyRules( *it, "de.test" );
+    }
+  }
+}
+
+
+QTEST_KDEMAIN( ScoringBenchmark, NoGUI )
+
+#include "scoringbenchmark.moc"
@@ -0,0 +1,28 @@
+/*
+  scoringbenchmark.h
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software Foundation,
+  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, US
+*/
+
+#ifndef SCORINGBENCHMARK_H
+#define SCORINGBENCHMARK_H
+
+#include <QtCore/QObject>
+
+class ScoringBenchmark : public QObject
+{
+  Q_OBJECT
+
+  private slots:
+    void testApplyRules();
+    void testRuleChanges();
+    void benchmarkApplyRules();
+};
+
+#endif // SCORINGBENCHMARK_H
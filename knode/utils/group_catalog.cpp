@@ -0,0 +1,186 @@
+/*
+    KNode, the KDE newsreader
+    Copyright (c) 2010 the KNode authors.
+    See file AUTHORS for details
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, US
+*/
+
+#include "group_catalog.h"
+
+#include <QRegExp>
+#include <QStringMatcher>
+
+#include <algorithm>
+
+
+namespace KNode {
+namespace Utilities {
+
+namespace {
+
+inline quint64 trigram( const QChar *c )
+{
+  return ( quint64( c[0].unicode() ) << 32 ) | ( quint64( c[1].unicode() ) << 16 ) | quint64( c[2].unicode() );
+}
+
+/** Orders positions in a list of names by name. */
+class NameLessThan
+{
+  public:
+    explicit NameLessThan( const QStringList &names ) : mNames( names ) {}
+
+    bool operator()( int a, int b ) const { return mNames.at( a ) < mNames.at( b ); }
+    bool operator()( int a, const QString &b ) const { return mNames.at( a ) < b; }
+    bool operator()( const QString &a, int b ) const { return a < mNames.at( b ); }
+
+  private:
+    const QStringList &mNames;
+};
+
+}
+
+
+GroupCatalog::GroupCatalog()
+{
+}
+
+GroupCatalog::~GroupCatalog()
+{
+}
+
+
+void GroupCatalog::setGroups( const QStringList &names )
+{
+  clear();
+  mNames = names;
+
+  const int count = mNames.count();
+  mSorted.resize( count );
+  for ( int i = 0 ; i < count ; ++i ) {
+    mSorted[ i ] = i;
+    mFolded.append( mNames.at( i ).toLower() );
+  }
+  std::sort( mSorted.begin(), mSorted.end(), NameLessThan( mNames ) );
+
+  // Posting lists hold ranks in mSorted, so that they come out in name order.
+  for ( int rank = 0 ; rank < count ; ++rank ) {
+    const QString &folded = mFolded.at( mSorted.at( rank ) );
+    const QChar *c = folded.constData();
+    for ( int i = 0 ; i + 3 <= folded.length() ; ++i ) {
+      QVector<int> &postings = mTrigrams[ trigram( c + i ) ];
+      if ( postings.isEmpty() || postings.last() != rank ) {
+        postings.append( rank );
+      }
+    }
+  }
+  mTrigrams.squeeze();
+}
+
+void GroupCatalog::clear()
+{
+  mNames.clear();
+  mFolded.clear();
+  mSorted.clear();
+  mTrigrams.clear();
+}
+
+
+QVector<int> GroupCatalog::find( const QString &text ) const
+{
+  if ( text.isEmpty() ) {
+    return mSorted;
+  }
+
+  const QString needle = text.toLower();
+  const QStringMatcher matcher( needle, Qt::CaseSensitive );
+  QVector<int> result;
+
+  if ( needle.length() < 3 ) {
+    foreach ( int i, mSorted ) {
+      if ( matcher.indexIn( mFolded.at( i ) ) != -1 ) {
+        result.append( i );
+      }
+    }
+    return result;
+  }
+
+  // Only groups that contain every trigram of the needle can match:
+  // verify the candidates of the rarest one.
+  const QVector<int> *candidates = 0;
+  const QChar *c = needle.constData();
+  for ( int i = 0 ; i + 3 <= needle.length() ; ++i ) {
+    const QHash<quint64, QVector<int> >::const_iterator it = mTrigrams.constFind( trigram( c + i ) );
+    if ( it == mTrigrams.constEnd() ) {
+      return result;
+    }
+    if ( !candidates || it.value().size() < candidates->size() ) {
+      candidates = &it.value();
+    }
+  }
+
+  foreach ( int rank, *candidates ) {
+    const int i = mSorted.at( rank );
+    if ( needle.length() == 3 || matcher.indexIn( mFolded.at( i ) ) != -1 ) {
+      result.append( i );
+    }
+  }
+  return result;
+}
+
+QVector<int> GroupCatalog::refine( const QVector<int> &previous, const QString &text ) const
+{
+  if ( text.isEmpty() ) {
+    return previous;
+  }
+
+  const QStringMatcher matcher( text.toLower(), Qt::CaseSensitive );
+  QVector<int> result;
+  foreach ( int i, previous ) {
+    if ( matcher.indexIn( mFolded.at( i ) ) != -1 ) {
+      result.append( i );
+    }
+  }
+  return result;
+}
+
+QVector<int> GroupCatalog::withPrefix( const QString &prefix ) const
+{
+  return withPrefix( mSorted, prefix );
+}
+
+QVector<int> GroupCatalog::withPrefix( const QVector<int> &among, const QString &prefix ) const
+{
+  if ( prefix.isEmpty() ) {
+    return among;
+  }
+
+  QVector<int> result;
+  QVector<int>::const_iterator it = std::lower_bound( among.constBegin(), among.constEnd(),
+                                                      prefix, NameLessThan( mNames ) );
+  for ( ; it != among.constEnd() && mNames.at( *it ).startsWith( prefix ) ; ++it ) {
+    result.append( *it );
+  }
+  return result;
+}
+
+QVector<int> GroupCatalog::match( const QRegExp &regexp ) const
+{
+  QRegExp reg( regexp );
+  QVector<int> result;
+  foreach ( int i, mSorted ) {
+    if ( reg.indexIn( mNames.at( i ) ) != -1 ) {
+      result.append( i );
+    }
+  }
+  return result;
+}
+
+} // namespace Utilities
+} // namespace KNode
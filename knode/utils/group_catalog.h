@@ -0,0 +1,106 @@
+/*
+    KNode, the KDE newsreader
+    Copyright (c) 2010 the KNode authors.
+    See file AUTHORS for details
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software Foundation,
+    Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, US
+*/
+
+#ifndef KNODE_UTILITIES_GROUPCATALOG_H
+#define KNODE_UTILITIES_GROUPCATALOG_H
+
+#include "knode_export.h"
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+class QRegExp;
+
+namespace KNode {
+namespace Utilities {
+
+/**
+  Searchable index over the names of the groups of a server (its active list).
+
+  Groups are identified by their position in the list given to setGroups().
+  Every lookup returns such positions ordered by group name (as KNGroupInfo
+  sorts them), so that callers do not need to sort the result again.
+
+  Substring lookups of at least three characters go through a trigram index;
+  prefix lookups are binary searches over the sorted names.
+*/
+class KNODE_EXPORT GroupCatalog
+{
+  public:
+    GroupCatalog();
+    ~GroupCatalog();
+
+    /**
+      Indexes the group names @p names, replacing any previous content.
+    */
+    void setGroups( const QStringList &names );
+    /**
+      Removes all groups from this catalog.
+    */
+    void clear();
+
+    /**
+      Returns the number of indexed groups.
+    */
+    int count() const { return mNames.count(); }
+    /**
+      Returns the name of the group at position @p index.
+    */
+    const QString &name( int index ) const { return mNames.at( index ); }
+
+    /**
+      Returns every group.
+    */
+    QVector<int> all() const { return mSorted; }
+    /**
+      Returns the groups whose name contains @p text, ignoring case.
+    */
+    QVector<int> find( const QString &text ) const;
+    /**
+      Returns the groups of @p previous whose name contains @p text, ignoring case.
+      This is meant to narrow down the result of a previous find() as the user
+      types more characters: it only looks at @p previous.
+      @param previous a result of this catalog (in name order).
+    */
+    QVector<int> refine( const QVector<int> &previous, const QString &text ) const;
+    /**
+      Returns the groups whose name starts with @p prefix (case sensitive).
+    */
+    QVector<int> withPrefix( const QString &prefix ) const;
+    /**
+      Returns the groups of @p among whose name starts with @p prefix (case sensitive).
+      @param among a result of this catalog (in name order).
+    */
+    QVector<int> withPrefix( const QVector<int> &among, const QString &prefix ) const;
+    /**
+      Returns the groups whose name matches the regular expression @p regexp.
+    */
+    QVector<int> match( const QRegExp &regexp ) const;
+
+  private:
+    /** Group names, as given to setGroups(). */
+    QStringList mNames;
+    /** Lower case group names, in the same order as mNames. */
+    QStringList mFolded;
+    /** Positions in mNames ordered by name. */
+    QVector<int> mSorted;
+    /** Trigram of lower case names -> positions in mSorted (increasing). */
+    QHash<quint64, QVector<int> > mTrigrams;
+};
+
+} // namespace Utilities
+} // namespace KNode
+
+#endif
@@ -35,6 +35,10 @@
 #include <Akonadi/CollectionFetchJob>
 #include <Akonadi/EntityDisplayAttribute>
 #include <Akonadi/ItemFetchScope>
+#include <Akonadi/Monitor>
+
+#include <KABC/Addressee>
+#include <KABC/ContactGroup>
 
 #include <KPIMUtils/Email>
 
@@ -62,6 +66,7 @@
 #include <QDropEvent>
 #include <QMouseEvent>
 #include <QMenu>
+#include <QPointer>
 #include <QTimer>
 #include <QtDBus/QDBusConnection>
 
@@ -73,9 +78,11 @@ class AddresseeLineEditStatic
 
     AddresseeLineEditStatic()
       : completion( new KMailCompletion ),
+        completionGeneration( 0 ),
         ldapTimer( 0 ),
         ldapSearch( 0 ),
-        ldapLineEdit( 0 )
+        ldapLineEdit( 0 ),
+        akonadiMonitor( 0 )
     {
     }
 
@@ -84,10 +91,16 @@ class AddresseeLineEditStatic
       delete completion;
       delete ldapTimer;
       delete ldapSearch;
+      delete akonadiMonitor;
     }
 
     KMailCompletion *completion;
     KPIM::CompletionItemsMap completionItemMap;
+    // maps completion items to the keywords they have been added with, so that
+    // the matches of a search can be narrowed down without asking s_static->completion again
+    QHash<QString, QStringList> completionItemKeyWords;
+    // incremented whenever s_static->completion changes, invalidates the cached matches
+    int completionGeneration;
     QStringList completionSources;
     QTimer *ldapTimer;
     KLDAP::LdapClientSearch *ldapSearch;
@@ -104,6 +117,9 @@ class AddresseeLineEditStatic
     QMap<Akonadi::Collection::Id, int> akonadiCollectionToCompletionSourceMap;
     // a list of akonadi items (contacts) that have not had their collection fetched yet
     Akonadi::Item::List akonadiPendingItems;
+    // watches the address books, so that the results of earlier searches are not reused
+    // once contacts have been added, changed or removed
+    Akonadi::Monitor *akonadiMonitor;
 };
 
 K_GLOBAL_STATIC( AddresseeLineEditStatic, s_static )
@@ -158,7 +174,11 @@ class AddresseeLineEdit::Private
         m_smartPaste( false ),
         m_addressBookConnected( false ),
         m_searchExtended( false ),
-        m_useSemicolonAsSeparator( false )
+        m_useSemicolonAsSeparator( false ),
+        m_akonadiSearchFailed( false ),
+        m_akonadiSearchTimer( 0 ),
+        m_cachedFullSearch( false ),
+        m_cachedGeneration( -1 )
     {
     }
 
@@ -170,8 +190,10 @@ class AddresseeLineEdit::Private
     void addCompletionItem( const QString &string, int weight, int source,
                             const QStringList *keyWords = 0 );
     const QStringList adjustedCompletionItems( bool fullSearch );
+    QStringList matchingCompletionItems( bool fullSearch );
     void updateSearchString();
     void akonadiPerformSearch();
+    void akonadiCancelSearch();
     void akonadiHandlePending();
     void doCompletion( bool ctrlT );
 
@@ -184,6 +206,8 @@ class AddresseeLineEdit::Private
     void slotUserCancelled( const QString & );
     void slotAkonadiSearchResult( KJob * );
     void slotAkonadiCollectionsReceived( const Akonadi::Collection::List & );
+    void slotAkonadiStartSearch();
+    void slotAkonadiAddressBookChanged();
 
     static KCompletion::CompOrder completionOrder();
 
@@ -197,6 +221,20 @@ class AddresseeLineEdit::Private
     bool m_lastSearchMode;
     bool m_searchExtended; //has \" been added?
     bool m_useSemicolonAsSeparator;
+
+    // the search jobs which are currently running for this line edit
+    QList< QPointer<KJob> > m_akonadiSearchJobs;
+    // the search string of the running jobs and of the last search which completed
+    QString m_akonadiRunningSearch;
+    QString m_akonadiLastSearch;
+    bool m_akonadiSearchFailed;
+    QTimer *m_akonadiSearchTimer;
+
+    // the matches of the previous keystroke, see matchingCompletionItems()
+    QString m_cachedSearchString;
+    QStringList m_cachedMatches;
+    bool m_cachedFullSearch;
+    int m_cachedGeneration;
 };
 
 void AddresseeLineEdit::Private::init()
@@ -206,6 +244,29 @@ void AddresseeLineEdit::Private::init()
     s_static->completion->setIgnoreCase( true );
   }
 
+  if ( !m_akonadiSearchTimer ) {
+    m_akonadiSearchTimer = new QTimer( q );
+    m_akonadiSearchTimer->setSingleShot( true );
+    m_akonadiSearchTimer->setInterval( 100 );
+    q->connect( m_akonadiSearchTimer, SIGNAL(timeout()), SLOT(slotAkonadiStartSearch()) );
+  }
+
+  if ( !s_static->akonadiMonitor ) {
+    s_static->akonadiMonitor = new Akonadi::Monitor;
+    s_static->akonadiMonitor->setMimeTypeMonitored( KABC::Addressee::mimeType() );
+    s_static->akonadiMonitor->setMimeTypeMonitored( KABC::ContactGroup::mimeType() );
+  }
+
+  if ( !m_addressBookConnected ) {
+    q->connect( s_static->akonadiMonitor, SIGNAL(itemAdded(const Akonadi::Item &, const Akonadi::Collection &)),
+                SLOT(slotAkonadiAddressBookChanged()) );
+    q->connect( s_static->akonadiMonitor, SIGNAL(itemChanged(const Akonadi::Item &, const QSet<QByteArray> &)),
+                SLOT(slotAkonadiAddressBookChanged()) );
+    q->connect( s_static->akonadiMonitor, SIGNAL(itemRemoved(const Akonadi::Item &)),
+                SLOT(slotAkonadiAddressBookChanged()) );
+    m_addressBookConnected = true;
+  }
+
   if ( m_useCompletion ) {
     if ( !s_static->ldapTimer ) {
       s_static->ldapTimer = new QTimer;
@@ -342,14 +403,65 @@ void AddresseeLineEdit::Private::addCompletionItem( const QString &string, int w
     s_static->completion->addItem( string, weight );
   } else {
     s_static->completion->addItemWithKeys( string, weight, keyWords );
+
+    QStringList &itemKeyWords = s_static->completionItemKeyWords[ string ];
+    foreach ( const QString &keyWord, *keyWords ) {
+      if ( !itemKeyWords.contains( keyWord ) ) {
+        itemKeyWords.append( keyWord );
+      }
+    }
   }
+
+  ++s_static->completionGeneration;
+}
+
+QStringList AddresseeLineEdit::Private::matchingCompletionItems( bool fullSearch )
+{
+  // As long as the completion has not changed, the matches of a search string are a
+  // subset of the matches of any of its prefixes, so while the user keeps typing we
+  // only have to filter the matches of the previous keystroke instead of walking the
+  // whole completion again.
+  const bool refine = m_cachedGeneration == s_static->completionGeneration &&
+                      m_cachedFullSearch == fullSearch &&
+                      !m_cachedSearchString.isEmpty() &&
+                      m_searchString.startsWith( m_cachedSearchString, Qt::CaseInsensitive );
+
+  QStringList items;
+  if ( !refine ) {
+    items = fullSearch ?
+            s_static->completion->allMatches( m_searchString ) :
+            s_static->completion->substringCompletion( m_searchString );
+  } else if ( fullSearch ) {
+    // allMatches() looks up the keywords and returns the items they belong to
+    foreach ( const QString &item, m_cachedMatches ) {
+      const QStringList keyWords = s_static->completionItemKeyWords.value( item );
+      foreach ( const QString &keyWord, keyWords ) {
+        if ( keyWord.startsWith( m_searchString, Qt::CaseInsensitive ) ) {
+          items.append( item );
+          break;
+        }
+      }
+    }
+  } else {
+    // substringCompletion() returns the keywords and items themselves
+    foreach ( const QString &item, m_cachedMatches ) {
+      if ( item.contains( m_searchString, Qt::CaseInsensitive ) ) {
+        items.append( item );
+      }
+    }
+  }
+
+  m_cachedSearchString = m_searchString;
+  m_cachedMatches = items;
+  m_cachedFullSearch = fullSearch;
+  m_cachedGeneration = s_static->completionGeneration;
+
+  return items;
 }
 
 const QStringList KPIM::AddresseeLineEdit::Private::adjustedCompletionItems( bool fullSearch )
 {
-  QStringList items = fullSearch ?
-                      s_static->completion->allMatches( m_searchString ) :
-                      s_static->completion->substringCompletion( m_searchString );
+  QStringList items = matchingCompletionItems( fullSearch );
 
   //force items to be sorted by email
   items.sort();
@@ -476,7 +588,52 @@ void AddresseeLineEdit::Private::updateSearchString()
 
 void AddresseeLineEdit::Private::akonadiPerformSearch()
 {
+  // Searches are coalesced, so that only the text the user has typed when pausing
+  // is sent to Akonadi instead of issuing a search per keystroke.
+  m_akonadiSearchTimer->start();
+}
+
+void AddresseeLineEdit::Private::akonadiCancelSearch()
+{
+  foreach ( const QPointer<KJob> &job, m_akonadiSearchJobs ) {
+    if ( job ) {
+      job->kill( KJob::Quietly );
+    }
+  }
+  m_akonadiSearchJobs.clear();
+  m_akonadiRunningSearch.clear();
+}
+
+void AddresseeLineEdit::Private::slotAkonadiStartSearch()
+{
+  if ( m_searchString.isEmpty() ) {
+    akonadiCancelSearch();
+    m_akonadiLastSearch.clear();
+    return;
+  }
+
+  if ( m_searchString == m_akonadiRunningSearch ) {
+    return;
+  }
+
+  // The results of the last search contain those of any refinement of it, and
+  // they are already part of the completion.
+  if ( !m_akonadiLastSearch.isEmpty() && m_searchString.startsWith( m_akonadiLastSearch ) ) {
+    akonadiCancelSearch();
+    akonadiHandlePending();
+    return;
+  }
+
+  akonadiCancelSearch();
+
+  // From here on the completion no longer holds everything the last search found
+  // that matches the running one.
+  m_akonadiLastSearch.clear();
+
   kDebug() << "searching akonadi with:" << m_searchString;
+  m_akonadiRunningSearch = m_searchString;
+  m_akonadiSearchFailed = false;
+
   Akonadi::ContactSearchJob *contactJob = new Akonadi::ContactSearchJob();
   Akonadi::ContactGroupSearchJob *groupJob = new Akonadi::ContactGroupSearchJob();
   contactJob->fetchScope().setAncestorRetrieval( Akonadi::ItemFetchScope::Parent );
@@ -492,9 +649,15 @@ void AddresseeLineEdit::Private::akonadiPerformSearch()
               q, SLOT(slotAkonadiSearchResult(KJob *)) );
   q->connect( groupJob, SIGNAL(result(KJob *)),
               q, SLOT(slotAkonadiSearchResult(KJob *)) );
+  m_akonadiSearchJobs << contactJob << groupJob;
   akonadiHandlePending();
 }
 
+void AddresseeLineEdit::Private::slotAkonadiAddressBookChanged()
+{
+  m_akonadiLastSearch.clear();
+}
+
 void AddresseeLineEdit::Private::akonadiHandlePending()
 {
   kDebug() << "Pending items: " << s_static->akonadiPendingItems.size();
@@ -585,6 +748,7 @@ void AddresseeLineEdit::Private::doCompletion( bool ctrlT )
       if ( m_searchExtended && m_searchString == QLatin1String( "\"" ) ) {
         m_searchExtended = false;
         m_searchString.clear();
+        m_akonadiLastSearch.clear();
         q->setText( m_previousAddresses );
         break;
       }
@@ -725,6 +889,7 @@ void AddresseeLineEdit::Private::slotEditCompletionOrder()
   if ( m_useCompletion ) {
     updateLDAPWeights();
   }
+  m_akonadiLastSearch.clear();
 }
 
 void AddresseeLineEdit::Private::slotUserCancelled( const QString &cancelText )
@@ -733,6 +898,9 @@ void AddresseeLineEdit::Private::slotUserCancelled( const QString &cancelText )
     stopLDAPLookup();
   }
 
+  akonadiCancelSearch();
+  m_akonadiLastSearch.clear();
+
   q->userCancelled( m_previousAddresses + cancelText ); // in KLineEdit
 }
 
@@ -749,6 +917,17 @@ void AddresseeLineEdit::Private::slotAkonadiSearchResult( KJob *job )
     kDebug() << "Found" << groupJob->contactGroups().size() << "groups";
   }
 
+  m_akonadiSearchJobs.removeAll( job );
+  if ( job->error() ) {
+    m_akonadiSearchFailed = true;
+  }
+  if ( m_akonadiSearchJobs.isEmpty() ) {
+    if ( !m_akonadiSearchFailed ) {
+      m_akonadiLastSearch = m_akonadiRunningSearch;
+    }
+    m_akonadiRunningSearch.clear();
+  }
+
   /* We have to fetch the collections of the items, so that
      the source name can be correctly labeled.*/
   Akonadi::Item::List items;
@@ -846,6 +1025,8 @@ AddresseeLineEdit::~AddresseeLineEdit()
     d->stopLDAPLookup();
   }
 
+  d->akonadiCancelSearch();
+
   delete d;
 }
 
@@ -188,6 +188,8 @@ class KDEPIM_EXPORT AddresseeLineEdit : public KLineEdit
     Q_PRIVATE_SLOT( d, void slotUserCancelled( const QString & ) )
     Q_PRIVATE_SLOT( d, void slotAkonadiSearchResult( KJob * ) )
     Q_PRIVATE_SLOT( d, void slotAkonadiCollectionsReceived( const Akonadi::Collection::List & ) )
+    Q_PRIVATE_SLOT( d, void slotAkonadiStartSearch() )
+    Q_PRIVATE_SLOT( d, void slotAkonadiAddressBookChanged() )
     //@endcond
 };
 
@@ -21,18 +21,255 @@
 
 #include "kmailcompletion.h"
 #include <KDebug>
-#include <QRegExp>
+
+#include <QHash>
+#include <QSet>
+
+#include <algorithm>
 
 using namespace KPIM;
 
+/**
+ * A compressed trie over the lowercased keywords. Every node carries the
+ * part of the keyword leading to it from its parent, so that a lookup only
+ * compares as many characters as the keyword has, independent of the
+ * number of keywords in the completion.
+ *
+ * The keywords ending in a node are kept with their original case, since
+ * KCompletion reports matches that way, together with the email addresses
+ * and the weights they have been added with.
+ */
+class KMailCompletion::KeyWordTrie
+{
+  public:
+    struct Entry
+    {
+      QString keyWord;
+      QStringList emails;
+      QList<int> weights;
+    };
+
+    struct Node
+    {
+      ~Node()
+      {
+        qDeleteAll( children );
+      }
+
+      QString label;
+      QList<Node*> children;
+      QList<Entry> entries;
+    };
+
+    KeyWordTrie()
+      : mRoot( new Node )
+    {
+    }
+
+    ~KeyWordTrie()
+    {
+      delete mRoot;
+    }
+
+    void clear()
+    {
+      delete mRoot;
+      mRoot = new Node;
+    }
+
+    void insert( const QString &keyWord, const QString &email, int weight )
+    {
+      Entry &entry = entryFor( insertNode( keyWord.toLower() ), keyWord );
+      const int index = entry.emails.indexOf( email );
+      if ( index == -1 ) {
+        entry.emails.append( email );
+        entry.weights.append( weight );
+      } else if ( entry.weights.at( index ) < weight ) {
+        entry.weights[ index ] = weight;
+      }
+    }
+
+    /**
+     * Returns the email addresses of exactly @p keyWord, case sensitive.
+     */
+    QStringList emails( const QString &keyWord ) const
+    {
+      const QString key = keyWord.toLower();
+      const Node *node = mRoot;
+      int pos = 0;
+      while ( pos < key.length() ) {
+        node = child( node, key.at( pos ) );
+        if ( !node || key.midRef( pos, node->label.length() ) != node->label ) {
+          return QStringList();
+        }
+        pos += node->label.length();
+      }
+
+      foreach ( const Entry &entry, node->entries ) {
+        if ( entry.keyWord == keyWord ) {
+          return entry.emails;
+        }
+      }
+      return QStringList();
+    }
+
+    /**
+     * Collects the email addresses of all keywords starting with @p prefix,
+     * case insensitive, together with the highest weight they were found with.
+     */
+    void collect( const QString &prefix, QHash<QString, int> *emails ) const
+    {
+      const QString key = prefix.toLower();
+      const Node *node = mRoot;
+      int pos = 0;
+      while ( pos < key.length() ) {
+        node = child( node, key.at( pos ) );
+        if ( !node ) {
+          return;
+        }
+        // the prefix may end inside the label of the node
+        const int length = qMin( node->label.length(), key.length() - pos );
+        if ( key.midRef( pos, length ) != node->label.leftRef( length ) ) {
+          return;
+        }
+        pos += length;
+      }
+
+      collect( node, emails );
+    }
+
+  private:
+    static Node *child( const Node *node, const QChar &first )
+    {
+      foreach ( Node *candidate, node->children ) {
+        if ( candidate->label.at( 0 ) == first ) {
+          return candidate;
+        }
+      }
+      return 0;
+    }
+
+    static void collect( const Node *node, QHash<QString, int> *emails )
+    {
+      foreach ( const Entry &entry, node->entries ) {
+        for ( int i = 0; i < entry.emails.count(); ++i ) {
+          const int weight = entry.weights.at( i );
+          QHash<QString, int>::iterator it = emails->find( entry.emails.at( i ) );
+          if ( it == emails->end() ) {
+            emails->insert( entry.emails.at( i ), weight );
+          } else if ( *it < weight ) {
+            *it = weight;
+          }
+        }
+      }
+
+      foreach ( const Node *child, node->children ) {
+        collect( child, emails );
+      }
+    }
+
+    static Entry &entryFor( Node *node, const QString &keyWord )
+    {
+      for ( int i = 0; i < node->entries.count(); ++i ) {
+        if ( node->entries.at( i ).keyWord == keyWord ) {
+          return node->entries[ i ];
+        }
+      }
+
+      Entry entry;
+      entry.keyWord = keyWord;
+      node->entries.append( entry );
+      return node->entries.last();
+    }
+
+    Node *insertNode( const QString &key )
+    {
+      Node *node = mRoot;
+      int pos = 0;
+      while ( pos < key.length() ) {
+        Node *next = child( node, key.at( pos ) );
+        if ( !next ) {
+          next = new Node;
+          next->label = key.mid( pos );
+          node->children.append( next );
+          return next;
+        }
+
+        int common = 1;
+        const int maxCommon = qMin( next->label.length(), key.length() - pos );
+        while ( common < maxCommon && next->label.at( common ) == key.at( pos + common ) ) {
+          ++common;
+        }
+
+        if ( common < next->label.length() ) {
+          // split the edge, the new inner node takes over the common part
+          Node *inner = new Node;
+          inner->label = next->label.left( common );
+          next->label = next->label.mid( common );
+          inner->children.append( next );
+          node->children[ node->children.indexOf( next ) ] = inner;
+          next = inner;
+        }
+
+        node = next;
+        pos += common;
+      }
+
+      return node;
+    }
+
+    Node *mRoot;
+};
+
+// the completion matches an email address if it has one of these formats:
+// localpart@domain or <email>
+static bool isEmailAddress( const QString &match )
+{
+  if ( match.contains( QLatin1Char( '@' ) ) ) {
+    return true;
+  }
+
+  const int start = match.indexOf( QLatin1Char( '<' ) );
+  return start != -1 && match.indexOf( QLatin1Char( '>' ), start + 1 ) != -1;
+}
+
+class WeightedEmailLessThan
+{
+  public:
+    WeightedEmailLessThan( const QHash<QString, int> &weights )
+      : mWeights( weights )
+    {
+    }
+
+    bool operator()( const QString &left, const QString &right ) const
+    {
+      const int leftWeight = mWeights.value( left );
+      const int rightWeight = mWeights.value( right );
+      if ( leftWeight != rightWeight ) {
+        return leftWeight > rightWeight;
+      }
+
+      return left < right;
+    }
+
+  private:
+    const QHash<QString, int> &mWeights;
+};
+
 KMailCompletion::KMailCompletion()
+  : m_keyWords( new KeyWordTrie )
 {
   setIgnoreCase( true );
 }
 
+KMailCompletion::~KMailCompletion()
+{
+  delete m_keyWords;
+}
+
 void KMailCompletion::clear()
 {
-  m_keyMap.clear();
+  m_keyWords->clear();
   KCompletion::clear();
 }
 
@@ -43,19 +280,20 @@ QString KMailCompletion::makeCompletion( const QString &string )
   // this should be in postProcessMatch, but postProcessMatch is const and will not allow nextMatch
   if ( !match.isEmpty() ){
     const QString firstMatch( match );
-    while ( match.indexOf( QRegExp( "(@)|(<.*>)" ) ) == -1 ) {
+    while ( !isEmailAddress( match ) ) {
       /* local email do not require @domain part, if match is an address we'll
-       * find last+first <match> in m_keyMap and we'll know that match is
+       * find last+first <match> in the keyword trie and we'll know that match is
        * already a valid email.
        *
        * Distribution list do not have last+first <match> entry, they will be
        * in mailAddr
        */
-      const QStringList &mailAddr = m_keyMap[ match ]; //get all mailAddr for this keyword
+      const QStringList mailAddr = m_keyWords->emails( match ); //get all mailAddr for this keyword
+      const QString bracketedMatch = QLatin1Char( '<' ) + match + QLatin1Char( '>' );
       bool isEmail = false;
       for ( QStringList::ConstIterator sit( mailAddr.begin() ), sEnd( mailAddr.end() );
             sit != sEnd; ++sit ) {
-        if ( (*sit).indexOf( '<' + match + '>' ) != -1 || (*sit) == match ) {
+        if ( (*sit).contains( bracketedMatch ) || (*sit) == match ) {
           isEmail = true;
           break;
         }
@@ -81,12 +319,24 @@ void KMailCompletion::addItemWithKeys( const QString &email, int weight,
 {
   Q_ASSERT( keyWords != 0 );
   for ( QStringList::ConstIterator it( keyWords->begin() ); it != keyWords->end(); ++it ) {
-    QStringList &emailList = m_keyMap[ (*it) ]; //lookup email-list for given keyword
-    if ( emailList.indexOf( email ) == -1 ) {   //add email if not there
-      emailList.append( email );
-    }
+    m_keyWords->insert( (*it), email, weight ); //add email to the keyword
     addItem( (*it), weight );                   //inform KCompletion about keyword
-    }
+  }
+}
+
+QStringList KMailCompletion::allMatches( const QString &string )
+{
+  QHash<QString, int> emails;
+  m_keyWords->collect( string, &emails );
+
+  QStringList matches = emails.keys();
+  if ( order() == Weighted ) {
+    std::sort( matches.begin(), matches.end(), WeightedEmailLessThan( emails ) );
+  } else {
+    matches.sort();
+  }
+
+  return matches;
 }
 
 void KMailCompletion::postProcessMatches( QStringList *pMatches ) const
@@ -100,7 +350,7 @@ void KMailCompletion::postProcessMatches( QStringList *pMatches ) const
   QSet< QString > mailAddrDistinct;
   for ( QStringList::ConstIterator sit( pMatches->begin() ), sEnd( pMatches->end() );
         sit != sEnd; ++sit ) {
-    const QStringList &mailAddr = m_keyMap[ (*sit) ]; //get all mailAddr for this keyword
+    const QStringList mailAddr = m_keyWords->emails( *sit ); //get all mailAddr for this keyword
     for ( QStringList::ConstIterator sit( mailAddr.begin() ), sEnd( mailAddr.end() );
           sit != sEnd; ++sit ) {
       mailAddrDistinct.insert( *sit );  //store mailAddr, QSet will make them unique
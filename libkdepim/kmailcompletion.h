@@ -24,7 +24,6 @@
 
 #include <KCompletion>
 
-#include <QMap>
 #include <QString>
 #include <QStringList>
 
@@ -42,7 +41,12 @@ class KMailCompletion : public KCompletion
     KMailCompletion();
 
     /**
-     * clears internal keyword map and calls KCompletion::clear.
+     * Destroys the mail completion.
+     */
+    ~KMailCompletion();
+
+    /**
+     * clears internal keyword trie and calls KCompletion::clear.
      */
     virtual void clear();
 
@@ -66,7 +70,18 @@ class KMailCompletion : public KCompletion
     void addItemWithKeys( const QString &email, int weight, const QStringList *keyWords );
 
     /**
-     * use internal map to replace all keywords in pMatches with corresponding
+     * looks up all keywords starting with string in the internal keyword trie
+     * and returns the email addresses they belong to. In weighted order the
+     * addresses with the highest keyword weight come first, otherwise they
+     * are sorted alphabetically.
+     *
+     * Hides KCompletion::allMatches( const QString & ), which would walk the
+     * whole KCompletion tree below string and map the keywords afterwards.
+     */
+    QStringList allMatches( const QString &string );
+
+    /**
+     * use internal trie to replace all keywords in pMatches with corresponding
      * email addresses.
      */
     virtual void postProcessMatches( QStringList *pMatches ) const;
@@ -74,9 +89,13 @@ class KMailCompletion : public KCompletion
     // We are not using allWeightedMatches() anywhere, therefore we don't need
     // to override the other postProcessMatches() function
     using KCompletion::postProcessMatches;
+    using KCompletion::allMatches;
 
   private:
-    QMap< QString, QStringList > m_keyMap;
+    //@cond PRIVATE
+    class KeyWordTrie;
+    KeyWordTrie *const m_keyWords;
+    //@endcond
 };
 
 }
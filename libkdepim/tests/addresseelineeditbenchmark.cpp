@@ -0,0 +1,109 @@
+/*
+    This file is part of libkdepim.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "addresseelineeditbenchmark.h"
+
+#include "../addresseelineedit.h"
+
+#include <KABC/Addressee>
+#include <KCompletionBox>
+
+#include <qtest_kde.h>
+
+QTEST_KDEMAIN( AddresseeLineEditBenchmark, GUI )
+
+class TestLineEdit : public KPIM::AddresseeLineEdit
+{
+  public:
+    TestLineEdit()
+      : KPIM::AddresseeLineEdit( 0, true )
+    {
+    }
+
+    using KPIM::AddresseeLineEdit::addContact;
+    using KPIM::AddresseeLineEdit::addCompletionSource;
+};
+
+static const int s_contactCount = 20000;
+
+static const char *s_givenNames[] = {
+  "Anna", "Andreas", "Annette", "Bernd", "Birgit", "Carla", "Daniel", "Elena"
+};
+
+static const char *s_familyNames[] = {
+  "Andersson", "Bauer", "Carlsson", "Dietrich", "Engel", "Fischer", "Graf"
+};
+
+void AddresseeLineEditBenchmark::initTestCase()
+{
+  mLineEdit = new TestLineEdit;
+  mLineEdit->setCompletionMode( KGlobalSettings::CompletionPopup );
+
+  const int addressBookSource = mLineEdit->addCompletionSource( QLatin1String( "Address Book" ), 1 );
+  // LDAP results take the same addContact() path as address book contacts,
+  // so a separate source stands in for a directory server
+  const int ldapSource = mLineEdit->addCompletionSource( QLatin1String( "LDAP server: localhost" ), 2 );
+
+  for ( int i = 0; i < s_contactCount; ++i ) {
+    KABC::Addressee contact;
+    contact.setGivenName( QLatin1String( s_givenNames[ i % 8 ] ) );
+    contact.setFamilyName( QLatin1String( s_familyNames[ i % 7 ] ) + QString::number( i ) );
+    contact.insertEmail( QString::fromLatin1( "%1.%2@example%3.com" )
+                         .arg( contact.givenName().toLower() )
+                         .arg( contact.familyName().toLower() )
+                         .arg( i % 50 ), true );
+    mLineEdit->addContact( contact, 1, ( i % 10 ) ? addressBookSource : ldapSource );
+  }
+}
+
+void AddresseeLineEditBenchmark::cleanupTestCase()
+{
+  delete mLineEdit;
+  mLineEdit = 0;
+}
+
+void AddresseeLineEditBenchmark::testIncrementalMatches()
+{
+  // typed character by character, the matches are refined from the previous keystroke
+  mLineEdit->clear();
+  QTest::keyClicks( mLineEdit, QLatin1String( "andersson1" ) );
+  const QStringList incremental = mLineEdit->completionBox()->items();
+  QVERIFY( !incremental.isEmpty() );
+
+  // a fresh line edit has no previous matches and has to look them up
+  TestLineEdit lineEdit;
+  lineEdit.setCompletionMode( KGlobalSettings::CompletionPopup );
+  lineEdit.setText( QLatin1String( "andersson" ) );
+  lineEdit.setCursorPosition( lineEdit.text().length() );
+  QTest::keyClick( &lineEdit, '1' );
+  QCOMPARE( lineEdit.completionBox()->items(), incremental );
+
+  mLineEdit->completionBox()->hide();
+}
+
+void AddresseeLineEditBenchmark::benchmarkTyping()
+{
+  QBENCHMARK {
+    mLineEdit->clear();
+    QTest::keyClicks( mLineEdit, QLatin1String( "annette.fischer" ) );
+  }
+  mLineEdit->completionBox()->hide();
+}
+
+#include "addresseelineeditbenchmark.moc"
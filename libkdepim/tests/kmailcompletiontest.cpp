@@ -0,0 +1,254 @@
+/*
+    This file is part of libkdepim.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+    Boston, MA 02110-1301, USA.
+*/
+
+#include "kmailcompletiontest.h"
+
+#include "../kmailcompletion.h"
+
+#include <QtCore/QMap>
+#include <QtCore/QRegExp>
+#include <QtCore/QSet>
+
+#include <qtest_kde.h>
+
+QTEST_KDEMAIN( KMailCompletionTest, GUI )
+
+/**
+ * The map and regexp based implementation KMailCompletion used before it
+ * got its keyword trie, the reference for the expected results.
+ */
+class MapMailCompletion : public KCompletion
+{
+  public:
+    MapMailCompletion()
+    {
+      setIgnoreCase( true );
+    }
+
+    QString makeCompletion( const QString &string )
+    {
+      QString match = KCompletion::makeCompletion( string );
+
+      if ( !match.isEmpty() ) {
+        const QString firstMatch( match );
+        while ( match.indexOf( QRegExp( "(@)|(<.*>)" ) ) == -1 ) {
+          const QStringList &mailAddr = m_keyMap[ match ];
+          bool isEmail = false;
+          for ( QStringList::ConstIterator sit( mailAddr.begin() ), sEnd( mailAddr.end() );
+                sit != sEnd; ++sit ) {
+            if ( (*sit).indexOf( '<' + match + '>' ) != -1 || (*sit) == match ) {
+              isEmail = true;
+              break;
+            }
+          }
+
+          if ( !isEmail ) {
+            match = nextMatch();
+            if ( firstMatch == match ) {
+              match.clear();
+              break;
+            }
+          } else {
+            break;
+          }
+        }
+      }
+      return match;
+    }
+
+    void addItemWithKeys( const QString &email, int weight, const QStringList *keyWords )
+    {
+      for ( QStringList::ConstIterator it( keyWords->begin() ); it != keyWords->end(); ++it ) {
+        QStringList &emailList = m_keyMap[ (*it) ];
+        if ( emailList.indexOf( email ) == -1 ) {
+          emailList.append( email );
+        }
+        addItem( (*it), weight );
+      }
+    }
+
+    virtual void postProcessMatches( QStringList *pMatches ) const
+    {
+      if ( pMatches->isEmpty() ) {
+        return;
+      }
+
+      QSet< QString > mailAddrDistinct;
+      for ( QStringList::ConstIterator sit( pMatches->begin() ), sEnd( pMatches->end() );
+            sit != sEnd; ++sit ) {
+        const QStringList &mailAddr = m_keyMap[ (*sit) ];
+        for ( QStringList::ConstIterator sit( mailAddr.begin() ), sEnd( mailAddr.end() );
+              sit != sEnd; ++sit ) {
+          mailAddrDistinct.insert( *sit );
+        }
+      }
+      pMatches->clear();
+      (*pMatches) += mailAddrDistinct.toList();
+    }
+
+    using KCompletion::postProcessMatches;
+
+  private:
+    QMap< QString, QStringList > m_keyMap;
+};
+
+static const char *s_givenNames[] = {
+  "Anna", "andreas", "Annette", "Bernd", "Birgit", "Carla", "Daniel", "Elena", "ANNA"
+};
+
+static const char *s_familyNames[] = {
+  "Andersson", "Bauer", "Carlsson", "Dietrich", "Engel", "Fischer", "Graf"
+};
+
+// adds the entries in the way AddresseeLineEdit::addContact() does
+template <class Completion>
+static void fillCompletion( Completion *completion, int contactCount )
+{
+  for ( int i = 0; i < contactCount; ++i ) {
+    const QString givenName = QLatin1String( s_givenNames[ i % 9 ] );
+    const QString familyName = QLatin1String( s_familyNames[ i % 7 ] ) + QString::number( i % 500 );
+    const QString domain = QString::fromLatin1( "example%1.org" ).arg( i % 13 );
+    const QString email = givenName.toLower() + QLatin1Char( '.' ) + familyName.toLower() +
+                          QLatin1Char( '@' ) + domain;
+    const QString fullEmail = QLatin1Char( '"' ) + givenName + QLatin1Char( ' ' ) + familyName +
+                              QLatin1String( "\" <" ) + email + QLatin1Char( '>' );
+    const int weight = i % 5;
+
+    completion->addItem( fullEmail, weight );
+    completion->addItem( email, weight );
+
+    QStringList keyWords;
+    keyWords << givenName + QLatin1Char( ' ' ) + familyName
+             << familyName + QLatin1Char( ' ' ) + givenName
+             << familyName + QLatin1String( ", " ) + givenName
+             << domain
+             << email;
+    if ( i % 3 == 0 ) {
+      keyWords << QString::fromLatin1( "nick%1" ).arg( i % 17 );
+    }
+    completion->addItemWithKeys( fullEmail, weight, &keyWords );
+
+    // a local address without domain and a distribution list
+    if ( i % 50 == 0 ) {
+      const QString local = QString::fromLatin1( "local%1" ).arg( i );
+      QStringList localKeyWords;
+      localKeyWords << local;
+      completion->addItem( local, weight );
+      completion->addItemWithKeys( local, weight, &localKeyWords );
+
+      const QString list = QString::fromLatin1( "List %1" ).arg( i );
+      QStringList listKeyWords;
+      listKeyWords << list;
+      completion->addItem( list, weight );
+      completion->addItemWithKeys( list, weight, &listKeyWords );
+    }
+  }
+}
+
+void KMailCompletionTest::initTestCase()
+{
+  mPrefixes << QLatin1String( "a" ) << QLatin1String( "An" ) << QLatin1String( "anna" )
+            << QLatin1String( "ANNA a" ) << QLatin1String( "andersson1" )
+            << QLatin1String( "Bauer1, " ) << QLatin1String( "example1" )
+            << QLatin1String( "birgit.dietrich" ) << QLatin1String( "nick1" )
+            << QLatin1String( "local" ) << QLatin1String( "local100" ) << QLatin1String( "List" )
+            << QLatin1String( "x" ) << QLatin1String( "\"" );
+}
+
+void KMailCompletionTest::testAllMatches_data()
+{
+  QTest::addColumn<QString>( "prefix" );
+  foreach ( const QString &prefix, mPrefixes ) {
+    QTest::newRow( prefix.toLatin1() ) << prefix;
+  }
+}
+
+void KMailCompletionTest::testAllMatches()
+{
+  QFETCH( QString, prefix );
+
+  MapMailCompletion reference;
+  KPIM::KMailCompletion completion;
+  fillCompletion( &reference, 2000 );
+  fillCompletion( &completion, 2000 );
+
+  // the reference returns the addresses in hash order
+  QStringList expected = reference.allMatches( prefix );
+  expected.sort();
+  QStringList actual = completion.allMatches( prefix );
+  actual.sort();
+
+  QCOMPARE( actual, expected );
+}
+
+void KMailCompletionTest::testMakeCompletion_data()
+{
+  testAllMatches_data();
+}
+
+void KMailCompletionTest::testMakeCompletion()
+{
+  QFETCH( QString, prefix );
+
+  MapMailCompletion reference;
+  KPIM::KMailCompletion completion;
+  fillCompletion( &reference, 2000 );
+  fillCompletion( &completion, 2000 );
+
+  QCOMPARE( completion.makeCompletion( prefix ), reference.makeCompletion( prefix ) );
+}
+
+void KMailCompletionTest::testWeightedOrder()
+{
+  KPIM::KMailCompletion completion;
+  completion.setOrder( KCompletion::Weighted );
+
+  QStringList keyWords;
+  keyWords << QLatin1String( "Anna" );
+  completion.addItemWithKeys( QLatin1String( "anna@light.org" ), 1, &keyWords );
+  completion.addItemWithKeys( QLatin1String( "anna@heavy.org" ), 10, &keyWords );
+  keyWords.clear();
+  keyWords << QLatin1String( "annabel" );
+  completion.addItemWithKeys( QLatin1String( "annabel@heavy.org" ), 10, &keyWords );
+
+  QStringList expected;
+  expected << QLatin1String( "anna@heavy.org" ) << QLatin1String( "annabel@heavy.org" )
+           << QLatin1String( "anna@light.org" );
+  QCOMPARE( completion.allMatches( QLatin1String( "ann" ) ), expected );
+
+  completion.setOrder( KCompletion::Sorted );
+  expected.sort();
+  QCOMPARE( completion.allMatches( QLatin1String( "ann" ) ), expected );
+}
+
+void KMailCompletionTest::benchmarkAllMatches()
+{
+  KPIM::KMailCompletion completion;
+  fillCompletion( &completion, 50000 );
+
+  QBENCHMARK {
+    completion.allMatches( QLatin1String( "a" ) );
+    completion.allMatches( QLatin1String( "an" ) );
+    completion.allMatches( QLatin1String( "ann" ) );
+    completion.allMatches( QLatin1String( "anna" ) );
+    completion.makeCompletion( QLatin1String( "anna" ) );
+  }
+}
+
+#include "kmailcompletiontest.moc"
@@ -39,6 +39,7 @@
 #include <ksieve/error.h>
 
 #include <QStack>
+#include <QString>
 
 namespace KSieve {
 
@@ -78,7 +79,36 @@ namespace KSieve {
       mState = mStateStack.pop();
     }
 
-    Lexer::Token nextToken( QString & tokenValue );
+    /** The value of a token, as a range of the (UTF-8) script.
+
+	Tokens are only converted into QStrings on request (see
+	toString()), so that values nobody looks at don't cost
+	anything, and those that are looked at are decoded in one go. */
+    struct Span {
+      enum Flags {
+        HasEscapes = 1,    // quoted-string contains backslash escapes
+        HasCRLF = 2,       // contains CRLF pairs to turn into LF
+        HasDotStuffing = 4 // multi-line contains dot-stuffed lines
+      };
+      Span() : begin( 0 ), end( 0 ), flags( 0 ), lineFeeds( 0 ) {}
+      const char * begin;
+      const char * end;
+      int flags;
+      int lineFeeds; // for LineFeeds tokens
+    };
+
+    Lexer::Token nextToken( Span & tokenValue );
+
+    Lexer::Token nextToken( QString & tokenValue ) {
+      Span span;
+      const Lexer::Token token = nextToken( span );
+      tokenValue = toString( token, span );
+      return token;
+    }
+
+    /** Converts the value @p span of a token of type @p token into
+	the string Lexer::nextToken() returns for it. */
+    static QString toString( Lexer::Token token, const Span & span );
 
   private:
     /** Cursor must be positioned on the \r or the \n. */
@@ -87,13 +117,13 @@ namespace KSieve {
     /** Cursor must be positioned after the opening hash (#). If
 	parsing is successful, cursor is positioned behind the CRLF
 	that ended the comment's line (or past the end). */
-    bool parseHashComment( QString & result, bool reallySave=false );
+    bool parseHashComment( Span & result );
     
     /** Cursor must be positioned after the opening slash-asterisk */
-    bool parseBracketComment( QString & result, bool reallySave=false );
+    bool parseBracketComment( Span & result );
     
     /** Cursor must be positioned on the opening '/'or '#' */
-    bool parseComment( QString & result, bool reallySave=false );
+    bool parseComment( Span & result );
 
     /** Eats whitespace, but not comments */
     bool eatWS();
@@ -102,19 +132,19 @@ namespace KSieve {
     bool eatCWS();
 
     /** Cursor must be positioned on the first character */
-    bool parseIdentifier( QString & result );
+    bool parseIdentifier( Span & result );
 
     /** Cursor must be positioned after the initial ':' */
-    bool parseTag( QString & result );
+    bool parseTag( Span & result );
 
     /** Cursor must be positioned on the first digit */
-    bool parseNumber( QString & result );
+    bool parseNumber( Span & result );
 
     /** Cursor must be positioned after the "text:" token. */
-    bool parseMultiLine( QString & result );
+    bool parseMultiLine( Span & result );
 
     /** Cursor must be positioned after the initial " */
-    bool parseQuotedString( QString & result );
+    bool parseQuotedString( Span & result );
 
     struct State {
       State( const char * s=0 )
@@ -82,7 +82,10 @@ namespace KSieve {
 
 
     Lexer::Token token() const { return mToken; }
-    QString tokenValue() const { return mTokenValue; }
+    QString tokenValue() const { return Lexer::Impl::toString( mToken, mTokenSpan ); }
+    bool isSpecial( char ch ) const {
+      return token() == Lexer::Special && *mTokenSpan.begin == ch ;
+    }
 
     bool atEnd() const {
       return !mToken && lexer.atEnd() ;
@@ -90,7 +93,7 @@ namespace KSieve {
     bool obtainToken();
     void consumeToken() {
       mToken = Lexer::None;
-      mTokenValue.clear();
+      mTokenSpan = Lexer::Impl::Span();
     }
     void makeError( Error::Type e, int line, int col ) {
       mError = Error( e, line, col );
@@ -108,7 +111,7 @@ namespace KSieve {
 
     Error mError;
     Lexer::Token mToken;
-    QString mTokenValue;
+    Lexer::Impl::Span mTokenSpan;
     Lexer::Impl lexer;
     ScriptBuilder * mBuilder;
   };
@@ -30,6 +30,8 @@
 #include <KPasswordDialog>
 #include <KMessageBox>
 
+#include <QtCore/QDateTime>
+
 static sasl_callback_t callbacks[] = {
     { SASL_CB_ECHOPROMPT, NULL, NULL },
     { SASL_CB_NOECHOPROMPT, NULL, NULL },
@@ -43,15 +45,20 @@ static sasl_callback_t callbacks[] = {
 
 using namespace KManageSieve;
 
+// Other clients may change scripts behind our back and ManageSieve has no
+// way to find out short of downloading them again, so cached scripts are
+// only trusted for a short while (in seconds).
+static const uint ScriptCacheLifetime = 60;
+
 Session::Session( QObject *parent ) :
   QObject( parent ),
   m_socket( new KTcpSocket( this ) ),
   m_sasl_conn( 0 ),
   m_sasl_client_interact( 0 ),
-  m_currentJob( 0 ),
   m_state( None ),
   m_pendingQuantity( -1 ),
-  m_supportsStartTls( false )
+  m_supportsStartTls( false ),
+  m_disconnected( false )
 {
   kDebug();
   connect( m_socket, SIGNAL(readyRead()), SLOT(dataReceived()) );
@@ -85,16 +92,33 @@ void Session::connectToHost( const KUrl &url )
 
 void Session::disconnectFromHost( bool sendLogout )
 {
+  if ( m_disconnected )
+    return;
+  m_disconnected = true;
+
   if ( sendLogout )
     sendData( "LOGOUT" );
   m_socket->disconnectFromHost();
-  if ( m_currentJob )
-    killJob( m_currentJob );
-  foreach ( SieveJob* job, m_jobs )
-    killJob( job );
+
+  QList<SieveJob*> jobs;
+  foreach ( const PendingCommand &command, m_pendingCommands ) {
+    if ( command.job && !jobs.contains( command.job ) )
+      jobs.append( command.job );
+  }
+  jobs += m_jobs;
+  m_pendingCommands.clear();
+  m_jobs.clear();
+  m_scriptCache.clear();
+  foreach ( SieveJob* job, jobs )
+    job->d->killed();
   deleteLater();
 }
 
+bool Session::isDisconnected() const
+{
+  return m_disconnected;
+}
+
 void Session::dataReceived()
 {
   if ( m_pendingQuantity > 0 ) {
@@ -135,8 +159,14 @@ void Session::dataReceived()
   }
 }
 
-void Session::feedBack(const QByteArray& data)
+void Session::feedBack( SieveJob* job, const QByteArray& data )
 {
+  // the response continues the command that just completed
+  PendingCommand command;
+  command.job = job;
+  command.readOnly = false;
+  m_pendingCommands.prepend( command );
+
   Response response;
   if ( !response.parseResponse( data ) ) {
     m_errorMsg = KIO::buildErrorString( KIO::ERR_UNKNOWN, i18n( "Syntax error." ) );
@@ -243,20 +273,30 @@ void Session::processResponse(const KManageSieve::Response& response, const QByt
       }
       break;
     default:
-      if ( m_currentJob ) {
-        if ( m_currentJob->d->handleResponse( response, data ) ) {
-          m_currentJob = 0;
-          QMetaObject::invokeMethod( this, "executeNextJob", Qt::QueuedConnection );
-        }
+    {
+      if ( m_pendingCommands.isEmpty() ) {
+        kDebug() << "Unhandled response!";
         break;
-      } else {
-        // we can get here in the kill current job case
-        if ( response.operationResult() != Response::Other ) {
-          QMetaObject::invokeMethod( this, "executeNextJob", Qt::QueuedConnection );
-          return;
+      }
+      // responses arrive in the order the commands were sent, an action
+      // (OK/NO) concludes the oldest command still in flight
+      const bool completed = response.type() == Response::Action;
+      SieveJob *job = completed ? m_pendingCommands.dequeue().job : m_pendingCommands.head().job;
+      if ( job && job->d->handleResponse( response, data ) ) {
+        // a failed PUTSCRIPT ends with the error message instead
+        if ( !completed && !m_pendingCommands.isEmpty() && m_pendingCommands.head().job == job )
+          m_pendingCommands.dequeue();
+        // the server still answers pipelined commands of a failed job
+        for ( int i = 0; i < m_pendingCommands.size(); ++i ) {
+          if ( m_pendingCommands.at( i ).job == job )
+            m_pendingCommands[ i ].job = 0;
         }
+        QMetaObject::invokeMethod( this, "executeNextJob", Qt::QueuedConnection );
+      } else if ( completed ) {
+        // the pipeline might have drained enough for the next job
+        QMetaObject::invokeMethod( this, "executeNextJob", Qt::QueuedConnection );
       }
-      kDebug() << "Unhandled response!";
+    }
   }
 }
 
@@ -269,6 +309,7 @@ void Session::socketError()
 void Session::scheduleJob(SieveJob* job)
 {
   kDebug() << job;
+  job->d->mSession = this;
   m_jobs.enqueue( job );
   QMetaObject::invokeMethod( this, "executeNextJob", Qt::QueuedConnection );
 }
@@ -276,21 +317,78 @@ void Session::scheduleJob(SieveJob* job)
 void Session::killJob(SieveJob* job)
 {
   kDebug() << job;
-  if ( m_currentJob == job ) {
-    m_currentJob->d->killed();
-    m_currentJob = 0;
-  } else {
-    m_jobs.removeAll( job );
-    job->d->killed();
+  // the server still answers commands already sent, keep their slots
+  for ( int i = 0; i < m_pendingCommands.size(); ++i ) {
+    if ( m_pendingCommands.at( i ).job == job )
+      m_pendingCommands[ i ].job = 0;
   }
+  m_jobs.removeAll( job );
+  job->d->killed();
+}
+
+void Session::startCommand( SieveJob* job )
+{
+  PendingCommand command;
+  command.job = job;
+  command.readOnly = job->d->nextCommandIsReadOnly();
+  m_pendingCommands.enqueue( command );
+  job->d->run( this );
 }
 
 void Session::executeNextJob()
 {
-  if ( m_socket->state() != KTcpSocket::ConnectedState || m_state != None || m_currentJob || m_jobs.isEmpty() )
+  if ( m_socket->state() != KTcpSocket::ConnectedState || m_state != None )
     return;
-  m_currentJob = m_jobs.dequeue();
-  m_currentJob->d->run( this );
+
+  // Read-only commands are pipelined, i.e. sent without waiting for the
+  // responses to those still in flight, which saves a round trip each on
+  // slow links. Anything changing the server waits for the pipeline to
+  // drain and blocks it in turn, so that reads see the result of writes
+  // scheduled before them.
+  while ( !m_jobs.isEmpty() ) {
+    if ( !m_pendingCommands.isEmpty() ) {
+      if ( !m_jobs.head()->d->nextCommandIsReadOnly() )
+        return;
+      foreach ( const PendingCommand &command, m_pendingCommands ) {
+        if ( !command.readOnly )
+          return;
+      }
+    }
+    m_jobs.dequeue()->d->start( this );
+  }
+}
+
+bool Session::cachedScript( const QString &name, QString *script ) const
+{
+  const QHash<QString, CachedScript>::const_iterator it = m_scriptCache.constFind( name );
+  if ( it == m_scriptCache.constEnd() || QDateTime::currentDateTime().toTime_t() - it->timestamp > ScriptCacheLifetime )
+    return false;
+  *script = it->script;
+  return true;
+}
+
+void Session::cacheScript( const QString &name, const QString &script )
+{
+  CachedScript entry;
+  entry.script = script;
+  entry.timestamp = QDateTime::currentDateTime().toTime_t();
+  m_scriptCache.insert( name, entry );
+}
+
+void Session::uncacheScript( const QString &name )
+{
+  m_scriptCache.remove( name );
+}
+
+void Session::retainCachedScripts( const QStringList &names )
+{
+  QHash<QString, CachedScript>::iterator it = m_scriptCache.begin();
+  while ( it != m_scriptCache.end() ) {
+    if ( names.contains( it.key() ) )
+      ++it;
+    else
+      it = m_scriptCache.erase( it );
+  }
 }
 
 QStringList Session::sieveExtensions() const
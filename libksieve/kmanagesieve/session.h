@@ -25,6 +25,7 @@
 #include "sasl-common.h"
 
 #include <KUrl>
+#include <QtCore/QHash>
 #include <QtCore/QObject>
 #include <QtCore/QQueue>
 #include <QStringList>
@@ -48,10 +49,23 @@ class Session : public QObject
     void connectToHost( const KUrl &url );
     void disconnectFromHost( bool sendLogout = true );
 
+    /** Returns true once the connection has been closed and the session is about to go away. */
+    bool isDisconnected() const;
+
     void scheduleJob( SieveJob* job );
     void killJob( SieveJob* job );
+    /** Sends the next command of @p job, its response is dispatched to @p job in turn. */
+    void startCommand( SieveJob* job );
     void sendData( const QByteArray &data );
-    void feedBack( const QByteArray &data );
+    /** Processes @p data as further response to the command of @p job that just completed. */
+    void feedBack( SieveJob* job, const QByteArray &data );
+
+    /** Looks up a recently transferred script, returns false if there is no usable copy. */
+    bool cachedScript( const QString &name, QString *script ) const;
+    void cacheScript( const QString &name, const QString &script );
+    void uncacheScript( const QString &name );
+    /** Drops all cached scripts not contained in the server's script list @p names. */
+    void retainCachedScripts( const QStringList &names );
 
     QString errorMessage() const;
     void setErrorMessage( const QString &msg );
@@ -79,7 +93,17 @@ class Session : public QObject
     sasl_conn_t *m_sasl_conn;
     sasl_interact_t *m_sasl_client_interact;
     QQueue<SieveJob*> m_jobs;
-    SieveJob* m_currentJob;
+    struct PendingCommand {
+      SieveJob *job; // 0 if the job has been killed meanwhile
+      bool readOnly;
+    };
+    // one entry per command sent but not yet answered, in the order sent
+    QQueue<PendingCommand> m_pendingCommands;
+    struct CachedScript {
+      QString script;
+      uint timestamp;
+    };
+    QHash<QString, CachedScript> m_scriptCache;
     QStringList m_sieveExtensions;
     QStringList m_saslMethods;
     QString m_implementation;
@@ -96,6 +120,7 @@ class Session : public QObject
     QString m_errorMsg;
     qint64 m_pendingQuantity;
     bool m_supportsStartTls;
+    bool m_disconnected;
 };
 
 }
@@ -31,7 +31,7 @@ Session* SieveJob::Private::sessionForUrl(const KUrl& url)
   KUrl hostUrl( url );
   hostUrl.setPath( QString() ); // remove parts not required to identify the server
   QPointer<Session> sessionPtr = m_sessionPool.value( hostUrl );
-  if ( !sessionPtr ) {
+  if ( !sessionPtr || sessionPtr->isDisconnected() ) {
     sessionPtr = QPointer<Session>( new Session() );
     m_sessionPool.insert( hostUrl, sessionPtr );
     sessionPtr->connectToHost( hostUrl );
@@ -56,9 +56,39 @@ static void append_lf2crlf( QByteArray & out, const QByteArray & in ) {
   out.resize( d - out.begin() );
 }
 
+void SieveJob::Private::start( Session *session )
+{
+  // LISTSCRIPTS is still needed to learn whether the script exists and is active
+  const QString filename = mUrl.fileName( KUrl::ObeyTrailingSlash );
+  if ( mCommands.first() == Get && session->cachedScript( filename, &mScript ) ) {
+    kDebug() << "Using cached copy of" << filename;
+    mCommands.remove( 0 );
+  }
+
+  // GETSCRIPT does not depend on the outcome of the LISTSCRIPTS before it
+  const bool readOnly = nextCommandIsReadOnly();
+  do {
+    session->startCommand( q );
+  } while ( readOnly && mCommandsInFlight < mCommands.size() && nextCommandIsReadOnly() );
+}
+
+bool SieveJob::Private::nextCommandIsReadOnly() const
+{
+  switch ( mCommands.at( mCommands.size() - 1 - mCommandsInFlight ) ) {
+    case Get:
+    case List:
+    case SearchActive:
+      return true;
+    default:
+      return false;
+  }
+}
+
 void SieveJob::Private::run( Session *session )
 {
-  switch ( mCommands.top() ) {
+  const Command command = mCommands.at( mCommands.size() - 1 - mCommandsInFlight );
+  ++mCommandsInFlight;
+  switch ( command ) {
     case Get:
     {
       const QString filename = mUrl.fileName( KUrl::ObeyTrailingSlash );
@@ -101,7 +131,7 @@ void SieveJob::Private::run( Session *session )
 bool SieveJob::Private::handleResponse( const Response &response, const QByteArray &data )
 {
   const Command lastCmd = mCommands.top();
-  Session* session = sessionForUrl( mUrl );
+  Session* session = mSession;
 
   // handle non-action responses
   if ( response.type() != Response::Action ) {
@@ -151,20 +181,58 @@ bool SieveJob::Private::handleResponse( const Response &response, const QByteArr
   if ( lastCmd == SearchActive && mFileExists == DontKnow && response.operationSuccessful() )
     mFileExists = No;
 
+  // The GETSCRIPT pipelined behind that is bound to fail then, which is fine:
+  bool success = response.operationSuccessful();
+  if ( (lastCmd == Get || lastCmd == SearchActive) && mFileExists == No ) {
+    mScript.clear();
+    success = true;
+  }
+
   // PUTSCRIPT reports the error message in an literal after the final response sometimes
   if ( lastCmd == Put && response.operationResult() == Response::No ) {
     if ( response.action().size() > 3 ) {
       const QByteArray extra = response.action().right( response.action().size() - 3 );
-      sessionForUrl( mUrl )->feedBack( extra );
+      session->feedBack( q, extra );
       return false;
     }
   }
 
   // prepare for next round:
   mCommands.pop();
+  --mCommandsInFlight;
+
+  const QString filename = mUrl.fileName( KUrl::ObeyTrailingSlash );
+  switch ( lastCmd ) {
+    case Get:
+      if ( response.operationSuccessful() )
+        session->cacheScript( filename, mScript );
+      else
+        session->uncacheScript( filename );
+      break;
+    case Put:
+      if ( response.operationSuccessful() ) {
+        // cache what a GETSCRIPT would return
+        QByteArray encodedData;
+        append_lf2crlf( encodedData, mScript.toUtf8() );
+        session->cacheScript( filename, QString::fromUtf8( encodedData ) );
+      } else {
+        session->uncacheScript( filename );
+      }
+      break;
+    case Delete:
+      session->uncacheScript( filename );
+      break;
+    case List:
+    case SearchActive:
+      if ( response.operationSuccessful() )
+        session->retainCachedScripts( mAvailableScripts );
+      break;
+    default:
+      break;
+  }
 
   // check for errors:
-  if ( !response.operationSuccessful() ) {
+  if ( !success ) {
     if ( mInteractive ) {
       if ( session->errorMessage().isEmpty() )
         KMessageBox::error( 0, i18n( "Sieve operation failed." ), i18n( "Sieve Error" ) );
@@ -183,15 +251,6 @@ bool SieveJob::Private::handleResponse( const Response &response, const QByteArr
     return true;
   }
 
-  // check for new tasks:
-  if ( !mCommands.empty() ) {
-    // Don't fail getting a non-existent script:
-    if ( (mCommands.top() == Get) && (mFileExists == No) ) {
-      mScript.clear();
-      mCommands.pop();
-    }
-  }
-
   if ( mCommands.empty() ) {
     // was last command; report success and delete this object:
     emit q->result( q, true, mScript, (mUrl.fileName() == mActiveScriptName) );
@@ -203,8 +262,9 @@ bool SieveJob::Private::handleResponse( const Response &response, const QByteArr
     q->deleteLater();
     return true;
   } else {
-    // schedule the next command:
-    run( sessionForUrl( mUrl ) );
+    // schedule the next command, unless it has been pipelined already:
+    if ( mCommandsInFlight == 0 )
+      session->startCommand( q );
     return false;
   }
 
@@ -218,6 +278,10 @@ void SieveJob::Private::killed()
     emit q->gotList( q, false, mAvailableScripts, mActiveScriptName );
   else
     emit q->gotScript( q, false, mScript, (mUrl.fileName() == mActiveScriptName) );
+
+  // don't get killed a second time
+  mCommands.clear();
+  mCommandsInFlight = 0;
 }
 
 SieveJob::SieveJob( QObject *parent )
@@ -237,7 +301,8 @@ void SieveJob::kill( KJob::KillVerbosity verbosity )
   Q_UNUSED( verbosity );
   if ( d->mCommands.isEmpty() )
     return; // done already
-  Private::sessionForUrl( d->mUrl )->killJob( this );
+  if ( d->mSession )
+    d->mSession->killJob( this );
 }
 
 void SieveJob::setInteractive( bool interactive )
@@ -247,9 +312,8 @@ void SieveJob::setInteractive( bool interactive )
 
 QStringList SieveJob::sieveCapabilities() const
 {
-  Session* session = d->sessionForUrl( d->mUrl );
-  if ( session )
-    return session->sieveExtensions();
+  if ( d->mSession )
+    return d->mSession->sieveExtensions();
   return QStringList();
 }
 
@@ -27,7 +27,7 @@ class SieveJob::Private
 {
   public:
     Private( SieveJob *qq )
-      : q( qq ), mFileExists( DontKnow ), mInteractive( true )
+      : q( qq ), mFileExists( DontKnow ), mCommandsInFlight( 0 ), mInteractive( true )
     {
     }
 
@@ -49,7 +49,9 @@ class SieveJob::Private
 
     static Session* sessionForUrl( const KUrl &url );
 
+    void start( Session *session );
     void run( Session *session );
+    bool nextCommandIsReadOnly() const;
     bool handleResponse( const Response &response, const QByteArray &data );
     void killed();
 
@@ -59,6 +61,9 @@ class SieveJob::Private
     QString mActiveScriptName;
     Existence mFileExists;
     QStack<Command> mCommands;
+    // number of commands from the top of mCommands sent already
+    int mCommandsInFlight;
+    QPointer<Session> mSession;
 
     // List of Sieve scripts on the server, used by @ref list()
     QStringList mAvailableScripts;
@@ -0,0 +1,330 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+#include <kmanagesieve/sievejob.h>
+
+#include <qtest_kde.h>
+
+#include <QtCore/QEventLoop>
+#include <QtCore/QObject>
+#include <QtCore/QRegExp>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+using namespace KManageSieve;
+
+/**
+ * A ManageSieve stand-in server answering from an in-memory set of scripts.
+ *
+ * Responses are deferred a little, so that commands sent without waiting for
+ * the previous response pile up and the pipeline depth becomes visible.
+ */
+class ScriptedSieveServer : public QTcpServer
+{
+  Q_OBJECT
+  public:
+    explicit ScriptedSieveServer( QObject *parent = 0 )
+      : QTcpServer( parent ), connections( 0 ), authentications( 0 ), m_client( 0 )
+    {
+      connect( this, SIGNAL(newConnection()), SLOT(newClient()) );
+      m_answerTimer.setSingleShot( true );
+      m_answerTimer.setInterval( 20 );
+      connect( &m_answerTimer, SIGNAL(timeout()), SLOT(answer()) );
+    }
+
+    /** Number of commands starting with @p prefix received so far. */
+    int count( const QByteArray &prefix ) const
+    {
+      int result = 0;
+      foreach ( const QByteArray &command, commands ) {
+        if ( command.startsWith( prefix ) )
+          ++result;
+      }
+      return result;
+    }
+
+    /** Number of unanswered commands when the first command starting with @p prefix arrived. */
+    int depth( const QByteArray &prefix ) const
+    {
+      for ( int i = 0; i < commands.size(); ++i ) {
+        if ( commands.at( i ).startsWith( prefix ) )
+          return depths.at( i );
+      }
+      return -1;
+    }
+
+    QHash<QByteArray, QByteArray> scripts;
+    QByteArray activeScript;
+    int connections;
+    int authentications;
+    QList<QByteArray> commands;
+    QList<int> depths;
+
+  private slots:
+    void newClient()
+    {
+      ++connections;
+      m_client = nextPendingConnection();
+      connect( m_client, SIGNAL(readyRead()), SLOT(readClient()) );
+      m_client->write( "\"IMPLEMENTATION\" \"KManageSieve test server\"\r\n"
+                       "\"SASL\" \"PLAIN\"\r\n"
+                       "\"SIEVE\" \"fileinto reject vacation\"\r\n"
+                       "OK\r\n" );
+    }
+
+    void readClient()
+    {
+      m_buffer += m_client->readAll();
+      forever {
+        const int eol = m_buffer.indexOf( "\r\n" );
+        if ( eol < 0 )
+          break;
+        const QByteArray line = m_buffer.left( eol );
+        int consumed = eol + 2;
+        QByteArray literal;
+        QRegExp literalSize( "\\{(\\d+)\\+?\\}$" );
+        if ( literalSize.indexIn( QString::fromLatin1( line ) ) >= 0 ) {
+          const int size = literalSize.cap( 1 ).toInt();
+          if ( m_buffer.size() < consumed + size + 2 )
+            break;
+          literal = m_buffer.mid( consumed, size );
+          consumed += size + 2;
+        }
+        m_buffer.remove( 0, consumed );
+
+        m_pending.append( qMakePair( line, literal ) );
+        commands.append( line );
+        depths.append( m_pending.size() );
+      }
+      if ( !m_pending.isEmpty() )
+        m_answerTimer.start();
+    }
+
+    void answer()
+    {
+      while ( !m_pending.isEmpty() ) {
+        const QPair<QByteArray, QByteArray> command = m_pending.takeFirst();
+        m_client->write( respond( command.first, command.second ) );
+      }
+    }
+
+  private:
+    static QByteArray argument( const QByteArray &line )
+    {
+      const int begin = line.indexOf( '"' );
+      const int end = line.indexOf( '"', begin + 1 );
+      return line.mid( begin + 1, end - begin - 1 );
+    }
+
+    QByteArray respond( const QByteArray &line, const QByteArray &literal )
+    {
+      if ( line.startsWith( "AUTHENTICATE" ) ) {
+        ++authentications;
+        return "OK\r\n";
+      } else if ( line == "LISTSCRIPTS" ) {
+        QByteArray response;
+        foreach ( const QByteArray &name, scripts.keys() )
+          response += '"' + name + ( name == activeScript ? "\" ACTIVE\r\n" : "\"\r\n" );
+        return response + "OK\r\n";
+      } else if ( line.startsWith( "GETSCRIPT" ) ) {
+        const QByteArray name = argument( line );
+        if ( !scripts.contains( name ) )
+          return "NO \"There is no script by that name\"\r\n";
+        const QByteArray script = scripts.value( name );
+        return '{' + QByteArray::number( script.size() ) + "}\r\n" + script + "\r\nOK\r\n";
+      } else if ( line.startsWith( "PUTSCRIPT" ) ) {
+        scripts.insert( argument( line ), literal );
+        return "OK\r\n";
+      } else if ( line.startsWith( "SETACTIVE" ) ) {
+        activeScript = argument( line );
+        return "OK\r\n";
+      } else if ( line.startsWith( "DELETESCRIPT" ) ) {
+        scripts.remove( argument( line ) );
+        return "OK\r\n";
+      } else if ( line == "LOGOUT" ) {
+        return "OK\r\n";
+      }
+      return "NO \"Unknown command\"\r\n";
+    }
+
+    QTcpSocket *m_client;
+    QByteArray m_buffer;
+    QList<QPair<QByteArray, QByteArray> > m_pending;
+    QTimer m_answerTimer;
+};
+
+class SieveJobTest : public QObject
+{
+  Q_OBJECT
+  private slots:
+    void init();
+    void cleanup();
+    void testSessionReuse();
+    void testPipelining();
+    void testWritesAreNotPipelined();
+    void testScriptCache();
+    void testMissingScript();
+
+  public slots:
+    void jobResult( KManageSieve::SieveJob *job, bool success, const QString &script, bool active );
+
+  private:
+    KUrl url( const QString &script = QString() ) const;
+    bool waitForResult( SieveJob *job );
+
+    ScriptedSieveServer *mServer;
+    bool mSuccess;
+    QString mScript;
+    bool mActive;
+};
+
+void SieveJobTest::init()
+{
+  // a new server for every test, so that no session is shared between them
+  mServer = new ScriptedSieveServer( this );
+  QVERIFY( mServer->listen( QHostAddress::LocalHost ) );
+  mServer->scripts.insert( "a", "keep;\r\n" );
+  mServer->scripts.insert( "b", "discard;\r\n" );
+  mServer->activeScript = "a";
+}
+
+void SieveJobTest::cleanup()
+{
+  delete mServer;
+  mServer = 0;
+}
+
+KUrl SieveJobTest::url( const QString &script ) const
+{
+  KUrl u;
+  u.setProtocol( "sieve" );
+  u.setHost( "127.0.0.1" );
+  u.setPort( mServer->serverPort() );
+  u.setUser( "user" );
+  u.setPass( "secret" );
+  u.setPath( '/' + script );
+  u.addQueryItem( "x-mech", "PLAIN" );
+  u.addQueryItem( "x-allow-unencrypted", "true" );
+  return u;
+}
+
+void SieveJobTest::jobResult( KManageSieve::SieveJob *job, bool success, const QString &script, bool active )
+{
+  Q_UNUSED( job );
+  mSuccess = success;
+  mScript = script;
+  mActive = active;
+}
+
+bool SieveJobTest::waitForResult( SieveJob *job )
+{
+  job->setInteractive( false );
+  mSuccess = false;
+  mScript.clear();
+  mActive = false;
+
+  QEventLoop loop;
+  connect( job, SIGNAL(result(KManageSieve::SieveJob*,bool,QString,bool)),
+           SLOT(jobResult(KManageSieve::SieveJob*,bool,QString,bool)) );
+  connect( job, SIGNAL(result(KManageSieve::SieveJob*,bool,QString,bool)), &loop, SLOT(quit()) );
+  QTimer::singleShot( 10000, &loop, SLOT(quit()) );
+  loop.exec();
+  return mSuccess;
+}
+
+void SieveJobTest::testSessionReuse()
+{
+  QVERIFY( waitForResult( SieveJob::list( url() ) ) );
+  QVERIFY( waitForResult( SieveJob::get( url( "b" ) ) ) );
+  QCOMPARE( mScript, QString( "discard;\r\n" ) );
+  QVERIFY( waitForResult( SieveJob::put( url( "c" ), "stop;\n", false, false ) ) );
+  QVERIFY( waitForResult( SieveJob::activate( url( "c" ) ) ) );
+  QCOMPARE( mServer->activeScript, QByteArray( "c" ) );
+
+  QCOMPARE( mServer->connections, 1 );
+  QCOMPARE( mServer->authentications, 1 );
+}
+
+void SieveJobTest::testPipelining()
+{
+  QVERIFY( waitForResult( SieveJob::get( url( "a" ) ) ) );
+  QCOMPARE( mScript, QString( "keep;\r\n" ) );
+  QVERIFY( mActive );
+
+  // GETSCRIPT went out before LISTSCRIPTS was answered
+  QCOMPARE( mServer->count( "LISTSCRIPTS" ), 1 );
+  QCOMPARE( mServer->count( "GETSCRIPT" ), 1 );
+  QCOMPARE( mServer->depth( "GETSCRIPT" ), 2 );
+}
+
+void SieveJobTest::testWritesAreNotPipelined()
+{
+  SieveJob *first = SieveJob::get( url( "a" ) );
+  first->setInteractive( false );
+  SieveJob *put = SieveJob::put( url( "b" ), "fileinto \"x\";\n", false, false );
+  put->setInteractive( false );
+  QVERIFY( waitForResult( SieveJob::get( url( "b" ) ) ) );
+  QCOMPARE( mScript, QString( "fileinto \"x\";\r\n" ) );
+
+  QCOMPARE( mServer->depth( "PUTSCRIPT" ), 1 );
+  QCOMPARE( mServer->commands.last(), QByteArray( "LISTSCRIPTS" ) );
+}
+
+void SieveJobTest::testScriptCache()
+{
+  QVERIFY( waitForResult( SieveJob::get( url( "a" ) ) ) );
+  QVERIFY( waitForResult( SieveJob::get( url( "a" ) ) ) );
+  QCOMPARE( mScript, QString( "keep;\r\n" ) );
+  QVERIFY( mActive );
+  QCOMPARE( mServer->count( "LISTSCRIPTS" ), 2 );
+  QCOMPARE( mServer->count( "GETSCRIPT" ), 1 );
+
+  // an upload replaces the cached copy
+  QVERIFY( waitForResult( SieveJob::put( url( "a" ), "discard;\n", false, false ) ) );
+  QVERIFY( waitForResult( SieveJob::get( url( "a" ) ) ) );
+  QCOMPARE( mScript, QString( "discard;\r\n" ) );
+  QCOMPARE( mServer->count( "GETSCRIPT" ), 1 );
+
+  // scripts gone from the server are not served from the cache
+  mServer->scripts.remove( "a" );
+  QVERIFY( waitForResult( SieveJob::get( url( "a" ) ) ) );
+  QVERIFY( mScript.isEmpty() );
+  QVERIFY( waitForResult( SieveJob::put( url( "a" ), "keep;\n", false, false ) ) );
+  QVERIFY( waitForResult( SieveJob::del( url( "a" ) ) ) );
+  QVERIFY( waitForResult( SieveJob::get( url( "a" ) ) ) );
+  QVERIFY( mScript.isEmpty() );
+}
+
+void SieveJobTest::testMissingScript()
+{
+  // the pipelined GETSCRIPT fails, but getting a non-existent script does not
+  QVERIFY( waitForResult( SieveJob::get( url( "missing" ) ) ) );
+  QVERIFY( mScript.isEmpty() );
+  QVERIFY( !mActive );
+  QCOMPARE( mServer->count( "GETSCRIPT" ), 1 );
+
+  // and the session is still in step with the server
+  QVERIFY( waitForResult( SieveJob::get( url( "b" ) ) ) );
+  QCOMPARE( mScript, QString( "discard;\r\n" ) );
+}
+
+QTEST_KDEMAIN( SieveJobTest, NoGUI )
+
+#include "sievejobtest.moc"
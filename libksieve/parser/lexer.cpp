@@ -37,11 +37,8 @@
 #include <impl/utf8validator.h>
 #include <ksieve/error.h>
 
+#include <QByteArray>
 #include <QString>
-#include <QStringList>
-#include <QTextCodec>
-
-#include <memory> // std::auto_ptr
 
 #include <assert.h>
 #include <ctype.h> // isdigit
@@ -159,17 +156,52 @@ static inline bool is8Bit( signed char ch ) {
     return ch < 0;
 }
 #endif
-static QString removeCRLF( const QString & s ) {
-  const bool CRLF = s.endsWith( QLatin1String("\r\n") );
-  const bool LF = !CRLF && s.endsWith( '\n' );
-
-  const int e = CRLF ? 2 : LF ? 1 : 0 ;  // what to chop off at the end
-
-  return s.left( s.length() - e );
+// Resolves backslash escapes and turns CRLF into LF:
+static QString decodeQuotedString( const char * begin, const char * end ) {
+  QByteArray buffer;
+  buffer.reserve( end - begin );
+  const char * run = begin;
+  for ( const char * it = begin ; it != end ; ++it )
+    if ( *it == '\\' || *it == '\r' ) {
+      // the lexer only accepts CRs as part of CRLF pairs, so
+      // dropping them is enough:
+      buffer.append( run, it - run );
+      run = it + 1;
+      if ( *it == '\\' && run != end )
+	++it; // the escaped char starts the next run
+    }
+  buffer.append( run, end - run );
+  return QString::fromUtf8( buffer.constData(), buffer.size() );
 }
 
-static QString removeDotStuff( const QString & s ) {
-    return s.startsWith( QLatin1String("..") ) ? s.mid( 1 ) : s ;
+// Removes the dot-stuffing and turns CRLF into LF. [begin,end[ spans
+// the lines before the lone dot, including their line breaks:
+static QString decodeMultiLine( const char * begin, const char * end, int flags ) {
+  if ( begin == end )
+    return QString();
+
+  // don't include the line break before the lone dot:
+  assert( end[-1] == '\n' );
+  --end;
+  if ( end != begin && end[-1] == '\r' )
+    --end;
+
+  if ( !( flags & ( KSieve::Lexer::Impl::Span::HasCRLF | KSieve::Lexer::Impl::Span::HasDotStuffing ) ) )
+    return QString::fromUtf8( begin, end - begin );
+
+  QByteArray buffer;
+  buffer.reserve( end - begin );
+  const char * run = begin;
+  bool atBeginOfLine = true;
+  for ( const char * it = begin ; it != end ; ++it ) {
+    if ( *it == '\r' || ( atBeginOfLine && *it == '.' && it + 1 != end && it[1] == '.' ) ) {
+      buffer.append( run, it - run );
+      run = it + 1;
+    }
+    atBeginOfLine = *it == '\n';
+  }
+  buffer.append( run, end - run );
+  return QString::fromUtf8( buffer.constData(), buffer.size() );
 }
 
 namespace KSieve {
@@ -190,9 +222,9 @@ namespace KSieve {
       assert( atEnd() );
   }
 
-  Lexer::Token Lexer::Impl::nextToken( QString & result ) {
+  Lexer::Token Lexer::Impl::nextToken( Span & result ) {
     assert( !atEnd() );
-    result.clear();
+    result = Span();
     //clearErrors();
 
     const int oldLine = line();
@@ -200,7 +232,7 @@ namespace KSieve {
     const bool eatingWSSucceeded = ignoreComments() ? eatCWS() : eatWS() ;
 
     if ( !ignoreLineFeeds() && oldLine != line() ) {
-      result.setNum( line() - oldLine ); // return number of linefeeds encountered
+      result.lineFeeds = line() - oldLine; // return number of linefeeds encountered
       return LineFeeds;
     }
 
@@ -215,7 +247,7 @@ namespace KSieve {
       assert( !ignoreComments() );
       ++mState.cursor;
       if ( !atEnd() )
-	parseHashComment( result, true );
+	parseHashComment( result );
       return HashComment;
     case '/': // BracketComment
       assert( !ignoreComments() );
@@ -229,7 +261,7 @@ namespace KSieve {
 	makeError( Error::UnfinishedBracketComment );
 	return BracketComment;
       }
-      parseBracketComment( result, true );
+      parseBracketComment( result );
       return BracketComment;
     case ':': // Tag
       ++mState.cursor;
@@ -255,7 +287,8 @@ namespace KSieve {
     case ')':
     case ';':
     case ',': // Special
-      result = *mState.cursor++;
+      result.begin = mState.cursor++;
+      result.end = mState.cursor;
       return Special;
     case '0':
     case '1':
@@ -289,6 +322,34 @@ namespace KSieve {
     }
   }
 
+  QString Lexer::Impl::toString( Lexer::Token token, const Span & span ) {
+    const int length = span.end - span.begin;
+    switch ( token ) {
+    case LineFeeds:
+      return QString::number( span.lineFeeds );
+    case Number:
+    case Identifier:
+    case Tag:
+    case Special:
+      // Can use the fast fromLatin1 here, since these are always
+      // in the us-ascii subset:
+      return QString::fromLatin1( span.begin, length );
+    case HashComment:
+      return QString::fromUtf8( span.begin, length );
+    case BracketComment:
+      return QString::fromUtf8( span.begin, length ).remove( '\r' ); // get rid of CR in CRLF pairs
+    case QuotedString:
+      if ( span.flags & ( Span::HasEscapes | Span::HasCRLF ) )
+	return decodeQuotedString( span.begin, span.end );
+      return QString::fromUtf8( span.begin, length );
+    case MultiLineString:
+      return decodeMultiLine( span.begin, span.end, span.flags );
+    case None:
+      break;
+    }
+    return QString();
+  }
+
   bool Lexer::Impl::eatWS() {
     while ( !atEnd() )
       switch ( *mState.cursor ) {
@@ -332,7 +393,7 @@ namespace KSieve {
   }
       
 
-  bool Lexer::Impl::parseHashComment( QString & result, bool reallySave ) {
+  bool Lexer::Impl::parseHashComment( Span & result ) {
     // hash-comment := "#" *CHAR-NOT-CRLF CRLF
 
     // check that the caller plays by the rules:
@@ -357,8 +418,8 @@ namespace KSieve {
 	  makeError( Error::InvalidUTF8 );
 	  return false;
 	}
-	if ( reallySave )
-	  result += QString::fromUtf8( commentStart, commentLength );
+	result.begin = commentStart;
+	result.end = commentStart + commentLength;
       }
       return true;
     }
@@ -366,7 +427,7 @@ namespace KSieve {
     return false;
   }
 
-  bool Lexer::Impl::parseBracketComment( QString & result, bool reallySave ) {
+  bool Lexer::Impl::parseBracketComment( Span & result ) {
     // bracket-comment := "/*" *(CHAR-NOT-STAR / ("*" CHAR-NOT-SLASH )) "*/"
 
     // check that caller plays by the rules:
@@ -399,30 +460,28 @@ namespace KSieve {
 	makeError( Error::InvalidUTF8 );
 	return false;
       }
-      if ( reallySave ) {
-	QString tmp = QString::fromUtf8( commentStart, commentLength );
-	result += tmp.remove( '\r' ); // get rid of CR in CRLF pairs
-      }
+      result.begin = commentStart;
+      result.end = commentStart + commentLength;
     }
 
     ++mState.cursor; // eat '/'
     return true;
   }
 
-  bool Lexer::Impl::parseComment( QString & result, bool reallySave ) {
+  bool Lexer::Impl::parseComment( Span & result ) {
     // comment := hash-comment / bracket-comment
 
     switch( *mState.cursor ) {
     case '#':
       ++mState.cursor;
-      return parseHashComment( result, reallySave );
+      return parseHashComment( result );
     case '/':
       if ( charsLeft() < 2 || mState.cursor[1] != '*' ) {
 	makeError( Error::IllegalCharacter );
 	return false;
       } else {
 	mState.cursor += 2; // eat "/*"
-	return parseBracketComment( result, reallySave );
+	return parseBracketComment( result );
       }
     default:
       return false; // don't set an error here - there was no comment
@@ -446,7 +505,7 @@ namespace KSieve {
       case '#':
       case '/': // comments
 	{
-	  QString dummy;
+	  Span dummy;
 	  if ( !parseComment( dummy ) )
 	    return false;
 	}
@@ -458,7 +517,7 @@ namespace KSieve {
     return true;
   }
 
-  bool Lexer::Impl::parseIdentifier( QString & result ) {
+  bool Lexer::Impl::parseIdentifier( Span & result ) {
     // identifier := (ALPHA / "_") *(ALPHA DIGIT "_")
 
     assert( isIText( *mState.cursor ) );
@@ -474,11 +533,8 @@ namespace KSieve {
     // rest of identifier chars ( now digits are allowed ):
     for ( ++mState.cursor ; !atEnd() && isIText( *mState.cursor ) ; ++mState.cursor ) ;
 
-    const int identifierLength = mState.cursor - identifierStart;
-
-    // Can use the fast fromLatin1 here, since identifiers are always
-    // in the us-ascii subset:
-    result += QString::fromLatin1( identifierStart, identifierLength );
+    result.begin = identifierStart;
+    result.end = mState.cursor;
 
     if ( atEnd() || isDelim( *mState.cursor ) )
       return true;
@@ -487,7 +543,7 @@ namespace KSieve {
     return false;
   }
 
-  bool Lexer::Impl::parseTag( QString & result ) {
+  bool Lexer::Impl::parseTag( Span & result ) {
     // tag := ":" identifier
 
     // check that the caller plays by the rules:
@@ -498,14 +554,16 @@ namespace KSieve {
     return parseIdentifier( result );
   }
 
-  bool Lexer::Impl::parseNumber( QString & result ) {
+  bool Lexer::Impl::parseNumber( Span & result ) {
     // number     := 1*DIGIT [QUANTIFIER]
     // QUANTIFIER := "K" / "M" / "G"
 
     assert( isdigit( *mState.cursor ) );
 
+    result.begin = mState.cursor;
     while ( !atEnd() && isdigit( *mState.cursor ) )
-      result += *mState.cursor++;
+      ++mState.cursor;
+    result.end = mState.cursor;
 
     if ( atEnd() || isDelim( *mState.cursor ) )
       return true;
@@ -517,7 +575,7 @@ namespace KSieve {
     case 'm':
     case 'K':
     case 'k':
-      result += *mState.cursor++;
+      result.end = ++mState.cursor;
       break;
     default:
       makeIllegalCharError();
@@ -531,7 +589,7 @@ namespace KSieve {
     return false;
   }
 
-  bool Lexer::Impl::parseMultiLine( QString & result ) {
+  bool Lexer::Impl::parseMultiLine( Span & result ) {
     // multi-line          := "text:" *(SP / HTAB) (hash-comment / CRLF)
     //                        *(multi-line-literal / multi-line-dotstuff)
     //                        "." CRLF
@@ -540,7 +598,7 @@ namespace KSieve {
     //         ;; A line containing only "." ends the multi-line.
     //         ;; Remove a leading '.' if followed by another '.'.
 
-    assert( _strnicmp( mState.cursor - 5, "text:", STR_DIM("text:") ) == 0 );
+    assert( qstrnicmp( mState.cursor - 5, "text:", STR_DIM("text:") ) == 0 );
 
     const int mlBeginLine = line();
     const int mlBeginCol = column() - 5;
@@ -554,7 +612,7 @@ namespace KSieve {
       case '#':
 	{
 	  ++mState.cursor;
-	  QString dummy;
+	  Span dummy;
 	  if ( !parseHashComment( dummy ) )
 	    return false;
 	  goto MultiLineStart; // break from switch _and_ while
@@ -575,8 +633,10 @@ namespace KSieve {
       return false;
     }
 
-    // Now, collect the single lines until one with only a single dot is found:
-    QStringList lines;
+    // Now, find the line with only a single dot. The lines before
+    // it are only decoded on request (see decodeMultiLine()):
+    const char * const mlBegin = beginOfLine();
+    int flags = 0;
     while ( !atEnd() ) {
       const char * const oldBeginOfLine = beginOfLine();
       if ( !skipToCRLF() )
@@ -587,27 +647,30 @@ namespace KSieve {
 	  makeError( Error::InvalidUTF8 );
 	  return false;
 	}
-	const QString line = removeCRLF( QString::fromUtf8( oldBeginOfLine, lineLength ) );
-	lines.push_back( removeDotStuff( line ) );
-	if ( line == "." )
-	  break;
-      } else {
-	lines.push_back( QString() );
+	const char * lineEnd = mState.cursor;
+	if ( lineEnd[-1] == '\n' ) {
+	  --lineEnd;
+	  if ( lineEnd != oldBeginOfLine && lineEnd[-1] == '\r' ) {
+	    --lineEnd;
+	    flags |= Span::HasCRLF;
+	  }
+	}
+	if ( lineEnd - oldBeginOfLine == 1 && *oldBeginOfLine == '.' ) {
+	  result.begin = mlBegin;
+	  result.end = oldBeginOfLine; // don't include the lone dot.
+	  result.flags = flags;
+	  return true;
+	}
+	if ( lineEnd - oldBeginOfLine >= 2 && oldBeginOfLine[0] == '.' && oldBeginOfLine[1] == '.' )
+	  flags |= Span::HasDotStuffing;
       }
     }
 
-    if ( lines.back() != "." ) {
-      makeError( Error::PrematureEndOfMultiLine, mlBeginLine, mlBeginCol );
-      return false;
-    }
-
-    assert( !lines.empty() );
-    lines.erase( --lines.end() ); // don't include the lone dot.
-    result = lines.join("\n");
-    return true;
+    makeError( Error::PrematureEndOfMultiLine, mlBeginLine, mlBeginCol );
+    return false;
   }
 
-  bool Lexer::Impl::parseQuotedString( QString & result ) {
+  bool Lexer::Impl::parseQuotedString( Span & result ) {
     // quoted-string := DQUOTE *CHAR DQUOTE
 
     // check that caller plays by the rules:
@@ -616,45 +679,45 @@ namespace KSieve {
     const int qsBeginCol = column() - 1;
     const int qsBeginLine = line();
 
-    const QTextCodec * const codec = QTextCodec::codecForMib( 106 ); // UTF-8
-    assert( codec );
-    const std::auto_ptr<QTextDecoder> dec( codec->makeDecoder() );
-    assert( dec.get() );
+    result.begin = mState.cursor;
 
     while ( !atEnd() )
       switch ( *mState.cursor ) {
       case '"':
-	++mState.cursor;
+	result.end = mState.cursor++;
 	return true;
       case '\r':
       case '\n':
+	result.end = mState.cursor;
+	if ( *mState.cursor == '\r' )
+	  result.flags |= Span::HasCRLF;
 	if ( !eatCRLF() )
 	  return false;
-	result += '\n';
 	break;
       case '\\':
+	result.flags |= Span::HasEscapes;
 	++mState.cursor;
 	if ( atEnd() )
 	  break;
 	// else fall through:
       default:
 	if ( !is8Bit( *mState.cursor ) )
-	  result += *mState.cursor++;
+	  ++mState.cursor;
 	else { // probably UTF-8
 	  const char * const eightBitBegin = mState.cursor;
 	  skipTo8BitEnd();
 	  const int eightBitLen = mState.cursor - eightBitBegin;
 	  assert( eightBitLen > 0 );
-	  if ( isValidUtf8( eightBitBegin, eightBitLen ) )
-	    result += dec->toUnicode( eightBitBegin, eightBitLen );
-	  else {
+	  if ( !isValidUtf8( eightBitBegin, eightBitLen ) ) {
 	    assert( column() >= eightBitLen );
+	    result.end = eightBitBegin;
 	    makeError( Error::InvalidUTF8, line(), column() - eightBitLen );
 	    return false;
 	  }
 	}
       }
 
+    result.end = mEnd;
     makeError( Error::PrematureEndOfQuotedString, qsBeginLine, qsBeginCol );
     return false;
   }
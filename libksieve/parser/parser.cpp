@@ -130,12 +130,12 @@ namespace KSieve {
     return isStringToken() ||
            token() == Lexer::Number ||
            token() == Lexer::Tag ||
-         ( token() == Lexer::Special && mTokenValue == "[" );
+         isSpecial( '[' );
   }
 
   bool Parser::Impl::obtainToken() {
     while ( !mToken && !lexer.atEnd() && !lexer.error() ) {
-      mToken = lexer.nextToken( mTokenValue );
+      mToken = lexer.nextToken( mTokenSpan );
       if ( lexer.error() )
         break;
       // comments and line feeds are semantically invisible and may
@@ -152,7 +152,7 @@ namespace KSieve {
         consumeToken();
         break;
       case Lexer::LineFeeds:
-        for ( unsigned int i = 0, end = tokenValue().toUInt() ; i < end ; ++i )
+        for ( int i = 0, end = mTokenSpan.lineFeeds ; i < end ; ++i )
           if ( scriptBuilder() ) // better check every iteration, b/c
                                  // we call out to ScriptBuilder,
                                  // where nasty things might happen!
@@ -251,7 +251,7 @@ namespace KSieve {
       return false;
     }
 
-    if ( token() == Lexer::Special && tokenValue() == "(" ) { // test-list
+    if ( isSpecial( '(' ) ) { // test-list
       if ( !parseTestList() ) {
         assert( error() );
         return false;
@@ -280,9 +280,9 @@ namespace KSieve {
       return false;
     }
 
-    if ( tokenValue() == ";" )
+    if ( isSpecial( ';' ) )
       consumeToken();
-    else if ( tokenValue() == "{" ) { // block
+    else if ( isSpecial( '{' ) ) { // block
       if ( !parseBlock() )
         return false; // it's an error since we saw '{'
     } else {
@@ -334,7 +334,7 @@ namespace KSieve {
         scriptBuilder()->stringArgument( tokenValue(), token() == Lexer::MultiLineString, QString() );
       consumeToken();
       return true;
-    } else if ( token() == Lexer::Special && tokenValue() == "[" ) {
+    } else if ( isSpecial( '[' ) ) {
       if ( !parseStringList() ) {
         assert( error() );
         return false;
@@ -352,7 +352,7 @@ namespace KSieve {
     if ( !obtainToken() || atEnd() )
       return false;
     
-    if ( token() != Lexer::Special || tokenValue() != "(" )
+    if ( !isSpecial( '(' ) )
       return false;
     if ( scriptBuilder() )
       scriptBuilder()->testListStart();
@@ -369,9 +369,8 @@ namespace KSieve {
       case Lexer::None:
         break;
       case Lexer::Special:
-        assert( tokenValue().length() == 1 );
-        assert( tokenValue()[0].toLatin1() );
-        switch ( tokenValue()[0].toLatin1() ) {
+        assert( mTokenSpan.end - mTokenSpan.begin == 1 );
+        switch ( *mTokenSpan.begin ) {
         case ')':
           consumeToken();
           if ( lastWasComma ) {
@@ -462,7 +461,7 @@ namespace KSieve {
     if ( atEnd() ) // a test w/o nested tests
       goto TestEnd;
 
-    if ( token() == Lexer::Special && tokenValue() == "(" ) { // test-list
+    if ( isSpecial( '(' ) ) { // test-list
       if ( !parseTestList() ) {
         assert( error() );
         return false;
@@ -488,7 +487,7 @@ namespace KSieve {
     if ( !obtainToken() || atEnd() )
       return false;
 
-    if ( token() != Lexer::Special || tokenValue() != "{" )
+    if ( !isSpecial( '{' ) )
       return false;
     if ( scriptBuilder() )
       scriptBuilder()->blockStart();
@@ -517,7 +516,7 @@ namespace KSieve {
       return false;
     }
 
-    if ( token() != Lexer::Special || tokenValue() != "}" ) {
+    if ( !isSpecial( '}' ) ) {
       makeError( Error::NonCommandInCommandList );
       return false;
     }
@@ -538,7 +537,7 @@ namespace KSieve {
     if ( !obtainToken() || atEnd() )
       return false;
 
-    if ( token() != Lexer::Special || tokenValue() != "[" )
+    if ( !isSpecial( '[' ) )
       return false;
 
     if ( scriptBuilder() )
@@ -556,8 +555,8 @@ namespace KSieve {
       case Lexer::None:
         break;
       case Lexer::Special:
-        assert( tokenValue().length() == 1 );
-        switch ( tokenValue()[0].toLatin1() ) {
+        assert( mTokenSpan.end - mTokenSpan.begin == 1 );
+        switch ( *mTokenSpan.begin ) {
         case ']':
           consumeToken();
           if ( lastWasComma ) {
@@ -617,7 +616,7 @@ namespace KSieve {
     // number:
     unsigned long result = 0;
     int i = 0;
-    const QByteArray s = tokenValue().toLatin1();
+    const QByteArray s = QByteArray::fromRawData( mTokenSpan.begin, mTokenSpan.end - mTokenSpan.begin );
     for ( const int len = s.length() ; i < len && isdigit( s[i] ) ; ++i ) {
       const unsigned long digitValue = s[i] - '0' ;
       if ( willOverflowULong( result, digitValue ) ) {
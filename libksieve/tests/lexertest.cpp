@@ -311,12 +311,39 @@ static const TestCase testcases[] = {
     { { Lexer::MultiLineString, "foo\n.\nbar" }, { Lexer::None, 0 } },
     Error::None, 0, 0
   },
+  { "Dotstuffed multiline string, several lines (CRLF)", "text:\r\n..foo\r\nbar\r\n...\r\n.\r\n",
+    { { Lexer::MultiLineString, ".foo\nbar\n.." }, { Lexer::None, 0 } },
+    Error::None, 0, 0
+  },
+  { "Multiline string with empty lines (LF)", "text:\n\nfoo\n\n.\n",
+    { { Lexer::MultiLineString, "\nfoo\n" }, { Lexer::None, 0 } },
+    Error::None, 0, 0
+  },
+  { "Empty multiline string", "text:\n.\n",
+    { { Lexer::MultiLineString, "" }, { Lexer::None, 0 } },
+    Error::None, 0, 0
+  },
+  { "Quoted string, escapes across lines (CRLF)", "\"a\\\"b\r\nc\\\\\"",
+    { { Lexer::QuotedString, "a\"b\nc\\" }, { Lexer::None, 0 } },
+    Error::None, 0, 0
+  },
+  { "Quoted string, escaped UTF-8", "\"foo\\\xC3\xB1" "foo\"",
+    { { Lexer::QuotedString, "foo\xC3\xB1" "foo" }, { Lexer::None, 0 } },
+    Error::None, 0, 0
+  },
 
 
   //
   // Errors in single tokens:
   //
 
+  //
+  // multiline strings:
+  //
+  { "Multiline string, only a dot-stuffed line", "text:\n..\n",
+    { { Lexer::MultiLineString, 0 } },
+    Error::PrematureEndOfMultiLine, 0, 0
+  },
   //
   // numbers:
   //
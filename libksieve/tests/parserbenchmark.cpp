@@ -0,0 +1,389 @@
+/*  -*- c++ -*-
+    tests/parserbenchmark.cpp
+
+    This file is part of the testsuite of KSieve,
+    the KDE internet mail/usenet news message filtering library.
+
+    KSieve is free software; you can redistribute it and/or modify it
+    under the terms of the GNU General Public License, version 2, as
+    published by the Free Software Foundation.
+
+    KSieve is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    In addition, as a special exception, the copyright holders give
+    permission to link the code of this program with any edition of
+    the Qt library by Trolltech AS, Norway (or with modified versions
+    of Qt that use the same license as Qt), and distribute linked
+    combinations including the two.  You must obey the GNU General
+    Public License in all respects for all of the code used other than
+    Qt.  If you modify this file, you may extend this exception to
+    your version of the file, but you are not obligated to do so.  If
+    you do not wish to do so, delete this exception statement from
+    your version.
+*/
+#include <ksieve/parser.h>
+#include <ksieve/lexer.h>
+#include <ksieve/error.h>
+#include <ksieve/scriptbuilder.h>
+
+#include <qtest_kde.h>
+
+#include <QByteArray>
+#include <QObject>
+#include <QStack>
+#include <QString>
+#include <QStringList>
+
+#include <memory> // std::auto_ptr
+
+using KSieve::Parser;
+using KSieve::Lexer;
+
+// A script as written by filter or vacation wizards, with about
+// 500 bytes per rule:
+static QByteArray makeScript( int rules, const char * lineBreak ) {
+  QByteArray script = "require [\"fileinto\", \"vacation\"];\n";
+  for ( int i = 0 ; i < rules ; ++i ) {
+    const QByteArray n = QByteArray::number( i );
+    script += "# rule " + n + "\n"
+      "/* generated by the\n"
+      "   filter wizard */\n"
+      "if allof ( header :contains \"Subject\" \"[list-" + n + "]\",\n"
+      "           not exists \"X-Spam-Flag\", size :over 100K ) {\n"
+      "  fileinto \"INBOX.lists." + n + "\";\n"
+      "  stop;\n"
+      "}\n"
+      "elsif anyof ( address :is :domain \"From\" [\"example.org\", \"ex\xC3\xA4mple.net\"],\n"
+      "              header :matches \"X-Tag\" \"a \\\"quoted\\\" \\\\ value*\" ) {\n"
+      "  vacation :days 7 :subject \"Away\" text:\n"
+      "Hello,\n"
+      "..this line starts with a dot\n"
+      "\n"
+      "I am away (rule " + n + ").\n"
+      ".\n"
+      ";\n"
+      "}\n";
+  }
+  if ( qstrcmp( lineBreak, "\n" ) != 0 )
+    script.replace( "\n", lineBreak );
+  return script;
+}
+
+static unsigned long factorForQuantifier( char ch ) {
+  switch ( ch ) {
+  case 'g':
+  case 'G':
+    return 1024*1024*1024;
+  case 'm':
+  case 'M':
+    return 1024*1024;
+  case 'k':
+  case 'K':
+    return 1024;
+  default:
+    return 1;
+  }
+}
+
+// Writes the script back in Sieve syntax and records what the parser
+// reported, so that the results of two parses can be compared.
+class SerializingScriptBuilder : public KSieve::ScriptBuilder {
+public:
+  SerializingScriptBuilder() : mLineFeeds( 0 ), mBlockEnded( false ) {
+    mInList.push( false );
+  }
+
+  QString script() const { return mScript; }
+  QStringList events() const { return mEvents; }
+  bool hasError() const { return !mError.isEmpty(); }
+  QString errorString() const { return mError; }
+
+  void taggedArgument( const QString & tag ) {
+    event( "tag", tag );
+    write( " :" + tag );
+  }
+  void stringArgument( const QString & string, bool multiLine, const QString & ) {
+    event( multiLine ? "multi-line" : "string", string );
+    write( " " );
+    writeString( string, multiLine );
+  }
+  void numberArgument( unsigned long number, char quantifier ) {
+    const QString suffix = quantifier ? QString( QLatin1Char( quantifier ) ) : QString() ;
+    event( "number", QString::number( number ) + suffix );
+    write( ' ' + QString::number( number / factorForQuantifier( quantifier ) ) + suffix );
+  }
+
+  void stringListArgumentStart() {
+    event( "string-list" );
+    write( " [" );
+    mInList.push( true );
+    mFirstInList.push( true );
+  }
+  void stringListEntry( const QString & string, bool multiLine, const QString & ) {
+    event( multiLine ? "multi-line" : "string", string );
+    separate();
+    writeString( string, multiLine );
+  }
+  void stringListArgumentEnd() {
+    event( "/string-list" );
+    write( "]" );
+    mInList.pop();
+    mFirstInList.pop();
+  }
+
+  void commandStart( const QString & identifier ) {
+    event( "command", identifier );
+    write( identifier );
+    mInList.push( false );
+  }
+  void commandEnd() {
+    event( "/command" );
+    if ( !mBlockEnded )
+      write( ";" );
+    mBlockEnded = false;
+    mInList.pop();
+  }
+
+  void testStart( const QString & identifier ) {
+    event( "test", identifier );
+    if ( mInList.top() )
+      separate();
+    else
+      write( " " );
+    write( identifier );
+    mInList.push( false );
+  }
+  void testEnd() {
+    event( "/test" );
+    mInList.pop();
+  }
+
+  void testListStart() {
+    event( "test-list" );
+    write( " (" );
+    mInList.push( true );
+    mFirstInList.push( true );
+  }
+  void testListEnd() {
+    event( "/test-list" );
+    write( ")" );
+    mInList.pop();
+    mFirstInList.pop();
+  }
+
+  void blockStart() {
+    event( "block" );
+    write( " {" );
+  }
+  void blockEnd() {
+    event( "/block" );
+    write( "}" );
+    mBlockEnded = true;
+  }
+
+  void hashComment( const QString & comment ) {
+    event( "hash-comment", comment );
+    write( '#' + comment + '\n' );
+  }
+  void bracketComment( const QString & comment ) {
+    event( "bracket-comment", comment );
+    write( "/*" + comment + "*/" );
+  }
+
+  void lineFeed() {
+    event( "crlf" );
+    // written with the next token, so that it stays behind a
+    // separating comma we don't know about yet:
+    ++mLineFeeds;
+  }
+
+  void error( const KSieve::Error & error ) {
+    mError = error.asString();
+  }
+
+  void finished() {
+    event( "finished" );
+    write( QString() );
+  }
+
+private:
+  void event( const char * name, const QString & value=QString() ) {
+    mEvents.push_back( value.isNull() ? QString::fromLatin1( name ) : QString::fromLatin1( name ) + ": " + value );
+  }
+  void write( const QString & text ) {
+    for ( ; mLineFeeds > 0 ; --mLineFeeds )
+      mScript += '\n';
+    mScript += text;
+  }
+  void separate() {
+    if ( mFirstInList.top() ) {
+      mFirstInList.top() = false;
+      write( QString() );
+    } else {
+      mScript += ',';
+      write( " " );
+    }
+  }
+  void writeString( const QString & string, bool multiLine ) {
+    if ( multiLine ) {
+      write( "text:\n" );
+      Q_FOREACH( const QString & line, string.split( '\n' ) ) {
+        if ( line.startsWith( '.' ) )
+          write( "." );
+        write( line + '\n' );
+      }
+      write( ".\n" );
+    } else {
+      QString escaped = string;
+      escaped.replace( '\\', "\\\\" ).replace( '"', "\\\"" );
+      write( '"' + escaped + '"' );
+    }
+  }
+
+  QString mScript;
+  QStringList mEvents;
+  QString mError;
+  QStack<bool> mInList;
+  QStack<bool> mFirstInList;
+  int mLineFeeds;
+  bool mBlockEnded;
+};
+
+// Only makes sure that every value is converted, like a real
+// consumer would do.
+class CountingScriptBuilder : public KSieve::ScriptBuilder {
+public:
+  CountingScriptBuilder() : characters( 0 ) {}
+
+  void taggedArgument( const QString & tag ) { characters += tag.length(); }
+  void stringArgument( const QString & string, bool, const QString & ) { characters += string.length(); }
+  void numberArgument( unsigned long, char ) {}
+  void stringListArgumentStart() {}
+  void stringListEntry( const QString & string, bool, const QString & ) { characters += string.length(); }
+  void stringListArgumentEnd() {}
+  void commandStart( const QString & identifier ) { characters += identifier.length(); }
+  void commandEnd() {}
+  void testStart( const QString & identifier ) { characters += identifier.length(); }
+  void testEnd() {}
+  void testListStart() {}
+  void testListEnd() {}
+  void blockStart() {}
+  void blockEnd() {}
+  void hashComment( const QString & comment ) { characters += comment.length(); }
+  void bracketComment( const QString & comment ) { characters += comment.length(); }
+  void lineFeed() {}
+  void error( const KSieve::Error & ) {}
+  void finished() {}
+
+  int characters;
+};
+
+static SerializingScriptBuilder * parse( const QByteArray & script ) {
+  SerializingScriptBuilder * const builder = new SerializingScriptBuilder;
+  Parser parser( script.constData(), script.constData() + script.size() );
+  parser.setScriptBuilder( builder );
+  parser.parse();
+  return builder;
+}
+
+class ParserBenchmark : public QObject {
+  Q_OBJECT
+private Q_SLOTS:
+  void testDecoding();
+  void testRoundTrip();
+  void testLineBreaks();
+  void benchmarkLexer();
+  void benchmarkParse();
+  void benchmarkParseWithoutBuilder();
+};
+
+void ParserBenchmark::testDecoding() {
+  const std::auto_ptr<SerializingScriptBuilder> builder( parse( makeScript( 1, "\n" ) ) );
+  QVERIFY2( !builder->hasError(), qPrintable( builder->errorString() ) );
+
+  const QStringList events = builder->events();
+  QVERIFY( events.contains( "hash-comment:  rule 0" ) );
+  QVERIFY( events.contains( "bracket-comment:  generated by the\n   filter wizard " ) );
+  QVERIFY( events.contains( "string: [list-0]" ) );
+  QVERIFY( events.contains( QString::fromUtf8( "string: ex\xC3\xA4mple.net" ) ) );
+  QVERIFY( events.contains( "string: a \"quoted\" \\ value*" ) );
+  QVERIFY( events.contains( "number: 102400K" ) );
+  QVERIFY( events.contains( "multi-line: Hello,\n.this line starts with a dot\n\nI am away (rule 0)." ) );
+}
+
+void ParserBenchmark::testRoundTrip() {
+  const std::auto_ptr<SerializingScriptBuilder> first( parse( makeScript( 50, "\n" ) ) );
+  QVERIFY2( !first->hasError(), qPrintable( first->errorString() ) );
+
+  const std::auto_ptr<SerializingScriptBuilder> second( parse( first->script().toUtf8() ) );
+  QVERIFY2( !second->hasError(), qPrintable( second->errorString() ) );
+
+  QCOMPARE( second->events(), first->events() );
+  QCOMPARE( second->script(), first->script() );
+}
+
+void ParserBenchmark::testLineBreaks() {
+  const std::auto_ptr<SerializingScriptBuilder> lf( parse( makeScript( 50, "\n" ) ) );
+  const std::auto_ptr<SerializingScriptBuilder> crlf( parse( makeScript( 50, "\r\n" ) ) );
+  QVERIFY2( !crlf->hasError(), qPrintable( crlf->errorString() ) );
+  QCOMPARE( crlf->events(), lf->events() );
+
+  // The lexer must report the same values as the parser sees:
+  const QByteArray script = makeScript( 50, "\r\n" );
+  Lexer lexer( script.constData(), script.constData() + script.size(), Lexer::IgnoreLineFeeds );
+  QStringList strings;
+  while ( !lexer.atEnd() ) {
+    QString value;
+    const Lexer::Token token = lexer.nextToken( value );
+    QVERIFY( !lexer.error() );
+    if ( token == Lexer::QuotedString )
+      strings.push_back( "string: " + value );
+    else if ( token == Lexer::MultiLineString )
+      strings.push_back( "multi-line: " + value );
+  }
+  QStringList expected;
+  Q_FOREACH( const QString & event, lf->events() )
+    if ( event.startsWith( "string: " ) || event.startsWith( "multi-line: " ) )
+      expected.push_back( event );
+  QCOMPARE( strings, expected );
+}
+
+void ParserBenchmark::benchmarkLexer() {
+  const QByteArray script = makeScript( 1000, "\n" );
+  QBENCHMARK {
+    Lexer lexer( script.constData(), script.constData() + script.size() );
+    QString value;
+    while ( !lexer.atEnd() )
+      lexer.nextToken( value );
+  }
+}
+
+void ParserBenchmark::benchmarkParse() {
+  const QByteArray script = makeScript( 1000, "\n" );
+  QBENCHMARK {
+    CountingScriptBuilder builder;
+    Parser parser( script.constData(), script.constData() + script.size() );
+    parser.setScriptBuilder( &builder );
+    QVERIFY( parser.parse() );
+  }
+}
+
+void ParserBenchmark::benchmarkParseWithoutBuilder() {
+  // e.g. only checking the syntax:
+  const QByteArray script = makeScript( 1000, "\n" );
+  QBENCHMARK {
+    Parser parser( script.constData(), script.constData() + script.size() );
+    QVERIFY( parser.parse() );
+  }
+}
+
+QTEST_KDEMAIN( ParserBenchmark, NoGUI )
+
+#include "parserbenchmark.moc"
@@ -44,10 +44,14 @@ using KPIM::BroadcastStatus;
 #include <akonadi/kmime/messageparts.h>
 #include <akonadi/itemmovejob.h>
 
-// Look at this number of messages in each slotDoWork call
-#define EXPIREJOB_NRMESSAGES 100
-// And wait this number of milliseconds before calling it again
-#define EXPIREJOB_TIMERINTERVAL 100
+#include <QTimer>
+
+// Look at the dates of this number of messages at once, and move at most
+// this number of messages with one job
+#define EXPIREJOB_NRMESSAGES 500
+// And wait this number of milliseconds before the next batch, so that
+// other clients of the server get their share
+#define EXPIREJOB_TIMERINTERVAL 10
 
 /*
  Testcases for folder expiry:
@@ -65,8 +69,10 @@ using KPIM::BroadcastStatus;
 namespace MailCommon {
 
 ExpireJob::ExpireJob( const Akonadi::Collection& folder, bool immediate )
- : ScheduledJob( folder, immediate ), mCurrentIndex( 0 ),
-   mFolderOpen( false ), mMoveToFolder( 0 )
+ : ScheduledJob( folder, immediate ), mRetryCacheOnly( false ), mCurrentJob( 0 ), mMovingCount( 0 ),
+   mMovedCount( 0 ), mMoveError( KJob::NoError ), mMaxUnreadTime( 0 ),
+   mMaxReadTime( 0 ), mListingDone( false ), mFinished( false ),
+   mFolderOpen( false )
 {
 }
 
@@ -84,7 +90,6 @@ void ExpireJob::execute()
 {
   mMaxUnreadTime = 0;
   mMaxReadTime = 0;
-  mCurrentIndex = 0;
   QSharedPointer<FolderCollection> fd( FolderCollection::forCollection( mSrcFolder ) );
   int unreadDays, readDays;
   fd->daysToExpire( unreadDays, readDays );
@@ -102,6 +107,19 @@ void ExpireJob::execute()
     deleteLater();
     return;
   }
+
+  if ( fd->expireAction() == FolderCollection::ExpireDelete ) {
+    // Expire by deletion, i.e. move to the trash folder
+    mMoveToFolder = Kernel::self()->trashCollectionFolder();
+  } else {
+    mMoveToFolder = Kernel::self()->collectionFromId( fd->expireToFolderId() );
+    if ( !mMoveToFolder.isValid() ) {
+      // nothing can be moved, so don't bother looking at the messages
+      done();
+      return;
+    }
+  }
+
   kDebug() << "ExpireJob: starting to expire in folder" << mSrcFolder.name();
   slotDoWork();
   // do nothing here, we might be deleted!
@@ -109,141 +127,246 @@ void ExpireJob::execute()
 
 void ExpireJob::slotDoWork()
 {
-#ifdef DEBUG_SCHEDULER
-  kDebug() << "ExpireJob: checking messages" << mCurrentIndex << "to" << stopIndex;
-#endif
+  // List the messages with their flags only, the dates are looked at in
+  // batches for the messages whose status allows expiring them at all
   Akonadi::ItemFetchJob *job = new Akonadi::ItemFetchJob( mSrcFolder, this );
-  job->fetchScope().fetchPayloadPart( Akonadi::MessagePart::Header );
-  connect( job, SIGNAL(result(KJob*)), SLOT(itemFetchResult(KJob*)) );
+  connect( job, SIGNAL(itemsReceived(Akonadi::Item::List)), SLOT(slotItemsListed(Akonadi::Item::List)) );
+  connect( job, SIGNAL(result(KJob*)), SLOT(slotListingDone(KJob*)) );
 }
 
-void ExpireJob::itemFetchResult( KJob *job )
+void ExpireJob::slotItemsListed( const Akonadi::Item::List &items )
 {
-  if ( job->error() ) {
-    kWarning() << job->errorString();
-    deleteLater();
+  if ( mFinished )
     return;
-  }
-  foreach ( const Akonadi::Item &item, qobject_cast<Akonadi::ItemFetchJob*>( job )->items() ) {
-    if ( !item.hasPayload<KMime::Message::Ptr>() )
-      continue;
-    const KMime::Message::Ptr mb = item.payload<KMime::Message::Ptr>();
+
+  const bool excludeImportant = SettingsIf->excludeImportantMailFromExpiry();
+
+  foreach ( const Akonadi::Item &item, items ) {
     Akonadi::MessageStatus status;
     status.setStatusFromFlags( item.flags() );
     if ( ( status.isImportant() || status.isToAct() || status.isWatched() )
-      && SettingsIf->excludeImportantMailFromExpiry() )
+      && excludeImportant )
        continue;
 
-    time_t maxTime = status.isRead() ? mMaxReadTime : mMaxUnreadTime;
-
-    if ( !mb->date( false ) )
+    const time_t maxTime = status.isRead() ? mMaxReadTime : mMaxUnreadTime;
+    if ( maxTime == 0 )
       continue;
 
-    if ( mb->date()->dateTime().dateTime().toTime_t() < maxTime ) {
-      mRemovedMsgs.append( item );
-    }
+    mCandidates.append( item.id() );
   }
 
-  done();
+  processNext();
 }
 
-void ExpireJob::done()
+void ExpireJob::slotListingDone( KJob *job )
 {
-  QString str;
-  bool moving = false;
-  QSharedPointer<FolderCollection> fd( FolderCollection::forCollection( mSrcFolder ) );
+  if ( job->error() ) {
+    kWarning() << job->errorString();
+    // don't judge the messages of an incomplete listing
+    mCandidates.clear();
+  }
 
-  if ( !mRemovedMsgs.isEmpty() ) {
-    int count = mRemovedMsgs.count();
-    // The command shouldn't kill us because it opens the folder
-    mCancellable = false;
-    if ( fd->expireAction() ==  FolderCollection::ExpireDelete ) {
-      // Expire by deletion, i.e. move to null target folder
-      kDebug() << "ExpireJob: finished expiring in folder"
-                    << mSrcFolder.name()
-                    << count << "messages to remove.";
-      Akonadi::ItemMoveJob *job = new Akonadi::ItemMoveJob( mRemovedMsgs, Kernel::self()->trashCollectionFolder(), this );
-      connect( job, SIGNAL(result(KJob*)), this, SLOT(slotMessagesMoved(KJob*)) );
-      moving = true;
-      str = i18np( "Removing 1 old message from folder %2...",
-                  "Removing %1 old messages from folder %2...", count,
-              mSrcFolder.name() );
-    } else {
-      // Expire by moving
-      mMoveToFolder = Kernel::self()->collectionFromId( fd->expireToFolderId() );
-      if ( !mMoveToFolder.isValid() ) {
-        str = i18n( "Cannot expire messages from folder %1: destination "
-                    "folder %2 not found",
-                    mSrcFolder.name(), fd->expireToFolderId() );
-        kWarning() << str;
-      } else {
-        kDebug() << "ExpireJob: finished expiring in folder"
-                      << mSrcFolder.name()
-                      << mRemovedMsgs.count() << "messages to move to"
-                      << mMoveToFolder.name();
-        Akonadi::ItemMoveJob *job = new Akonadi::ItemMoveJob( mRemovedMsgs, mMoveToFolder, this );
-        connect( job, SIGNAL(result(KJob*)), this, SLOT(slotMessagesMoved(KJob*)) );
-        moving = true;
-        str = i18np( "Moving 1 old message from folder %2 to folder %3...",
-                     "Moving %1 old messages from folder %2 to folder %3...",
-                     count, mSrcFolder.name(), mMoveToFolder.name() );
+  mListingDone = true;
+  processNext();
+}
+
+void ExpireJob::processNext()
+{
+  if ( mCurrentJob || mFinished )
+    return;
+
+  const bool datesKnown = mListingDone && mCandidates.isEmpty() && mUncachedCandidates.isEmpty() &&
+                          mRetryCandidates.isEmpty();
+
+  if ( mExpiredMessages.count() >= EXPIREJOB_NRMESSAGES ||
+       ( datesKnown && !mExpiredMessages.isEmpty() ) ) {
+    moveExpiredMessages();
+  } else if ( !mRetryCandidates.isEmpty() ) {
+    fetchDates( mRetryCandidates, mRetryCacheOnly, 1 );
+  } else if ( mCandidates.count() >= EXPIREJOB_NRMESSAGES ||
+              ( mListingDone && !mCandidates.isEmpty() ) ) {
+    fetchDates( mCandidates, true, EXPIREJOB_NRMESSAGES );
+  } else if ( mListingDone && !mUncachedCandidates.isEmpty() ) {
+    fetchDates( mUncachedCandidates, false, EXPIREJOB_NRMESSAGES );
+  } else if ( datesKnown ) {
+    done();
+  }
+}
+
+void ExpireJob::fetchDates( QList<Akonadi::Item::Id> &candidates, bool cacheOnly, int maxCount )
+{
+  const int count = qMin( candidates.count(), maxCount );
+
+  mFetchingIds = candidates.mid( 0, count );
+  candidates.erase( candidates.begin(), candidates.begin() + count );
+
+  Akonadi::Item::List items;
+  items.reserve( count );
+  foreach ( const Akonadi::Item::Id id, mFetchingIds )
+    items.append( Akonadi::Item( id ) );
+
+#ifdef DEBUG_SCHEDULER
+  kDebug() << "ExpireJob: checking" << count << "messages, cache only:" << cacheOnly;
+#endif
+
+  // The envelope contains the date and is much smaller than the header,
+  // and usually it is in the cache already
+  Akonadi::ItemFetchJob *job = new Akonadi::ItemFetchJob( items, this );
+  job->fetchScope().fetchPayloadPart( Akonadi::MessagePart::Envelope );
+  job->fetchScope().setCacheOnly( cacheOnly );
+  job->setProperty( "cacheOnly", cacheOnly );
+  connect( job, SIGNAL(result(KJob*)), SLOT(slotDatesFetched(KJob*)) );
+  mCurrentJob = job;
+}
+
+void ExpireJob::slotDatesFetched( KJob *job )
+{
+  mCurrentJob = 0;
+  const bool cacheOnly = job->property( "cacheOnly" ).toBool();
+
+  if ( job->error() ) {
+    kWarning() << job->errorString();
+    // A single message deleted since the listing fails the whole batch,
+    // so look at the others one by one.
+    if ( mFetchingIds.count() > 1 ) {
+      mRetryCandidates = mFetchingIds;
+      mRetryCacheOnly = cacheOnly;
+    }
+  } else {
+    const bool excludeImportant = SettingsIf->excludeImportantMailFromExpiry();
+
+    foreach ( const Akonadi::Item &item, qobject_cast<Akonadi::ItemFetchJob*>( job )->items() ) {
+      if ( !item.hasPayload<KMime::Message::Ptr>() ) {
+        if ( cacheOnly )
+          mUncachedCandidates.append( item.id() );
+        continue;
       }
+
+      // the flags might have changed since the listing
+      Akonadi::MessageStatus status;
+      status.setStatusFromFlags( item.flags() );
+      if ( ( status.isImportant() || status.isToAct() || status.isWatched() )
+        && excludeImportant )
+         continue;
+
+      const time_t maxTime = status.isRead() ? mMaxReadTime : mMaxUnreadTime;
+
+      const KMime::Message::Ptr mb = item.payload<KMime::Message::Ptr>();
+      if ( !mb->date( false ) )
+        continue;
+
+      if ( mb->date()->dateTime().dateTime().toTime_t() < maxTime )
+        mExpiredMessages.append( item.id() );
     }
   }
-  if ( !str.isEmpty() )
-    BroadcastStatus::instance()->setStatusMsg( str );
 
-  KConfigGroup group( KernelIf->config(), fd->configGroupName() );
-  group.writeEntry( "Current", -1 ); // i.e. make it invalid, the serial number will be used
+  QTimer::singleShot( EXPIREJOB_TIMERINTERVAL, this, SLOT(processNext()) );
+}
 
-  if ( !moving )
-    deleteLater();
+void ExpireJob::moveExpiredMessages()
+{
+  mMovingCount = qMin( mExpiredMessages.count(), EXPIREJOB_NRMESSAGES );
+
+  Akonadi::Item::List items;
+  items.reserve( mMovingCount );
+  for ( int i = 0; i < mMovingCount; ++i )
+    items.append( Akonadi::Item( mExpiredMessages.at( i ) ) );
+  mExpiredMessages.erase( mExpiredMessages.begin(), mExpiredMessages.begin() + mMovingCount );
+
+  if ( mMovedCount == 0 ) {
+    QString str;
+    QSharedPointer<FolderCollection> fd( FolderCollection::forCollection( mSrcFolder ) );
+    if ( fd->expireAction() == FolderCollection::ExpireDelete ) {
+      str = i18n( "Removing old messages from folder %1...", mSrcFolder.name() );
+    } else {
+      str = i18n( "Moving old messages from folder %1 to folder %2...",
+                  mSrcFolder.name(), mMoveToFolder.name() );
+    }
+    BroadcastStatus::instance()->setStatusMsg( str );
+  }
+
+  // The command shouldn't kill us because it opens the folder
+  mCancellable = false;
+  Akonadi::ItemMoveJob *job = new Akonadi::ItemMoveJob( items, mMoveToFolder, this );
+  connect( job, SIGNAL(result(KJob*)), this, SLOT(slotMessagesMoved(KJob*)) );
+  mCurrentJob = job;
 }
 
 void ExpireJob::slotMessagesMoved( KJob* job )
 {
   kDebug() << job << job->error();
+  mCurrentJob = 0;
+  mCancellable = true;
+
+  if ( job->error() ) {
+    kWarning() << job->errorString();
+    mMoveError = job->error();
+    done();
+    return;
+  }
+
+  mMovedCount += mMovingCount;
+  QTimer::singleShot( EXPIREJOB_TIMERINTERVAL, this, SLOT(processNext()) );
+}
+
+void ExpireJob::done()
+{
+  mFinished = true;
+
   QString msg;
   QSharedPointer<FolderCollection> fd( FolderCollection::forCollection( mSrcFolder ) );
-  if ( fd ) {
-    int error = job->error();
-    switch (error ) {
-     case KJob::NoError:
+
+  if ( !mMoveToFolder.isValid() ) {
+    msg = i18n( "Cannot expire messages from folder %1: destination "
+                "folder %2 not found",
+                mSrcFolder.name(), fd->expireToFolderId() );
+    kWarning() << msg;
+  } else {
+    switch ( mMoveError ) {
+    case KJob::NoError:
+      kDebug() << "ExpireJob: finished expiring in folder"
+               << mSrcFolder.name() << mMovedCount << "messages moved to"
+               << mMoveToFolder.name();
+      if ( mMovedCount == 0 )
+        break;
       if ( fd->expireAction() == FolderCollection::ExpireDelete ) {
         msg = i18np( "Removed 1 old message from folder %2.",
                      "Removed %1 old messages from folder %2.",
-                     mRemovedMsgs.count(),
-                     mSrcFolder.name() );
-      }
-      else {
+                     mMovedCount, mSrcFolder.name() );
+      } else {
         msg = i18np( "Moved 1 old message from folder %2 to folder %3.",
                      "Moved %1 old messages from folder %2 to folder %3.",
-                     mRemovedMsgs.count(), mSrcFolder.name(), mMoveToFolder.name() );
+                     mMovedCount, mSrcFolder.name(), mMoveToFolder.name() );
       }
       break;
     case Akonadi::Job::UserCanceled:
       if ( fd->expireAction() == FolderCollection::ExpireDelete ) {
         msg = i18n( "Removing old messages from folder %1 was canceled.",
                     mSrcFolder.name() );
-      }
-      else {
+      } else {
         msg = i18n( "Moving old messages from folder %1 to folder %2 was "
                     "canceled.",
                     mSrcFolder.name(), mMoveToFolder.name() );
       }
+      break;
     default: //any other error
       if ( fd->expireAction() == FolderCollection::ExpireDelete ) {
         msg = i18n( "Removing old messages from folder %1 failed.",
                     mSrcFolder.name() );
-      }
-      else {
+      } else {
         msg = i18n( "Moving old messages from folder %1 to folder %2 failed.",
                     mSrcFolder.name(), mMoveToFolder.name() );
       }
       break;
     }
-    BroadcastStatus::instance()->setStatusMsg( msg );
   }
+
+  if ( !msg.isEmpty() )
+    BroadcastStatus::instance()->setStatusMsg( msg );
+
+  KConfigGroup group( KernelIf->config(), fd->configGroupName() );
+  group.writeEntry( "Current", -1 ); // i.e. make it invalid, the serial number will be used
+
   deleteLater();
 }
 
@@ -53,17 +53,37 @@ public:
 
 private slots:
   void slotDoWork();
+  void slotItemsListed( const Akonadi::Item::List &items );
+  void slotListingDone( KJob *job );
+  void slotDatesFetched( KJob *job );
   void slotMessagesMoved( KJob *job );
-  void itemFetchResult( KJob* job );
+  void processNext();
 
 private:
+  void fetchDates( QList<Akonadi::Item::Id> &candidates, bool cacheOnly, int maxCount );
+  void moveExpiredMessages();
   void done();
 
 private:
-  QList<Akonadi::Item> mRemovedMsgs;
-  int mCurrentIndex;
+  // messages whose status allows expiry, their date is not known yet
+  QList<Akonadi::Item::Id> mCandidates;
+  // candidates whose envelope was not in the cache
+  QList<Akonadi::Item::Id> mUncachedCandidates;
+  // the messages of a failed batch, looked at one by one
+  QList<Akonadi::Item::Id> mRetryCandidates;
+  bool mRetryCacheOnly;
+  // the messages whose dates are being fetched
+  QList<Akonadi::Item::Id> mFetchingIds;
+  // messages found to be old enough, to be moved in chunks
+  QList<Akonadi::Item::Id> mExpiredMessages;
+  KJob *mCurrentJob;
+  int mMovingCount;
+  int mMovedCount;
+  int mMoveError;
   int mMaxUnreadTime;
   int mMaxReadTime;
+  bool mListingDone;
+  bool mFinished;
   bool mFolderOpen;
   Akonadi::Collection mMoveToFolder;
 };
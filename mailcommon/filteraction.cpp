@@ -3,7 +3,9 @@
 #include "filteraction.h"
 
 #include "filtermanager.h"
+#include "filterprocesspool_p.h"
 #include "folderrequester.h"
+#include "itemmodificationcollector_p.h"
 #include "mailutil.h"
 #include "mailkernel.h"
 #include "mdnadvicedialog.h"
@@ -16,8 +18,6 @@
 #endif
 
 #include <akonadi/collectioncombobox.h>
-#include <akonadi/itemcopyjob.h>
-#include <akonadi/itemmodifyjob.h>
 #include <akonadi/kmime/messagestatus.h>
 #include <kabc/addressee.h>
 #include <kdebug.h>
@@ -480,7 +480,9 @@ static KMime::Content* findMimeNodeForIndex( KMime::Content* node, int &index )
 
 QString FilterActionWithCommand::substituteCommandLineArgsFor( const KMime::Message::Ptr &aMsg, QList<KTemporaryFile*> &aTempFileList ) const
 {
-  QString result = mParameter;
+  // the one-shot way doesn't need to know whether the command could stay running
+  QString result;
+  FilterProcessPool::parseCommandLine( mParameter, result );
   QList<int> argList;
   QRegExp r( "%[0-9-]+" );
 
@@ -554,6 +556,26 @@ QString FilterActionWithCommand::substituteCommandLineArgsFor( const KMime::Mess
   return result;
 }
 
+// replaces the message with the output of a pipe-through command
+static FilterAction::ReturnCode applyCommandOutput( const KMime::Message::Ptr &aMsg, const QByteArray &msgText )
+{
+  if ( msgText.isEmpty() )
+    return FilterAction::ErrorButGoOn;
+
+  /* If the pipe through alters the message, it could very well
+     happen that it no longer has a X-UID header afterwards. That is
+     unfortunate, as we need to removed the original from the folder
+     using that, and look it up in the message. When the (new) message
+     is uploaded, the header is stripped anyhow. */
+  const QString uid = aMsg->headerByType( "X-UID" ) ? aMsg->headerByType( "X-UID" )->asUnicodeString() : "";
+  aMsg->setContent( msgText );
+
+  KMime::Headers::Generic *header = new KMime::Headers::Generic( "X-UID", aMsg.get(), uid, "utf-8" );
+  aMsg->setHeader( header );
+
+  return FilterAction::GoOn;
+}
+
 FilterAction::ReturnCode FilterActionWithCommand::genericProcess( const Akonadi::Item &item, bool withOutput ) const
 {
   const KMime::Message::Ptr aMsg = item.payload<KMime::Message::Ptr>();
@@ -562,6 +584,22 @@ FilterAction::ReturnCode FilterActionWithCommand::genericProcess( const Akonadi:
   if ( mParameter.isEmpty() )
     return ErrorButGoOn;
 
+  // Commands marked as supporting it can stay running between messages, as
+  // long as their command line has no message parts or header fields in it.
+  static const QRegExp perMessageArgs( "%([0-9-]|\\{)" );
+  QString command;
+  if ( FilterProcessPool::parseCommandLine( mParameter, command ) && !command.contains( perMessageArgs ) ) {
+    int exitCode = 0;
+    QByteArray output;
+    const FilterProcessPool::Result result = FilterProcessPool::self()->process( command, aMsg->encodedContent(),
+                                                                                   exitCode, output );
+    if ( result == FilterProcessPool::Failed || ( result == FilterProcessPool::Processed && exitCode != 0 ) )
+      return ErrorButGoOn;
+
+    if ( result == FilterProcessPool::Processed )
+      return withOutput ? applyCommandOutput( aMsg, output ) : GoOn;
+  }
+
   // KProcess doesn't support a QProcess::launch() equivalent, so
   // we must use a temp file :-(
   KTemporaryFile * inFile = new KTemporaryFile;
@@ -602,37 +640,17 @@ FilterAction::ReturnCode FilterActionWithCommand::genericProcess( const Akonadi:
   shProc.setShellCommand( commandLine );
   int result = shProc.execute();
 
-  if ( result != 0 ) {
-    qDeleteAll( atmList );
-    atmList.clear();
+  qDeleteAll( atmList );
+  atmList.clear();
+
+  if ( result != 0 )
     return ErrorButGoOn;
-  }
 
   if ( withOutput ) {
     // read altered message:
-    const QByteArray msgText = shProc.readAllStandardOutput();
-
-    if ( !msgText.isEmpty() ) {
-    /* If the pipe through alters the message, it could very well
-       happen that it no longer has a X-UID header afterwards. That is
-       unfortunate, as we need to removed the original from the folder
-       using that, and look it up in the message. When the (new) message
-       is uploaded, the header is stripped anyhow. */
-      const QString uid = aMsg->headerByType( "X-UID" ) ? aMsg->headerByType( "X-UID" )->asUnicodeString() : "";
-      aMsg->setContent( msgText );
-
-      KMime::Headers::Generic *header = new KMime::Headers::Generic( "X-UID", aMsg.get(), uid, "utf-8" );
-      aMsg->setHeader( header );
-    } else {
-      qDeleteAll( atmList );
-      atmList.clear();
-      return ErrorButGoOn;
-    }
+    return applyCommandOutput( aMsg, shProc.readAllStandardOutput() );
   }
 
-  qDeleteAll( atmList );
-  atmList.clear();
-
   return GoOn;
 }
 
@@ -718,7 +736,7 @@ FilterAction::ReturnCode FilterActionTransport::process( const Akonadi::Item &it
   msg->setHeader( header );
   msg->assemble();
 
-  new Akonadi::ItemModifyJob( item, FilterIf->filterManager() );
+  FilterIf->filterManager()->modifications()->setPayloadModified( item );
 
   return GoOn;
 }
@@ -754,7 +772,7 @@ FilterAction::ReturnCode FilterActionReplyTo::process( const Akonadi::Item &item
   msg->setHeader( header );
   msg->assemble();
 
-  new Akonadi::ItemModifyJob( item, FilterIf->filterManager() );
+  FilterIf->filterManager()->modifications()->setPayloadModified( item );
 
   return GoOn;
 }
@@ -795,7 +813,7 @@ FilterAction::ReturnCode FilterActionIdentity::process( const Akonadi::Item &ite
   msg->setHeader( header );
   msg->assemble();
 
-  new Akonadi::ItemModifyJob( item, FilterIf->filterManager() );
+  FilterIf->filterManager()->modifications()->setPayloadModified( item );
 
   return GoOn;
 }
@@ -902,8 +920,10 @@ FilterAction::ReturnCode FilterActionSetStatus::process( const Akonadi::Item &it
   if ( index < 1 )
     return ErrorButGoOn;
 
+  ItemModificationCollector *modifications = FilterIf->filterManager()->modifications();
+
   Akonadi::MessageStatus status;
-  status.setStatusFromFlags( item.flags() );
+  status.setStatusFromFlags( modifications->flags( item ) );
 
   const Akonadi::MessageStatus newStatus = stati[ index - 1 ];
   if ( newStatus == Akonadi::MessageStatus::statusUnread() )
@@ -911,10 +931,7 @@ FilterAction::ReturnCode FilterActionSetStatus::process( const Akonadi::Item &it
   else
     status.set( newStatus );
 
-  Akonadi::Item newItem( item.id() );
-  newItem.setRevision( item.revision() );
-  newItem.setFlags( status.statusFlags() );
-  new Akonadi::ItemModifyJob( newItem, FilterIf->filterManager() ); // TODO handle error
+  modifications->setFlags( item, status.statusFlags() );
 
   return GoOn;
 }
@@ -1114,8 +1131,7 @@ FilterAction::ReturnCode FilterActionFakeDisposition::process( const Akonadi::It
   if ( index == 1 ) { // ignore
     if ( item.hasAttribute<MessageCore::MDNStateAttribute>() ) {
       item.attribute<MessageCore::MDNStateAttribute>()->setMDNState( MessageCore::MDNStateAttribute::MDNIgnore );
-      Akonadi::ItemModifyJob* modifyJob = new Akonadi::ItemModifyJob( item );
-      modifyJob->setIgnorePayload( true );
+      FilterIf->filterManager()->modifications()->setAttributesModified( item );
     }
   } else // send
     sendMDN( item, mdns[ index - 2 ] ); // skip first two entries: "" and "ignore"
@@ -1214,7 +1230,7 @@ FilterAction::ReturnCode FilterActionRemoveHeader::process( const Akonadi::Item
 
   msg->assemble();
 
-  new Akonadi::ItemModifyJob( item, FilterIf->filterManager() );
+  FilterIf->filterManager()->modifications()->setPayloadModified( item );
 
   return GoOn;
 }
@@ -1294,7 +1310,7 @@ FilterAction::ReturnCode FilterActionAddHeader::process( const Akonadi::Item &it
   msg->setHeader( header );
   msg->assemble();
 
-  new Akonadi::ItemModifyJob( item, FilterIf->filterManager() );
+  FilterIf->filterManager()->modifications()->setPayloadModified( item );
 
   return GoOn;
 }
@@ -1473,7 +1489,7 @@ FilterAction::ReturnCode FilterActionRewriteHeader::process( const Akonadi::Item
   header->fromUnicodeString( newValue, "utf-8" );
   msg->assemble();
 
-  new Akonadi::ItemModifyJob( item, FilterIf->filterManager() );
+  FilterIf->filterManager()->modifications()->setPayloadModified( item );
 
   return GoOn;
 }
@@ -1678,8 +1694,8 @@ FilterActionCopy::FilterActionCopy( QObject *parent )
 
 FilterAction::ReturnCode FilterActionCopy::process( const Akonadi::Item &item ) const
 {
-  // copy the message 1:1
-  new Akonadi::ItemCopyJob( item, mFolder, FilterIf->filterManager() ); // TODO handle error
+  // copy the message 1:1, with what the actions before changed
+  FilterIf->filterManager()->modifications()->copy( item, mFolder );
 
   return GoOn;
 }
@@ -1978,7 +1994,11 @@ FilterActionExtFilter::FilterActionExtFilter( QObject *parent )
 
 FilterAction::ReturnCode FilterActionExtFilter::process( const Akonadi::Item &item ) const
 {
-  return FilterActionWithCommand::genericProcess( item, true ); // use output
+  const ReturnCode result = FilterActionWithCommand::genericProcess( item, true ); // use output
+  if ( result == GoOn )
+    FilterIf->filterManager()->modifications()->setPayloadModified( item );
+
+  return result;
 }
 
 
@@ -5,6 +5,7 @@
 
 #include "filterimporterexporter.h"
 #include "filterlog.h"
+#include "itemmodificationcollector_p.h"
 #include "mailfilter.h"
 #include "mailkernel.h"
 #include "messageproperty.h"
@@ -40,7 +41,8 @@ class FilterManager::Private
   public:
     Private( FilterManager *qq )
       : q( qq ),
-        mRequiresBody( false )
+        mRequiresBody( false ),
+        mBatchModifications( false )
     {
     }
 
@@ -64,7 +66,9 @@ class FilterManager::Private
     FilterManager *q;
     QList<MailFilter *> mFilters;
     Akonadi::ChangeRecorder *mChangeRecorder;
+    ItemModificationCollector *mModifications;
     bool mRequiresBody;
+    bool mBatchModifications;
 };
 
 void FilterManager::Private::tryToFilterInboxOnStartup()
@@ -134,6 +138,9 @@ void FilterManager::Private::slotItemsFetchedForFilter( const Akonadi::Item::Lis
     kWarning() << "Got invalid progress item for slotItemsFetchedFromFilter! Something went wrong...";
   }
 
+  // store the changes to the items not moved away all at once
+  mBatchModifications = true;
+
   foreach ( const Akonadi::Item &item, items ) {
     if ( progressItem ) {
       progressItem->incCompletedItems();
@@ -156,6 +163,9 @@ void FilterManager::Private::slotItemsFetchedForFilter( const Akonadi::Item::Lis
       CommonKernel->emergencyExit( i18n( "Unable to process messages: " ) + QString::fromLocal8Bit( strerror( errno ) ) );
     }
   }
+
+  mBatchModifications = false;
+  mModifications->flush();
 }
 
 void FilterManager::Private::itemAdded( const Akonadi::Item &item, const Akonadi::Collection &collection )
@@ -285,6 +295,8 @@ FilterManager::FilterManager( QObject *parent )
 {
   d->tryToMonitorCollection();
 
+  d->mModifications = new ItemModificationCollector( this );
+
   d->mChangeRecorder = new Akonadi::ChangeRecorder( this );
   d->mChangeRecorder->setMimeTypeMonitored( KMime::Message::mimeType() );
   d->mChangeRecorder->setChangeRecordingEnabled( false );
@@ -350,14 +362,20 @@ int FilterManager::process( const Akonadi::Item &item, const MailFilter *filter
     }
 
     if ( filter->execActions( item, stopIt ) == MailFilter::CriticalError ) {
+      // store what the actions did so far, it must not wait for other items
+      d->mModifications->flush( item );
       return 2;
     }
 
     const Akonadi::Collection targetFolder = MessageProperty::filterFolder( item );
     d->endFiltering( item );
     if ( targetFolder.isValid() ) {
+      // the changes have to be stored before the item is moved away
+      d->mModifications->flush( item );
       new Akonadi::ItemMoveJob( item, targetFolder, this ); // TODO: check result
       result = 0;
+    } else if ( !d->mBatchModifications ) {
+      d->mModifications->flush();
     }
   } else {
     result = 1;
@@ -397,6 +415,8 @@ int FilterManager::process( const Akonadi::Item &item, FilterSet set,
       if ( d->isMatching( item, *it ) ) {
         // execute actions:
         if ( (*it)->execActions( item, stopIt ) == MailFilter::CriticalError ) {
+          // store what the actions did so far, it must not wait for other items
+          d->mModifications->flush( item );
           return 2;
         }
       }
@@ -408,10 +428,15 @@ int FilterManager::process( const Akonadi::Item &item, FilterSet set,
   d->endFiltering( item );
 
   if ( targetFolder.isValid() ) {
+    // the changes have to be stored before the item is moved away
+    d->mModifications->flush( item );
     new Akonadi::ItemMoveJob( item, targetFolder, this ); // TODO: check result
     return 0;
   }
 
+  if ( !d->mBatchModifications )
+    d->mModifications->flush();
+
   emit itemNotMoved( item );
   return 1;
 }
@@ -517,6 +542,11 @@ void FilterManager::dump() const
 }
 #endif
 
+ItemModificationCollector *FilterManager::modifications() const
+{
+  return d->mModifications;
+}
+
 void FilterManager::applyFilters( const QList<Akonadi::Item> &selectedMessages )
 {
   const int msgCountToFilter = selectedMessages.size();
@@ -27,6 +27,7 @@
 
 namespace MailCommon {
 
+class ItemModificationCollector;
 class MailFilter;
 
 class MAILCOMMON_EXPORT FilterManager: public QObject
@@ -147,6 +148,12 @@ class MAILCOMMON_EXPORT FilterManager: public QObject
      */
     int process( const Akonadi::Item &item, const MailFilter *filter );
 
+    /**
+     * Returns the collector the filter actions hand their changes to items to.
+     * The changes are stored when the filtering of a message is finished.
+     */
+    ItemModificationCollector *modifications() const;
+
     /**
      * Applies the filters on the given @p messages.
      */
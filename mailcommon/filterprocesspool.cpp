@@ -0,0 +1,281 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+#include "filterprocesspool_p.h"
+
+#include <kdebug.h>
+#include <kglobal.h>
+#include <kprocess.h>
+
+#include <QtCore/QTime>
+
+using namespace MailCommon;
+
+K_GLOBAL_STATIC( FilterProcessPool, sPool )
+
+static const char GREETING[] = "KMAIL-FILTER 1\n";
+
+static const char MARKER[] = "%persistent ";
+
+// how long a command may take to greet before it is run the one-shot way
+static const int GREETING_TIMEOUT = 2000;
+
+// how long a command may take for a message before it is considered hanging
+static const int RESPONSE_TIMEOUT = 60000;
+
+// reads one line, without its line break
+static bool readLine( KProcess *process, QByteArray &line, int timeout )
+{
+  QTime timer;
+  timer.start();
+
+  while ( !process->canReadLine() ) {
+    const int remaining = timeout - timer.elapsed();
+    if ( remaining <= 0 || !process->waitForReadyRead( remaining ) )
+      return false;
+  }
+
+  line = process->readLine();
+  line.chop( 1 );
+  return true;
+}
+
+static bool readBytes( KProcess *process, int count, QByteArray &data, int timeout )
+{
+  QTime timer;
+  timer.start();
+
+  while ( process->bytesAvailable() < count ) {
+    const int remaining = timeout - timer.elapsed();
+    if ( remaining <= 0 || !process->waitForReadyRead( remaining ) )
+      return false;
+  }
+
+  data = process->read( count );
+  return true;
+}
+
+FilterProcessPool::FilterProcessPool()
+  : mMaximumHelpers( 8 ), mIdleTimeout( 300 )
+{
+  mIdleTimer.setInterval( 60000 );
+  connect( &mIdleTimer, SIGNAL( timeout() ), SLOT( expireIdleHelpers() ) );
+}
+
+FilterProcessPool::~FilterProcessPool()
+{
+  clear();
+}
+
+FilterProcessPool *FilterProcessPool::self()
+{
+  return sPool;
+}
+
+bool FilterProcessPool::parseCommandLine( const QString &commandLine, QString &command )
+{
+  const QString marker = QLatin1String( MARKER );
+  if ( !commandLine.startsWith( marker ) ) {
+    command = commandLine;
+    return false;
+  }
+
+  command = commandLine.mid( marker.length() );
+  return true;
+}
+
+FilterProcessPool::Result FilterProcessPool::process( const QString &command, const QByteArray &message,
+                                                      int &exitCode, QByteArray &output )
+{
+  if ( mOneShotCommands.contains( command ) )
+    return NotSupported;
+
+  QHash<QString, Helper>::iterator it = mHelpers.find( command );
+  if ( it != mHelpers.end() && it->process->state() != QProcess::Running ) {
+    kDebug() << "Filter command" << command << "has exited, restarting it";
+    stopHelper( it->process );
+    mHelpers.erase( it );
+    it = mHelpers.end();
+  }
+
+  if ( it == mHelpers.end() ) {
+    bool greeted = false;
+    KProcess *process = startHelper( command, greeted );
+    if ( !process )
+      return Failed;
+
+    if ( !greeted ) {
+      // Whatever it writes was meant for the protocol, so it must not be
+      // given the message. The caller runs it again without the protocol.
+      kDebug() << "Filter command" << command << "did not greet, running it the one-shot way";
+      stopHelper( process );
+      mOneShotCommands.insert( command );
+      return NotSupported;
+    }
+
+    if ( mHelpers.count() >= mMaximumHelpers )
+      removeLeastRecentlyUsed();
+
+    Helper helper;
+    helper.process = process;
+    it = mHelpers.insert( command, helper );
+
+    if ( !mIdleTimer.isActive() )
+      mIdleTimer.start();
+  }
+
+  it->lastUsed = QDateTime::currentDateTime();
+
+  const Result result = exchange( it->process, message, exitCode, output );
+  if ( result == Failed ) {
+    kWarning() << "Filter command" << command << "did not answer as expected, stopping it";
+    stopHelper( it->process );
+    mHelpers.erase( it );
+  }
+
+  return result;
+}
+
+KProcess *FilterProcessPool::startHelper( const QString &command, bool &greeted ) const
+{
+  KProcess *process = new KProcess;
+  // stderr goes where ours goes, nobody would read it otherwise
+  process->setOutputChannelMode( KProcess::OnlyStdoutChannel );
+  process->setEnv( QLatin1String( "KMAIL_FILTER_PROTOCOL" ), QLatin1String( "1" ) );
+  // The parentheses force the creation of a subshell, as for one-shot runs
+  process->setShellCommand( QLatin1Char( '(' ) + command + QLatin1Char( ')' ) );
+  process->start();
+
+  if ( !process->waitForStarted() ) {
+    kWarning() << "Could not start filter command" << command;
+    delete process;
+    return 0;
+  }
+
+  // Commands not knowing about the protocol wait for their input without
+  // writing anything, or write something else, or exit right away
+  QByteArray line;
+  greeted = readLine( process, line, GREETING_TIMEOUT ) && line + '\n' == GREETING;
+
+  return process;
+}
+
+FilterProcessPool::Result FilterProcessPool::exchange( KProcess *process, const QByteArray &message,
+                                                       int &exitCode, QByteArray &output ) const
+{
+  process->write( QByteArray::number( message.size() ) + '\n' );
+  process->write( message );
+
+  QByteArray header;
+  if ( !readLine( process, header, RESPONSE_TIMEOUT ) )
+    return Failed;
+
+  const QList<QByteArray> fields = header.split( ' ' );
+  if ( fields.count() != 2 )
+    return Failed;
+
+  bool codeOk = false;
+  bool sizeOk = false;
+  exitCode = fields.at( 0 ).toInt( &codeOk );
+  const int size = fields.at( 1 ).toInt( &sizeOk );
+  if ( !codeOk || !sizeOk || size < 0 )
+    return Failed;
+
+  if ( !readBytes( process, size, output, RESPONSE_TIMEOUT ) )
+    return Failed;
+
+  // a command restarted behind our back greets instead of filtering
+  if ( output.startsWith( GREETING ) )
+    return Failed;
+
+  return Processed;
+}
+
+void FilterProcessPool::removeLeastRecentlyUsed()
+{
+  QHash<QString, Helper>::iterator oldest = mHelpers.end();
+  for ( QHash<QString, Helper>::iterator it = mHelpers.begin(); it != mHelpers.end(); ++it ) {
+    if ( oldest == mHelpers.end() || it->lastUsed < oldest->lastUsed )
+      oldest = it;
+  }
+
+  if ( oldest != mHelpers.end() ) {
+    stopHelper( oldest->process );
+    mHelpers.erase( oldest );
+  }
+}
+
+void FilterProcessPool::stopHelper( KProcess *process )
+{
+  // closing stdin asks it to exit
+  process->closeWriteChannel();
+  if ( !process->waitForFinished( 1000 ) ) {
+    process->kill();
+    process->waitForFinished( 1000 );
+  }
+
+  delete process;
+}
+
+void FilterProcessPool::setMaximumHelpers( int count )
+{
+  mMaximumHelpers = qMax( 1, count );
+  while ( mHelpers.count() > mMaximumHelpers )
+    removeLeastRecentlyUsed();
+}
+
+void FilterProcessPool::setIdleTimeout( int seconds )
+{
+  mIdleTimeout = qMax( 1, seconds );
+}
+
+int FilterProcessPool::helperCount() const
+{
+  return mHelpers.count();
+}
+
+void FilterProcessPool::clear()
+{
+  foreach ( const Helper &helper, mHelpers )
+    stopHelper( helper.process );
+
+  mHelpers.clear();
+  mOneShotCommands.clear();
+  mIdleTimer.stop();
+}
+
+void FilterProcessPool::expireIdleHelpers()
+{
+  const QDateTime oldestAllowed = QDateTime::currentDateTime().addSecs( -mIdleTimeout );
+
+  QHash<QString, Helper>::iterator it = mHelpers.begin();
+  while ( it != mHelpers.end() ) {
+    if ( it->lastUsed < oldestAllowed ) {
+      stopHelper( it->process );
+      it = mHelpers.erase( it );
+    } else {
+      ++it;
+    }
+  }
+
+  if ( mHelpers.isEmpty() )
+    mIdleTimer.stop();
+}
+
+#include "filterprocesspool_p.moc"
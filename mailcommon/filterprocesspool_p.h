@@ -0,0 +1,139 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+#ifndef MAILCOMMON_FILTERPROCESSPOOL_P_H
+#define MAILCOMMON_FILTERPROCESSPOOL_P_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+
+class KProcess;
+
+namespace MailCommon {
+
+/**
+ * @internal
+ *
+ * Keeps the commands of "pipe through" and "execute command" filter actions
+ * running between messages, so that filtering a message does not cost
+ * starting a shell and the command every time.
+ *
+ * This only works with commands written for it, which the user marks by
+ * putting "%persistent " in front of the command line. They are started with
+ * KMAIL_FILTER_PROTOCOL=1 in their environment and take part in the
+ * following protocol on stdin and stdout:
+ *
+ * @li Right after starting, the command writes the line "KMAIL-FILTER 1".
+ * @li For every message, it reads a line with the size of the message in
+ *     bytes followed by the message itself.
+ * @li It answers with a line holding its result code (0 for success, like the
+ *     exit code of a one-shot run) and the size of its output, separated by
+ *     a space, followed by the output itself.
+ * @li When its stdin is closed, it exits.
+ *
+ * Commands that don't greet within a moment are stopped before they are
+ * given a message. The caller then runs them the one-shot way, without
+ * the protocol, and the pool doesn't try them again.
+ */
+class FilterProcessPool : public QObject
+{
+  Q_OBJECT
+
+  public:
+    enum Result
+    {
+      Processed,   ///< The command processed the message.
+      Failed,      ///< The command could not be run or broke the protocol.
+      NotSupported ///< The command has to be run the one-shot way.
+    };
+
+    FilterProcessPool();
+    ~FilterProcessPool();
+
+    /**
+     * Returns the pool used by the filter actions.
+     */
+    static FilterProcessPool *self();
+
+    /**
+     * Returns whether @p commandLine is marked as supporting the protocol,
+     * and sets @p command to the command line without the marker.
+     */
+    static bool parseCommandLine( const QString &commandLine, QString &command );
+
+    /**
+     * Passes @p message through the shell command @p command.
+     *
+     * @param exitCode The result code of the command.
+     * @param output What the command wrote to stdout.
+     */
+    Result process( const QString &command, const QByteArray &message, int &exitCode, QByteArray &output );
+
+    /**
+     * Sets the number of commands that are kept running at most (default 8).
+     * The one used the longest time ago is stopped to make room.
+     */
+    void setMaximumHelpers( int count );
+
+    /**
+     * Sets the time in seconds after which an unused command is stopped (default 300).
+     */
+    void setIdleTimeout( int seconds );
+
+    /**
+     * Returns the number of commands currently kept running.
+     */
+    int helperCount() const;
+
+    /**
+     * Stops all running commands and forgets which commands don't
+     * support the protocol.
+     */
+    void clear();
+
+  private Q_SLOTS:
+    void expireIdleHelpers();
+
+  private:
+    struct Helper
+    {
+      KProcess *process;
+      QDateTime lastUsed;
+    };
+
+    KProcess *startHelper( const QString &command, bool &greeted ) const;
+    Result exchange( KProcess *process, const QByteArray &message, int &exitCode, QByteArray &output ) const;
+    void removeLeastRecentlyUsed();
+    static void stopHelper( KProcess *process );
+
+    QHash<QString, Helper> mHelpers;
+    QSet<QString> mOneShotCommands;
+    QTimer mIdleTimer;
+    int mMaximumHelpers;
+    int mIdleTimeout;
+};
+
+}
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "foldertreeview.h"
 #include "mailkernel.h"
+#include "unreadcollectionindex_p.h"
 
 #include <KDebug>
 #include <KLocale>
@@ -88,6 +89,15 @@ void FolderTreeView::init( bool showUnreadCount )
 
 }
 
+void FolderTreeView::setModel( QAbstractItemModel *model )
+{
+  Akonadi::EntityTreeView::setModel( model );
+
+  // follow the unread folders from now on, instead of finding them on the first search
+  if ( model )
+    UnreadCollectionIndex::forModel( model );
+}
+
 void FolderTreeView::showStatisticAnimation( bool anim )
 {
   mCollectionStatisticsDelegate->setProgressAnimationEnabled( anim );
@@ -381,27 +391,17 @@ void FolderTreeView::selectNextUnreadFolder( bool confirm )
 {
   // find next unread collection starting from current position
   if ( !trySelectNextUnreadFolder( currentIndex(), MailCommon::Util::ForwardSearch, confirm ) ) {
-    // if there is none, jump to the last collection and try again
-    trySelectNextUnreadFolder( model()->index( 0, 0 ), MailCommon::Util::ForwardSearch, confirm );
+    // if there is none, jump to the top and try again
+    trySelectNextUnreadFolder( QModelIndex(), MailCommon::Util::ForwardSearch, confirm );
   }
 }
 
-// helper method to find last item in the model tree
-static QModelIndex lastChildOf( QAbstractItemModel *model, const QModelIndex &current )
-{
-  if ( model->rowCount( current ) == 0 )
-    return current;
-
-  return lastChildOf( model, model->index( model->rowCount( current ) - 1, 0, current ) );
-}
-
 void FolderTreeView::selectPrevUnreadFolder( bool confirm )
 {
   // find next unread collection starting from current position
   if ( !trySelectNextUnreadFolder( currentIndex(), MailCommon::Util::BackwardSearch, confirm ) ) {
-    // if there is none, jump to top and try again
-    const QModelIndex index = lastChildOf( model(), QModelIndex() );
-    trySelectNextUnreadFolder( index, MailCommon::Util::BackwardSearch, confirm );
+    // if there is none, jump to the bottom and try again
+    trySelectNextUnreadFolder( QModelIndex(), MailCommon::Util::BackwardSearch, confirm );
   }
 }
 
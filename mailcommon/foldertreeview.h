@@ -50,6 +50,8 @@ public:
 
   virtual ~FolderTreeView();
 
+  virtual void setModel( QAbstractItemModel *model );
+
   void selectNextUnreadFolder( bool confirm = false);
   void selectPrevUnreadFolder( bool confirm = false);
 
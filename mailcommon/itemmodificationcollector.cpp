@@ -0,0 +1,214 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+#include "itemmodificationcollector_p.h"
+
+#include <akonadi/itemcopyjob.h>
+#include <akonadi/itemmodifyjob.h>
+#include <kdebug.h>
+
+#include <QtCore/QMap>
+
+using namespace MailCommon;
+
+// keeps the commands sent to the server at a sensible size
+static const int MAXIMUM_ITEMS_PER_JOB = 500;
+
+static QByteArray joinedFlags( const Akonadi::Item::Flags &flags )
+{
+  QList<QByteArray> list = flags.toList();
+  qSort( list );
+
+  QByteArray result;
+  foreach ( const QByteArray &flag, list )
+    result += flag + ' ';
+
+  return result;
+}
+
+ItemModificationCollector::ItemModificationCollector( QObject *parent )
+  : QObject( parent ), mJobCount( 0 )
+{
+}
+
+ItemModificationCollector::~ItemModificationCollector()
+{
+  if ( !mModifications.isEmpty() )
+    kWarning() << "Dropping the changes to" << mModifications.count() << "items";
+}
+
+ItemModificationCollector::Modification &ItemModificationCollector::modification( const Akonadi::Item &item )
+{
+  QHash<Akonadi::Item::Id, Modification>::iterator it = mModifications.find( item.id() );
+  if ( it == mModifications.end() ) {
+    Modification modification;
+    modification.item = item;
+    modification.flags = item.flags();
+    modification.payloadModified = false;
+    modification.attributesModified = false;
+    modification.flagsModified = false;
+
+    mOrder.append( item.id() );
+    it = mModifications.insert( item.id(), modification );
+  }
+
+  return *it;
+}
+
+void ItemModificationCollector::setPayloadModified( const Akonadi::Item &item )
+{
+  Modification &modification = this->modification( item );
+  modification.item = item;
+  modification.payloadModified = true;
+}
+
+void ItemModificationCollector::setAttributesModified( const Akonadi::Item &item )
+{
+  Modification &modification = this->modification( item );
+  modification.item = item;
+  modification.attributesModified = true;
+}
+
+void ItemModificationCollector::setFlags( const Akonadi::Item &item, const Akonadi::Item::Flags &flags )
+{
+  Modification &modification = this->modification( item );
+  modification.flags = flags;
+  modification.flagsModified = true;
+}
+
+Akonadi::Item::Flags ItemModificationCollector::flags( const Akonadi::Item &item ) const
+{
+  const QHash<Akonadi::Item::Id, Modification>::const_iterator it = mModifications.constFind( item.id() );
+  if ( it == mModifications.constEnd() )
+    return item.flags();
+
+  return it->flags;
+}
+
+bool ItemModificationCollector::isEmpty() const
+{
+  return mModifications.isEmpty();
+}
+
+int ItemModificationCollector::jobCount() const
+{
+  return mJobCount;
+}
+
+void ItemModificationCollector::flush( const Akonadi::Item &item )
+{
+  const QHash<Akonadi::Item::Id, Modification>::iterator it = mModifications.find( item.id() );
+  if ( it == mModifications.end() )
+    return;
+
+  const Modification modification = *it;
+  mModifications.erase( it );
+  mOrder.removeOne( item.id() );
+
+  store( modification );
+}
+
+void ItemModificationCollector::flush()
+{
+  // items with the same flags added and removed can share a job
+  QMap<QByteArray, Akonadi::Item::List> flagChanges;
+
+  foreach ( const Akonadi::Item::Id id, mOrder ) {
+    const Modification &modification = mModifications.value( id );
+    if ( modification.payloadModified || modification.attributesModified ) {
+      store( modification );
+      continue;
+    }
+
+    const Akonadi::Item::Flags originalFlags = modification.item.flags();
+    const Akonadi::Item::Flags added = Akonadi::Item::Flags( modification.flags ).subtract( originalFlags );
+    const Akonadi::Item::Flags removed = Akonadi::Item::Flags( originalFlags ).subtract( modification.flags );
+    if ( added.isEmpty() && removed.isEmpty() )
+      continue;
+
+    Akonadi::Item item( id );
+    item.setRevision( modification.item.revision() );
+    foreach ( const QByteArray &flag, added )
+      item.setFlag( flag );
+    foreach ( const QByteArray &flag, removed )
+      item.clearFlag( flag );
+
+    flagChanges[ joinedFlags( added ) + '\n' + joinedFlags( removed ) ].append( item );
+  }
+
+  mModifications.clear();
+  mOrder.clear();
+
+  foreach ( const Akonadi::Item::List &items, flagChanges ) {
+    for ( int i = 0; i < items.count(); i += MAXIMUM_ITEMS_PER_JOB ) {
+      modifyFlags( items.mid( i, MAXIMUM_ITEMS_PER_JOB ) );
+      ++mJobCount;
+    }
+  }
+}
+
+void ItemModificationCollector::copy( const Akonadi::Item &item, const Akonadi::Collection &collection )
+{
+  // the jobs of a session run in order, so the copy sees the changes
+  flush( item );
+  copyItem( item, collection );
+}
+
+void ItemModificationCollector::store( const Modification &modification )
+{
+  Akonadi::Item item = modification.item;
+  if ( modification.flagsModified )
+    item.setFlags( modification.flags );
+
+  if ( modification.payloadModified || modification.attributesModified ) {
+    modifyItem( item, !modification.payloadModified );
+    ++mJobCount;
+  } else if ( modification.flagsModified && modification.flags != modification.item.flags() ) {
+    // flags only: don't send the payload along
+    modifyItem( item, true );
+    ++mJobCount;
+  }
+}
+
+void ItemModificationCollector::modifyItem( const Akonadi::Item &item, bool ignorePayload )
+{
+  Akonadi::ItemModifyJob *job = new Akonadi::ItemModifyJob( item, parent() );
+  job->setIgnorePayload( ignorePayload );
+  connect( job, SIGNAL( result( KJob* ) ), SLOT( slotResult( KJob* ) ) );
+}
+
+void ItemModificationCollector::modifyFlags( const Akonadi::Item::List &items )
+{
+  Akonadi::ItemModifyJob *job = new Akonadi::ItemModifyJob( items, parent() );
+  job->setIgnorePayload( true );
+  connect( job, SIGNAL( result( KJob* ) ), SLOT( slotResult( KJob* ) ) );
+}
+
+void ItemModificationCollector::copyItem( const Akonadi::Item &item, const Akonadi::Collection &collection )
+{
+  new Akonadi::ItemCopyJob( item, collection, parent() ); // TODO handle error
+}
+
+void ItemModificationCollector::slotResult( KJob *job )
+{
+  if ( job->error() )
+    kWarning() << "Could not store the changes of the filter actions:" << job->errorString();
+}
+
+#include "itemmodificationcollector_p.moc"
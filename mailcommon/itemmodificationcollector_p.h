@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+#ifndef MAILCOMMON_ITEMMODIFICATIONCOLLECTOR_P_H
+#define MAILCOMMON_ITEMMODIFICATIONCOLLECTOR_P_H
+
+#include <akonadi/collection.h>
+#include <akonadi/item.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+
+class KJob;
+
+namespace MailCommon {
+
+/**
+ * @internal
+ *
+ * Collects the changes the filter actions make to items, so that they are
+ * stored with as few jobs as possible: all changes to one item go into one
+ * modify job, and items whose flags are all that changed are stored together,
+ * one job for all items with the same flags added and removed.
+ *
+ * The filter manager flushes the changes to an item before it moves the
+ * item, and all remaining changes at the end of a filter run. Filter actions
+ * copying an item do so through copy(), which flushes its changes first.
+ */
+class ItemModificationCollector : public QObject
+{
+  Q_OBJECT
+
+  public:
+    /**
+     * Creates a new collector. The jobs it starts are children of @p parent,
+     * changes not flushed before the collector is deleted are lost.
+     */
+    explicit ItemModificationCollector( QObject *parent = 0 );
+    ~ItemModificationCollector();
+
+    /**
+     * Remembers that the payload of @p item (and maybe its attributes) has
+     * been changed in place.
+     */
+    void setPayloadModified( const Akonadi::Item &item );
+
+    /**
+     * Remembers that the attributes of @p item have been changed in place.
+     */
+    void setAttributesModified( const Akonadi::Item &item );
+
+    /**
+     * Remembers that the flags of @p item are to be replaced with @p flags.
+     */
+    void setFlags( const Akonadi::Item &item, const Akonadi::Item::Flags &flags );
+
+    /**
+     * Returns the flags of @p item including the changes not flushed yet.
+     */
+    Akonadi::Item::Flags flags( const Akonadi::Item &item ) const;
+
+    /**
+     * Returns whether there are changes not flushed yet.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Stores the changes to @p item.
+     */
+    void flush( const Akonadi::Item &item );
+
+    /**
+     * Stores all changes.
+     */
+    void flush();
+
+    /**
+     * Copies @p item into @p collection, after storing the changes to it,
+     * so that the copy has them.
+     */
+    void copy( const Akonadi::Item &item, const Akonadi::Collection &collection );
+
+    /**
+     * Returns the number of modify jobs started so far.
+     */
+    int jobCount() const;
+
+  protected:
+    /**
+     * Stores @p item, its payload only if @p ignorePayload is @c false.
+     */
+    virtual void modifyItem( const Akonadi::Item &item, bool ignorePayload );
+
+    /**
+     * Stores the flags added to and removed from @p items.
+     */
+    virtual void modifyFlags( const Akonadi::Item::List &items );
+
+    /**
+     * Copies @p item into @p collection.
+     */
+    virtual void copyItem( const Akonadi::Item &item, const Akonadi::Collection &collection );
+
+  private Q_SLOTS:
+    void slotResult( KJob *job );
+
+  private:
+    struct Modification
+    {
+      Akonadi::Item item;
+      Akonadi::Item::Flags flags;
+      bool payloadModified;
+      bool attributesModified;
+      bool flagsModified;
+    };
+
+    Modification &modification( const Akonadi::Item &item );
+    void store( const Modification &modification );
+
+    QHash<Akonadi::Item::Id, Modification> mModifications;
+    QList<Akonadi::Item::Id> mOrder;
+    int mJobCount;
+};
+
+}
+
+#endif
@@ -30,6 +30,9 @@
 #include "jobscheduler.h"
 #include <kdebug.h>
 
+#include <QDateTime>
+#include <QtAlgorithms>
+
 namespace MailCommon {
 
 ScheduledTask::ScheduledTask( const Akonadi::Collection& folder, bool immediate )
@@ -41,11 +44,20 @@ ScheduledTask::~ScheduledTask()
 {
 }
 
+// Background tasks wait this long after being registered with an idle scheduler
+#ifdef DEBUG_SCHEDULER
+static const int s_startDelay = 10000; // 10 seconds
+#else
+static const int s_startDelay = 1 * 60000; // 1 minute
+#endif
+
 JobScheduler::JobScheduler( QObject* parent )
-  : QObject( parent ), mTimer( this ),
-    mPendingImmediateTasks( 0 ),
-    mCurrentTask( 0 ), mCurrentJob( 0 )
+  : QObject( parent ), mNextSequence( 0 ), mTimer( this ),
+    mPaused( false ), mStartingJobs( false ),
+    mMaximumRunningJobs( 4 ), mMaximumRunningJobsPerResource( 1 ),
+    mBackgroundShare( 25 ), mNextBackgroundStart( 0 )
 {
+  mTimer.setSingleShot( true );
   connect( &mTimer, SIGNAL( timeout() ), SLOT( slotRunNextJob() ) );
   // No need to start the internal timer yet, we wait for a task to be scheduled
 }
@@ -53,195 +65,268 @@ JobScheduler::JobScheduler( QObject* parent )
 
 JobScheduler::~JobScheduler()
 {
-  qDeleteAll( mTaskList );
+  foreach ( const Task &task, mTaskList )
+    delete task.task;
   mTaskList.clear();
-  delete mCurrentTask;
-  mCurrentTask = 0;
-  delete mCurrentJob;
+
+  const QMap<FolderJob*, RunningTask> runningTasks = mRunningTasks;
+  mRunningTasks.clear();
+  foreach ( const RunningTask &running, runningTasks ) {
+    disconnect( running.job, 0, this, 0 );
+    delete running.job;
+    delete running.task;
+  }
 }
 
 void JobScheduler::registerTask( ScheduledTask* task )
 {
-  bool immediate = task->isImmediate();
-  int typeId = task->taskTypeId();
+  Task entry;
+  entry.task = task;
+  entry.immediate = task->isImmediate();
+  entry.priority = task->priority();
+  entry.sequence = mNextSequence++;
+
+  const int typeId = task->taskTypeId();
   if ( typeId ) {
     const Akonadi::Collection folder = task->folder();
-    // Search for an identical task already scheduled
-    for( TaskList::Iterator it = mTaskList.begin(); it != mTaskList.end(); ++it ) {
-      if ( (*it)->taskTypeId() == typeId && (*it)->folder() == folder ) {
+    // Search for an identical task already scheduled, only one of them is kept
+    for ( int i = 0; i < mTaskList.count(); ++i ) {
+      const Task other = mTaskList.at( i );
+      if ( other.task->taskTypeId() == typeId && other.task->folder() == folder ) {
 #ifdef DEBUG_SCHEDULER
-        kDebug() << "JobScheduler: already having task type" << typeId << "for folder" << folder->label();
+        kDebug() << "JobScheduler: already having task type" << typeId << "for folder" << folder.name();
 #endif
         delete task;
-        if ( !mCurrentTask && immediate ) {
-          ScheduledTask* task = *it;
-          removeTask( it );
-          runTaskNow( task );
-        }
-        return;
+        entry.task = other.task;
+        entry.immediate = entry.immediate || other.immediate;
+        entry.priority = qMax( entry.priority, other.priority );
+        entry.sequence = other.sequence;
+        mTaskList.removeAt( i );
+        break;
       }
     }
     // Note that scheduling an identical task as the one currently running is allowed.
   }
-  if ( !mCurrentTask && immediate )
-    runTaskNow( task );
-  else {
+
+  // Let a burst of background tasks, e.g. at startup, wait a bit
+  if ( !entry.immediate && mTaskList.isEmpty() && mRunningTasks.isEmpty() )
+    mNextBackgroundStart = qMax( mNextBackgroundStart, currentTime() + s_startDelay );
+
 #ifdef DEBUG_SCHEDULER
-    kDebug() << "JobScheduler: adding task" << task << "(type" << task->taskTypeId()
-                  << ") for folder" << task->folder() << task->folder().name();
+  kDebug() << "JobScheduler: adding task" << entry.task << "(type" << entry.task->taskTypeId()
+           << ") for folder" << entry.task->folder() << entry.task->folder().name();
 #endif
-    mTaskList.append( task );
-    if ( immediate )
-      ++mPendingImmediateTasks;
-    if ( !mCurrentTask && !mTimer.isActive() )
-      restartTimer();
-  }
+  enqueue( entry );
+  slotRunNextJob();
 }
 
-void JobScheduler::removeTask( TaskList::Iterator& it )
+bool JobScheduler::runsBefore( const Task &left, const Task &right )
 {
-  if ( (*it)->isImmediate() )
-    --mPendingImmediateTasks;
-  mTaskList.erase( it );
+  if ( left.immediate != right.immediate )
+    return left.immediate;
+  if ( left.priority != right.priority )
+    return left.priority > right.priority;
+  return left.sequence < right.sequence;
+}
+
+void JobScheduler::enqueue( const Task &task )
+{
+  TaskList::Iterator it = qUpperBound( mTaskList.begin(), mTaskList.end(), task, runsBefore );
+  mTaskList.insert( it, task );
 }
 
 void JobScheduler::notifyOpeningFolder( const Akonadi::Collection& folder )
 {
-  if ( mCurrentTask && mCurrentTask->folder() == folder ) {
-    if ( mCurrentJob->isOpeningFolder() ) { // set when starting a job for this folder
+  foreach ( const RunningTask &running, mRunningTasks ) {
+    if ( running.task->folder() != folder )
+      continue;
+
+    if ( running.job->isOpeningFolder() ) { // set when starting a job for this folder
 #ifdef DEBUG_SCHEDULER
       kDebug() << "JobScheduler: got the opening-notification for" << folder.name() << "as expected.";
 #endif
     } else {
       // Jobs scheduled from here should always be cancellable.
-      // One exception though, is when ExpireJob does its final KMMoveCommand.
+      // One exception though, is when ExpireJob moves the messages.
       // Then that command shouldn't kill its own parent job just because it opens a folder...
-      if ( mCurrentJob->isCancellable() )
-        interruptCurrentTask();
+      if ( running.job->isCancellable() )
+        interruptTask( running.job );
     }
   }
 }
 
-void JobScheduler::interruptCurrentTask()
+void JobScheduler::setMaximumRunningJobs( int count )
 {
-  Q_ASSERT( mCurrentTask );
+  mMaximumRunningJobs = qMax( 1, count );
+  slotRunNextJob();
+}
+
+void JobScheduler::setMaximumRunningJobsPerResource( int count )
+{
+  mMaximumRunningJobsPerResource = qMax( 1, count );
+  slotRunNextJob();
+}
+
+void JobScheduler::setBackgroundShare( int percent )
+{
+  mBackgroundShare = qBound( 1, percent, 100 );
+}
+
+qint64 JobScheduler::currentTime() const
+{
+  const QDateTime now = QDateTime::currentDateTime().toUTC();
+  return static_cast<qint64>( now.toTime_t() ) * 1000 + now.time().msec();
+}
+
+void JobScheduler::interruptTask( FolderJob *job )
+{
+  const RunningTask running = mRunningTasks.take( job );
 #ifdef DEBUG_SCHEDULER
-  kDebug() << "JobScheduler: interrupting job" << mCurrentJob << "for folder" << mCurrentTask->folder()->label();
+  kDebug() << "JobScheduler: interrupting job" << job << "for folder" << running.task->folder().name();
 #endif
+  job->kill(); // This deletes the job, slotJobFinished() ignores it then
+  // Leave the folder alone for a while before running background tasks again
+  mNextBackgroundStart = qMax( mNextBackgroundStart, currentTime() + s_startDelay );
   // File it again. This will either delete it or put it in mTaskList.
-  registerTask( mCurrentTask );
-  mCurrentTask = 0;
-  mCurrentJob->kill(); // This deletes the job and calls slotJobFinished!
+  registerTask( running.task );
+}
+
+int JobScheduler::runningJobs( const QString &resource ) const
+{
+  int count = 0;
+  foreach ( const RunningTask &running, mRunningTasks ) {
+    if ( running.task->folder().resource() == resource )
+      ++count;
+  }
+  return count;
+}
+
+bool JobScheduler::hasBackgroundTasks() const
+{
+  // immediate tasks are sorted first
+  return !mTaskList.isEmpty() && !mTaskList.last().immediate;
 }
 
 void JobScheduler::slotRunNextJob()
 {
-  while ( !mCurrentJob ) {
+  // a job finishing right when it is started calls us again, the loop
+  // below takes care of that
+  if ( mStartingJobs )
+    return;
+
+  mStartingJobs = true;
+  mTimer.stop();
+
+  bool started = true;
+  while ( started && mRunningTasks.count() < mMaximumRunningJobs ) {
 #ifdef DEBUG_SCHEDULER
     kDebug() << "JobScheduler: slotRunNextJob";
 #endif
-    Q_ASSERT( mCurrentTask == 0 );
-    ScheduledTask* task = 0;
-    // Find a task suitable for being run
-    for( TaskList::Iterator it = mTaskList.begin(); it != mTaskList.end(); ++it ) {
+    started = false;
+    const bool backgroundAllowed = !mPaused && currentTime() >= mNextBackgroundStart;
+
+    // Find the first task suitable for being run
+    for ( int i = 0; i < mTaskList.count(); ++i ) {
+      const Task task = mTaskList.at( i );
+      if ( !task.immediate && !backgroundAllowed )
+        break; // only background tasks follow
+
       // Remove if folder died
-      const Akonadi::Collection folder = (*it)->folder();
+      const Akonadi::Collection folder = task.task->folder();
       if ( !folder.isValid() ) {
 #ifdef DEBUG_SCHEDULER
-        kDebug() << "  folder for task" << (*it) << "was deleted";
+        kDebug() << "  folder for task" << task.task << "was deleted";
 #endif
-        removeTask( it );
-        if ( !mTaskList.isEmpty() )
-          slotRunNextJob(); // to avoid the mess with invalid iterators :)
-        else
-          mTimer.stop();
-        return;
+        mTaskList.removeAt( i );
+        delete task.task;
+        started = true;
+        break;
       }
+
+      if ( runningJobs( folder.resource() ) >= mMaximumRunningJobsPerResource )
+        continue;
+
 #ifdef DEBUG_SCHEDULER
-      kDebug() << "  looking at folder" << folder.name();
+      kDebug() << "  running task for folder" << folder.name();
 #endif
-      task = *it;
-      removeTask( it );
+      mTaskList.removeAt( i );
+      runTaskNow( task );
+      started = true;
       break;
     }
+  }
 
-    if ( !task ) // found nothing to run, i.e. folder was opened
-      return; // Timer keeps running, i.e. try again in 1 minute
+  mStartingJobs = false;
 
-    runTaskNow( task );
-  } // If nothing to do for that task, loop and find another one to run
+  // Otherwise a finishing job will call us again
+  const qint64 now = currentTime();
+  if ( !mPaused && hasBackgroundTasks() && mNextBackgroundStart > now )
+    mTimer.start( static_cast<int>( qMin<qint64>( mNextBackgroundStart - now, INT_MAX ) ) );
 }
 
-void JobScheduler::restartTimer()
+void JobScheduler::runTaskNow( const Task &task )
 {
-  if ( mPendingImmediateTasks > 0 )
-    slotRunNextJob();
-  else
-  {
+  ScheduledJob *job = task.task->run();
 #ifdef DEBUG_SCHEDULER
-    mTimer.start( 10000 ); // 10 seconds
-#else
-    mTimer.start( 1 * 60000 ); // 1 minute
+  kDebug() << "JobScheduler: task" << task.task
+           << "(type" << task.task->taskTypeId() << ")"
+           << "for folder" << task.task->folder().name()
+           << "returned job" << job
+           << ( job ? job->metaObject()->className() : 0 );
 #endif
+  if ( !job ) { // nothing to do, e.g. folder deleted
+    delete task.task;
+    return;
   }
+
+  RunningTask running;
+  running.task = task.task;
+  running.job = job;
+  running.immediate = task.immediate;
+  running.startTime = currentTime();
+  mRunningTasks.insert( job, running );
+
+  connect( job, SIGNAL( result( FolderJob* ) ), this, SLOT( slotJobFinished( FolderJob* ) ) );
+  job->start();
 }
 
-void JobScheduler::runTaskNow( ScheduledTask* task )
+void JobScheduler::slotJobFinished( FolderJob *job )
 {
-  Q_ASSERT( mCurrentTask == 0 );
-  if ( mCurrentTask ) {
-    interruptCurrentTask();
-  }
-  mCurrentTask = task;
-  mTimer.stop();
-  mCurrentJob = mCurrentTask->run();
+  // Do we need to test for job->error()? What do we do then?
 #ifdef DEBUG_SCHEDULER
-  kDebug() << "JobScheduler: task" << mCurrentTask
-                << "(type" << mCurrentTask->taskTypeId() << ")"
-                << "for folder" << mCurrentTask->folder()->label()
-                << "returned job" << mCurrentJob
-                << ( mCurrentJob?mCurrentJob->className():0 );
+  kDebug() << "JobScheduler: slotJobFinished";
 #endif
-  if ( !mCurrentJob ) { // nothing to do, e.g. folder deleted
-    delete mCurrentTask;
-    mCurrentTask = 0;
-    if ( !mTaskList.isEmpty() )
-      restartTimer();
+  if ( !mRunningTasks.contains( job ) ) // interrupted
     return;
+
+  const RunningTask running = mRunningTasks.take( job );
+  delete running.task;
+
+  // Background jobs pay for their run time with time the scheduler stays idle
+  if ( !running.immediate ) {
+    const qint64 now = currentTime();
+    const qint64 idleTime = ( now - running.startTime ) * ( 100 - mBackgroundShare ) / mBackgroundShare;
+    mNextBackgroundStart = qMax( mNextBackgroundStart, now + idleTime );
   }
-  // Register the job in the folder. This makes it autodeleted if the folder is deleted.
-#if 0
-  mCurrentTask->folder()->storage()->addJob( mCurrentJob );
-#endif
-  connect( mCurrentJob, SIGNAL( finished() ), this, SLOT( slotJobFinished() ) );
-  mCurrentJob->start();
-}
 
-void JobScheduler::slotJobFinished()
-{
-  // Do we need to test for mCurrentJob->error()? What do we do then?
-#ifdef DEBUG_SCHEDULER
-  kDebug() << "JobScheduler: slotJobFinished";
-#endif
-  delete mCurrentTask;
-  mCurrentTask = 0;
-  mCurrentJob = 0;
-  if ( !mTaskList.isEmpty() )
-    restartTimer();
+  slotRunNextJob();
 }
 
 // D-Bus call to pause any background jobs
 void JobScheduler::pause()
 {
-  mPendingImmediateTasks = 0;
-  if ( mCurrentJob && mCurrentJob->isCancellable() )
-    interruptCurrentTask();
+  mPaused = true;
+  foreach ( const RunningTask &running, mRunningTasks ) {
+    if ( !running.immediate && running.job->isCancellable() )
+      interruptTask( running.job );
+  }
   mTimer.stop();
 }
 
 void JobScheduler::resume()
 {
-  restartTimer();
+  mPaused = false;
+  slotRunNextJob();
 }
 
 ////
@@ -31,6 +31,7 @@
 
 #include "mailcommon_export.h"
 
+#include <QMap>
 #include <QObject>
 
 #include <QTimer>
@@ -79,6 +80,10 @@ public:
 
   bool isImmediate() const { return mImmediate; }
 
+  /// The priority of this task; among the tasks waiting to be run, those with
+  /// a higher priority run first. Immediate tasks run before all others.
+  virtual int priority() const { return 0; }
+
 private:
   Akonadi::Collection mCurrentFolder;
   bool mImmediate;
@@ -87,10 +92,16 @@ private:
 /**
  * The unique JobScheduler instance (owned by kmkernel) implements "background processing"
  * of folder operations (like expiration and compaction). Tasks (things to be done)
- * are registered with the JobScheduler, and it will execute them one at a time,
- * separated with a 1-minute timer. The jobs themselves should use timers to avoid
- * using too much CPU for too long. Tasks for opened folders are not executed until
- * the folder is closed.
+ * are registered with the JobScheduler, which keeps them ordered by priority and
+ * runs several of them at the same time, but only a limited number per resource.
+ * Only one task of a type is kept per folder.
+ *
+ * Background tasks are only started after a delay, and only as long as they
+ * keep the scheduler busy for no more than a share of the time: after a job
+ * has run for some time, the next one waits proportionally long. Immediate
+ * tasks are not subject to that. The jobs themselves should use timers to
+ * avoid using too much CPU for too long. Tasks for opened folders are not
+ * executed until the folder is closed.
  */
 class MAILCOMMON_EXPORT JobScheduler : public QObject
 {
@@ -107,32 +118,69 @@ public:
   /// Interrupt any running job for this folder and re-schedule it for later
   void notifyOpeningFolder( const Akonadi::Collection& folder );
 
+  /// Set the number of jobs that may run at the same time (default 4)
+  void setMaximumRunningJobs( int count );
+
+  /// Set the number of jobs that may run at the same time for the folders
+  /// of one resource (default 1)
+  void setMaximumRunningJobsPerResource( int count );
+
+  /// Set the share of the time, in percent, background jobs may keep the
+  /// scheduler busy (default 25)
+  void setBackgroundShare( int percent );
+
   // D-Bus calls, called from KMKernel
   void pause();
   void resume();
 
+protected:
+  /// The current time in milliseconds, used to budget the background jobs
+  virtual qint64 currentTime() const;
+
 private slots:
-  /// Called by a timer to run the next job
+  /// Called by a timer to run the next jobs
   void slotRunNextJob();
 
-  /// Called when the current job terminates
-  void slotJobFinished();
+  /// Called when a running job terminates
+  void slotJobFinished( FolderJob *job );
 
 private:
-  void restartTimer();
-  void interruptCurrentTask();
-  void runTaskNow( ScheduledTask* task );
-  typedef QList<ScheduledTask *> TaskList;
-  void removeTask( TaskList::Iterator& it );
+  struct Task {
+    ScheduledTask *task;
+    bool immediate;
+    int priority;
+    qint64 sequence;
+  };
+  typedef QList<Task> TaskList;
+
+  struct RunningTask {
+    ScheduledTask *task;
+    ScheduledJob *job;
+    bool immediate;
+    qint64 startTime;
+  };
+
+  static bool runsBefore( const Task &left, const Task &right );
+  void enqueue( const Task &task );
+  void interruptTask( FolderJob *job );
+  void runTaskNow( const Task &task );
+  int runningJobs( const QString &resource ) const;
+  bool hasBackgroundTasks() const;
+
 private:
-  TaskList mTaskList; // FIFO of tasks to be run
+  TaskList mTaskList; // tasks to be run, in the order they will be run
+  qint64 mNextSequence;
 
   QTimer mTimer;
-  int mPendingImmediateTasks;
-
-  /// Information about the currently running job, if any
-  ScheduledTask* mCurrentTask;
-  ScheduledJob* mCurrentJob;
+  bool mPaused;
+  bool mStartingJobs;
+  int mMaximumRunningJobs;
+  int mMaximumRunningJobsPerResource;
+  int mBackgroundShare;
+  qint64 mNextBackgroundStart; // background jobs are not started before this time
+
+  /// The currently running jobs
+  QMap<FolderJob*, RunningTask> mRunningTasks;
 };
 
 /**
@@ -101,7 +101,9 @@ namespace Util {
      * Returns the index of the next unread collection following a given index.
      *
      * @param model The item model to search in.
-     * @param current The index of the collection where the search will start.
+     * @param current The index of the collection where the search will start. An invalid
+     *                index starts the search at the top of the model, or at its bottom when
+     *                searching backward.
      * @param direction The direction of search.
      * @param ignoreCollectionCallback A callback method to ignore certain collections by returning @c true.
      */
@@ -0,0 +1,65 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+// A pipe-through filter that adds a header to every message. It speaks the
+// protocol of the filter process pool, unless started with --one-shot.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+static const char HEADER[] = "X-Dummy-Filter: passed\n";
+
+static int runOnce()
+{
+  fputs( HEADER, stdout );
+
+  char buffer[4096];
+  size_t count;
+  while ( ( count = fread( buffer, 1, sizeof( buffer ), stdin ) ) > 0 )
+    fwrite( buffer, 1, count, stdout );
+
+  return 0;
+}
+
+int main( int argc, char **argv )
+{
+  if ( ( argc > 1 && strcmp( argv[1], "--one-shot" ) == 0 ) || !getenv( "KMAIL_FILTER_PROTOCOL" ) )
+    return runOnce();
+
+  fputs( "KMAIL-FILTER 1\n", stdout );
+  fflush( stdout );
+
+  char line[32];
+  while ( fgets( line, sizeof( line ), stdin ) ) {
+    const size_t size = strtoul( line, 0, 10 );
+    std::string message( size, '\0' );
+    if ( size > 0 && fread( &message[0], 1, size, stdin ) != size )
+      return 1;
+
+    printf( "0 %lu\n", static_cast<unsigned long>( strlen( HEADER ) + size ) );
+    fputs( HEADER, stdout );
+    fwrite( message.data(), 1, size, stdout );
+    fflush( stdout );
+  }
+
+  return 0;
+}
@@ -0,0 +1,249 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+#include "expirejob.h"
+#include "foldercollection.h"
+#include "mailinterfaces.h"
+#include "mailkernel.h"
+
+#include <akonadi/collectioncreatejob.h>
+#include <akonadi/item.h>
+#include <akonadi/itemcreatejob.h>
+#include <akonadi/itemdeletejob.h>
+#include <akonadi/itemfetchjob.h>
+#include <akonadi/kmime/messageflags.h>
+#include <akonadi/kmime/specialmailcollections.h>
+#include <akonadi/kmime/specialmailcollectionsrequestjob.h>
+#include <akonadi/qtest_akonadi.h>
+#include <akonadi/transactionsequence.h>
+#include <kdatetime.h>
+#include <kglobal.h>
+#include <kmime/kmime_message.h>
+#include <kpimidentities/identitymanager.h>
+
+#include <QtCore/QEventLoop>
+#include <QtCore/QObject>
+
+using namespace MailCommon;
+
+// half of the messages are old enough to be expired
+static const int MESSAGE_COUNT = 10000;
+
+/**
+ * The parts of a mail kernel the expire job uses.
+ */
+class TestKernel : public IKernel, public ISettings
+{
+  public:
+    TestKernel()
+      : mIdentityManager( true )
+    {
+    }
+
+    Akonadi::EntityMimeTypeFilterModel *collectionModel() const { return 0; }
+    KPIMIdentities::IdentityManager *identityManager() { return &mIdentityManager; }
+    KSharedConfig::Ptr config() { return KGlobal::config(); }
+    void syncConfig() {}
+    JobScheduler* jobScheduler() const { return 0; }
+    Akonadi::ChangeRecorder *folderCollectionMonitor() const { return 0; }
+    void updateSystemTray() {}
+    MessageSender *msgSender() { return 0; }
+
+    bool showPopupAfterDnD() { return false; }
+    bool excludeImportantMailFromExpiry() { return true; }
+    qreal closeToQuotaThreshold() { return 80; }
+    Akonadi::Collection::Id lastSelectedFolder() { return -1; }
+    void setLastSelectedFolder( const Akonadi::Collection::Id& ) {}
+    QStringList customTemplates() { return QStringList(); }
+
+  private:
+    KPIMIdentities::IdentityManager mIdentityManager;
+};
+
+class ExpireJobBenchmark : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void initTestCase();
+    void benchmarkExpire();
+    void testVanishedMessage();
+
+  public Q_SLOTS:
+    void deleteVanishingMessage();
+
+  private:
+    int itemCount( const Akonadi::Collection &collection );
+    bool createMessages( const Akonadi::Collection &collection, int count, int oldEvery );
+
+    TestKernel mKernel;
+    Akonadi::Collection mTrash;
+    Akonadi::Collection mArchive;
+    Akonadi::Item mVanishing;
+};
+
+QTEST_AKONADIMAIN( ExpireJobBenchmark, NoGUI )
+
+void ExpireJobBenchmark::initTestCase()
+{
+  CommonKernel->registerKernelIf( &mKernel );
+  CommonKernel->registerSettingsIf( &mKernel );
+
+  Akonadi::SpecialMailCollectionsRequestJob *requestJob = new Akonadi::SpecialMailCollectionsRequestJob( this );
+  requestJob->requestDefaultCollection( Akonadi::SpecialMailCollections::Trash );
+  AKVERIFYEXEC( requestJob );
+  mTrash = requestJob->collection();
+  QVERIFY( mTrash.isValid() );
+
+  Akonadi::Collection archive;
+  archive.setParentCollection( mTrash.parentCollection() );
+  archive.setName( QLatin1String( "archive" ) );
+  archive.setContentMimeTypes( QStringList() << KMime::Message::mimeType() );
+  Akonadi::CollectionCreateJob *createJob = new Akonadi::CollectionCreateJob( archive );
+  AKVERIFYEXEC( createJob );
+  mArchive = createJob->collection();
+
+  QVERIFY( createMessages( mArchive, MESSAGE_COUNT, 2 ) );
+  QCOMPARE( itemCount( mArchive ), MESSAGE_COUNT );
+
+  QSharedPointer<FolderCollection> fd = FolderCollection::forCollection( mArchive );
+  fd->setAutoExpire( true );
+  fd->setReadExpireAge( 30 );
+  fd->setReadExpireUnits( FolderCollection::ExpireDays );
+  fd->setUnreadExpireAge( 30 );
+  fd->setUnreadExpireUnits( FolderCollection::ExpireDays );
+  fd->setExpireAction( FolderCollection::ExpireDelete );
+  fd->writeConfig();
+}
+
+// every oldEvery-th message is old enough to be expired
+bool ExpireJobBenchmark::createMessages( const Akonadi::Collection &collection, int count, int oldEvery )
+{
+  Akonadi::TransactionSequence *transaction = 0;
+  for ( int i = 0; i < count; ++i ) {
+    if ( !transaction )
+      transaction = new Akonadi::TransactionSequence();
+
+    const QByteArray date = ( i % oldEvery == oldEvery - 1 ) ? "Mon, 02 May 2005 10:00:00 +0200" : KDateTime::currentUtcDateTime().toString( KDateTime::RFCDate ).toLatin1();
+    KMime::Message::Ptr message( new KMime::Message );
+    message->setContent( "From: sender" + QByteArray::number( i ) + "@example.org\r\n"
+                         "To: archive@example.org\r\n"
+                         "Subject: Message " + QByteArray::number( i ) + "\r\n"
+                         "Date: " + date + "\r\n"
+                         "\r\n"
+                         "This message is part of the expiry benchmark.\r\n" );
+    message->parse();
+
+    Akonadi::Item item;
+    item.setMimeType( KMime::Message::mimeType() );
+    item.setPayload<KMime::Message::Ptr>( message );
+    item.setFlag( Akonadi::MessageFlags::Seen );
+    new Akonadi::ItemCreateJob( item, collection, transaction );
+
+    if ( i % 500 == 499 || i == count - 1 ) {
+      transaction->commit();
+      if ( !transaction->exec() )
+        return false;
+      transaction = 0;
+    }
+  }
+
+  return true;
+}
+
+int ExpireJobBenchmark::itemCount( const Akonadi::Collection &collection )
+{
+  Akonadi::ItemFetchJob *job = new Akonadi::ItemFetchJob( collection );
+  if ( !job->exec() )
+    return -1;
+
+  return job->items().count();
+}
+
+void ExpireJobBenchmark::benchmarkExpire()
+{
+  QBENCHMARK_ONCE {
+    ExpireJob *job = new ExpireJob( mArchive, true );
+
+    QEventLoop loop;
+    connect( job, SIGNAL(finished()), &loop, SLOT(quit()) );
+    job->start();
+    loop.exec();
+  }
+
+  QCOMPARE( itemCount( mArchive ), MESSAGE_COUNT / 2 );
+  QCOMPARE( itemCount( mTrash ), MESSAGE_COUNT / 2 );
+}
+
+void ExpireJobBenchmark::deleteVanishingMessage()
+{
+  if ( !mVanishing.isValid() )
+    return;
+
+  // queued in the session of the expire job, so it is deleted after the
+  // listing and before the dates are fetched
+  new Akonadi::ItemDeleteJob( mVanishing );
+  mVanishing = Akonadi::Item();
+}
+
+void ExpireJobBenchmark::testVanishedMessage()
+{
+  Akonadi::Collection folder;
+  folder.setParentCollection( mTrash.parentCollection() );
+  folder.setName( QLatin1String( "vanishing" ) );
+  folder.setContentMimeTypes( QStringList() << KMime::Message::mimeType() );
+  Akonadi::CollectionCreateJob *createJob = new Akonadi::CollectionCreateJob( folder );
+  AKVERIFYEXEC( createJob );
+  folder = createJob->collection();
+
+  QVERIFY( createMessages( folder, 20, 1 ) );
+  Akonadi::ItemFetchJob *fetchJob = new Akonadi::ItemFetchJob( folder );
+  AKVERIFYEXEC( fetchJob );
+  QCOMPARE( fetchJob->items().count(), 20 );
+  mVanishing = fetchJob->items().at( 7 );
+
+  QSharedPointer<FolderCollection> fd = FolderCollection::forCollection( folder );
+  fd->setAutoExpire( true );
+  fd->setReadExpireAge( 30 );
+  fd->setReadExpireUnits( FolderCollection::ExpireDays );
+  fd->setUnreadExpireAge( 30 );
+  fd->setUnreadExpireUnits( FolderCollection::ExpireDays );
+  fd->setExpireAction( FolderCollection::ExpireDelete );
+  fd->writeConfig();
+
+  const int trashCount = itemCount( mTrash );
+
+  ExpireJob *job = new ExpireJob( folder, true );
+  QEventLoop loop;
+  connect( job, SIGNAL(finished()), &loop, SLOT(quit()) );
+  job->start();
+
+  // the listing is the only job the expire job has started so far
+  Akonadi::ItemFetchJob *listJob = job->findChild<Akonadi::ItemFetchJob*>();
+  QVERIFY( listJob );
+  connect( listJob, SIGNAL(itemsReceived(Akonadi::Item::List)), SLOT(deleteVanishingMessage()) );
+  loop.exec();
+
+  // the batch with the vanished message failed, the others are still expired
+  QVERIFY( !mVanishing.isValid() );
+  QCOMPARE( itemCount( folder ), 0 );
+  QCOMPARE( itemCount( mTrash ), trashCount + 19 );
+}
+
+#include "expirejobbenchmark.moc"
@@ -0,0 +1,232 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+
+#include <qtest_kde.h>
+
+#include "filterprocesspool.cpp"
+
+#include <kshell.h>
+#include <ktemporaryfile.h>
+
+#include <QtCore/QFile>
+#include <QtCore/QTime>
+
+using namespace MailCommon;
+
+// the number of messages filtered per benchmark run
+static const int MESSAGE_COUNT = 200;
+
+static const QByteArray FILTER_HEADER( "X-Dummy-Filter: passed\n" );
+
+class FilterProcessPoolBenchmark : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void initTestCase();
+    void testProtocol();
+    void testCommandLine();
+    void testOneShotFallback();
+    void testSlowGreeting();
+    void testExitedHelper();
+    void testHelperLimit();
+    void benchmarkOneShot();
+    void benchmarkPool();
+
+  private:
+    QString mFilter;
+    QByteArray mMessage;
+};
+
+QTEST_KDEMAIN( FilterProcessPoolBenchmark, NoGUI )
+
+void FilterProcessPoolBenchmark::initTestCase()
+{
+  mFilter = KShell::quoteArg( QCoreApplication::applicationDirPath() + QLatin1String( "/dummyfilter" ) );
+  QVERIFY( QFile::exists( QCoreApplication::applicationDirPath() + QLatin1String( "/dummyfilter" ) ) );
+
+  mMessage = "From: sender@example.org\n"
+             "To: receiver@example.org\n"
+             "Subject: Filter benchmark\n"
+             "\n";
+  for ( int i = 0; i < 100; ++i )
+    mMessage += "A line of text to give the message a realistic size of a few kilobytes.\n";
+}
+
+void FilterProcessPoolBenchmark::testProtocol()
+{
+  FilterProcessPool pool;
+
+  for ( int i = 0; i < 3; ++i ) {
+    int exitCode = -1;
+    QByteArray output;
+    QCOMPARE( pool.process( mFilter, mMessage, exitCode, output ), FilterProcessPool::Processed );
+    QCOMPARE( exitCode, 0 );
+    QCOMPARE( output, FILTER_HEADER + mMessage );
+    QCOMPARE( pool.helperCount(), 1 );
+  }
+
+  // empty messages are fine as well
+  int exitCode = -1;
+  QByteArray output;
+  QCOMPARE( pool.process( mFilter, QByteArray(), exitCode, output ), FilterProcessPool::Processed );
+  QCOMPARE( output, FILTER_HEADER );
+}
+
+void FilterProcessPoolBenchmark::testCommandLine()
+{
+  QString command;
+  QVERIFY( FilterProcessPool::parseCommandLine( QLatin1String( "%persistent spamfilter --mode=kmail" ), command ) );
+  QCOMPARE( command, QString::fromLatin1( "spamfilter --mode=kmail" ) );
+
+  // commands are only kept running when asked for
+  QVERIFY( !FilterProcessPool::parseCommandLine( QLatin1String( "spamfilter --mode=kmail" ), command ) );
+  QCOMPARE( command, QString::fromLatin1( "spamfilter --mode=kmail" ) );
+}
+
+void FilterProcessPoolBenchmark::testOneShotFallback()
+{
+  FilterProcessPool pool;
+  const QString command = mFilter + QLatin1String( " --one-shot" );
+
+  // a command that doesn't greet is never given the message, the caller
+  // runs it again without the protocol
+  int exitCode = -1;
+  QByteArray output;
+  QCOMPARE( pool.process( command, mMessage, exitCode, output ), FilterProcessPool::NotSupported );
+  QCOMPARE( pool.helperCount(), 0 );
+
+  // and so are the following ones, without trying again
+  QTime timer;
+  timer.start();
+  QCOMPARE( pool.process( command, mMessage, exitCode, output ), FilterProcessPool::NotSupported );
+  QVERIFY( timer.elapsed() < 1000 );
+
+  // commands that exit right away don't make us wait
+  timer.start();
+  QCOMPARE( pool.process( QLatin1String( "exit 3" ), mMessage, exitCode, output ), FilterProcessPool::NotSupported );
+  QVERIFY( timer.elapsed() < 1000 );
+}
+
+void FilterProcessPoolBenchmark::testSlowGreeting()
+{
+  FilterProcessPool pool;
+
+  // A command greeting too late must not have its greeting taken for the
+  // filtered message. It is stopped, so the file is never written.
+  KTemporaryFile marker;
+  QVERIFY( marker.open() );
+  const QString markerFile = marker.fileName();
+  marker.close();
+  QFile::remove( markerFile );
+
+  const QString command = QLatin1String( "sleep 3; echo 'KMAIL-FILTER 1'; touch " ) + KShell::quoteArg( markerFile )
+                        + QLatin1String( "; read size; head -c $size > /dev/null; echo '0 2'; echo ok" );
+  int exitCode = -1;
+  QByteArray output;
+  QCOMPARE( pool.process( command, mMessage, exitCode, output ), FilterProcessPool::NotSupported );
+  QVERIFY( output.isEmpty() );
+  QCOMPARE( pool.helperCount(), 0 );
+
+  QTest::qWait( 2000 );
+  QVERIFY( !QFile::exists( markerFile ) );
+}
+
+void FilterProcessPoolBenchmark::testExitedHelper()
+{
+  FilterProcessPool pool;
+
+  // a helper that exits after its first message is restarted for the next one
+  const QString command = QLatin1String( "echo 'KMAIL-FILTER 1'; read size; head -c $size > /dev/null; echo '0 2'; echo ok" );
+  for ( int i = 0; i < 2; ++i ) {
+    int exitCode = -1;
+    QByteArray output;
+    QCOMPARE( pool.process( command, mMessage, exitCode, output ), FilterProcessPool::Processed );
+    QCOMPARE( output, QByteArray( "ok" ) );
+    QTest::qWait( 100 );
+  }
+
+  // a helper breaking the protocol is stopped
+  int exitCode = -1;
+  QByteArray output;
+  QCOMPARE( pool.process( QLatin1String( "echo 'KMAIL-FILTER 1'; echo garbage" ), mMessage, exitCode, output ),
+            FilterProcessPool::Failed );
+  QCOMPARE( pool.helperCount(), 1 );
+
+  // and so is one answering with a greeting, which is never a filtered message
+  const QString greeting = QLatin1String( "echo 'KMAIL-FILTER 1'; read size; head -c $size > /dev/null; "
+                                          "echo '0 15'; echo 'KMAIL-FILTER 1'" );
+  QCOMPARE( pool.process( greeting, mMessage, exitCode, output ), FilterProcessPool::Failed );
+  QCOMPARE( pool.helperCount(), 1 );
+}
+
+void FilterProcessPoolBenchmark::testHelperLimit()
+{
+  FilterProcessPool pool;
+  pool.setMaximumHelpers( 2 );
+
+  for ( int i = 0; i < 4; ++i ) {
+    int exitCode = -1;
+    QByteArray output;
+    const QString command = mFilter + QLatin1String( " helper" ) + QString::number( i );
+    QCOMPARE( pool.process( command, mMessage, exitCode, output ), FilterProcessPool::Processed );
+    QVERIFY( pool.helperCount() <= 2 );
+  }
+
+  pool.clear();
+  QCOMPARE( pool.helperCount(), 0 );
+}
+
+void FilterProcessPoolBenchmark::benchmarkOneShot()
+{
+  // what the filter actions did for every message before
+  const QString command = mFilter + QLatin1String( " --one-shot" );
+
+  QBENCHMARK_ONCE {
+    for ( int i = 0; i < MESSAGE_COUNT; ++i ) {
+      KTemporaryFile inFile;
+      QVERIFY( inFile.open() );
+      inFile.write( mMessage );
+      inFile.close();
+
+      KProcess shProc;
+      shProc.setOutputChannelMode( KProcess::SeparateChannels );
+      shProc.setShellCommand( QLatin1Char( '(' ) + command + QLatin1String( ") <" ) + inFile.fileName() );
+      QCOMPARE( shProc.execute(), 0 );
+      QCOMPARE( shProc.readAllStandardOutput(), FILTER_HEADER + mMessage );
+    }
+  }
+}
+
+void FilterProcessPoolBenchmark::benchmarkPool()
+{
+  FilterProcessPool pool;
+
+  QBENCHMARK_ONCE {
+    for ( int i = 0; i < MESSAGE_COUNT; ++i ) {
+      int exitCode = -1;
+      QByteArray output;
+      QCOMPARE( pool.process( mFilter, mMessage, exitCode, output ), FilterProcessPool::Processed );
+      QCOMPARE( output, FILTER_HEADER + mMessage );
+    }
+  }
+}
+
+#include "filterprocesspoolbenchmark.moc"
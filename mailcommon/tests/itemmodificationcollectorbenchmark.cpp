@@ -0,0 +1,321 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+
+#include <qtest_kde.h>
+
+#include "itemmodificationcollector.cpp"
+
+using namespace MailCommon;
+
+// the number of messages per simulated filter run
+static const int MESSAGE_COUNT = 5000;
+
+static const QByteArray SEEN_FLAG( "\\SEEN" );
+static const QByteArray FLAGGED_FLAG( "\\FLAGGED" );
+
+// records what would be sent to the server instead of starting jobs
+class RecordingCollector : public ItemModificationCollector
+{
+  public:
+    struct Modify
+    {
+      Akonadi::Item item;
+      bool ignorePayload;
+    };
+
+    struct Copy
+    {
+      Akonadi::Item item;
+      Akonadi::Collection collection;
+      int modifiesBefore;
+    };
+
+    QList<Modify> mModifies;
+    QList<Akonadi::Item::List> mFlagModifies;
+    QList<Copy> mCopies;
+
+  protected:
+    void modifyItem( const Akonadi::Item &item, bool ignorePayload )
+    {
+      Modify modify;
+      modify.item = item;
+      modify.ignorePayload = ignorePayload;
+      mModifies.append( modify );
+    }
+
+    void modifyFlags( const Akonadi::Item::List &items )
+    {
+      mFlagModifies.append( items );
+    }
+
+    void copyItem( const Akonadi::Item &item, const Akonadi::Collection &collection )
+    {
+      Copy copy;
+      copy.item = item;
+      copy.collection = collection;
+      copy.modifiesBefore = mModifies.count();
+      mCopies.append( copy );
+    }
+};
+
+class ItemModificationCollectorBenchmark : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void testMergeChangesToItem();
+    void testFlagsSeenByLaterActions();
+    void testBatchFlagChanges();
+    void testFlushItem();
+    void testUnchangedFlags();
+    void testModifyThenCopy();
+    void testCriticalError();
+    void benchmarkFilterRun();
+
+  private:
+    static Akonadi::Item item( Akonadi::Item::Id id );
+};
+
+QTEST_KDEMAIN( ItemModificationCollectorBenchmark, NoGUI )
+
+Akonadi::Item ItemModificationCollectorBenchmark::item( Akonadi::Item::Id id )
+{
+  Akonadi::Item item( id );
+  item.setRevision( 1 );
+  item.setFlag( "$LABEL1" );
+  return item;
+}
+
+void ItemModificationCollectorBenchmark::testMergeChangesToItem()
+{
+  RecordingCollector collector;
+  const Akonadi::Item item = this->item( 1 );
+
+  // set transport, set status, add header and set status again
+  collector.setPayloadModified( item );
+  collector.setFlags( item, collector.flags( item ) << SEEN_FLAG );
+  collector.setPayloadModified( item );
+  collector.setFlags( item, collector.flags( item ) << FLAGGED_FLAG );
+  QVERIFY( !collector.isEmpty() );
+
+  collector.flush();
+  QVERIFY( collector.isEmpty() );
+  QCOMPARE( collector.jobCount(), 1 );
+  QCOMPARE( collector.mModifies.count(), 1 );
+  QVERIFY( collector.mFlagModifies.isEmpty() );
+
+  const RecordingCollector::Modify modify = collector.mModifies.first();
+  QCOMPARE( modify.item.id(), item.id() );
+  QVERIFY( !modify.ignorePayload );
+  QCOMPARE( modify.item.flags(), Akonadi::Item::Flags() << "$LABEL1" << SEEN_FLAG << FLAGGED_FLAG );
+
+  // attribute changes don't send the payload
+  collector.setAttributesModified( item );
+  collector.flush();
+  QCOMPARE( collector.jobCount(), 2 );
+  QVERIFY( collector.mModifies.last().ignorePayload );
+}
+
+void ItemModificationCollectorBenchmark::testFlagsSeenByLaterActions()
+{
+  RecordingCollector collector;
+  const Akonadi::Item item = this->item( 1 );
+
+  QCOMPARE( collector.flags( item ), item.flags() );
+
+  Akonadi::Item::Flags flags = item.flags();
+  flags.remove( "$LABEL1" );
+  collector.setFlags( item, flags );
+  QCOMPARE( collector.flags( item ), flags );
+  QCOMPARE( collector.flags( this->item( 2 ) ), this->item( 2 ).flags() );
+}
+
+void ItemModificationCollectorBenchmark::testBatchFlagChanges()
+{
+  RecordingCollector collector;
+
+  // 600 messages are marked as read and 300 are marked as read and important
+  for ( int i = 1; i <= 900; ++i ) {
+    const Akonadi::Item item = this->item( i );
+    Akonadi::Item::Flags flags = item.flags() << SEEN_FLAG;
+    if ( i % 3 == 0 )
+      flags << FLAGGED_FLAG;
+    collector.setFlags( item, flags );
+  }
+
+  collector.flush();
+  QVERIFY( collector.mModifies.isEmpty() );
+
+  // 500 + 100 read ones and 300 important ones
+  QCOMPARE( collector.jobCount(), 3 );
+  QCOMPARE( collector.mFlagModifies.count(), 3 );
+
+  int count = 0;
+  foreach ( const Akonadi::Item::List &items, collector.mFlagModifies ) {
+    count += items.count();
+    const bool flagged = ( items.first().id() % 3 == 0 );
+    foreach ( const Akonadi::Item &item, items ) {
+      QCOMPARE( item.id() % 3 == 0, flagged );
+      QCOMPARE( item.revision(), 1 );
+      QVERIFY( !item.hasPayload() );
+    }
+  }
+  QCOMPARE( count, 900 );
+}
+
+void ItemModificationCollectorBenchmark::testFlushItem()
+{
+  RecordingCollector collector;
+  const Akonadi::Item first = item( 1 );
+  const Akonadi::Item second = item( 2 );
+
+  collector.setPayloadModified( first );
+  collector.setFlags( second, second.flags() << SEEN_FLAG );
+
+  // what the filter manager does before moving the item
+  collector.flush( second );
+  QCOMPARE( collector.jobCount(), 1 );
+  QCOMPARE( collector.mModifies.count(), 1 );
+  QCOMPARE( collector.mModifies.first().item.id(), second.id() );
+  QVERIFY( collector.mModifies.first().ignorePayload );
+
+  collector.flush( second );
+  QCOMPARE( collector.jobCount(), 1 );
+
+  collector.flush();
+  QCOMPARE( collector.jobCount(), 2 );
+  QCOMPARE( collector.mModifies.last().item.id(), first.id() );
+}
+
+void ItemModificationCollectorBenchmark::testUnchangedFlags()
+{
+  RecordingCollector collector;
+  const Akonadi::Item item = this->item( 1 );
+
+  // marking a read message as read again
+  collector.setFlags( item, item.flags() );
+  collector.flush( item );
+  collector.setFlags( item, item.flags() );
+  collector.flush();
+
+  QCOMPARE( collector.jobCount(), 0 );
+}
+
+void ItemModificationCollectorBenchmark::testModifyThenCopy()
+{
+  RecordingCollector collector;
+  const Akonadi::Item item = this->item( 1 );
+  const Akonadi::Item other = this->item( 2 );
+  const Akonadi::Collection folder( 42 );
+
+  // set status, add header, then copy into folder
+  collector.setFlags( item, collector.flags( item ) << SEEN_FLAG );
+  collector.setPayloadModified( item );
+  collector.setFlags( other, other.flags() << SEEN_FLAG );
+  collector.copy( item, folder );
+
+  // the changes are stored before the copy is made
+  QCOMPARE( collector.mCopies.count(), 1 );
+  QCOMPARE( collector.mCopies.first().item.id(), item.id() );
+  QCOMPARE( collector.mCopies.first().collection.id(), folder.id() );
+  QCOMPARE( collector.mCopies.first().modifiesBefore, 1 );
+  QCOMPARE( collector.mModifies.first().item.id(), item.id() );
+  QVERIFY( !collector.mModifies.first().ignorePayload );
+  QCOMPARE( collector.mModifies.first().item.flags(), Akonadi::Item::Flags() << "$LABEL1" << SEEN_FLAG );
+
+  // and the changes to other items are still collected
+  QVERIFY( !collector.isEmpty() );
+  collector.flush();
+  QCOMPARE( collector.mFlagModifies.count(), 1 );
+  QCOMPARE( collector.mFlagModifies.first().first().id(), other.id() );
+
+  // copying an unchanged item stores nothing
+  collector.copy( item, folder );
+  QCOMPARE( collector.mCopies.count(), 2 );
+  QCOMPARE( collector.jobCount(), 2 );
+}
+
+void ItemModificationCollectorBenchmark::testCriticalError()
+{
+  RecordingCollector collector;
+  const Akonadi::Item failed = item( 1 );
+  const Akonadi::Item moved = item( 2 );
+
+  // set status and add header, then the next action fails critically
+  collector.setFlags( failed, collector.flags( failed ) << SEEN_FLAG );
+  collector.setPayloadModified( failed );
+
+  // what the filter manager does before giving up on the item
+  collector.flush( failed );
+  QCOMPARE( collector.jobCount(), 1 );
+  QVERIFY( collector.isEmpty() );
+  QCOMPARE( collector.mModifies.first().item.id(), failed.id() );
+  QCOMPARE( collector.mModifies.first().item.flags(), Akonadi::Item::Flags() << "$LABEL1" << SEEN_FLAG );
+
+  // the next item is filtered and moved, its changes are stored on their own
+  collector.setPayloadModified( moved );
+  collector.flush( moved );
+  QCOMPARE( collector.jobCount(), 2 );
+  QCOMPARE( collector.mModifies.count(), 2 );
+  QCOMPARE( collector.mModifies.last().item.id(), moved.id() );
+  QVERIFY( collector.mFlagModifies.isEmpty() );
+
+  collector.flush();
+  QCOMPARE( collector.jobCount(), 2 );
+}
+
+void ItemModificationCollectorBenchmark::benchmarkFilterRun()
+{
+  // A filter marking all messages as read and every tenth one as important,
+  // and a filter setting the transport of every fifth message. The filter
+  // actions used to start a job each.
+  int jobsBefore = 0;
+  int jobsNow = 0;
+
+  QBENCHMARK_ONCE {
+    RecordingCollector collector;
+    for ( int i = 1; i <= MESSAGE_COUNT; ++i ) {
+      const Akonadi::Item item = this->item( i );
+
+      collector.setFlags( item, collector.flags( item ) << SEEN_FLAG );
+      ++jobsBefore;
+
+      if ( i % 10 == 0 ) {
+        collector.setFlags( item, collector.flags( item ) << FLAGGED_FLAG );
+        ++jobsBefore;
+      }
+
+      if ( i % 5 == 0 ) {
+        collector.setPayloadModified( item );
+        ++jobsBefore;
+      }
+    }
+
+    collector.flush();
+    jobsNow = collector.jobCount();
+  }
+
+  // one job per message with a new transport, plus the batched flag changes
+  QCOMPARE( jobsBefore, MESSAGE_COUNT + MESSAGE_COUNT / 10 + MESSAGE_COUNT / 5 );
+  QCOMPARE( jobsNow, MESSAGE_COUNT / 5 + ( MESSAGE_COUNT - MESSAGE_COUNT / 5 + 499 ) / 500 );
+  qDebug() << "Modify jobs for" << MESSAGE_COUNT << "messages:" << jobsBefore << "before," << jobsNow << "now";
+}
+
+#include "itemmodificationcollectorbenchmark.moc"
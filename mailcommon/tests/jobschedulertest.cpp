@@ -0,0 +1,351 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+
+#include <qtest_kde.h>
+
+#include "jobscheduler.cpp"
+#include "folderjob.cpp"
+
+using namespace MailCommon;
+
+class TestJob;
+
+// the jobs that have been started and did not finish yet
+static QList<TestJob*> s_runningJobs;
+
+class TestJob : public ScheduledJob
+{
+  public:
+    TestJob( const Akonadi::Collection &folder, bool immediate )
+      : ScheduledJob( folder, immediate )
+    {
+    }
+
+    ~TestJob()
+    {
+      s_runningJobs.removeAll( this );
+    }
+
+    Akonadi::Collection folder() const
+    {
+      return mSrcFolder;
+    }
+
+  protected:
+    void execute()
+    {
+      s_runningJobs.append( this );
+    }
+};
+
+class TestTask : public ScheduledTask
+{
+  public:
+    TestTask( const Akonadi::Collection &folder, bool immediate, int priority = 0, int typeId = 1 )
+      : ScheduledTask( folder, immediate ), mPriority( priority ), mTypeId( typeId )
+    {
+    }
+
+    ScheduledJob *run()
+    {
+      return new TestJob( folder(), isImmediate() );
+    }
+
+    int taskTypeId() const
+    {
+      return mTypeId;
+    }
+
+    int priority() const
+    {
+      return mPriority;
+    }
+
+  private:
+    int mPriority;
+    int mTypeId;
+};
+
+/**
+ * A scheduler whose clock only moves when the test says so.
+ */
+class FakeClockScheduler : public JobScheduler
+{
+  Q_OBJECT
+
+  public:
+    FakeClockScheduler()
+      : JobScheduler( 0 ), mNow( 1000000 )
+    {
+    }
+
+    /// Moves the clock forward and lets the scheduler look at its tasks, like its timer would.
+    void advance( qint64 milliSeconds )
+    {
+      mNow += milliSeconds;
+      QMetaObject::invokeMethod( this, "slotRunNextJob" );
+    }
+
+  protected:
+    qint64 currentTime() const
+    {
+      return mNow;
+    }
+
+  private:
+    qint64 mNow;
+};
+
+class JobSchedulerTest : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testImmediateTasks();
+    void testStartDelay();
+    void testPriorities();
+    void testResourceLimit();
+    void testDuplicates();
+    void testIdleBudget();
+    void testOpeningFolder();
+    void testPause();
+
+  private:
+    static Akonadi::Collection folder( Akonadi::Collection::Id id, const QString &resource = QString( "resource" ) );
+    static QList<Akonadi::Collection::Id> runningFolders();
+    static void finish( Akonadi::Collection::Id id );
+
+    FakeClockScheduler *mScheduler;
+};
+
+QTEST_KDEMAIN( JobSchedulerTest, NoGUI )
+
+// the time background tasks wait after having been registered with an idle scheduler
+static const qint64 START_DELAY = 60000;
+
+Akonadi::Collection JobSchedulerTest::folder( Akonadi::Collection::Id id, const QString &resource )
+{
+  Akonadi::Collection collection( id );
+  collection.setResource( resource );
+  return collection;
+}
+
+QList<Akonadi::Collection::Id> JobSchedulerTest::runningFolders()
+{
+  QList<Akonadi::Collection::Id> ids;
+  foreach ( TestJob *job, s_runningJobs )
+    ids.append( job->folder().id() );
+  qSort( ids );
+  return ids;
+}
+
+void JobSchedulerTest::finish( Akonadi::Collection::Id id )
+{
+  foreach ( TestJob *job, s_runningJobs ) {
+    if ( job->folder().id() == id ) {
+      delete job;
+      return;
+    }
+  }
+  QFAIL( "no such job" );
+}
+
+void JobSchedulerTest::init()
+{
+  mScheduler = new FakeClockScheduler;
+}
+
+void JobSchedulerTest::cleanup()
+{
+  delete mScheduler;
+  QVERIFY( s_runningJobs.isEmpty() );
+}
+
+void JobSchedulerTest::testImmediateTasks()
+{
+  mScheduler->registerTask( new TestTask( folder( 1 ), true ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 );
+
+  finish( 1 );
+  QVERIFY( s_runningJobs.isEmpty() );
+}
+
+void JobSchedulerTest::testStartDelay()
+{
+  mScheduler->registerTask( new TestTask( folder( 1 ), false ) );
+  QVERIFY( s_runningJobs.isEmpty() );
+
+  mScheduler->advance( START_DELAY - 1 );
+  QVERIFY( s_runningJobs.isEmpty() );
+
+  mScheduler->advance( 1 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 );
+
+  // immediate tasks don't wait
+  mScheduler->registerTask( new TestTask( folder( 2, "other" ), true ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 << 2 );
+}
+
+void JobSchedulerTest::testPriorities()
+{
+  mScheduler->setMaximumRunningJobs( 1 );
+  mScheduler->registerTask( new TestTask( folder( 1 ), false, 0 ) );
+  mScheduler->registerTask( new TestTask( folder( 2 ), false, 5 ) );
+  mScheduler->registerTask( new TestTask( folder( 3 ), false, 1 ) );
+  mScheduler->registerTask( new TestTask( folder( 4 ), false, 1 ) );
+
+  mScheduler->advance( START_DELAY );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 );
+
+  // jobs without run time don't make the next one wait
+  finish( 2 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 3 );
+  finish( 3 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 4 );
+
+  // immediate tasks go first, whatever their priority
+  mScheduler->registerTask( new TestTask( folder( 5 ), true, -10 ) );
+  finish( 4 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 5 );
+  finish( 5 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 );
+}
+
+void JobSchedulerTest::testResourceLimit()
+{
+  mScheduler->registerTask( new TestTask( folder( 1, "a" ), true ) );
+  mScheduler->registerTask( new TestTask( folder( 2, "a" ), true ) );
+  mScheduler->registerTask( new TestTask( folder( 3, "b" ), true ) );
+  mScheduler->registerTask( new TestTask( folder( 4, "c" ), true ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 << 3 << 4 );
+
+  finish( 1 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 << 3 << 4 );
+
+  // and the total is limited as well
+  mScheduler->setMaximumRunningJobs( 3 );
+  mScheduler->registerTask( new TestTask( folder( 5, "d" ), true ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 << 3 << 4 );
+  finish( 3 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 << 4 << 5 );
+
+  mScheduler->setMaximumRunningJobsPerResource( 2 );
+  mScheduler->registerTask( new TestTask( folder( 6, "a" ), true ) );
+  finish( 5 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 << 4 << 6 );
+}
+
+void JobSchedulerTest::testDuplicates()
+{
+  mScheduler->setMaximumRunningJobsPerResource( 4 );
+  mScheduler->registerTask( new TestTask( folder( 1 ), false ) );
+  mScheduler->registerTask( new TestTask( folder( 1 ), false ) );
+  // a different kind of task for the same folder is kept
+  mScheduler->registerTask( new TestTask( folder( 1 ), false, 0, 2 ) );
+  // tasks without a type are never merged
+  mScheduler->registerTask( new TestTask( folder( 2 ), false, 0, 0 ) );
+  mScheduler->registerTask( new TestTask( folder( 2 ), false, 0, 0 ) );
+
+  mScheduler->advance( START_DELAY );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 << 1 << 2 << 2 );
+  finish( 1 );
+  finish( 1 );
+  finish( 2 );
+  finish( 2 );
+
+  // asking for a scheduled task to be run immediately runs it once, right away
+  mScheduler->registerTask( new TestTask( folder( 3 ), false ) );
+  mScheduler->registerTask( new TestTask( folder( 3 ), true ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 3 );
+  finish( 3 );
+  mScheduler->advance( START_DELAY );
+  QVERIFY( s_runningJobs.isEmpty() );
+}
+
+void JobSchedulerTest::testIdleBudget()
+{
+  mScheduler->setMaximumRunningJobs( 1 );
+  mScheduler->setBackgroundShare( 25 );
+  mScheduler->registerTask( new TestTask( folder( 1, "a" ), false ) );
+  mScheduler->registerTask( new TestTask( folder( 2, "b" ), false ) );
+  mScheduler->registerTask( new TestTask( folder( 3, "c" ), true ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 3 );
+
+  // immediate jobs don't use up the budget
+  mScheduler->advance( START_DELAY );
+  finish( 3 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 );
+
+  // a job running for 10 seconds makes the next one wait for 30 seconds
+  mScheduler->advance( 10000 );
+  finish( 1 );
+  QVERIFY( s_runningJobs.isEmpty() );
+  mScheduler->advance( 29999 );
+  QVERIFY( s_runningJobs.isEmpty() );
+  mScheduler->advance( 1 );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 );
+}
+
+void JobSchedulerTest::testOpeningFolder()
+{
+  mScheduler->registerTask( new TestTask( folder( 1, "a" ), false ) );
+  mScheduler->registerTask( new TestTask( folder( 2, "b" ), false ) );
+  mScheduler->advance( START_DELAY );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 << 2 );
+
+  // the job is killed and its task is scheduled again
+  mScheduler->notifyOpeningFolder( folder( 1, "a" ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 );
+
+  // jobs that are not cancellable are left alone
+  s_runningJobs.first()->setCancellable( false );
+  mScheduler->notifyOpeningFolder( folder( 2, "b" ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 );
+
+  // the interrupted task waits before it is run again
+  finish( 2 );
+  QVERIFY( s_runningJobs.isEmpty() );
+  mScheduler->advance( START_DELAY );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 );
+}
+
+void JobSchedulerTest::testPause()
+{
+  mScheduler->registerTask( new TestTask( folder( 1, "a" ), false ) );
+  mScheduler->advance( START_DELAY );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 );
+
+  // running background jobs are interrupted, immediate tasks still run
+  mScheduler->pause();
+  QVERIFY( s_runningJobs.isEmpty() );
+  mScheduler->registerTask( new TestTask( folder( 2, "b" ), true ) );
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 2 );
+  finish( 2 );
+
+  mScheduler->advance( 10 * START_DELAY );
+  QVERIFY( s_runningJobs.isEmpty() );
+
+  mScheduler->resume();
+  QCOMPARE( runningFolders(), QList<Akonadi::Collection::Id>() << 1 );
+}
+
+#include "jobschedulertest.moc"
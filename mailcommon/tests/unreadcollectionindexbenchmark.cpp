@@ -0,0 +1,175 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+
+#include <qtest_kde.h>
+
+#include "unreadcollectionindex.cpp"
+
+#include <QtGui/QStandardItemModel>
+
+using namespace MailCommon;
+
+// 4 + 16 + ... + 4096 = 5460 folders
+static const int TREE_WIDTH = 4;
+static const int TREE_DEPTH = 6;
+
+// one folder out of this many has unread messages
+static const int UNREAD_SPACING = 97;
+
+class UnreadCollectionIndexBenchmark : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void benchmarkTreeWalk();
+    void benchmarkIndex();
+    void benchmarkStatisticsChanged();
+
+  private:
+    void addFolders( QStandardItem *parent, int depth );
+    static bool isUnread( const QModelIndex &index );
+    QModelIndex indexBelow( const QModelIndex &current ) const;
+
+    QStandardItemModel *mModel;
+    QList<QStandardItem*> mFolders;
+    int mUnreadCount;
+};
+
+QTEST_KDEMAIN( UnreadCollectionIndexBenchmark, NoGUI )
+
+void UnreadCollectionIndexBenchmark::addFolders( QStandardItem *parent, int depth )
+{
+  if ( depth == TREE_DEPTH )
+    return;
+
+  for ( int i = 0; i < TREE_WIDTH; ++i ) {
+    const int number = mFolders.count();
+
+    Akonadi::Collection collection( number + 1 );
+    collection.setName( QString::number( number ) );
+    if ( number % UNREAD_SPACING == UNREAD_SPACING - 1 ) {
+      Akonadi::CollectionStatistics statistics;
+      statistics.setUnreadCount( 1 );
+      collection.setStatistics( statistics );
+      ++mUnreadCount;
+    }
+
+    QStandardItem *item = new QStandardItem( collection.name() );
+    item->setData( QVariant::fromValue( collection ), Akonadi::EntityTreeModel::CollectionRole );
+    mFolders.append( item );
+
+    addFolders( item, depth + 1 );
+    parent->appendRow( item );
+  }
+}
+
+void UnreadCollectionIndexBenchmark::initTestCase()
+{
+  mModel = new QStandardItemModel;
+  mUnreadCount = 0;
+  addFolders( mModel->invisibleRootItem(), 0 );
+  QCOMPARE( mFolders.count(), 5460 );
+}
+
+void UnreadCollectionIndexBenchmark::cleanupTestCase()
+{
+  delete mModel;
+}
+
+bool UnreadCollectionIndexBenchmark::isUnread( const QModelIndex &index )
+{
+  const Akonadi::Collection collection = index.data( Akonadi::EntityTreeModel::CollectionRole ).value<Akonadi::Collection>();
+  return collection.statistics().unreadCount() > 0;
+}
+
+// how Util::nextUnreadCollection() used to step through the tree
+QModelIndex UnreadCollectionIndexBenchmark::indexBelow( const QModelIndex &current ) const
+{
+  if ( mModel->rowCount( current ) > 0 )
+    return mModel->index( 0, 0, current );
+
+  QModelIndex index = current;
+  while ( index.isValid() ) {
+    const QModelIndex sibling = index.sibling( index.row() + 1, 0 );
+    if ( sibling.isValid() )
+      return sibling;
+    index = index.parent();
+  }
+
+  return QModelIndex();
+}
+
+void UnreadCollectionIndexBenchmark::benchmarkTreeWalk()
+{
+  int found = 0;
+  QBENCHMARK {
+    found = 0;
+    for ( QModelIndex index = indexBelow( QModelIndex() ); index.isValid(); index = indexBelow( index ) ) {
+      if ( isUnread( index ) )
+        ++found;
+    }
+  }
+
+  QCOMPARE( found, mUnreadCount );
+}
+
+void UnreadCollectionIndexBenchmark::benchmarkIndex()
+{
+  UnreadCollectionIndex *unreadCollections = UnreadCollectionIndex::forModel( mModel );
+  QCOMPARE( unreadCollections->count(), mUnreadCount );
+
+  int found = 0;
+  QBENCHMARK {
+    found = 0;
+    for ( QModelIndex index = unreadCollections->next( QModelIndex(), Util::ForwardSearch ); index.isValid();
+          index = unreadCollections->next( index, Util::ForwardSearch ) )
+      ++found;
+  }
+
+  QCOMPARE( found, mUnreadCount );
+}
+
+void UnreadCollectionIndexBenchmark::benchmarkStatisticsChanged()
+{
+  // what keeping the index up to date costs: mark some folders as read and unread again
+  UnreadCollectionIndex *unreadCollections = UnreadCollectionIndex::forModel( mModel );
+
+  QBENCHMARK {
+    for ( int i = 0; i < mFolders.count(); i += 7 ) {
+      QStandardItem *item = mFolders.at( i );
+      Akonadi::Collection collection = item->data( Akonadi::EntityTreeModel::CollectionRole ).value<Akonadi::Collection>();
+      const Akonadi::CollectionStatistics original = collection.statistics();
+
+      Akonadi::CollectionStatistics statistics;
+      statistics.setUnreadCount( 1 - original.unreadCount() );
+      collection.setStatistics( statistics );
+      item->setData( QVariant::fromValue( collection ), Akonadi::EntityTreeModel::CollectionRole );
+
+      collection.setStatistics( original );
+      item->setData( QVariant::fromValue( collection ), Akonadi::EntityTreeModel::CollectionRole );
+    }
+  }
+
+  QCOMPARE( unreadCollections->count(), mUnreadCount );
+}
+
+#include "unreadcollectionindexbenchmark.moc"
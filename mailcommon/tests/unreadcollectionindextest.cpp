@@ -0,0 +1,244 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+
+#include <qtest_kde.h>
+
+#include "unreadcollectionindex.cpp"
+
+#include <QtGui/QStandardItemModel>
+
+using namespace MailCommon;
+
+class UnreadCollectionIndexTest : public QObject
+{
+  Q_OBJECT
+
+  private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testInitialTree();
+    void testNeighbours();
+    void testStatisticsChanged();
+    void testRowsInserted();
+    void testRowsRemoved();
+    void testLayoutChanged();
+    void testMatchesTreeWalk();
+
+  private:
+    static QStandardItem *folder( const QString &name, qint64 unreadCount );
+    static void setUnreadCount( QStandardItem *item, qint64 unreadCount );
+    QStringList indexedNames( Util::SearchDirection direction ) const;
+    QStringList walkedNames( const QModelIndex &parent = QModelIndex() ) const;
+    QStandardItem *item( const QString &name ) const;
+
+    QStandardItemModel *mModel;
+    UnreadCollectionIndex *mIndex;
+};
+
+QTEST_KDEMAIN( UnreadCollectionIndexTest, NoGUI )
+
+QStandardItem *UnreadCollectionIndexTest::folder( const QString &name, qint64 unreadCount )
+{
+  static Akonadi::Collection::Id nextId = 1;
+
+  QStandardItem *item = new QStandardItem( name );
+  Akonadi::Collection collection( nextId++ );
+  collection.setName( name );
+  item->setData( QVariant::fromValue( collection ), Akonadi::EntityTreeModel::CollectionRole );
+  setUnreadCount( item, unreadCount );
+
+  return item;
+}
+
+void UnreadCollectionIndexTest::setUnreadCount( QStandardItem *item, qint64 unreadCount )
+{
+  Akonadi::Collection collection = item->data( Akonadi::EntityTreeModel::CollectionRole ).value<Akonadi::Collection>();
+  Akonadi::CollectionStatistics statistics;
+  statistics.setUnreadCount( unreadCount );
+  collection.setStatistics( statistics );
+  item->setData( QVariant::fromValue( collection ), Akonadi::EntityTreeModel::CollectionRole );
+}
+
+QStringList UnreadCollectionIndexTest::indexedNames( Util::SearchDirection direction ) const
+{
+  QStringList names;
+  QModelIndex index = mIndex->next( QModelIndex(), direction );
+  while ( index.isValid() ) {
+    names.append( index.data().toString() );
+    index = mIndex->next( index, direction );
+  }
+
+  return names;
+}
+
+QStringList UnreadCollectionIndexTest::walkedNames( const QModelIndex &parent ) const
+{
+  QStringList names;
+  for ( int row = 0; row < mModel->rowCount( parent ); ++row ) {
+    const QModelIndex index = mModel->index( row, 0, parent );
+    const Akonadi::Collection collection = index.data( Akonadi::EntityTreeModel::CollectionRole ).value<Akonadi::Collection>();
+    if ( collection.statistics().unreadCount() > 0 )
+      names.append( index.data().toString() );
+    names += walkedNames( index );
+  }
+
+  return names;
+}
+
+QStandardItem *UnreadCollectionIndexTest::item( const QString &name ) const
+{
+  const QList<QStandardItem*> items = mModel->findItems( name, Qt::MatchExactly | Qt::MatchRecursive );
+  Q_ASSERT( items.count() == 1 );
+  return items.first();
+}
+
+void UnreadCollectionIndexTest::init()
+{
+  // inbox
+  //   a (2)
+  //     a1
+  //     a2 (1)
+  //   b
+  // outbox (3)
+  // trash
+  //   t1 (5)
+  mModel = new QStandardItemModel;
+
+  QStandardItem *inbox = folder( "inbox", 0 );
+  QStandardItem *a = folder( "a", 2 );
+  a->appendRow( folder( "a1", 0 ) );
+  a->appendRow( folder( "a2", 1 ) );
+  inbox->appendRow( a );
+  inbox->appendRow( folder( "b", 0 ) );
+  mModel->appendRow( inbox );
+
+  mModel->appendRow( folder( "outbox", 3 ) );
+
+  QStandardItem *trash = folder( "trash", 0 );
+  trash->appendRow( folder( "t1", 5 ) );
+  mModel->appendRow( trash );
+
+  mIndex = UnreadCollectionIndex::forModel( mModel );
+}
+
+void UnreadCollectionIndexTest::cleanup()
+{
+  // deletes the index as well
+  delete mModel;
+}
+
+void UnreadCollectionIndexTest::testInitialTree()
+{
+  QCOMPARE( mIndex->count(), 4 );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), QStringList() << "a" << "a2" << "outbox" << "t1" );
+  QCOMPARE( indexedNames( Util::BackwardSearch ), QStringList() << "t1" << "outbox" << "a2" << "a" );
+
+  // only one index per model
+  QCOMPARE( UnreadCollectionIndex::forModel( mModel ), mIndex );
+}
+
+void UnreadCollectionIndexTest::testNeighbours()
+{
+  // searching from folders that are not in the index
+  QCOMPARE( mIndex->next( item( "b" )->index(), Util::ForwardSearch ).data().toString(), QString( "outbox" ) );
+  QCOMPARE( mIndex->next( item( "b" )->index(), Util::BackwardSearch ).data().toString(), QString( "a2" ) );
+  QCOMPARE( mIndex->next( item( "inbox" )->index(), Util::ForwardSearch ).data().toString(), QString( "a" ) );
+  QVERIFY( !mIndex->next( item( "inbox" )->index(), Util::BackwardSearch ).isValid() );
+
+  // children come right after their parent
+  QCOMPARE( mIndex->next( item( "a" )->index(), Util::ForwardSearch ).data().toString(), QString( "a2" ) );
+  QCOMPARE( mIndex->next( item( "a2" )->index(), Util::BackwardSearch ).data().toString(), QString( "a" ) );
+  QVERIFY( !mIndex->next( item( "t1" )->index(), Util::ForwardSearch ).isValid() );
+}
+
+void UnreadCollectionIndexTest::testStatisticsChanged()
+{
+  setUnreadCount( item( "b" ), 4 );
+  setUnreadCount( item( "a" ), 0 );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), QStringList() << "a2" << "b" << "outbox" << "t1" );
+
+  // a changed unread count keeps the folder where it is
+  setUnreadCount( item( "b" ), 7 );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), QStringList() << "a2" << "b" << "outbox" << "t1" );
+
+  setUnreadCount( item( "t1" ), 0 );
+  setUnreadCount( item( "outbox" ), 0 );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), QStringList() << "a2" << "b" );
+}
+
+void UnreadCollectionIndexTest::testRowsInserted()
+{
+  // a whole subtree appears at once
+  QStandardItem *b1 = folder( "b1", 1 );
+  b1->appendRow( folder( "b11", 0 ) );
+  b1->appendRow( folder( "b12", 2 ) );
+  item( "b" )->appendRow( b1 );
+
+  mModel->insertRow( 0, folder( "drafts", 1 ) );
+
+  QCOMPARE( indexedNames( Util::ForwardSearch ), QStringList() << "drafts" << "a" << "a2" << "b1" << "b12" << "outbox" << "t1" );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), walkedNames() );
+}
+
+void UnreadCollectionIndexTest::testRowsRemoved()
+{
+  mModel->removeRow( 0 );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), QStringList() << "outbox" << "t1" );
+
+  item( "trash" )->removeRow( 0 );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), QStringList() << "outbox" );
+  QCOMPARE( mIndex->count(), 1 );
+}
+
+void UnreadCollectionIndexTest::testLayoutChanged()
+{
+  mModel->sort( 0, Qt::DescendingOrder );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), QStringList() << "t1" << "outbox" << "a" << "a2" );
+  QCOMPARE( indexedNames( Util::ForwardSearch ), walkedNames() );
+}
+
+void UnreadCollectionIndexTest::testMatchesTreeWalk()
+{
+  qsrand( 42 );
+
+  // a random tree of some depth, with random changes afterwards
+  QList<QStandardItem*> items;
+  items.append( mModel->invisibleRootItem() );
+  for ( int i = 0; i < 500; ++i ) {
+    QStandardItem *parent = items.at( qrand() % items.count() );
+    QStandardItem *child = folder( QString( "folder%1" ).arg( i ), ( qrand() % 4 == 0 ) ? 1 : 0 );
+    parent->insertRow( qrand() % ( parent->rowCount() + 1 ), child );
+    items.append( child );
+  }
+  QCOMPARE( indexedNames( Util::ForwardSearch ), walkedNames() );
+
+  for ( int i = 0; i < 200; ++i ) {
+    QStandardItem *changed = items.at( 1 + qrand() % ( items.count() - 1 ) );
+    setUnreadCount( changed, qrand() % 2 );
+  }
+  QCOMPARE( indexedNames( Util::ForwardSearch ), walkedNames() );
+
+  QStringList backward;
+  foreach ( const QString &name, walkedNames() )
+    backward.prepend( name );
+  QCOMPARE( indexedNames( Util::BackwardSearch ), backward );
+}
+
+#include "unreadcollectionindextest.moc"
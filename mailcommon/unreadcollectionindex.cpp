@@ -0,0 +1,198 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+#include "unreadcollectionindex_p.h"
+
+#include <akonadi/collection.h>
+#include <akonadi/collectionstatistics.h>
+#include <akonadi/entitytreemodel.h>
+
+#include <QtCore/QAbstractItemModel>
+#include <QtCore/QVector>
+#include <QtCore/QtAlgorithms>
+
+using namespace MailCommon;
+
+UnreadCollectionIndex::UnreadCollectionIndex( QAbstractItemModel *model )
+  : QObject( model ), mModel( model )
+{
+  connect( model, SIGNAL( rowsInserted( const QModelIndex&, int, int ) ),
+           SLOT( slotRowsInserted( const QModelIndex&, int, int ) ) );
+  connect( model, SIGNAL( rowsRemoved( const QModelIndex&, int, int ) ),
+           SLOT( slotRowsRemoved() ) );
+  connect( model, SIGNAL( rowsMoved( const QModelIndex&, int, int, const QModelIndex&, int ) ),
+           SLOT( slotLayoutChanged() ) );
+  connect( model, SIGNAL( layoutChanged() ),
+           SLOT( slotLayoutChanged() ) );
+  connect( model, SIGNAL( modelReset() ),
+           SLOT( rebuild() ) );
+  connect( model, SIGNAL( dataChanged( const QModelIndex&, const QModelIndex& ) ),
+           SLOT( slotDataChanged( const QModelIndex&, const QModelIndex& ) ) );
+
+  rebuild();
+}
+
+UnreadCollectionIndex::~UnreadCollectionIndex()
+{
+}
+
+UnreadCollectionIndex *UnreadCollectionIndex::forModel( QAbstractItemModel *model )
+{
+  foreach ( QObject *child, model->children() ) {
+    UnreadCollectionIndex *index = qobject_cast<UnreadCollectionIndex*>( child );
+    if ( index )
+      return index;
+  }
+
+  return new UnreadCollectionIndex( model );
+}
+
+QModelIndex UnreadCollectionIndex::next( const QModelIndex &current, Util::SearchDirection direction ) const
+{
+  if ( direction == Util::ForwardSearch ) {
+    // an invalid index sorts before all others
+    QList<QPersistentModelIndex>::const_iterator it = qUpperBound( mUnread.constBegin(), mUnread.constEnd(), current, lessThan );
+    if ( it == mUnread.constEnd() )
+      return QModelIndex();
+
+    return *it;
+  } else {
+    if ( !current.isValid() )
+      return mUnread.isEmpty() ? QModelIndex() : QModelIndex( mUnread.last() );
+
+    QList<QPersistentModelIndex>::const_iterator it = qLowerBound( mUnread.constBegin(), mUnread.constEnd(), current, lessThan );
+    if ( it == mUnread.constBegin() )
+      return QModelIndex();
+
+    return *( --it );
+  }
+}
+
+int UnreadCollectionIndex::count() const
+{
+  return mUnread.count();
+}
+
+void UnreadCollectionIndex::rebuild()
+{
+  mUnread.clear();
+
+  // collecting walks the tree in order, so there is nothing to sort
+  collect( QModelIndex(), 0, mModel->rowCount() - 1, mUnread );
+}
+
+void UnreadCollectionIndex::slotRowsInserted( const QModelIndex &parent, int first, int last )
+{
+  QList<QPersistentModelIndex> inserted;
+  collect( parent, first, last, inserted );
+
+  foreach ( const QPersistentModelIndex &index, inserted )
+    insert( index );
+}
+
+void UnreadCollectionIndex::slotRowsRemoved()
+{
+  // the removed collections are invalid now, the others keep their order
+  QList<QPersistentModelIndex>::iterator it = mUnread.begin();
+  while ( it != mUnread.end() ) {
+    if ( it->isValid() )
+      ++it;
+    else
+      it = mUnread.erase( it );
+  }
+}
+
+void UnreadCollectionIndex::slotLayoutChanged()
+{
+  slotRowsRemoved();
+  qStableSort( mUnread.begin(), mUnread.end(), lessThan );
+}
+
+void UnreadCollectionIndex::slotDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight )
+{
+  const QModelIndex parent = topLeft.parent();
+  for ( int row = topLeft.row(); row <= bottomRight.row(); ++row ) {
+    const QModelIndex index = mModel->index( row, 0, parent );
+    if ( isUnread( index ) )
+      insert( index );
+    else
+      remove( index );
+  }
+}
+
+bool UnreadCollectionIndex::isUnread( const QModelIndex &index )
+{
+  const Akonadi::Collection collection = index.data( Akonadi::EntityTreeModel::CollectionRole ).value<Akonadi::Collection>();
+
+  return collection.isValid() && collection.statistics().unreadCount() > 0;
+}
+
+// the rows leading from the top of the tree down to index
+static QVector<int> treePosition( const QModelIndex &index )
+{
+  QVector<int> position;
+  for ( QModelIndex i = index; i.isValid(); i = i.parent() )
+    position.prepend( i.row() );
+
+  return position;
+}
+
+bool UnreadCollectionIndex::lessThan( const QModelIndex &left, const QModelIndex &right )
+{
+  if ( left.parent() == right.parent() )
+    return left.row() < right.row();
+
+  // a parent comes before its children, which come before its next sibling
+  const QVector<int> leftPosition = treePosition( left );
+  const QVector<int> rightPosition = treePosition( right );
+  const int depth = qMin( leftPosition.count(), rightPosition.count() );
+  for ( int i = 0; i < depth; ++i ) {
+    if ( leftPosition.at( i ) != rightPosition.at( i ) )
+      return leftPosition.at( i ) < rightPosition.at( i );
+  }
+
+  return leftPosition.count() < rightPosition.count();
+}
+
+void UnreadCollectionIndex::collect( const QModelIndex &parent, int first, int last, QList<QPersistentModelIndex> &found ) const
+{
+  for ( int row = first; row <= last; ++row ) {
+    const QModelIndex index = mModel->index( row, 0, parent );
+    if ( isUnread( index ) )
+      found.append( index );
+
+    collect( index, 0, mModel->rowCount( index ) - 1, found );
+  }
+}
+
+void UnreadCollectionIndex::insert( const QModelIndex &index )
+{
+  QList<QPersistentModelIndex>::iterator it = qLowerBound( mUnread.begin(), mUnread.end(), index, lessThan );
+  if ( it == mUnread.end() || *it != index )
+    mUnread.insert( it, index );
+}
+
+void UnreadCollectionIndex::remove( const QModelIndex &index )
+{
+  QList<QPersistentModelIndex>::iterator it = qLowerBound( mUnread.begin(), mUnread.end(), index, lessThan );
+  if ( it != mUnread.end() && *it == index )
+    mUnread.erase( it );
+}
+
+#include "unreadcollectionindex_p.moc"
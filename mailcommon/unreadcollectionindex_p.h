@@ -0,0 +1,93 @@
+/*
+    Copyright (c) 2010 the KDE PIM authors
+
+    This library is free software; you can redistribute it and/or modify it
+    under the terms of the GNU Library General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or (at your
+    option) any later version.
+
+    This library is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+    License for more details.
+
+    You should have received a copy of the GNU Library General Public License
+    along with this library; see the file COPYING.LIB.  If not, write to the
+    Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+    02110-1301, USA.
+*/
+
+#ifndef MAILCOMMON_UNREADCOLLECTIONINDEX_P_H
+#define MAILCOMMON_UNREADCOLLECTIONINDEX_P_H
+
+#include "mailutil.h"
+
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QPersistentModelIndex>
+
+class QAbstractItemModel;
+
+namespace MailCommon {
+
+/**
+ * @internal
+ *
+ * Keeps track of the collections of a model that contain unread messages,
+ * in the order a tree view shows them. Looking for the next unread folder
+ * then does not have to walk over all the read folders in between.
+ *
+ * The index follows the changes of the model, including the changes of the
+ * collection statistics, which the model reports via dataChanged().
+ */
+class UnreadCollectionIndex : public QObject
+{
+  Q_OBJECT
+
+  public:
+    /**
+     * Creates an index of the unread collections of @p model, which
+     * becomes the parent of the index.
+     */
+    explicit UnreadCollectionIndex( QAbstractItemModel *model );
+    ~UnreadCollectionIndex();
+
+    /**
+     * Returns the index kept for @p model, creating it if there is none yet.
+     */
+    static UnreadCollectionIndex *forModel( QAbstractItemModel *model );
+
+    /**
+     * Returns the first collection with unread messages that follows
+     * @p current in the given @p direction, or an invalid index if there is
+     * none. An invalid @p current starts the search at the top of the tree
+     * when searching forward, and at its bottom when searching backward.
+     */
+    QModelIndex next( const QModelIndex &current, Util::SearchDirection direction ) const;
+
+    /**
+     * Returns the number of collections with unread messages.
+     */
+    int count() const;
+
+  private Q_SLOTS:
+    void rebuild();
+    void slotRowsInserted( const QModelIndex &parent, int first, int last );
+    void slotRowsRemoved();
+    void slotLayoutChanged();
+    void slotDataChanged( const QModelIndex &topLeft, const QModelIndex &bottomRight );
+
+  private:
+    static bool isUnread( const QModelIndex &index );
+    static bool lessThan( const QModelIndex &left, const QModelIndex &right );
+    void collect( const QModelIndex &parent, int first, int last, QList<QPersistentModelIndex> &found ) const;
+    void insert( const QModelIndex &index );
+    void remove( const QModelIndex &index );
+
+    QAbstractItemModel *mModel;
+    QList<QPersistentModelIndex> mUnread; // in tree order
+};
+
+}
+
+#endif